@@ -0,0 +1,803 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _WIN32
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <dirent.h>
+#include <glob.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "marcrecord/marc_compress.h"
+#include "marcrecord/marc_converter.h"
+#include "marcrecord/marc_stats.h"
+#include "marc_batch.h"
+
+#define ISO2709_RECORD_SEPARATOR	'\x1D'
+#define JSONL_RECORD_SEPARATOR		'\n'
+
+using namespace marcrecord;
+
+// Input file of batch.
+struct BatchFile {
+	// Names of input and output files.
+	std::string inputFileName;
+	std::string outputFileName;
+	// Size of input file.
+	unsigned long long inputSize;
+	// Number of parts of input file.
+	int numParts;
+
+	// Mutex of output and counters.
+	pthread_mutex_t mutex;
+	// Output file (opened when first part is written).
+	FILE *outputFile;
+	// Number of next part written to output file (this part is
+	// converted directly to output file).
+	int nextPart;
+	// Temporary files of converted parts waiting for previous parts.
+	std::map<int, FILE *> pendingParts;
+	// Number of finished parts.
+	int numFinishedParts;
+
+	// Number of converted records.
+	unsigned int numRecords;
+	// Number of skipped invalid records (permissive mode).
+	unsigned int numBadRecords;
+	// Number of written bytes.
+	unsigned long long outputBytes;
+	// Conversion failed flag.
+	bool failed;
+	// Message of first error.
+	std::string errorMessage;
+	// Time of start of first part.
+	unsigned long long startTime;
+};
+typedef struct BatchFile BatchFile;
+
+// Part of input file converted by single task.
+struct BatchTask {
+	// Input file.
+	BatchFile *file;
+	// Number of part.
+	int partNo;
+	// Start and end positions of part in input file.
+	unsigned long long startPos;
+	unsigned long long endPos;
+};
+typedef struct BatchTask BatchTask;
+
+// Worker thread with own queue of tasks.
+struct BatchWorker {
+	// Index of worker.
+	int index;
+	// Thread of worker.
+	pthread_t thread;
+	// Mutex of queue.
+	pthread_mutex_t mutex;
+	// Queue of tasks (owner takes tasks from front, other workers
+	// steal them from back).
+	std::deque<BatchTask> tasks;
+	// Number of executed tasks.
+	unsigned int numTasks;
+	// Number of tasks stolen from other workers.
+	unsigned int numStolenTasks;
+};
+typedef struct BatchWorker BatchWorker;
+
+// Options of running batch.
+static const BatchOptions *batchOptions = NULL;
+// Workers of running batch.
+static std::vector<BatchWorker *> batchWorkers;
+// Mutex of reports.
+static pthread_mutex_t reportMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Add input file or files matched by glob pattern.
+ */
+static bool
+addInputFile(const char *inputArg, std::vector<std::string> &inputFileNames)
+{
+	struct stat inputStat;
+	if (stat(inputArg, &inputStat) == 0) {
+		if (!S_ISDIR(inputStat.st_mode)) {
+			inputFileNames.push_back(inputArg);
+			return true;
+		}
+
+		// Add regular files of directory (hidden files are skipped).
+		DIR *dir = opendir(inputArg);
+		if (dir == NULL) {
+			return false;
+		}
+		std::vector<std::string> dirFileNames;
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL) {
+			if (entry->d_name[0] == '.') {
+				continue;
+			}
+			std::string fileName = std::string(inputArg) + "/"
+				+ entry->d_name;
+			if (stat(fileName.c_str(), &inputStat) == 0
+				&& S_ISREG(inputStat.st_mode))
+			{
+				dirFileNames.push_back(fileName);
+			}
+		}
+		closedir(dir);
+		std::sort(dirFileNames.begin(), dirFileNames.end());
+		inputFileNames.insert(inputFileNames.end(),
+			dirFileNames.begin(), dirFileNames.end());
+		return true;
+	}
+
+	// Expand glob pattern (quoted to avoid argument list limits).
+	if (strpbrk(inputArg, "*?[") == NULL) {
+		return false;
+	}
+	glob_t globResult;
+	if (glob(inputArg, 0, NULL, &globResult) != 0) {
+		return false;
+	}
+	for (size_t i = 0; i < globResult.gl_pathc; i++) {
+		if (stat(globResult.gl_pathv[i], &inputStat) == 0
+			&& S_ISREG(inputStat.st_mode))
+		{
+			inputFileNames.push_back(globResult.gl_pathv[i]);
+		}
+	}
+	globfree(&globResult);
+
+	return true;
+}
+
+/*
+ * Expand input arguments (files, directories and glob patterns) to list
+ * of input files.
+ */
+bool
+expandBatchInputs(const std::vector<const char *> &inputArgs,
+	std::vector<std::string> &inputFileNames)
+{
+	for (size_t i = 0; i < inputArgs.size(); i++) {
+		if (!addInputFile(inputArgs[i], inputFileNames)) {
+			fprintf(stderr, "Error: can't find input files '%s'.\n",
+				inputArgs[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Get default extension of output format.
+ */
+static const char *
+getFormatExtension(const char *formatName)
+{
+	switch (MarcConverter::parseFormat(formatName)) {
+	case MarcConverter::FORMAT_ISO2709:
+		return "iso";
+	case MarcConverter::FORMAT_MARCXML:
+	case MarcConverter::FORMAT_UNIMARCXML:
+		return "xml";
+	case MarcConverter::FORMAT_TEXT:
+		return "txt";
+	case MarcConverter::FORMAT_JSON:
+		return "json";
+	case MarcConverter::FORMAT_JSONL:
+		return "jsonl";
+	default:
+		return "";
+	}
+}
+
+/*
+ * Make name of output file from template (%d: directory, %f: file name,
+ * %b: file name without extension, %n: number of file, %e: extension of
+ * output format).
+ */
+static bool
+makeOutputName(const char *outputTemplate, const std::string &inputFileName,
+	int fileNo, std::string &outputFileName)
+{
+	size_t slashPos = inputFileName.rfind('/');
+	std::string dirName = slashPos == std::string::npos
+		? "." : inputFileName.substr(0, slashPos);
+	std::string fileName = slashPos == std::string::npos
+		? inputFileName : inputFileName.substr(slashPos + 1);
+	size_t dotPos = fileName.rfind('.');
+	std::string baseName = dotPos == std::string::npos || dotPos == 0
+		? fileName : fileName.substr(0, dotPos);
+
+	outputFileName.clear();
+	for (const char *p = outputTemplate; *p != '\0'; p++) {
+		if (*p != '%') {
+			outputFileName.append(1, *p);
+			continue;
+		}
+
+		char numBuf[16];
+		switch (*++p) {
+		case 'd':
+			outputFileName.append(dirName);
+			break;
+		case 'f':
+			outputFileName.append(fileName);
+			break;
+		case 'b':
+			outputFileName.append(baseName);
+			break;
+		case 'n':
+			sprintf(numBuf, "%d", fileNo);
+			outputFileName.append(numBuf);
+			break;
+		case 'e':
+			outputFileName.append(getFormatExtension(
+				batchOptions->outputFormat));
+			break;
+		case '%':
+			outputFileName.append(1, '%');
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Check if input files can be split at record boundaries (parts of
+ * output are concatenated without repeated header and footer).
+ */
+static bool
+isSplittable(void)
+{
+	MarcConverter::RecordFormat inputFormat =
+		MarcConverter::parseFormat(batchOptions->inputFormat);
+	MarcConverter::RecordFormat outputFormat =
+		MarcConverter::parseFormat(batchOptions->outputFormat);
+
+	// Records of text output are numbered, JSON array needs separators
+	// between parts.
+	return (inputFormat == MarcConverter::FORMAT_ISO2709
+		|| inputFormat == MarcConverter::FORMAT_JSONL)
+		&& (outputFormat == MarcConverter::FORMAT_ISO2709
+		|| outputFormat == MarcConverter::FORMAT_MARCXML
+		|| outputFormat == MarcConverter::FORMAT_UNIMARCXML
+		|| outputFormat == MarcConverter::FORMAT_JSONL);
+}
+
+/*
+ * Check if input file is compressed.
+ */
+static bool
+isCompressedFile(FILE *inputFile)
+{
+	MarcCompressedInput compressedInput;
+	compressedInput.open(inputFile);
+	bool compressed = compressedInput.getFormat() != COMPRESSION_NONE;
+	compressedInput.close();
+
+	return compressed;
+}
+
+/*
+ * Split input file to parts at record boundaries (compressed files are
+ * not split).
+ */
+static bool
+splitFile(BatchFile &file, std::vector<BatchTask> &tasks)
+{
+	BatchTask task;
+	task.file = &file;
+	task.partNo = 0;
+	task.startPos = 0;
+	task.endPos = file.inputSize;
+
+	unsigned long long splitSize = batchOptions->splitSize;
+	if (splitSize == 0 || file.inputSize <= splitSize || !isSplittable()) {
+		tasks.push_back(task);
+		file.numParts = 1;
+		return true;
+	}
+
+	FILE *inputFile = fopen(file.inputFileName.c_str(), "rb");
+	if (inputFile == NULL) {
+		return false;
+	}
+	if (isCompressedFile(inputFile)) {
+		fclose(inputFile);
+		tasks.push_back(task);
+		file.numParts = 1;
+		return true;
+	}
+	char separator = MarcConverter::parseFormat(batchOptions->inputFormat)
+		== MarcConverter::FORMAT_ISO2709
+		? ISO2709_RECORD_SEPARATOR : JSONL_RECORD_SEPARATOR;
+	char buf[65536];
+	while (task.startPos < file.inputSize) {
+		// Find end of record after split size.
+		task.endPos = file.inputSize;
+		unsigned long long pos = task.startPos + splitSize - 1;
+		if (pos < file.inputSize
+			&& fseeko(inputFile, (off_t) pos, SEEK_SET) == 0)
+		{
+			size_t readLen;
+			while ((readLen = fread(buf, 1, sizeof(buf),
+				inputFile)) > 0)
+			{
+				const char *end = (const char *) memchr(buf,
+					separator, readLen);
+				if (end != NULL) {
+					task.endPos = pos + (end - buf) + 1;
+					break;
+				}
+				pos += readLen;
+			}
+		}
+
+		tasks.push_back(task);
+		task.partNo++;
+		task.startPos = task.endPos;
+	}
+	fclose(inputFile);
+	file.numParts = task.partNo;
+
+	return true;
+}
+
+/*
+ * Append temporary file of converted part to output file.
+ */
+static bool
+appendPart(FILE *partFile, FILE *outputFile)
+{
+	if (fflush(partFile) != 0 || fseeko(partFile, 0, SEEK_SET) != 0) {
+		return false;
+	}
+
+	char buf[65536];
+	size_t readLen;
+	while ((readLen = fread(buf, 1, sizeof(buf), partFile)) > 0) {
+		if (fwrite(buf, readLen, 1, outputFile) != 1) {
+			return false;
+		}
+	}
+
+	return !ferror(partFile);
+}
+
+/*
+ * Print report of converted file.
+ */
+static void
+reportFile(BatchFile &file)
+{
+	pthread_mutex_lock(&reportMutex);
+	if (file.failed) {
+		fprintf(stderr, "Error in %s: %s.\n", file.inputFileName.c_str(),
+			file.errorMessage.c_str());
+	} else if (batchOptions->verboseLevel > 0) {
+		fprintf(stderr, "%s: %u records (errors: %u), %llu bytes -> "
+			"%s: %llu bytes, %d parts, %.3f s\n",
+			file.inputFileName.c_str(), file.numRecords,
+			file.numBadRecords, file.inputSize,
+			file.outputFileName.c_str(), file.outputBytes,
+			file.numParts,
+			(get_time_ns() - file.startTime) / 1000000000.0);
+	}
+	pthread_mutex_unlock(&reportMutex);
+}
+
+/*
+ * Finish part of file (part converted to temporary file is appended to
+ * output file after previous parts, file is closed after last part).
+ */
+static void
+finishPart(BatchFile &file, int partNo, bool status,
+	const std::string &errorMessage, unsigned int numRecords,
+	unsigned int numBadRecords, FILE *partFile)
+{
+	pthread_mutex_lock(&file.mutex);
+	if (!status && !file.failed) {
+		file.failed = true;
+		file.errorMessage = errorMessage;
+	}
+
+	if (!file.failed) {
+		file.numRecords += numRecords;
+		file.numBadRecords += numBadRecords;
+		if (partFile == NULL) {
+			// Part was converted directly to output file.
+			file.nextPart++;
+		} else {
+			file.pendingParts[partNo] = partFile;
+			partFile = NULL;
+		}
+
+		// Append parts which follow written parts.
+		std::map<int, FILE *>::iterator partIt;
+		while ((partIt = file.pendingParts.find(file.nextPart))
+			!= file.pendingParts.end())
+		{
+			if (file.outputFile == NULL) {
+				file.outputFile = fopen(
+					file.outputFileName.c_str(), "wb");
+			}
+			if (file.outputFile == NULL
+				|| !appendPart(partIt->second, file.outputFile))
+			{
+				file.failed = true;
+				file.errorMessage = "can't write output file";
+				break;
+			}
+			fclose(partIt->second);
+			file.pendingParts.erase(partIt);
+			file.nextPart++;
+		}
+	}
+	if (partFile != NULL) {
+		fclose(partFile);
+	}
+
+	// Close output file after last part (output of failed conversion
+	// is removed).
+	bool finished = ++file.numFinishedParts == file.numParts;
+	if (finished) {
+		if (file.outputFile != NULL) {
+			off_t outputSize = ftello(file.outputFile);
+			if (outputSize >= 0) {
+				file.outputBytes =
+					(unsigned long long) outputSize;
+			}
+			if (fclose(file.outputFile) != 0 && !file.failed) {
+				file.failed = true;
+				file.errorMessage = "can't write output file";
+			}
+			file.outputFile = NULL;
+			if (file.failed) {
+				remove(file.outputFileName.c_str());
+			}
+		}
+		if (file.failed) {
+			// Records of removed output are not counted.
+			file.numRecords = 0;
+			file.numBadRecords = 0;
+			file.outputBytes = 0;
+		}
+		std::map<int, FILE *>::iterator partIt;
+		for (partIt = file.pendingParts.begin();
+			partIt != file.pendingParts.end(); partIt++)
+		{
+			fclose(partIt->second);
+		}
+		file.pendingParts.clear();
+	}
+	pthread_mutex_unlock(&file.mutex);
+
+	if (finished) {
+		reportFile(file);
+	}
+}
+
+/*
+ * Convert part of input file.
+ */
+static void
+runTask(const BatchTask &task, MarcConverter &converter)
+{
+	BatchFile &file = *task.file;
+	std::string errorMessage;
+
+	// Skip parts of failed file. Next part in order is converted
+	// directly to output file, other parts are converted to temporary
+	// files (output file is written by single part at a time).
+	pthread_mutex_lock(&file.mutex);
+	bool status = !file.failed;
+	if (file.startTime == 0) {
+		file.startTime = get_time_ns();
+	}
+	FILE *outputFile = NULL, *partFile = NULL;
+	if (status && task.partNo == file.nextPart) {
+		if (file.outputFile == NULL) {
+			file.outputFile = fopen(file.outputFileName.c_str(),
+				"wb");
+		}
+		outputFile = file.outputFile;
+		if (outputFile == NULL) {
+			errorMessage = "can't open output file";
+			status = false;
+		}
+	} else if (status) {
+		outputFile = partFile = tmpfile();
+		if (outputFile == NULL) {
+			errorMessage = "can't create temporary file";
+			status = false;
+		}
+	}
+	pthread_mutex_unlock(&file.mutex);
+
+	// Read part through decompressing input.
+	FILE *inputFile = NULL;
+	MarcFileInput fileInput;
+	MarcRangeInput rangeInput;
+	MarcCompressedInput compressedInput;
+	if (status) {
+		inputFile = fopen(file.inputFileName.c_str(), "rb");
+		fileInput.open(inputFile);
+		if (inputFile == NULL || !rangeInput.open(&fileInput,
+			task.startPos, task.endPos))
+		{
+			errorMessage = "can't read input file";
+			status = false;
+		} else if (!compressedInput.open(&rangeInput)) {
+			errorMessage = compressedInput.getErrorMessage();
+			status = false;
+		}
+	}
+
+	// Convert records of part.
+	MarcFileOutput fileOutput(outputFile);
+	if (status && !converter.convert(&compressedInput, &fileOutput,
+		task.partNo == 0, task.partNo == file.numParts - 1))
+	{
+		errorMessage = converter.getErrorMessage();
+		status = false;
+	}
+	if (status && compressedInput.isError()) {
+		errorMessage = compressedInput.getErrorMessage();
+		status = false;
+	}
+	compressedInput.close();
+	if (inputFile != NULL) {
+		fclose(inputFile);
+	}
+
+	finishPart(file, task.partNo, status, errorMessage,
+		converter.getNumRecords(), converter.getNumBadRecords(),
+		partFile);
+}
+
+/*
+ * Take task from own queue or steal task from other worker.
+ */
+static bool
+takeTask(BatchWorker &worker, BatchTask &task)
+{
+	pthread_mutex_lock(&worker.mutex);
+	if (!worker.tasks.empty()) {
+		task = worker.tasks.front();
+		worker.tasks.pop_front();
+		pthread_mutex_unlock(&worker.mutex);
+		return true;
+	}
+	pthread_mutex_unlock(&worker.mutex);
+
+	// Steal task from other workers (tasks are not added while batch is
+	// running, so batch is finished when all queues are empty).
+	size_t numWorkers = batchWorkers.size();
+	for (size_t i = 1; i < numWorkers; i++) {
+		BatchWorker &victim = *batchWorkers[(worker.index + i)
+			% numWorkers];
+		pthread_mutex_lock(&victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			pthread_mutex_unlock(&victim.mutex);
+			worker.numStolenTasks++;
+			return true;
+		}
+		pthread_mutex_unlock(&victim.mutex);
+	}
+
+	return false;
+}
+
+/*
+ * Worker thread.
+ */
+static void *
+runWorker(void *arg)
+{
+	BatchWorker &worker = *(BatchWorker *) arg;
+	MarcConverter converter;
+
+	converter.open(batchOptions->inputFormat, batchOptions->outputFormat,
+		batchOptions->inputEncoding, batchOptions->outputEncoding);
+	converter.setPermissiveMode(batchOptions->permissiveRead);
+
+	BatchTask task;
+	while (takeTask(worker, task)) {
+		runTask(task, converter);
+		worker.numTasks++;
+	}
+
+	return NULL;
+}
+
+/*
+ * Compare tasks by size (larger first).
+ */
+static bool
+isLargerTask(const BatchTask &task1, const BatchTask &task2)
+{
+	return task1.endPos - task1.startPos > task2.endPos - task2.startPos;
+}
+
+/*
+ * Convert input files on pool of worker threads (false if conversion of
+ * any file failed).
+ */
+bool
+convertBatch(const BatchOptions &options,
+	const std::vector<std::string> &inputFileNames)
+{
+	batchOptions = &options;
+	unsigned long long startTime = get_time_ns();
+
+	// Check formats and encodings.
+	MarcConverter converter;
+	if (!converter.open(options.inputFormat, options.outputFormat,
+		options.inputEncoding, options.outputEncoding))
+	{
+		fprintf(stderr, "Error: %s.\n",
+			converter.getErrorMessage().c_str());
+		return false;
+	}
+	converter.close();
+
+	// Make names of output files (files must not be overwritten).
+	std::vector<BatchFile> files(inputFileNames.size());
+	std::set<std::string> outputFileNames;
+	for (size_t i = 0; i < files.size(); i++) {
+		BatchFile &file = files[i];
+		file.inputFileName = inputFileNames[i];
+		if (!makeOutputName(options.outputTemplate,
+			file.inputFileName, (int) i + 1, file.outputFileName))
+		{
+			fprintf(stderr, "Error: wrong output file template.\n");
+			return false;
+		}
+		if (!outputFileNames.insert(file.outputFileName).second
+			|| file.outputFileName == file.inputFileName)
+		{
+			fprintf(stderr, "Error: output file name '%s' is "
+				"not unique.\n", file.outputFileName.c_str());
+			return false;
+		}
+	}
+
+	// Split input files to tasks.
+	std::vector<BatchTask> tasks;
+	unsigned long long inputBytes = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		BatchFile &file = files[i];
+		struct stat inputStat;
+		if (stat(file.inputFileName.c_str(), &inputStat) != 0) {
+			fprintf(stderr, "Error: can't open input file '%s'.\n",
+				file.inputFileName.c_str());
+			return false;
+		}
+		file.inputSize = (unsigned long long) inputStat.st_size;
+		if (!splitFile(file, tasks)) {
+			fprintf(stderr, "Error: can't open input file '%s'.\n",
+				file.inputFileName.c_str());
+			return false;
+		}
+		inputBytes += file.inputSize;
+		pthread_mutex_init(&file.mutex, NULL);
+		file.outputFile = NULL;
+		file.nextPart = 0;
+		file.numFinishedParts = 0;
+		file.numRecords = 0;
+		file.numBadRecords = 0;
+		file.outputBytes = 0;
+		file.failed = false;
+		file.startTime = 0;
+	}
+	std::stable_sort(tasks.begin(), tasks.end(), isLargerTask);
+
+	// Deal tasks to workers (largest tasks are started first).
+	int numJobs = std::max(1, std::min(options.numJobs,
+		(int) tasks.size()));
+	batchWorkers.resize(numJobs);
+	for (int i = 0; i < numJobs; i++) {
+		batchWorkers[i] = new BatchWorker();
+		batchWorkers[i]->index = i;
+		batchWorkers[i]->numTasks = 0;
+		batchWorkers[i]->numStolenTasks = 0;
+		pthread_mutex_init(&batchWorkers[i]->mutex, NULL);
+	}
+	for (size_t i = 0; i < tasks.size(); i++) {
+		batchWorkers[i % numJobs]->tasks.push_back(tasks[i]);
+	}
+
+	// Run workers.
+	int numStartedJobs = 0;
+	for (; numStartedJobs < numJobs; numStartedJobs++) {
+		if (pthread_create(&batchWorkers[numStartedJobs]->thread, NULL,
+			runWorker, batchWorkers[numStartedJobs]) != 0)
+		{
+			break;
+		}
+	}
+	if (numStartedJobs == 0) {
+		// Tasks are executed in main thread.
+		runWorker(batchWorkers[0]);
+	}
+	// Wait for all workers before freeing them (running workers steal
+	// tasks from queues of other workers).
+	for (int i = 0; i < numStartedJobs; i++) {
+		pthread_join(batchWorkers[i]->thread, NULL);
+	}
+	unsigned int numStolenTasks = 0;
+	for (int i = 0; i < numJobs; i++) {
+		numStolenTasks += batchWorkers[i]->numStolenTasks;
+		pthread_mutex_destroy(&batchWorkers[i]->mutex);
+		delete batchWorkers[i];
+	}
+	batchWorkers.clear();
+
+	// Print aggregate counters.
+	int numFailedFiles = 0;
+	unsigned int numRecords = 0, numBadRecords = 0;
+	unsigned long long outputBytes = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		numFailedFiles += files[i].failed ? 1 : 0;
+		numRecords += files[i].numRecords;
+		numBadRecords += files[i].numBadRecords;
+		outputBytes += files[i].outputBytes;
+		pthread_mutex_destroy(&files[i].mutex);
+	}
+	if (options.verboseLevel > 0) {
+		fprintf(stderr, "Files: %d (failed: %d)\n",
+			(int) files.size(), numFailedFiles);
+		fprintf(stderr, "Converted records: %u\n", numRecords);
+		fprintf(stderr, "Records with errors: %u\n", numBadRecords);
+		fprintf(stderr, "Input bytes: %llu\n", inputBytes);
+		fprintf(stderr, "Output bytes: %llu\n", outputBytes);
+		fprintf(stderr, "Tasks: %d (stolen: %u), workers: %d\n",
+			(int) tasks.size(), numStolenTasks, numJobs);
+		fprintf(stderr, "Done in %.3f s.\n",
+			(get_time_ns() - startTime) / 1000000000.0);
+	}
+
+	return numFailedFiles == 0;
+}
+
+#endif // _WIN32
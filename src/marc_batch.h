@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARC_BATCH_H
+#define MARC_BATCH_H
+
+#include <string>
+#include <vector>
+
+// Default size of parts of large input files converted in parallel.
+#define BATCH_SPLIT_SIZE	(16 * 1048576)
+
+// Options of batch conversion.
+struct BatchOptions {
+	// Formats of input and output files (format names).
+	const char *inputFormat;
+	const char *outputFormat;
+	// Encodings of input and output files (NULL for UTF-8).
+	const char *inputEncoding;
+	const char *outputEncoding;
+	// Template of output file names.
+	const char *outputTemplate;
+	// Number of worker threads.
+	int numJobs;
+	// Size of parts of large input files (0: files are not split).
+	unsigned long long splitSize;
+	// Permissive reading (errors are corrected, invalid records are
+	// skipped).
+	bool permissiveRead;
+	// Verbosity level.
+	int verboseLevel;
+};
+typedef struct BatchOptions BatchOptions;
+
+// Expand input arguments (files, directories and glob patterns) to list
+// of input files.
+bool expandBatchInputs(const std::vector<const char *> &inputArgs,
+	std::vector<std::string> &inputFileNames);
+// Convert input files on pool of worker threads (false if conversion of
+// any file failed).
+bool convertBatch(const BatchOptions &batchOptions,
+	const std::vector<std::string> &inputFileNames);
+
+#endif // MARC_BATCH_H
@@ -0,0 +1,1092 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+extern "C" {
+#include <getopt.h>
+}
+#include <iconv.h>
+#include <sys/time.h>
+#include "marcrecord/marc_reader.h"
+#include "marcrecord/marc_writer.h"
+#include "marcrecord/marciso_reader.h"
+#include "marcrecord/marciso_writer.h"
+#include "marcrecord/marcrecord.h"
+#include "marcrecord/marcrecord_tools.h"
+#include "marcrecord/marcxml_reader.h"
+#include "marcrecord/marcxml_writer.h"
+
+using namespace marcrecord;
+
+// Application options structure.
+struct Options {
+	int numRecords;
+	unsigned int seed;
+	int minFields;
+	int maxFields;
+	int maxSubfieldLength;
+	int oversizedInterval;
+	int cyrillicPercent;
+	bool marc21;
+	int numIterations;
+	double tolerance;
+	const char *benchName;
+	const char *baselineFileName;
+	const char *saveBaselineFileName;
+	const char *corpusFileName;
+};
+typedef struct Options Options;
+
+// Result of benchmark.
+struct BenchResult {
+	std::string name;
+	double recordsPerSecond;
+	double megabytesPerSecond;
+	double allocationsPerRecord;
+};
+typedef struct BenchResult BenchResult;
+
+// Benchmark function (returns number of processed bytes).
+typedef size_t (*BenchFunction)(size_t &numRecords);
+
+// Benchmark description.
+struct Bench {
+	const char *name;
+	BenchFunction function;
+};
+typedef struct Bench Bench;
+
+// Application options.
+static Options options = {
+	20000, 1, 8, 40, 60, 1000, 50, false, 5, 0.3,
+	NULL, NULL, NULL, NULL };
+
+// Codes of long options without short equivalents.
+enum LongOption {
+	OPTION_SEED = 256, OPTION_MIN_FIELDS, OPTION_MAX_FIELDS,
+	OPTION_SUBFIELD_LENGTH, OPTION_OVERSIZED, OPTION_CYRILLIC,
+	OPTION_MARC21, OPTION_TOLERANCE, OPTION_BASELINE,
+	OPTION_SAVE_BASELINE, OPTION_CORPUS };
+
+// Number of memory allocations (operator new).
+static unsigned long long numAllocations = 0;
+
+// Generated records.
+static std::vector<MarcRecord> corpus;
+// Records in ISO 2709 format.
+static std::string isoData;
+// Positions and lengths of records in ISO 2709 data.
+static std::vector<std::pair<size_t, unsigned int> > isoRecords;
+// Records in MARCXML format.
+static std::string xmlData;
+// Data of all subfields of records.
+static std::vector<std::string> subfieldData;
+
+/*
+ * Allocate memory (allocations are counted).
+ */
+void *
+operator new(size_t size) throw (std::bad_alloc)
+{
+	numAllocations++;
+	void *ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+/*
+ * Free memory (not inlined, so compiler doesn't match free() with
+ * operator new).
+ */
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void
+operator delete(void *ptr) throw ()
+{
+	free(ptr);
+}
+
+/*
+ * Input source reading data from memory.
+ */
+class MemoryInput : public MarcInput {
+protected:
+	// Input data.
+	const std::string *m_data;
+	// Position of unread data.
+	size_t m_pos;
+
+public:
+	// Constructor.
+	MemoryInput(const std::string &data)
+	{
+		m_data = &data;
+		m_pos = 0;
+	}
+
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen)
+	{
+		size_t readLen = std::min(bufLen, m_data->size() - m_pos);
+		memcpy(buf, m_data->data() + m_pos, readLen);
+		m_pos += readLen;
+		return readLen;
+	}
+};
+
+/*
+ * Output sink storing data in memory (or only counting its length).
+ */
+class MemoryOutput : public MarcOutput {
+protected:
+	// Output data (NULL if data is not stored).
+	std::string *m_data;
+	// Length of written data.
+	size_t m_length;
+
+public:
+	// Constructor.
+	MemoryOutput(std::string *data = NULL)
+	{
+		m_data = data;
+		m_length = 0;
+	}
+
+	// Get length of written data.
+	size_t getLength(void)
+	{
+		return m_length;
+	}
+
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks)
+	{
+		for (size_t i = 0; i < numBlocks; i++) {
+			if (m_data != NULL) {
+				m_data->append(blocks[i].data,
+					blocks[i].length);
+			}
+			m_length += blocks[i].length;
+		}
+		return true;
+	}
+};
+
+/*
+ * Deterministic generator of MARC records.
+ */
+class CorpusGenerator {
+protected:
+	// State of pseudo-random numbers generator.
+	unsigned long long m_state;
+
+	// Get pseudo-random number in range [0, n).
+	unsigned int random(unsigned int n);
+	// Get pseudo-random number in range [min, max].
+	unsigned int random(unsigned int min, unsigned int max);
+	// Append random word to string.
+	void appendWord(std::string &s);
+	// Make text of random length (not longer than maxLength bytes).
+	std::string makeText(unsigned int maxLength);
+	// Make random decimal number of specified length.
+	std::string makeNumber(unsigned int length);
+	// Add repeatable data field with random contents.
+	void addFillerField(MarcRecord &record, const std::string &recordId);
+	// Add fields making record larger than ISO 2709 limit.
+	void addOversizedFields(MarcRecord &record);
+
+public:
+	// Constructor.
+	CorpusGenerator(unsigned int seed);
+
+	// Generate record.
+	void generate(int recNo, MarcRecord &record);
+};
+
+// Syllables of Latin words.
+static const char *latinSyllables[] = {
+	"ka", "lo", "mer", "ti", "on", "sa", "ber", "vi", "dor", "an",
+	"el", "us", "tra", "ni", "quo", "pe", NULL };
+// Syllables of Cyrillic words (UTF-8).
+static const char *cyrillicSyllables[] = {
+	"\xd0\xba\xd0\xb0", "\xd0\xbb\xd0\xbe", "\xd0\xbc\xd0\xb5\xd1\x80",
+	"\xd1\x82\xd0\xb8", "\xd0\xbe\xd0\xbd", "\xd1\x81\xd0\xb0",
+	"\xd0\xb1\xd0\xb5\xd1\x80", "\xd0\xb2\xd0\xb8",
+	"\xd0\xb4\xd0\xbe\xd1\x80", "\xd1\x89\xd0\xb8",
+	"\xd0\xb6\xd1\x83", "\xd1\x91\xd0\xbb", "\xd0\xa0\xd1\x83",
+	"\xd0\xb7\xd1\x8f", "\xd1\x8b\xd0\xb9", "\xd1\x8d\xd1\x84", NULL };
+// Punctuation and XML special characters between words.
+static const char *separators[] = {
+	" ", " ", " ", " ", " ", " ", ", ", ". ", " & ", " <", "> ",
+	" \"", "\" ", " - ", NULL };
+
+/*
+ * Constructor.
+ */
+CorpusGenerator::CorpusGenerator(unsigned int seed)
+{
+	m_state = 0x9E3779B97F4A7C15ULL ^ seed;
+}
+
+/*
+ * Get pseudo-random number in range [0, n) (xorshift64*).
+ */
+unsigned int
+CorpusGenerator::random(unsigned int n)
+{
+	m_state ^= m_state >> 12;
+	m_state ^= m_state << 25;
+	m_state ^= m_state >> 27;
+	unsigned long long value = m_state * 0x2545F4914F6CDD1DULL;
+	return n == 0 ? 0 : (unsigned int) ((value >> 32) % n);
+}
+
+/*
+ * Get pseudo-random number in range [min, max].
+ */
+unsigned int
+CorpusGenerator::random(unsigned int min, unsigned int max)
+{
+	return max <= min ? min : min + random(max - min + 1);
+}
+
+/*
+ * Append random word to string.
+ */
+void
+CorpusGenerator::appendWord(std::string &s)
+{
+	const char **syllables =
+		(int) random(100) < options.cyrillicPercent
+		? cyrillicSyllables : latinSyllables;
+	unsigned int numSyllables = 0;
+	while (syllables[numSyllables] != NULL) {
+		numSyllables++;
+	}
+
+	for (unsigned int i = random(1, 4); i > 0; i--) {
+		s.append(syllables[random(numSyllables)]);
+	}
+}
+
+/*
+ * Make text of random length (not longer than maxLength bytes, except
+ * the first word).
+ */
+std::string
+CorpusGenerator::makeText(unsigned int maxLength)
+{
+	unsigned int numSeparators = 0;
+	while (separators[numSeparators] != NULL) {
+		numSeparators++;
+	}
+
+	std::string text;
+	unsigned int length = random(1, maxLength);
+	appendWord(text);
+	while (text.size() < length) {
+		std::string word = separators[random(numSeparators)];
+		appendWord(word);
+		if (text.size() + word.size() > length) {
+			break;
+		}
+		text.append(word);
+	}
+
+	return text;
+}
+
+/*
+ * Make random decimal number of specified length.
+ */
+std::string
+CorpusGenerator::makeNumber(unsigned int length)
+{
+	std::string number(length, '0');
+	for (unsigned int i = 0; i < length; i++) {
+		number[i] = (char) ('0' + random(10));
+	}
+
+	return number;
+}
+
+/*
+ * Add repeatable data field with random contents (UNIMARC linking
+ * fields contain embedded fields).
+ */
+void
+CorpusGenerator::addFillerField(MarcRecord &record,
+	const std::string &recordId)
+{
+	unsigned int maxLength = (unsigned int) options.maxSubfieldLength;
+	MarcRecord::FieldIt fieldIt;
+
+	switch (random(4)) {
+	case 0:
+		fieldIt = record.addDataField(options.marc21 ? "500" : "300");
+		fieldIt->addSubfield('a', makeText(maxLength * 2));
+		break;
+	case 1:
+		fieldIt = record.addDataField(options.marc21 ? "650" : "606",
+			options.marc21 ? ' ' : '1', options.marc21 ? '0' : ' ');
+		fieldIt->addSubfield('a', makeText(maxLength));
+		for (unsigned int i = random(3); i > 0; i--) {
+			fieldIt->addSubfield('x', makeText(maxLength / 2));
+		}
+		break;
+	case 2:
+		fieldIt = record.addDataField("700",
+			options.marc21 ? '1' : ' ', options.marc21 ? ' ' : '1');
+		fieldIt->addSubfield('a', makeText(maxLength / 3));
+		fieldIt->addSubfield('b', makeText(4));
+		break;
+	default:
+		if (options.marc21) {
+			fieldIt = record.addDataField("773", '0', ' ');
+			fieldIt->addSubfield('t', makeText(maxLength));
+			fieldIt->addSubfield('g', makeText(maxLength / 4));
+			fieldIt->addSubfield('w', recordId);
+		} else {
+			// Linking field with embedded fields.
+			fieldIt = record.addDataField("461", ' ', '1');
+			fieldIt->addSubfield('1', "001" + recordId);
+			fieldIt->addSubfield('1', "2001 ");
+			fieldIt->addSubfield('a', makeText(maxLength));
+			fieldIt->addSubfield('v', makeNumber(2));
+		}
+		break;
+	}
+}
+
+/*
+ * Add fields making record larger than ISO 2709 limit (99999 bytes).
+ */
+void
+CorpusGenerator::addOversizedFields(MarcRecord &record)
+{
+	for (int i = 0; i < 150; i++) {
+		MarcRecord::FieldIt fieldIt =
+			record.addDataField(options.marc21 ? "500" : "300");
+		std::string text;
+		while (text.size() < 800) {
+			appendWord(text);
+			text.append(" ");
+		}
+		fieldIt->addSubfield('a', text);
+	}
+}
+
+/*
+ * Generate record.
+ */
+void
+CorpusGenerator::generate(int recNo, MarcRecord &record)
+{
+	unsigned int maxLength = (unsigned int) options.maxSubfieldLength;
+	char recordId[16];
+	sprintf(recordId, "%09d", recNo);
+	MarcRecord::FieldIt fieldIt;
+
+	record.clear();
+	record.setFormatVariant(options.marc21
+		? MarcRecord::MARC21 : MarcRecord::UNIMARC);
+
+	if (options.marc21) {
+		record.setLeader("00000nam a2200000 a 4500");
+		record.addControlField("001", recordId);
+		record.addControlField("005", "20190429120000.0");
+		record.addControlField("008",
+			"190429s2019    ru            000 0 rus d");
+		fieldIt = record.addDataField("020");
+		fieldIt->addSubfield('a', makeNumber(13));
+		fieldIt = record.addDataField("100", '1', ' ');
+		fieldIt->addSubfield('a', makeText(maxLength / 2));
+		fieldIt = record.addDataField("245", '1', '0');
+		fieldIt->addSubfield('a', makeText(maxLength));
+		fieldIt->addSubfield('b', makeText(maxLength));
+		fieldIt->addSubfield('c', makeText(maxLength / 2));
+		fieldIt = record.addDataField("260");
+		fieldIt->addSubfield('a', makeText(16));
+		fieldIt->addSubfield('b', makeText(maxLength / 2));
+		fieldIt->addSubfield('c', makeNumber(4));
+		fieldIt = record.addDataField("300");
+		fieldIt->addSubfield('a', makeNumber(3) + " p.");
+		fieldIt->addSubfield('c', "21 cm");
+	} else {
+		record.setLeader("00000nam0 2200000   450 ");
+		record.addControlField("001", recordId);
+		record.addControlField("005", "20190429120000.0");
+		fieldIt = record.addDataField("010");
+		fieldIt->addSubfield('a', makeNumber(13));
+		fieldIt->addSubfield('d', makeNumber(3) + " p.");
+		fieldIt = record.addDataField("100");
+		fieldIt->addSubfield('a',
+			"20190429d2019    k  y0rusy50      ca");
+		fieldIt = record.addDataField("101", '0', ' ');
+		fieldIt->addSubfield('a', "rus");
+		fieldIt = record.addDataField("200", '1', ' ');
+		fieldIt->addSubfield('a', makeText(maxLength));
+		fieldIt->addSubfield('e', makeText(maxLength));
+		fieldIt->addSubfield('f', makeText(maxLength / 2));
+		fieldIt = record.addDataField("210");
+		fieldIt->addSubfield('a', makeText(16));
+		fieldIt->addSubfield('c', makeText(maxLength / 2));
+		fieldIt->addSubfield('d', makeNumber(4));
+		fieldIt = record.addDataField("215");
+		fieldIt->addSubfield('a', makeNumber(3) + " c.");
+		fieldIt->addSubfield('d', "21 cm");
+	}
+
+	// Add repeatable fields up to selected number of data fields.
+	unsigned int numFields = random((unsigned int) options.minFields,
+		(unsigned int) options.maxFields);
+	for (unsigned int i = 5; i < numFields; i++) {
+		addFillerField(record, recordId);
+	}
+
+	// Make every n-th record oversized.
+	if (options.oversizedInterval > 0
+		&& recNo % options.oversizedInterval == 0)
+	{
+		addOversizedFields(record);
+	}
+}
+
+/*
+ * Get current time in seconds.
+ */
+static double
+getTime(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
+
+/*
+ * Write records in ISO 2709 format (UTF-8).
+ */
+static size_t
+benchIsoWrite(size_t &numRecords)
+{
+	MarcIsoWriter writer;
+	MemoryOutput output;
+	writer.open(NULL, NULL);
+	writer.setOutput(&output);
+	for (size_t i = 0; i < corpus.size(); i++) {
+		if (writer.write(corpus[i])) {
+			numRecords++;
+		}
+	}
+	writer.close();
+
+	return output.getLength();
+}
+
+/*
+ * Write records in ISO 2709 format with recoding to CP1251.
+ */
+static size_t
+benchIsoWriteRecode(size_t &numRecords)
+{
+	MarcIsoWriter writer;
+	MemoryOutput output;
+	writer.open(NULL, "cp1251");
+	writer.setOutput(&output);
+	for (size_t i = 0; i < corpus.size(); i++) {
+		if (writer.write(corpus[i])) {
+			numRecords++;
+		}
+	}
+	writer.close();
+
+	return output.getLength();
+}
+
+/*
+ * Parse records from ISO 2709 buffers.
+ */
+static size_t
+benchIsoParse(size_t &numRecords)
+{
+	MarcIsoReader reader;
+	MarcRecord record;
+	reader.open(NULL, NULL);
+	for (size_t i = 0; i < isoRecords.size(); i++) {
+		if (reader.parse(isoData.data() + isoRecords[i].first,
+			isoRecords[i].second, record))
+		{
+			numRecords++;
+		}
+	}
+	reader.close();
+
+	return isoData.size();
+}
+
+/*
+ * Read records from ISO 2709 stream.
+ */
+static size_t
+benchIsoRead(size_t &numRecords)
+{
+	MarcIsoReader reader;
+	MemoryInput input(isoData);
+	MarcRecord record;
+	reader.open(NULL, NULL);
+	reader.setInput(&input);
+	while (reader.next(record)) {
+		numRecords++;
+	}
+	reader.close();
+
+	return isoData.size();
+}
+
+/*
+ * Write records in MARCXML format.
+ */
+static size_t
+benchXmlWrite(size_t &numRecords)
+{
+	MarcXmlWriter writer;
+	MemoryOutput output;
+	writer.open(NULL, NULL);
+	writer.setOutput(&output);
+	writer.writeHeader();
+	for (size_t i = 0; i < corpus.size(); i++) {
+		if (writer.write(corpus[i])) {
+			numRecords++;
+		}
+	}
+	writer.writeFooter();
+	writer.close();
+
+	return output.getLength();
+}
+
+/*
+ * Read records from MARCXML stream.
+ */
+static size_t
+benchXmlRead(size_t &numRecords)
+{
+	MarcXmlReader reader;
+	MemoryInput input(xmlData);
+	MarcRecord record;
+	reader.open(NULL, NULL);
+	reader.setInput(&input);
+	while (reader.next(record)) {
+		numRecords++;
+	}
+	reader.close();
+
+	return xmlData.size();
+}
+
+/*
+ * Replace XML special characters in data of subfields.
+ */
+static size_t
+benchSerializeXml(size_t &numRecords)
+{
+	size_t dataLen = 0;
+	for (size_t i = 0; i < subfieldData.size(); i++) {
+		dataLen += serialize_xml(subfieldData[i]).size();
+	}
+	numRecords = corpus.size();
+
+	return dataLen;
+}
+
+/*
+ * Convert data of subfields from UTF-8 to CP1251 with iconv.
+ */
+static size_t
+benchIconv(size_t &numRecords)
+{
+	iconv_t iconvDesc = iconv_open("CP1251", "UTF-8");
+	if (iconvDesc == (iconv_t) -1) {
+		return 0;
+	}
+
+	size_t dataLen = 0;
+	std::string encodedData;
+	for (size_t i = 0; i < subfieldData.size(); i++) {
+		if (marcrecord::iconv(iconvDesc, subfieldData[i],
+			encodedData))
+		{
+			dataLen += subfieldData[i].size();
+		}
+	}
+	iconv_close(iconvDesc);
+	numRecords = corpus.size();
+
+	return dataLen;
+}
+
+// List of benchmarks.
+static const Bench benches[] = {
+	{ "iso_write", benchIsoWrite },
+	{ "iso_write_cp1251", benchIsoWriteRecode },
+	{ "iso_parse", benchIsoParse },
+	{ "iso_read", benchIsoRead },
+	{ "xml_write", benchXmlWrite },
+	{ "xml_read", benchXmlRead },
+	{ "serialize_xml", benchSerializeXml },
+	{ "iconv", benchIconv },
+	{ NULL, NULL }
+};
+
+/*
+ * Generate corpus and prepare data for benchmarks.
+ */
+static bool
+prepareCorpus(void)
+{
+	// Generate records.
+	CorpusGenerator generator(options.seed);
+	corpus.resize(options.numRecords);
+	for (int i = 0; i < options.numRecords; i++) {
+		generator.generate(i + 1, corpus[i]);
+	}
+
+	// Collect data of subfields.
+	for (size_t i = 0; i < corpus.size(); i++) {
+		MarcRecord::FieldRefList fields = corpus[i].getFields();
+		for (MarcRecord::FieldRefIt fieldIt = fields.begin();
+			fieldIt != fields.end(); fieldIt++)
+		{
+			MarcRecord::SubfieldRefList subfields =
+				(*fieldIt)->getSubfields();
+			for (MarcRecord::SubfieldRefIt subfieldIt =
+				subfields.begin();
+				subfieldIt != subfields.end(); subfieldIt++)
+			{
+				subfieldData.push_back(
+					(*subfieldIt)->getData());
+			}
+		}
+	}
+
+	// Write records in ISO 2709 format (oversized records are
+	// rejected by writer).
+	MarcIsoWriter isoWriter;
+	MemoryOutput isoOutput(&isoData);
+	isoWriter.open(NULL, NULL);
+	isoWriter.setOutput(&isoOutput);
+	int numOversized = 0;
+	for (size_t i = 0; i < corpus.size(); i++) {
+		if (!isoWriter.write(corpus[i])) {
+			numOversized++;
+		}
+	}
+	isoWriter.close();
+
+	// Find positions of records in ISO 2709 data.
+	for (size_t pos = 0; pos + 5 <= isoData.size(); ) {
+		unsigned int recordLen;
+		if (!parse_decimal(isoData.data() + pos, 5, recordLen)
+			|| recordLen == 0 || pos + recordLen > isoData.size())
+		{
+			fprintf(stderr, "Error: invalid ISO 2709 data.\n");
+			return false;
+		}
+		isoRecords.push_back(std::make_pair(pos, recordLen));
+		pos += recordLen;
+	}
+
+	// Write records in MARCXML format.
+	MarcXmlWriter xmlWriter;
+	MemoryOutput xmlOutput(&xmlData);
+	xmlWriter.open(NULL, NULL);
+	xmlWriter.setOutput(&xmlOutput);
+	xmlWriter.writeHeader();
+	for (size_t i = 0; i < corpus.size(); i++) {
+		xmlWriter.write(corpus[i]);
+	}
+	xmlWriter.writeFooter();
+	xmlWriter.close();
+
+	fprintf(stderr, "Corpus: %d %s records (%d oversized), "
+		"%lu bytes of ISO 2709, %lu bytes of MARCXML\n",
+		options.numRecords, options.marc21 ? "MARC21" : "UNIMARC",
+		numOversized, (unsigned long) isoData.size(),
+		(unsigned long) xmlData.size());
+
+	// Save corpus to file.
+	if (options.corpusFileName != NULL) {
+		FILE *corpusFile = fopen(options.corpusFileName, "wb");
+		if (corpusFile == NULL || fwrite(isoData.data(), 1,
+			isoData.size(), corpusFile) != isoData.size())
+		{
+			fprintf(stderr, "Error: can't write corpus file.\n");
+			if (corpusFile != NULL) {
+				fclose(corpusFile);
+			}
+			return false;
+		}
+		fclose(corpusFile);
+	}
+
+	return true;
+}
+
+/*
+ * Run benchmark (the best time of iterations is used).
+ */
+static BenchResult
+runBench(const Bench &bench)
+{
+	double bestTime = 0.0;
+	size_t numRecords = 0, dataLen = 0;
+	unsigned long long allocations = 0;
+
+	for (int i = 0; i < options.numIterations; i++) {
+		numRecords = 0;
+		unsigned long long startAllocations = numAllocations;
+		double startTime = getTime();
+		dataLen = bench.function(numRecords);
+		double usedTime = getTime() - startTime;
+		allocations = numAllocations - startAllocations;
+		if (i == 0 || usedTime < bestTime) {
+			bestTime = usedTime;
+		}
+	}
+
+	if (bestTime <= 0.0) {
+		bestTime = 1e-6;
+	}
+
+	BenchResult result;
+	result.name = bench.name;
+	result.recordsPerSecond = (double) numRecords / bestTime;
+	result.megabytesPerSecond = (double) dataLen / bestTime / 1048576.0;
+	result.allocationsPerRecord = numRecords == 0 ? 0.0
+		: (double) allocations / (double) numRecords;
+
+	return result;
+}
+
+/*
+ * Load baseline results (lines of benchmark name, records per second
+ * and allocations per record).
+ */
+static bool
+loadBaseline(const char *fileName,
+	std::map<std::string, BenchResult> &baseline)
+{
+	FILE *baselineFile = fopen(fileName, "r");
+	if (baselineFile == NULL) {
+		return false;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), baselineFile) != NULL) {
+		char name[128];
+		BenchResult result;
+		if (line[0] == '#' || sscanf(line, "%127s %lf %lf", name,
+			&result.recordsPerSecond,
+			&result.allocationsPerRecord) != 3)
+		{
+			continue;
+		}
+		result.name = name;
+		result.megabytesPerSecond = 0.0;
+		baseline[result.name] = result;
+	}
+	fclose(baselineFile);
+
+	return true;
+}
+
+/*
+ * Save results as baseline.
+ */
+static bool
+saveBaseline(const char *fileName,
+	const std::vector<BenchResult> &results)
+{
+	FILE *baselineFile = fopen(fileName, "w");
+	if (baselineFile == NULL) {
+		return false;
+	}
+
+	fprintf(baselineFile, "# marc-bench baseline: name, records/s, "
+		"allocations/record\n");
+	fprintf(baselineFile, "# corpus: %d records, seed %u, fields %d-%d, "
+		"subfield length %d, oversized 1/%d, cyrillic %d%%, %s\n",
+		options.numRecords, options.seed, options.minFields,
+		options.maxFields, options.maxSubfieldLength,
+		options.oversizedInterval, options.cyrillicPercent,
+		options.marc21 ? "MARC21" : "UNIMARC");
+	for (size_t i = 0; i < results.size(); i++) {
+		fprintf(baselineFile, "%s %.1f %.2f\n",
+			results[i].name.c_str(), results[i].recordsPerSecond,
+			results[i].allocationsPerRecord);
+	}
+
+	return fclose(baselineFile) == 0;
+}
+
+/*
+ * Display usage information.
+ */
+static void
+displayUsage(void)
+{
+	int i;
+	const char *help[] = {
+		"marc-bench 1.4 (29 Apr 2019)\n",
+		"Benchmark MARC records readers and writers on synthetic "
+		"records.\n",
+		"\n",
+		"usage: marc-bench [-h] [-n numrecs] [-i iterations] "
+		"[-b bench] [options]\n",
+		"\n",
+		"  -h --help        give this help\n",
+		"  -n --numrecs     number of generated records\n",
+		"                   (default: 20000)\n",
+		"  -i --iterations  number of iterations of benchmark "
+		"(default: 5)\n",
+		"  -b --bench       run only benchmarks with name containing "
+		"string\n",
+		"     --seed        seed of records generator (default: 1)\n",
+		"     --min-fields  minimal number of data fields\n",
+		"                   (default: 8)\n",
+		"     --max-fields  maximal number of data fields\n",
+		"                   (default: 40)\n",
+		"     --subfield-length\n",
+		"                   maximal length of subfield (default: 60)\n",
+		"     --oversized   every n-th record exceeds ISO 2709 limit\n",
+		"                   (default: 1000, 0: none)\n",
+		"     --cyrillic    percent of Cyrillic words (default: 50)\n",
+		"     --marc21      generate MARC21 records\n",
+		"                   (default: UNIMARC)\n",
+		"     --tolerance   allowed slowdown against baseline "
+		"(default: 0.3)\n",
+		"     --baseline    compare results with baseline file\n",
+		"     --save-baseline\n",
+		"                   save results to baseline file\n",
+		"     --corpus      save generated records to ISO 2709 file\n",
+		"\n",
+		NULL};
+
+	for (i = 0; help[i] != NULL; i++) {
+		fputs(help[i], stderr);
+	}
+}
+
+/*
+ * Parse command line arguments.
+ */
+static int
+parseCommandLine(int argc, char **argv)
+{
+	static const char *short_options = "hn:i:b:";
+	static struct option long_options[] = {
+		{ "help", no_argument, 0, 'h' },
+		{ "numrecs", required_argument, 0, 'n' },
+		{ "iterations", required_argument, 0, 'i' },
+		{ "bench", required_argument, 0, 'b' },
+		{ "seed", required_argument, 0, OPTION_SEED },
+		{ "min-fields", required_argument, 0, OPTION_MIN_FIELDS },
+		{ "max-fields", required_argument, 0, OPTION_MAX_FIELDS },
+		{ "subfield-length", required_argument, 0,
+			OPTION_SUBFIELD_LENGTH },
+		{ "oversized", required_argument, 0, OPTION_OVERSIZED },
+		{ "cyrillic", required_argument, 0, OPTION_CYRILLIC },
+		{ "marc21", no_argument, 0, OPTION_MARC21 },
+		{ "tolerance", required_argument, 0, OPTION_TOLERANCE },
+		{ "baseline", required_argument, 0, OPTION_BASELINE },
+		{ "save-baseline", required_argument, 0,
+			OPTION_SAVE_BASELINE },
+		{ "corpus", required_argument, 0, OPTION_CORPUS },
+		{ 0, 0, 0, 0 }
+	};
+	int option;
+
+	while ((option = getopt_long(argc, argv, short_options,
+		long_options, NULL)) != -1)
+	{
+		switch (option) {
+		case 'h':
+			displayUsage();
+			return 2;
+		case 'n':
+			options.numRecords = atol(optarg);
+			break;
+		case 'i':
+			options.numIterations = atol(optarg);
+			break;
+		case 'b':
+			options.benchName = optarg;
+			break;
+		case OPTION_SEED:
+			options.seed = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case OPTION_MIN_FIELDS:
+			options.minFields = atol(optarg);
+			break;
+		case OPTION_MAX_FIELDS:
+			options.maxFields = atol(optarg);
+			break;
+		case OPTION_SUBFIELD_LENGTH:
+			options.maxSubfieldLength = atol(optarg);
+			break;
+		case OPTION_OVERSIZED:
+			options.oversizedInterval = atol(optarg);
+			break;
+		case OPTION_CYRILLIC:
+			options.cyrillicPercent = atol(optarg);
+			break;
+		case OPTION_MARC21:
+			options.marc21 = true;
+			break;
+		case OPTION_TOLERANCE:
+			options.tolerance = atof(optarg);
+			break;
+		case OPTION_BASELINE:
+			options.baselineFileName = optarg;
+			break;
+		case OPTION_SAVE_BASELINE:
+			options.saveBaselineFileName = optarg;
+			break;
+		case OPTION_CORPUS:
+			options.corpusFileName = optarg;
+			break;
+		default:
+			return 2;
+		}
+	}
+
+	if (options.numRecords <= 0 || options.numIterations <= 0
+		|| options.maxFields < options.minFields
+		|| options.maxSubfieldLength <= 0)
+	{
+		fprintf(stderr, "Error: wrong generator parameters.\n");
+		return 2;
+	}
+
+	return 0;
+}
+
+/*
+ * Main function.
+ */
+int
+main(int argc, char **argv)
+{
+	int result_code;
+
+	// Parse command line arguments.
+	result_code = parseCommandLine(argc, argv);
+	if (result_code != 0) {
+		return result_code;
+	}
+
+	// Load baseline before running benchmarks.
+	std::map<std::string, BenchResult> baseline;
+	if (options.baselineFileName != NULL
+		&& !loadBaseline(options.baselineFileName, baseline))
+	{
+		fprintf(stderr, "Error: can't read baseline file.\n");
+		return 1;
+	}
+
+	if (!prepareCorpus()) {
+		return 1;
+	}
+
+	// Run benchmarks and compare results with baseline.
+	std::vector<BenchResult> results;
+	int numRegressions = 0;
+	printf("%-18s %12s %10s %12s %s\n", "benchmark", "records/s",
+		"MB/s", "allocs/rec",
+		options.baselineFileName != NULL ? "baseline" : "");
+	for (int i = 0; benches[i].name != NULL; i++) {
+		if (options.benchName != NULL
+			&& strstr(benches[i].name, options.benchName) == NULL)
+		{
+			continue;
+		}
+
+		BenchResult result = runBench(benches[i]);
+		results.push_back(result);
+		printf("%-18s %12.1f %10.1f %12.2f", result.name.c_str(),
+			result.recordsPerSecond, result.megabytesPerSecond,
+			result.allocationsPerRecord);
+
+		std::map<std::string, BenchResult>::iterator baseIt =
+			baseline.find(result.name);
+		if (baseIt != baseline.end()) {
+			const BenchResult &base = baseIt->second;
+			double ratio = result.recordsPerSecond
+				/ base.recordsPerSecond;
+			bool slower = ratio < 1.0 - options.tolerance;
+			// Allocations are deterministic, so any growth is
+			// reported.
+			bool moreAllocations = result.allocationsPerRecord
+				> base.allocationsPerRecord + 0.005;
+			printf(" %+.1f%%%s%s", (ratio - 1.0) * 100.0,
+				slower ? " SLOWER" : "",
+				moreAllocations ? " MORE ALLOCATIONS" : "");
+			if (slower || moreAllocations) {
+				numRegressions++;
+			}
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if (options.saveBaselineFileName != NULL
+		&& !saveBaseline(options.saveBaselineFileName, results))
+	{
+		fprintf(stderr, "Error: can't write baseline file.\n");
+		return 1;
+	}
+
+	if (numRegressions > 0) {
+		fprintf(stderr, "Regressions against baseline: %d.\n",
+			numRegressions);
+		return 1;
+	}
+
+	return 0;
+}
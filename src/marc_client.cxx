@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+extern "C" {
+#include <getopt.h>
+}
+#include <sys/time.h>
+#include "marcrecord/marc_socket.h"
+
+using namespace marcrecord;
+
+// Application options structure.
+struct Options {
+	const char *socketPath;
+	const char *inputFormat;
+	const char *outputFormat;
+	const char *inputEncoding;
+	const char *outputEncoding;
+	const char *inputFileName;
+	const char *outputFileName;
+	int numRequests;
+	int verboseLevel;
+};
+typedef struct Options Options;
+
+// Application options.
+static Options options = {
+	NULL, "iso2709", "text", NULL, NULL, NULL, NULL, 1, 0 };
+
+/*
+ * Get current time in seconds.
+ */
+static double
+getTime(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
+
+/*
+ * Read whole file to string.
+ */
+static bool
+readFile(const char *fileName, std::string &data)
+{
+	FILE *inputFile = stdin;
+	if (fileName != NULL && strcmp(fileName, "-") != 0) {
+		inputFile = fopen(fileName, "rb");
+		if (inputFile == NULL) {
+			return false;
+		}
+	}
+
+	char buf[65536];
+	size_t readLen;
+	while ((readLen = fread(buf, 1, sizeof(buf), inputFile)) > 0) {
+		data.append(buf, readLen);
+	}
+	bool status = !ferror(inputFile);
+
+	if (inputFile != stdin) {
+		fclose(inputFile);
+	}
+	return status;
+}
+
+/*
+ * Display usage information.
+ */
+static void
+displayUsage(void)
+{
+	int i;
+	const char *help[] = {
+		"marc-client 1.4 (29 Apr 2019)\n",
+		"Convert MARC records by marc-server.\n",
+		"\n",
+		"usage: marc-client [-hv] -s socket\n",
+		"  [-f srcfmt] [-t destfmt] [-e srcenc] [-r destenc]\n",
+		"  [-n numreqs] [-o outfile] [infile]\n",
+		"\n",
+		"  -h --help        give this help\n",
+		"  -e --encoding    encoding of input file\n",
+		"                   default encoding: utf-8\n",
+		"  -f --from        format of input file (default: iso2709)\n",
+		"                   (iso2709, marcxml, json, jsonl)\n",
+		"  -n --numreqs     number of repeated requests (default: 1)\n",
+		"  -o --output      name of output file ('-' for stdout)\n",
+		"  -r --recode      encoding of output file\n",
+		"  -s --socket      path of server socket\n",
+		"  -t --to          format of output file (default: text)\n",
+		"                   (iso2709, marcxml, unimarcxml, text, json,\n",
+		"                   jsonl)\n",
+		"  -v --verbose     print number of requests per second\n",
+		"\n",
+		NULL};
+
+	for (i = 0; help[i] != NULL; i++) {
+		fputs(help[i], stderr);
+	}
+}
+
+/*
+ * Parse command line arguments.
+ */
+static int
+parseCommandLine(int argc, char **argv)
+{
+	static const char *short_options = "he:f:n:o:r:s:t:v";
+	static struct option long_options[] = {
+		{ "help", no_argument, 0, 'h' },
+		{ "encoding", required_argument, 0, 'e' },
+		{ "from", required_argument, 0, 'f' },
+		{ "numreqs", required_argument, 0, 'n' },
+		{ "output", required_argument, 0, 'o' },
+		{ "recode", required_argument, 0, 'r' },
+		{ "socket", required_argument, 0, 's' },
+		{ "to", required_argument, 0, 't' },
+		{ "verbose", no_argument, 0, 'v' },
+		{ 0, 0, 0, 0 }
+	};
+	int option;
+
+	while ((option = getopt_long(argc, argv, short_options,
+		long_options, NULL)) != -1)
+	{
+		switch (option) {
+		case 'h':
+			displayUsage();
+			return 2;
+		case 'e':
+			options.inputEncoding = optarg;
+			break;
+		case 'f':
+			options.inputFormat = optarg;
+			break;
+		case 'n':
+			options.numRequests = atol(optarg);
+			break;
+		case 'o':
+			options.outputFileName = optarg;
+			break;
+		case 'r':
+			options.outputEncoding = optarg;
+			break;
+		case 's':
+			options.socketPath = optarg;
+			break;
+		case 't':
+			options.outputFormat = optarg;
+			break;
+		case 'v':
+			options.verboseLevel++;
+			break;
+		default:
+			return 2;
+		}
+	}
+
+	if (optind < argc) {
+		options.inputFileName = argv[optind++];
+	}
+
+	if (options.socketPath == NULL || options.numRequests <= 0) {
+		displayUsage();
+		return 2;
+	}
+
+	// If only input encoding specified then use it as output encoding too.
+	if (options.inputEncoding != NULL && options.outputEncoding == NULL) {
+		options.outputEncoding = options.inputEncoding;
+	}
+
+	return 0;
+}
+
+/*
+ * Main function.
+ */
+int
+main(int argc, char **argv)
+{
+	int result_code;
+
+	// Parse command line arguments.
+	result_code = parseCommandLine(argc, argv);
+	if (result_code != 0) {
+		return result_code;
+	}
+
+	std::string inputData;
+	if (!readFile(options.inputFileName, inputData)) {
+		fprintf(stderr, "Error: can't read input file.\n");
+		return 1;
+	}
+
+	// Send requests over single connection.
+	MarcSocketClient client;
+	if (!client.connect(options.socketPath)) {
+		fprintf(stderr, "Error: %s.\n",
+			client.getErrorMessage().c_str());
+		return 1;
+	}
+	std::string outputData;
+	double startTime = getTime();
+	for (int i = 0; i < options.numRequests; i++) {
+		if (!client.convert(options.inputFormat, options.outputFormat,
+			options.inputEncoding, options.outputEncoding,
+			inputData.data(), inputData.size(), outputData))
+		{
+			fprintf(stderr, "Error: %s.\n",
+				client.getErrorMessage().c_str());
+			return 1;
+		}
+	}
+	double usedTime = getTime() - startTime;
+	client.close();
+
+	if (options.verboseLevel > 0) {
+		fprintf(stderr, "Requests: %d, %.1f requests/s.\n",
+			options.numRequests, usedTime > 0.0
+			? options.numRequests / usedTime : 0.0);
+	}
+
+	// Write output of last request.
+	FILE *outputFile = stdout;
+	if (options.outputFileName != NULL
+		&& strcmp(options.outputFileName, "-") != 0)
+	{
+		outputFile = fopen(options.outputFileName, "wb");
+		if (outputFile == NULL) {
+			fprintf(stderr, "Error: can't open output file.\n");
+			return 1;
+		}
+	}
+	if ((!outputData.empty() && fwrite(outputData.data(),
+		outputData.size(), 1, outputFile) != 1)
+		|| fflush(outputFile) != 0)
+	{
+		fprintf(stderr, "Error: can't write output file.\n");
+		return 1;
+	}
+	if (outputFile != stdout) {
+		fclose(outputFile);
+	}
+
+	return 0;
+}
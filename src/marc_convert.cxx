@@ -27,13 +27,38 @@
  */
 
 #include <cerrno>
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <new>
+#include <string>
+#include <vector>
 extern "C" {
 #include <getopt.h>
 }
 #include <math.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#include "marcrecord/marc_async.h"
+#include "marcrecord/marc_chunk.h"
+#include "marcrecord/marc_compress.h"
+#include "marcrecord/marc_follow.h"
+#include "marcrecord/marc_stats.h"
+#include "marcrecord/marcarchive_reader.h"
+#include "marcrecord/marcarchive_writer.h"
+#include "marcrecord/marcbinary_reader.h"
+#include "marcrecord/marcbinary_writer.h"
+#include "marcrecord/marccolumn_writer.h"
+#include "marcrecord/marcjson_reader.h"
+#include "marcrecord/marcjson_writer.h"
 #include "marcrecord/marcrecord.h"
 #include "marcrecord/marciso_reader.h"
 #include "marcrecord/marciso_writer.h"
@@ -41,13 +66,15 @@ extern "C" {
 #include "marcrecord/marcxml_reader.h"
 #include "marcrecord/marcxml_writer.h"
 #include "marcrecord/unimarcxml_writer.h"
+#include "marc_batch.h"
 
 using namespace marcrecord;
 
 // Record format variants.
 enum RecordFormat {
 	FORMAT_NULL, FORMAT_ISO2709, FORMAT_MARCXML, FORMAT_UNIMARCXML,
-	FORMAT_TEXT };
+	FORMAT_TEXT, FORMAT_ARCHIVE, FORMAT_BINARY, FORMAT_JSON,
+	FORMAT_JSONL, FORMAT_CSV, FORMAT_TSV, FORMAT_ARROW };
 
 // Application options structure.
 struct Options {
@@ -61,6 +88,29 @@ struct Options {
 	enum RecordFormat outputFormat;
 	const char *inputEncoding;
 	const char *outputEncoding;
+	bool directIo;
+	const char *compressFormat;
+	int compressLevel;
+	int compressThreads;
+	int blockRecords;
+	const char *columns;
+	const char *joinSeparator;
+	int asyncBuffers;
+	int asyncBlocks;
+	int asyncBlockSize;
+	const char *statsFormat;
+	int progressFd;
+	const char *metricsFileName;
+	int progressInterval;
+	const char *checkpointFileName;
+	int checkpointInterval;
+	bool resume;
+	bool follow;
+	int followInterval;
+	int numJobs;
+	unsigned long long splitSize;
+	int splitRecords;
+	unsigned long long splitBytes;
 };
 typedef struct Options Options;
 
@@ -72,20 +122,1031 @@ struct Counters {
 };
 typedef Counters Counters;
 
+// Checkpoint of conversion structure.
+struct Checkpoint {
+	// Position in input file after last read record.
+	double inputPos;
+	// Length of output file (output is flushed at record boundary).
+	double outputLength;
+	// Records counters.
+	Counters counters;
+};
+typedef struct Checkpoint Checkpoint;
+
 // Application options.
 static Options options = {
 	0, false, 0, 0, NULL, NULL,
-	FORMAT_ISO2709, FORMAT_TEXT, NULL, NULL };
+	FORMAT_ISO2709, FORMAT_TEXT, NULL, NULL, false, NULL, -1, 0,
+	0, NULL, NULL, 0, 0, 0, NULL, -1, NULL, 1,
+	NULL, 60, false, false, MARC_FOLLOW_POLL_INTERVAL, 0,
+	BATCH_SPLIT_SIZE, 0, 0 };
+
+// Codes of long options without short equivalents.
+enum LongOption {
+	OPTION_DIRECT_IO = 256, OPTION_COMPRESS, OPTION_COMPRESS_LEVEL,
+	OPTION_COMPRESS_THREADS, OPTION_BLOCK_RECORDS, OPTION_COLUMNS,
+	OPTION_JOIN, OPTION_ASYNC_OUTPUT, OPTION_ASYNC_INPUT,
+	OPTION_ASYNC_BLOCK_SIZE, OPTION_STATS, OPTION_PROGRESS_FD,
+	OPTION_METRICS_FILE, OPTION_PROGRESS_INTERVAL, OPTION_CHECKPOINT,
+	OPTION_CHECKPOINT_INTERVAL, OPTION_RESUME, OPTION_FOLLOW,
+	OPTION_FOLLOW_INTERVAL, OPTION_SPLIT_SIZE, OPTION_SPLIT_RECORDS,
+	OPTION_SPLIT_BYTES };
+
+// Records readers.
+MarcIsoReader marcIsoReader;
+MarcXmlReader marcXmlReader;
+MarcArchiveReader marcArchiveReader;
+MarcBinaryReader marcBinaryReader;
+MarcJsonReader marcJsonReader;
+
+// Records writers.
+MarcIsoWriter marcIsoWriter;
+MarcTextWriter marcTextWriter;
+MarcXmlWriter marcXmlWriter;
+UnimarcXmlWriter unimarcXmlWriter;
+MarcArchiveWriter marcArchiveWriter;
+MarcBinaryWriter marcBinaryWriter;
+MarcJsonWriter marcJsonWriter;
+MarcColumnWriter marcColumnWriter;
+
+// Input sources.
+MarcFileInput marcFileInput;
+MarcCompressedInput marcCompressedInput;
+MarcFollowInput marcFollowInput;
+#ifndef _WIN32
+MarcAsyncInput marcAsyncInput;
+#endif
+
+// Output sinks.
+MarcFileOutput marcFileOutput;
+MarcCompressedOutput marcCompressedOutput;
+#ifndef _WIN32
+MarcFdOutput marcFdOutput;
+MarcAsyncOutput marcAsyncOutput;
+#endif
+
+// Input arguments (several files are converted in batch mode).
+static std::vector<const char *> inputArgs;
+
+// Copy records from input to output without parsing.
+static bool rawCopyMode = false;
+
+// Conversion statistics structure.
+struct Statistics {
+	// Statistics of reading and writing.
+	MarcStats io;
+	// Time of parsing records (without reading and transcoding, may be
+	// negative while transcoding time is estimated).
+	long long parseTime;
+	// Time of serializing records (without transcoding and writing).
+	long long serializeTime;
+	// Latencies of records conversion.
+	MarcLatencyHistogram latency;
+	// Start time of current phase.
+	unsigned long long phaseStartTime;
+	// Statistics of reading and writing at start of current phase.
+	MarcStats phaseStartIo;
+	// Statistics of reading input file (before decompression).
+	MarcStats inputFile;
+};
+typedef struct Statistics Statistics;
+
+// Progress reports structure.
+struct Progress {
+	// Files of progress reports (progress fd and metrics file).
+	FILE *files[2];
+	// Input file.
+	FILE *inputFile;
+	// Size of input file (0 if unknown).
+	double inputSize;
+	// Start time of conversion.
+	unsigned long long startTime;
+	// Time of previous report.
+	unsigned long long prevTime;
+	// Number of read records at previous report.
+	int prevNumRecs;
+	// Number of input bytes at previous report.
+	unsigned long long prevInputBytes;
+};
+typedef struct Progress Progress;
+
+// Conversion statistics.
+static Statistics statistics;
+// Progress reports.
+static Progress progress = { { NULL, NULL }, NULL, 0.0, 0, 0, 0, 0 };
+// Length of output file before output of resumed conversion.
+static double resumedOutputLength = 0.0;
+// Input sources and output sink counting statistics.
+MarcStatsInput marcStatsInput;
+MarcStatsInput marcFileStatsInput;
+MarcStatsOutput marcStatsOutput;
+
+// Split output structure.
+struct SplitOutput {
+	// Data of current chunk.
+	std::string chunkData;
+	// Data of last converted record.
+	std::string recordData;
+	// Length of footer of chunk.
+	size_t footerLength;
+	// Numbers of first and last records of current chunk.
+	int firstRecNo;
+	int lastRecNo;
+	// Number of records in current chunk.
+	int numRecs;
+};
+typedef struct SplitOutput SplitOutput;
+
+// Split output.
+static SplitOutput splitOutput;
+// Output sink collecting records of split output.
+MarcMemoryOutput marcSplitOutput;
+// Writer threads of chunk files.
+MarcChunkPool marcChunkPool;
+
+// Allocations are counted flag (set before threads are started).
+static bool countAllocations = false;
+// Number of memory allocations (operator new).
+static unsigned long long numAllocations = 0;
+
+/*
+ * Allocate memory (allocations are counted for statistics, counter is
+ * shared by threads of asynchronous i/o and writers of chunks).
+ */
+void *
+operator new(size_t size) throw (std::bad_alloc)
+{
+	if (countAllocations) {
+#ifdef __GNUC__
+		__sync_fetch_and_add(&numAllocations, 1);
+#else
+		numAllocations++;
+#endif
+	}
+	void *ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+/*
+ * Free memory allocated by operator new.
+ */
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void
+operator delete(void *ptr) throw ()
+{
+	free(ptr);
+}
+
+/*
+ * Start timing of conversion phase.
+ */
+static void
+startPhase(void)
+{
+	statistics.phaseStartTime = get_time_ns();
+	statistics.phaseStartIo = statistics.io;
+}
+
+/*
+ * Add time of conversion phase without time of reading, framing,
+ * transcoding and writing (counted by readers and writers) to phase time
+ * and start timing of next phase.
+ */
+static void
+endPhase(long long &phaseTime)
+{
+	unsigned long long curTime = get_time_ns();
+	const MarcStats &io = statistics.io;
+	const MarcStats &startIo = statistics.phaseStartIo;
+
+	// Input data is read while records are framed (if reader frames
+	// records before parsing).
+	unsigned long long frameTime = io.frameTime - startIo.frameTime;
+	unsigned long long countedTime = (frameTime > 0 ? frameTime
+		: io.readTime - startIo.readTime)
+		+ (io.decodeTime - startIo.decodeTime)
+		+ (io.encodeTime - startIo.encodeTime)
+		+ (io.writeTime - startIo.writeTime);
+
+	phaseTime += (long long) (curTime - statistics.phaseStartTime)
+		- (long long) countedTime;
+
+	statistics.phaseStartTime = curTime;
+	statistics.phaseStartIo = io;
+}
+
+/*
+ * Get peak resident set size of process in bytes (0 if unknown).
+ */
+static double
+getPeakRss(void)
+{
+#ifndef _WIN32
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0.0;
+	}
+#ifdef __APPLE__
+	return (double) usage.ru_maxrss;
+#else
+	return (double) usage.ru_maxrss * 1024.0;
+#endif
+#else
+	return 0.0;
+#endif
+}
+
+/*
+ * Check if progress reports are written.
+ */
+static bool
+isProgressEnabled(void)
+{
+	return progress.files[0] != NULL || progress.files[1] != NULL;
+}
+
+/*
+ * Get size of input file (0 if input is not a regular file).
+ */
+static double
+getInputSize(FILE *inputFile)
+{
+#ifdef _WIN32
+	struct _stati64 st;
+	if (_fstati64(_fileno(inputFile), &st) != 0
+		|| (st.st_mode & _S_IFMT) != _S_IFREG)
+	{
+		return 0.0;
+	}
+#else
+	struct stat st;
+	if (fstat(fileno(inputFile), &st) != 0 || !S_ISREG(st.st_mode)) {
+		return 0.0;
+	}
+#endif
+
+	return (double) st.st_size;
+}
+
+/*
+ * Open files of progress reports.
+ */
+static void
+openProgress(void)
+{
+	if (options.progressFd >= 0) {
+		progress.files[0] = fdopen(options.progressFd, "w");
+		if (progress.files[0] == NULL) {
+			throw std::string("can't open progress file descriptor");
+		}
+	}
+	if (options.metricsFileName != NULL) {
+		progress.files[1] = fopen(options.metricsFileName, "w");
+		if (progress.files[1] == NULL) {
+			throw std::string("can't open metrics file");
+		}
+	}
+
+	progress.startTime = get_time_ns();
+	progress.prevTime = progress.startTime;
+	progress.prevNumRecs = 0;
+	progress.prevInputBytes = 0;
+}
+
+/*
+ * Write progress report (JSON line) to files of progress reports,
+ * summary is written with event "summary" and status of conversion.
+ */
+static void
+writeProgress(Counters &counters, const char *event,
+	const char *errorMessage = NULL)
+{
+	if (!isProgressEnabled()) {
+		return;
+	}
+
+	// Get offset in input file after last parsed record (archive is
+	// read by reader directly, position of parsed data in compressed
+	// input file is not known).
+	double inputOffset = 0.0;
+	if (progress.inputFile == NULL) {
+		// Input file is not opened yet.
+	} else if (options.inputFormat == FORMAT_ARCHIVE) {
+#ifdef _WIN32
+		inputOffset = (double) _ftelli64(progress.inputFile);
+#else
+		inputOffset = (double) ftello(progress.inputFile);
+#endif
+		if (inputOffset < 0.0) {
+			inputOffset = 0.0;
+		}
+	} else if (marcCompressedInput.getFormat() != COMPRESSION_NONE
+		|| options.inputFormat == FORMAT_BINARY)
+	{
+		inputOffset = (double) statistics.inputFile.inputBytes;
+	} else if (options.inputFormat == FORMAT_MARCXML) {
+		inputOffset = (double) marcXmlReader.getInputPos();
+	} else if (options.inputFormat == FORMAT_JSON
+		|| options.inputFormat == FORMAT_JSONL)
+	{
+		inputOffset = (double) marcJsonReader.getInputPos();
+	} else {
+		inputOffset = (double) marcIsoReader.getInputPos();
+	}
+
+	// Get number of processed input bytes (decompressed data, blocks of
+	// archive are decompressed by reader).
+	unsigned long long inputBytes = options.inputFormat == FORMAT_ARCHIVE
+		? (unsigned long long) inputOffset : statistics.io.inputBytes;
+
+	// Get throughput since previous report.
+	unsigned long long curTime = get_time_ns();
+	int numReadRecs = counters.recNo > 0 ? counters.recNo - 1 : 0;
+	double interval = (double) (curTime - progress.prevTime) / 1e9;
+	if (interval <= 0.0) {
+		interval = 1e-9;
+	}
+	double recordsRate = (double) (numReadRecs - progress.prevNumRecs)
+		/ interval;
+	double bytesRate = (double) (inputBytes - progress.prevInputBytes)
+		/ interval;
+	progress.prevTime = curTime;
+	progress.prevNumRecs = numReadRecs;
+	progress.prevInputBytes = inputBytes;
+
+	// Format report.
+	char line[512];
+	sprintf(line, "{\"event\":\"%s\",\"time\":%.3f,\"records\":%d,"
+		"\"converted\":%d,\"errors\":%d,\"input_bytes\":%.0f,"
+		"\"output_bytes\":%.0f,\"input_offset\":%.0f,", event,
+		(double) (curTime - progress.startTime) / 1e9, numReadRecs,
+		counters.numConvertedRecs, counters.numBadRecs,
+		(double) inputBytes, (double) statistics.io.outputBytes,
+		inputOffset);
+	std::string report = line;
+	if (progress.inputSize > 0.0) {
+		sprintf(line, "\"input_size\":%.0f,\"percent\":%.2f,",
+			progress.inputSize,
+			inputOffset * 100.0 / progress.inputSize);
+	} else {
+		sprintf(line, "\"input_size\":null,\"percent\":null,");
+	}
+	report += line;
+	sprintf(line, "\"records_per_second\":%.1f,"
+		"\"bytes_per_second\":%.0f", recordsRate, bytesRate);
+	report += line;
+	if (strcmp(event, "summary") == 0) {
+		report += errorMessage == NULL ? ",\"status\":\"ok\""
+			: ",\"status\":\"error\",\"error\":\"";
+		if (errorMessage != NULL) {
+			for (const char *p = errorMessage; *p != '\0'; p++) {
+				if (*p == '"' || *p == '\\') {
+					report += '\\';
+				}
+				report += (unsigned char) *p < 0x20 ? ' ' : *p;
+			}
+			report += '"';
+		}
+	}
+	report += "}\n";
+
+	// Write report to files.
+	for (int i = 0; i < 2; i++) {
+		if (progress.files[i] != NULL) {
+			fputs(report.c_str(), progress.files[i]);
+			fflush(progress.files[i]);
+		}
+	}
+}
+
+/*
+ * Close files of progress reports.
+ */
+static void
+closeProgress(void)
+{
+	for (int i = 0; i < 2; i++) {
+		if (progress.files[i] != NULL) {
+			fclose(progress.files[i]);
+			progress.files[i] = NULL;
+		}
+	}
+}
+
+/*
+ * Print conversion statistics (as text or JSON) to stderr.
+ */
+static void
+printStatistics(Counters &counters, unsigned long long usedTime)
+{
+	const MarcStats &io = statistics.io;
+	MarcLatencyHistogram &latency = statistics.latency;
+
+	// Get times of conversion phases.
+	const char *phaseNames[] = { "read", "frame", "parse", "transcode",
+		"serialize", "write", "other" };
+	double phaseTimes[7];
+	phaseTimes[0] = (double) io.readTime;
+	phaseTimes[1] = io.frameTime > io.readTime
+		? (double) (io.frameTime - io.readTime) : 0.0;
+	phaseTimes[2] = statistics.parseTime > 0
+		? (double) statistics.parseTime : 0.0;
+	phaseTimes[3] = (double) (io.decodeTime + io.encodeTime);
+	phaseTimes[4] = statistics.serializeTime > 0
+		? (double) statistics.serializeTime : 0.0;
+	phaseTimes[5] = (double) io.writeTime;
+	phaseTimes[6] = (double) usedTime;
+	for (int i = 0; i < 6; i++) {
+		phaseTimes[6] -= phaseTimes[i];
+	}
+	if (phaseTimes[6] < 0.0) {
+		phaseTimes[6] = 0.0;
+	}
+
+	double seconds = usedTime > 0 ? (double) usedTime / 1e9 : 1e-9;
+	int numReadRecs = counters.recNo - 1;
+
+	if (strcmp(options.statsFormat, "json") == 0) {
+		fprintf(stderr, "{\"records\":%d,\"converted\":%d,"
+			"\"errors\":%d,\"time_ns\":%.0f,"
+			"\"input_bytes\":%.0f,\"output_bytes\":%.0f,",
+			numReadRecs, counters.numConvertedRecs,
+			counters.numBadRecs, (double) usedTime,
+			(double) io.inputBytes, (double) io.outputBytes);
+		fprintf(stderr, "\"phases_ns\":{");
+		for (int i = 0; i < 7; i++) {
+			fprintf(stderr, "%s\"%s\":%.0f", i > 0 ? "," : "",
+				phaseNames[i], phaseTimes[i]);
+		}
+		fprintf(stderr, "},\"latency_ns\":{\"count\":%.0f,"
+			"\"mean\":%.0f,\"p50\":%.0f,\"p99\":%.0f,"
+			"\"max\":%.0f},",
+			(double) latency.getCount(), (double) latency.getMean(),
+			(double) latency.getPercentile(0.5),
+			(double) latency.getPercentile(0.99),
+			(double) latency.getMax());
+		fprintf(stderr, "\"allocations\":%.0f,"
+			"\"peak_rss_bytes\":%.0f}\n",
+			(double) numAllocations, getPeakRss());
+		return;
+	}
+
+	fprintf(stderr, "Records: %d read, %d converted, %d with errors\n",
+		numReadRecs, counters.numConvertedRecs, counters.numBadRecs);
+	fprintf(stderr, "Time: %.3f s (%.0f records/s)\n", seconds,
+		(double) numReadRecs / seconds);
+	fprintf(stderr, "Input: %.0f bytes (%.1f MB/s)\n",
+		(double) io.inputBytes, (double) io.inputBytes / seconds / 1e6);
+	fprintf(stderr, "Output: %.0f bytes (%.1f MB/s)\n",
+		(double) io.outputBytes,
+		(double) io.outputBytes / seconds / 1e6);
+	fprintf(stderr, "Phases:\n");
+	for (int i = 0; i < 7; i++) {
+		fprintf(stderr, "  %-10s %10.3f ms %5.1f%%\n", phaseNames[i],
+			phaseTimes[i] / 1e6,
+			phaseTimes[i] * 100.0 / (seconds * 1e9));
+	}
+	fprintf(stderr, "Record latency: p50 %.1f us, p99 %.1f us, "
+		"max %.1f us, mean %.1f us\n",
+		(double) latency.getPercentile(0.5) / 1e3,
+		(double) latency.getPercentile(0.99) / 1e3,
+		(double) latency.getMax() / 1e3,
+		(double) latency.getMean() / 1e3);
+	fprintf(stderr, "Allocations: %.0f (%.1f per record)\n",
+		(double) numAllocations, numReadRecs > 0
+		? (double) numAllocations / numReadRecs : 0.0);
+	fprintf(stderr, "Peak RSS: %.0f KB\n", getPeakRss() / 1024.0);
+}
+
+/*
+ * Check if format is table of selected columns.
+ */
+static bool
+isTableFormat(RecordFormat format)
+{
+	return format == FORMAT_CSV || format == FORMAT_TSV
+		|| format == FORMAT_ARROW;
+}
+
+/*
+ * Check if encoding is UTF-8 (default encoding).
+ */
+static bool
+isDefaultEncoding(const char *encoding)
+{
+	return encoding == NULL || strcmp(encoding, "UTF-8") == 0
+		|| strcmp(encoding, "utf-8") == 0;
+}
+
+/*
+ * Get compression format of output file (specified by option or by
+ * extension of output file name).
+ */
+static CompressionFormat
+getOutputCompression(void)
+{
+	const char *format = options.compressFormat;
+	if (format == NULL && options.outputFileName != NULL) {
+		// Detect format by extension of output file name.
+		const char *extension = strrchr(options.outputFileName, '.');
+		format = extension == NULL ? "none" : extension + 1;
+	}
+
+	if (format == NULL || strcmp(format, "none") == 0) {
+		return COMPRESSION_NONE;
+	} else if (strcmp(format, "gz") == 0
+		|| strcmp(format, "gzip") == 0)
+	{
+		return COMPRESSION_GZIP;
+	} else if (strcmp(format, "zst") == 0
+		|| strcmp(format, "zstd") == 0)
+	{
+		return COMPRESSION_ZSTD;
+	} else if (options.compressFormat != NULL) {
+		throw std::string("unknown compression format");
+	}
+
+	return COMPRESSION_NONE;
+}
+
+/*
+ * Check if records can be copied from input to output without parsing
+ * (same format and encoding, no transformations).
+ */
+static bool
+isRawCopyPossible(void)
+{
+	if (options.inputFormat != FORMAT_ISO2709
+		|| options.outputFormat != FORMAT_ISO2709
+		|| options.permissiveRead)
+	{
+		return false;
+	}
+
+	if (isDefaultEncoding(options.inputEncoding)
+		|| isDefaultEncoding(options.outputEncoding))
+	{
+		return isDefaultEncoding(options.inputEncoding)
+			&& isDefaultEncoding(options.outputEncoding);
+	}
+
+	return strcmp(options.inputEncoding, options.outputEncoding) == 0;
+}
+
+/*
+ * Check if conversion can be resumed from checkpoint (input is seekable
+ * at record boundary, output can be truncated and appended).
+ */
+static void
+checkResumable(void)
+{
+	if (options.inputFileName == NULL
+		|| strcmp(options.inputFileName, "-") == 0
+		|| options.outputFileName == NULL
+		|| strcmp(options.outputFileName, "-") == 0)
+	{
+		throw std::string("checkpoints require input and output files");
+	}
+	if (options.inputFormat != FORMAT_ISO2709
+		&& options.inputFormat != FORMAT_MARCXML)
+	{
+		throw std::string("checkpoints are not supported "
+			"for input format");
+	}
+	switch (options.outputFormat) {
+	case FORMAT_ISO2709:
+	case FORMAT_MARCXML:
+	case FORMAT_UNIMARCXML:
+	case FORMAT_TEXT:
+	case FORMAT_JSONL:
+	case FORMAT_CSV:
+	case FORMAT_TSV:
+		break;
+	default:
+		throw std::string("checkpoints are not supported "
+			"for output format");
+	}
+	if (getOutputCompression() != COMPRESSION_NONE) {
+		throw std::string("checkpoints are not supported "
+			"for compressed output");
+	}
+	if (options.asyncBlocks > 0 || options.directIo) {
+		throw std::string("checkpoints are not supported "
+			"with asynchronous input or direct i/o");
+	}
+}
+
+/*
+ * Read checkpoint from checkpoint file.
+ */
+static void
+readCheckpoint(Checkpoint &checkpoint)
+{
+	FILE *checkpointFile = fopen(options.checkpointFileName, "r");
+	if (checkpointFile == NULL) {
+		throw std::string("can't open checkpoint file");
+	}
+
+	// Parse lines with names and values.
+	int numValues = 0;
+	char line[256], name[64];
+	double value;
+	while (fgets(line, sizeof(line), checkpointFile) != NULL) {
+		if (line[0] == '#' || sscanf(line, "%63s %lf", name, &value) != 2) {
+			continue;
+		}
+		numValues++;
+		if (strcmp(name, "input_pos") == 0) {
+			checkpoint.inputPos = value;
+		} else if (strcmp(name, "output_length") == 0) {
+			checkpoint.outputLength = value;
+		} else if (strcmp(name, "record") == 0) {
+			checkpoint.counters.recNo = (int) value;
+		} else if (strcmp(name, "converted_records") == 0) {
+			checkpoint.counters.numConvertedRecs = (int) value;
+		} else if (strcmp(name, "bad_records") == 0) {
+			checkpoint.counters.numBadRecs = (int) value;
+		} else {
+			numValues--;
+		}
+	}
+	fclose(checkpointFile);
+
+	if (numValues != 5) {
+		throw std::string("invalid checkpoint file");
+	}
+}
+
+/*
+ * Write checkpoint to checkpoint file (temporary file is renamed, so
+ * previous checkpoint is kept if writing fails).
+ */
+static void
+writeCheckpoint(const Checkpoint &checkpoint)
+{
+	std::string tempFileName = options.checkpointFileName;
+	tempFileName += ".tmp";
+	FILE *checkpointFile = fopen(tempFileName.c_str(), "w");
+	if (checkpointFile == NULL) {
+		throw std::string("can't write checkpoint file");
+	}
+
+	fprintf(checkpointFile, "# marc-convert checkpoint\n");
+	fprintf(checkpointFile, "input_pos %.0f\n", checkpoint.inputPos);
+	fprintf(checkpointFile, "output_length %.0f\n",
+		checkpoint.outputLength);
+	fprintf(checkpointFile, "record %d\n", checkpoint.counters.recNo);
+	fprintf(checkpointFile, "converted_records %d\n",
+		checkpoint.counters.numConvertedRecs);
+	fprintf(checkpointFile, "bad_records %d\n",
+		checkpoint.counters.numBadRecs);
+	bool writeStatus = fflush(checkpointFile) == 0
+		&& !ferror(checkpointFile);
+	fclose(checkpointFile);
+
+#ifdef _WIN32
+	remove(options.checkpointFileName);
+#endif
+	if (!writeStatus
+		|| rename(tempFileName.c_str(), options.checkpointFileName) != 0)
+	{
+		remove(tempFileName.c_str());
+		throw std::string("can't write checkpoint file");
+	}
+}
+
+/*
+ * Save checkpoint of conversion before reading of next record.
+ */
+static void
+saveCheckpoint(Counters &counters, MarcWriter *marcWriter)
+{
+	// Flush output at record boundary.
+	if (!marcWriter->flush()) {
+		throw marcWriter->getErrorMessage();
+	}
+
+	Checkpoint checkpoint;
+	checkpoint.inputPos = (double) (options.inputFormat == FORMAT_MARCXML
+		? marcXmlReader.getInputPos() : marcIsoReader.getInputPos());
+	checkpoint.outputLength = resumedOutputLength
+		+ (double) statistics.io.outputBytes;
+	checkpoint.counters = counters;
+	writeCheckpoint(checkpoint);
+}
+
+/*
+ * Open output file of resumed conversion (output is truncated to length
+ * saved in checkpoint).
+ */
+static FILE *
+openResumedOutput(const Checkpoint &checkpoint)
+{
+	FILE *outputFile = fopen(options.outputFileName, "r+b");
+	if (outputFile == NULL) {
+		throw std::string("can't open output file.");
+	}
+
+#ifdef _WIN32
+	bool truncateStatus = _chsize_s(_fileno(outputFile),
+		(long long) checkpoint.outputLength) == 0
+		&& _fseeki64(outputFile, 0, SEEK_END) == 0;
+#else
+	bool truncateStatus = ftruncate(fileno(outputFile),
+		(off_t) checkpoint.outputLength) == 0
+		&& fseeko(outputFile, 0, SEEK_END) == 0;
+#endif
+	if (!truncateStatus) {
+		fclose(outputFile);
+		throw std::string("can't truncate output file");
+	}
+
+	return outputFile;
+}
+
+/*
+ * Stop following of input file (signal handler).
+ */
+static void
+stopFollowing(int)
+{
+	MarcFollowInput::stop();
+}
+
+/*
+ * Check if input file can be followed and stop following on SIGINT and
+ * SIGTERM (conversion is finished normally).
+ */
+static void
+startFollowing(void)
+{
+	if (options.inputFileName == NULL
+		|| strcmp(options.inputFileName, "-") == 0)
+	{
+		throw std::string("following requires input file");
+	}
+	if (options.inputFormat != FORMAT_ISO2709) {
+		throw std::string("following is supported only "
+			"for ISO 2709 input");
+	}
+	if (options.asyncBlocks > 0) {
+		throw std::string("following is not supported "
+			"with asynchronous input");
+	}
+
+	signal(SIGINT, stopFollowing);
+	signal(SIGTERM, stopFollowing);
+}
+
+/*
+ * Copy or skip ISO 2709 record without parsing (only leader and directory
+ * are validated). Side effect: updates counters.
+ */
+static bool
+copyRawRecord(Counters &counters)
+{
+	// Read raw record from input file.
+	const char *recordBuf;
+	unsigned int recordLen;
+
+	if (!marcIsoReader.nextRaw(recordBuf, recordLen)) {
+		switch (marcIsoReader.getErrorCode()) {
+		case MarcReader::END_OF_FILE:
+			return false;
+		case MarcReader::ERROR_INVALID_RECORD:
+			counters.numBadRecs++;
+			throw marcIsoReader.getErrorMessage();
+		default:
+			throw marcIsoReader.getErrorMessage();
+		}
+	}
+	if (options.statsFormat != NULL) {
+		endPhase(statistics.parseTime);
+	}
+
+	// Write raw record to output file.
+	if (counters.recNo > options.skipRecs) {
+		if (!marcIsoWriter.writeRaw(recordBuf, recordLen)) {
+			counters.numBadRecs++;
+			throw marcIsoWriter.getErrorMessage();
+		}
+		counters.numConvertedRecs++;
+		if (options.statsFormat != NULL) {
+			endPhase(statistics.serializeTime);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Parse size in bytes (with optional suffix k, m or g).
+ */
+static unsigned long long
+parseSize(const char *sizeStr)
+{
+	char *suffix;
+	unsigned long long size = strtoull(sizeStr, &suffix, 10);
+	switch (*suffix) {
+	case 'k':
+	case 'K':
+		return size << 10;
+	case 'm':
+	case 'M':
+		return size << 20;
+	case 'g':
+	case 'G':
+		return size << 30;
+	default:
+		return size;
+	}
+}
+
+/*
+ * Get number of online processors (default number of worker threads).
+ */
+static int
+getNumProcessors(void)
+{
+#ifdef _WIN32
+	const char *numProcessors = getenv("NUMBER_OF_PROCESSORS");
+	return numProcessors != NULL && atoi(numProcessors) > 0
+		? atoi(numProcessors) : 1;
+#else
+	long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+	return numProcessors > 0 ? (int) numProcessors : 1;
+#endif
+}
+
+/*
+ * Check if output is split into chunk files.
+ */
+static bool
+isSplitMode(void)
+{
+	return options.splitRecords > 0 || options.splitBytes > 0;
+}
+
+/*
+ * Check if output can be split into chunk files (records are written
+ * independently, chunks are complete files with header and footer).
+ */
+static void
+checkSplittable(void)
+{
+	if (options.outputFileName == NULL
+		|| strcmp(options.outputFileName, "-") == 0)
+	{
+		throw std::string("split output requires output file");
+	}
+	switch (options.outputFormat) {
+	case FORMAT_ISO2709:
+	case FORMAT_MARCXML:
+	case FORMAT_UNIMARCXML:
+	case FORMAT_JSONL:
+		break;
+	default:
+		throw std::string("split output is not supported "
+			"for output format");
+	}
+	if (options.checkpointFileName != NULL || options.follow
+		|| options.asyncBuffers > 0 || options.directIo)
+	{
+		throw std::string("split output is not supported with "
+			"checkpoints, following, asynchronous output "
+			"or direct i/o");
+	}
+}
+
+/*
+ * Write header of chunk file.
+ */
+static void
+writeChunkHeader(void)
+{
+	if (options.outputFormat == FORMAT_MARCXML) {
+		marcXmlWriter.writeHeader();
+	} else if (options.outputFormat == FORMAT_UNIMARCXML) {
+		unimarcXmlWriter.writeHeader();
+	} else if (options.outputFormat == FORMAT_JSONL
+		&& !marcJsonWriter.writeHeader())
+	{
+		throw marcJsonWriter.getErrorMessage();
+	}
+}
+
+/*
+ * Write footer of chunk file.
+ */
+static void
+writeChunkFooter(void)
+{
+	if (options.outputFormat == FORMAT_MARCXML) {
+		marcXmlWriter.writeFooter();
+	} else if (options.outputFormat == FORMAT_UNIMARCXML) {
+		unimarcXmlWriter.writeFooter();
+	} else if (options.outputFormat == FORMAT_JSONL
+		&& !marcJsonWriter.writeFooter())
+	{
+		throw marcJsonWriter.getErrorMessage();
+	}
+}
+
+/*
+ * Start new chunk of split output (header is written to chunk, length of
+ * footer is measured).
+ */
+static void
+startChunk(MarcWriter *marcWriter)
+{
+	splitOutput.chunkData.clear();
+	splitOutput.firstRecNo = 0;
+	splitOutput.lastRecNo = 0;
+	splitOutput.numRecs = 0;
+
+	// Encoding state is reset for each chunk file.
+	marcSplitOutput.open(&splitOutput.chunkData);
+	if (!marcWriter->reset()) {
+		throw marcWriter->getErrorMessage();
+	}
+	writeChunkHeader();
+	if (!marcWriter->flush()) {
+		throw marcWriter->getErrorMessage();
+	}
+
+	std::string footer;
+	marcSplitOutput.open(&footer);
+	writeChunkFooter();
+	if (!marcWriter->flush()) {
+		throw marcWriter->getErrorMessage();
+	}
+	splitOutput.footerLength = footer.size();
+
+	// Records are collected separately to check size of chunk.
+	marcSplitOutput.open(&splitOutput.recordData);
+}
+
+/*
+ * Finish chunk of split output (footer is written, chunk is passed to
+ * writer threads).
+ */
+static void
+finishChunk(MarcWriter *marcWriter)
+{
+	marcSplitOutput.open(&splitOutput.chunkData);
+	writeChunkFooter();
+	if (!marcWriter->flush()) {
+		throw marcWriter->getErrorMessage();
+	}
+	marcSplitOutput.open(&splitOutput.recordData);
 
-// Records readers.
-MarcIsoReader marcIsoReader;
-MarcXmlReader marcXmlReader;
+	if (!marcChunkPool.write(splitOutput.chunkData,
+		(unsigned int) splitOutput.firstRecNo,
+		(unsigned int) splitOutput.lastRecNo,
+		(unsigned int) splitOutput.numRecs))
+	{
+		throw marcChunkPool.getErrorMessage();
+	}
+}
 
-// Records writers.
-MarcIsoWriter marcIsoWriter;
-MarcTextWriter marcTextWriter;
-MarcXmlWriter marcXmlWriter;
-UnimarcXmlWriter unimarcXmlWriter;
+/*
+ * Append converted record to chunk of split output (next chunk is
+ * started if record exceeds limits of chunk).
+ */
+static void
+writeChunkRecord(Counters &counters, MarcWriter *marcWriter)
+{
+	if (!marcWriter->flush()) {
+		throw marcWriter->getErrorMessage();
+	}
+
+	// Check limits of chunk.
+	if (splitOutput.numRecs > 0
+		&& ((options.splitRecords > 0
+		&& splitOutput.numRecs >= options.splitRecords)
+		|| (options.splitBytes > 0
+		&& splitOutput.chunkData.size() + splitOutput.recordData.size()
+		+ splitOutput.footerLength > options.splitBytes)))
+	{
+		finishChunk(marcWriter);
+		startChunk(marcWriter);
+	}
+
+	// Append record to chunk.
+	if (splitOutput.numRecs == 0) {
+		splitOutput.firstRecNo = counters.recNo;
+	}
+	splitOutput.lastRecNo = counters.recNo;
+	splitOutput.numRecs++;
+	splitOutput.chunkData.append(splitOutput.recordData);
+	splitOutput.recordData.clear();
+}
 
 /*
  * Convert record (read it from input file and write to output file).
@@ -94,6 +1155,13 @@ UnimarcXmlWriter unimarcXmlWriter;
 static bool
 convertRecord(Counters &counters)
 {
+	// Copy records in raw mode, skip records without parsing.
+	if (options.inputFormat == FORMAT_ISO2709
+		&& (rawCopyMode || counters.recNo <= options.skipRecs))
+	{
+		return copyRawRecord(counters);
+	}
+
 	// Read record from input file.
 	MarcRecord record;
 	bool readStatus;
@@ -128,28 +1196,79 @@ convertRecord(Counters &counters)
 			throw marcXmlReader.getErrorMessage();
 		}
 		break;
+	case FORMAT_ARCHIVE:
+		readStatus = marcArchiveReader.next(record);
+		if (readStatus) {
+			break;
+		}
+
+		switch (marcArchiveReader.getErrorCode()) {
+		case MarcReader::END_OF_FILE:
+			return false;
+		case MarcReader::ERROR_INVALID_RECORD:
+			counters.numBadRecs++;
+			throw marcArchiveReader.getErrorMessage();
+		default:
+			throw marcArchiveReader.getErrorMessage();
+		}
+		break;
+	case FORMAT_BINARY:
+		readStatus = marcBinaryReader.next(record);
+		if (readStatus) {
+			break;
+		}
+
+		switch (marcBinaryReader.getErrorCode()) {
+		case MarcReader::END_OF_FILE:
+			return false;
+		case MarcReader::ERROR_INVALID_RECORD:
+			counters.numBadRecs++;
+			throw marcBinaryReader.getErrorMessage();
+		default:
+			throw marcBinaryReader.getErrorMessage();
+		}
+		break;
+	case FORMAT_JSON:
+	case FORMAT_JSONL:
+		readStatus = marcJsonReader.next(record);
+		if (readStatus) {
+			break;
+		}
+
+		switch (marcJsonReader.getErrorCode()) {
+		case MarcReader::END_OF_FILE:
+			return false;
+		case MarcReader::ERROR_INVALID_RECORD:
+			counters.numBadRecs++;
+			throw marcJsonReader.getErrorMessage();
+		default:
+			throw marcJsonReader.getErrorMessage();
+		}
+		break;
 	default:
 		throw std::string("unknown input format");
 	}
+	if (options.statsFormat != NULL) {
+		endPhase(statistics.parseTime);
+	}
 
 	// Write record to output file.
 	if (readStatus && counters.recNo > options.skipRecs) {
-		counters.numConvertedRecs++;
-		std::string textRecord, textRecordRecoded;
+		MarcWriter *marcWriter;
 
 		switch (options.outputFormat) {
 		case FORMAT_ISO2709:
-			marcIsoWriter.write(record);
+			marcWriter = &marcIsoWriter;
 			break;
 		case FORMAT_MARCXML:
-			marcXmlWriter.write(record);
+			marcWriter = &marcXmlWriter;
 			break;
 		case FORMAT_UNIMARCXML:
-			unimarcXmlWriter.write(record);
+			marcWriter = &unimarcXmlWriter;
 			break;
 		case FORMAT_TEXT:
 			char recordHeader[30];
-			if (counters.numConvertedRecs > 1) {
+			if (counters.numConvertedRecs > 0) {
 				sprintf(recordHeader, "\nRecord %d\n",
 					counters.recNo);
 			} else {
@@ -158,11 +1277,36 @@ convertRecord(Counters &counters)
 			}
 
 			marcTextWriter.setRecordHeader(recordHeader);
-			marcTextWriter.write(record);
+			marcWriter = &marcTextWriter;
+			break;
+		case FORMAT_ARCHIVE:
+			marcWriter = &marcArchiveWriter;
+			break;
+		case FORMAT_BINARY:
+			marcWriter = &marcBinaryWriter;
+			break;
+		case FORMAT_JSON:
+		case FORMAT_JSONL:
+			marcWriter = &marcJsonWriter;
+			break;
+		case FORMAT_CSV:
+		case FORMAT_TSV:
+		case FORMAT_ARROW:
+			marcWriter = &marcColumnWriter;
 			break;
 		default:
 			throw std::string("unknown output format");
 		}
+
+		// Records rejected by writer are counted as bad records.
+		if (!marcWriter->write(record)) {
+			counters.numBadRecs++;
+			throw marcWriter->getErrorMessage();
+		}
+		counters.numConvertedRecs++;
+		if (options.statsFormat != NULL) {
+			endPhase(statistics.serializeTime);
+		}
 	}
 
 	return true;
@@ -175,9 +1319,39 @@ static bool
 convertFile(void)
 {
 	FILE *inputFile = NULL, *outputFile = NULL;
+	MarcReader *marcReader = NULL;
+	MarcWriter *marcWriter = NULL;
 	Counters counters = { 0, 0, 0 };
 
 	try {
+		// Check statistics format and start timing of conversion.
+		if (options.statsFormat != NULL
+			&& strcmp(options.statsFormat, "text") != 0
+			&& strcmp(options.statsFormat, "json") != 0)
+		{
+			throw std::string("unknown statistics format");
+		}
+		countAllocations = options.statsFormat != NULL;
+		unsigned long long statsStartTime = get_time_ns();
+
+		// Open files of progress reports.
+		openProgress();
+
+		// Read checkpoint of resumed conversion.
+		Checkpoint checkpoint = { 0.0, 0.0, { 0, 0, 0 } };
+		if (options.resume && options.checkpointFileName == NULL) {
+			throw std::string("checkpoint file is not specified");
+		}
+		if (options.checkpointFileName != NULL) {
+			checkResumable();
+		}
+		if (options.resume) {
+			readCheckpoint(checkpoint);
+		}
+		if (options.follow) {
+			startFollowing();
+		}
+
 		// Open input file.
 		if (options.inputFileName == NULL
 			|| strcmp(options.inputFileName, "-") == 0)
@@ -189,65 +1363,372 @@ convertFile(void)
 				throw std::string("can't open input file");
 			}
 		}
+		progress.inputFile = inputFile;
+		progress.inputSize = getInputSize(inputFile);
 
-		// Open output file.
-		if (options.outputFileName == NULL
+		// Open output file (chunks of split output are written to
+		// separate files).
+		if (isSplitMode()) {
+			checkSplittable();
+		} else if (options.outputFileName == NULL
 			|| strcmp(options.outputFileName, "-") == 0)
 		{
 			outputFile = stdout;
 		} else {
-			outputFile = fopen(options.outputFileName, "wb");
+			outputFile = options.resume
+				? openResumedOutput(checkpoint)
+				: fopen(options.outputFileName, "wb");
 			if (outputFile == NULL) {
 				throw std::string("can't open output file.");
 			}
 		}
 
+		// Check if records can be copied without parsing.
+		rawCopyMode = isRawCopyPossible();
+
+		// Read input file asynchronously (blocks are read ahead
+		// while records are parsed).
+		MarcInput *fileInput = &marcFileInput;
+		marcFileInput.open(inputFile);
+		if (options.follow) {
+			// Wait for data appended to input file at end of file.
+			marcFollowInput.open(inputFile, options.inputFileName,
+				options.followInterval);
+			fileInput = &marcFollowInput;
+		}
+		if (options.asyncBlocks > 0) {
+#ifndef _WIN32
+			if (options.inputFormat == FORMAT_ARCHIVE) {
+				throw std::string("asynchronous input is not "
+					"supported for archive");
+			}
+			if (!marcAsyncInput.open(&marcFileInput,
+				fileno(inputFile), options.asyncBlockSize > 0
+				? options.asyncBlockSize : MARC_ASYNC_BLOCK_SIZE,
+				options.asyncBlocks))
+			{
+				throw marcAsyncInput.getErrorMessage();
+			}
+			fileInput = &marcAsyncInput;
+#else
+			throw std::string("asynchronous input is not supported");
+#endif
+		}
+
+		// Count bytes read from input file (offset in input file for
+		// progress reports).
+		if (isProgressEnabled()) {
+			marcFileStatsInput.open(fileInput, &statistics.inputFile);
+			fileInput = &marcFileStatsInput;
+		}
+
+		// Detect compression of input file (blocks of archive are
+		// decompressed by archive reader).
+		if (options.inputFormat != FORMAT_ARCHIVE
+			&& !marcCompressedInput.open(fileInput))
+		{
+			throw marcCompressedInput.getErrorMessage();
+		}
+		if (options.follow
+			&& marcCompressedInput.getFormat() != COMPRESSION_NONE)
+		{
+			throw std::string("following of compressed input "
+				"is not supported");
+		}
+
 		// Open input file in MarcReader or MarcXmlReader.
 		switch (options.inputFormat) {
 		case FORMAT_ISO2709:
+			marcReader = &marcIsoReader;
 			marcIsoReader.open(inputFile, options.inputEncoding);
 			marcIsoReader.setAutoCorrectionMode(
 				options.permissiveRead);
+			// Fields are copied to ISO 2709 output without decoding,
+			// only selected fields are decoded for table output.
+			marcIsoReader.setLazyMode(
+				options.outputFormat == FORMAT_ISO2709
+				|| isTableFormat(options.outputFormat));
 			break;
 		case FORMAT_MARCXML:
+			marcReader = &marcXmlReader;
 			marcXmlReader.open(inputFile, options.inputEncoding);
 			marcXmlReader.setAutoCorrectionMode(
 				options.permissiveRead);
 			break;
+		case FORMAT_ARCHIVE:
+			marcReader = &marcArchiveReader;
+			if (!marcArchiveReader.open(inputFile,
+				options.inputEncoding))
+			{
+				throw marcArchiveReader.getErrorMessage();
+			}
+			marcArchiveReader.setAutoCorrectionMode(
+				options.permissiveRead);
+			// Fields are copied to ISO 2709 output without decoding,
+			// only selected fields are decoded for table output.
+			marcArchiveReader.setLazyMode(
+				options.outputFormat == FORMAT_ISO2709
+				|| options.outputFormat == FORMAT_ARCHIVE
+				|| isTableFormat(options.outputFormat));
+			break;
+		case FORMAT_BINARY:
+			marcReader = &marcBinaryReader;
+			marcBinaryReader.open(inputFile, options.inputEncoding);
+			break;
+		case FORMAT_JSON:
+		case FORMAT_JSONL:
+			marcReader = &marcJsonReader;
+			if (!marcJsonReader.open(inputFile,
+				options.inputEncoding))
+			{
+				throw marcJsonReader.getErrorMessage();
+			}
+			break;
 		default:
 			throw std::string("wrong input format specified");
 		}
+		if (options.inputFormat != FORMAT_ARCHIVE) {
+			MarcInput *input = &marcCompressedInput;
+			if (options.statsFormat != NULL || isProgressEnabled()
+				|| options.checkpointFileName != NULL)
+			{
+				// Count bytes and time of reading.
+				marcStatsInput.open(input, &statistics.io);
+				input = &marcStatsInput;
+			}
+			marcReader->setInput(input);
+		}
+		if (options.statsFormat != NULL) {
+			marcReader->setStats(&statistics.io);
+		}
+
+		// Continue reading after last record of checkpoint.
+		if (options.resume) {
+			unsigned long long inputPos =
+				(unsigned long long) checkpoint.inputPos;
+			if (options.inputFormat == FORMAT_MARCXML
+				? !marcXmlReader.seekInput(inputPos)
+				: !marcIsoReader.seekInput(inputPos))
+			{
+				throw marcReader->getErrorMessage();
+			}
+			statistics.inputFile.inputBytes = inputPos;
+			resumedOutputLength = checkpoint.outputLength;
+		}
 
 		// Open output file in *Writer.
 		switch (options.outputFormat) {
 		case FORMAT_ISO2709:
+			marcWriter = &marcIsoWriter;
 			marcIsoWriter.open(outputFile, options.outputEncoding);
 			break;
 		case FORMAT_MARCXML:
+			marcWriter = &marcXmlWriter;
 			marcXmlWriter.open(outputFile, options.outputEncoding);
-			marcXmlWriter.writeHeader();
 			break;
 		case FORMAT_UNIMARCXML:
+			marcWriter = &unimarcXmlWriter;
 			unimarcXmlWriter.open(outputFile,
 				options.outputEncoding);
-			unimarcXmlWriter.writeHeader();
 			break;
 		case FORMAT_TEXT:
+			marcWriter = &marcTextWriter;
 			marcTextWriter.open(outputFile,
 				options.outputEncoding);
 			marcTextWriter.setRecordFooter("\n");
 			break;
+		case FORMAT_ARCHIVE:
+			marcWriter = &marcArchiveWriter;
+			marcArchiveWriter.open(outputFile,
+				options.outputEncoding);
+			marcArchiveWriter.setBlockRecords(options.blockRecords);
+			break;
+		case FORMAT_BINARY:
+			marcWriter = &marcBinaryWriter;
+			marcBinaryWriter.open(outputFile,
+				options.outputEncoding);
+			break;
+		case FORMAT_JSON:
+		case FORMAT_JSONL:
+			marcWriter = &marcJsonWriter;
+			marcJsonWriter.open(outputFile,
+				options.outputEncoding);
+			marcJsonWriter.setLinesMode(
+				options.outputFormat == FORMAT_JSONL);
+			break;
+		case FORMAT_CSV:
+		case FORMAT_TSV:
+		case FORMAT_ARROW:
+			marcWriter = &marcColumnWriter;
+			marcColumnWriter.open(outputFile,
+				options.outputEncoding);
+			marcColumnWriter.setTableFormat(
+				options.outputFormat == FORMAT_CSV
+				? MarcColumnWriter::TABLE_CSV
+				: options.outputFormat == FORMAT_TSV
+				? MarcColumnWriter::TABLE_TSV
+				: MarcColumnWriter::TABLE_ARROW);
+			if (options.columns == NULL) {
+				throw std::string("columns are not specified");
+			}
+			if (!marcColumnWriter.setColumns(options.columns)) {
+				throw marcColumnWriter.getErrorMessage();
+			}
+			if (options.joinSeparator != NULL) {
+				marcColumnWriter.setJoinSeparator(
+					options.joinSeparator);
+			}
+			break;
 		default:
 			throw std::string("wrong input format specified");
 		}
 
+		// Write output file with direct i/o.
+		MarcOutput *fileOutput = &marcFileOutput;
+		marcFileOutput.open(outputFile);
+		if (options.directIo) {
+#ifndef _WIN32
+			if (outputFile == stdout
+				|| !marcFdOutput.open(fileno(outputFile), true))
+			{
+				throw std::string("direct i/o is not supported "
+					"for output file");
+			}
+			fileOutput = &marcFdOutput;
+#else
+			throw std::string("direct i/o is not supported");
+#endif
+		}
+
+		// Write output file asynchronously (records are converted
+		// while previous buffer is written).
+		if (options.asyncBuffers > 0) {
+#ifndef _WIN32
+			fflush(outputFile);
+			if (!marcAsyncOutput.open(fileOutput, fileno(outputFile),
+				options.asyncBuffers))
+			{
+				throw marcAsyncOutput.getErrorMessage();
+			}
+			fileOutput = &marcAsyncOutput;
+#else
+			throw std::string("asynchronous output is not supported");
+#endif
+		}
+
+		// Compress output file (blocks of archive are compressed
+		// instead of output file).
+		CompressionFormat outputCompression = getOutputCompression();
+		if (options.outputFormat == FORMAT_ARCHIVE) {
+			if (options.compressFormat == NULL) {
+				outputCompression =
+					marcArchiveWriter.getCompression();
+			}
+			if (!marcArchiveWriter.setCompression(outputCompression,
+				options.compressLevel))
+			{
+				throw std::string("compression format "
+					"is not supported");
+			}
+			outputCompression = COMPRESSION_NONE;
+		}
+		if (isSplitMode()) {
+			// Chunk files are compressed by writer threads.
+			if (!marcChunkPool.open(options.outputFileName,
+				outputCompression, options.compressLevel,
+				options.numJobs > 0 ? options.numJobs
+				: getNumProcessors()))
+			{
+				throw marcChunkPool.getErrorMessage();
+			}
+			fileOutput = &marcSplitOutput;
+			outputCompression = COMPRESSION_NONE;
+		}
+		if (outputCompression != COMPRESSION_NONE) {
+			if (!marcCompressedOutput.open(fileOutput,
+				outputCompression, options.compressLevel,
+				options.compressThreads))
+			{
+				throw marcCompressedOutput.getErrorMessage();
+			}
+			fileOutput = &marcCompressedOutput;
+		}
+		if (options.statsFormat != NULL || isProgressEnabled()
+			|| options.checkpointFileName != NULL)
+		{
+			// Count bytes and time of writing.
+			marcStatsOutput.open(fileOutput, &statistics.io);
+			fileOutput = &marcStatsOutput;
+		}
+		if (options.statsFormat != NULL) {
+			marcWriter->setStats(&statistics.io);
+		}
+		marcWriter->setOutput(fileOutput);
+		if (options.follow) {
+			// Flush converted records while waiting for input.
+			marcFollowInput.setFlushWriter(marcWriter);
+		}
+
+		// Write header to output file.
+		if (options.resume) {
+			// Header is written before checkpoint.
+		} else if (isSplitMode()) {
+			// Header is written to each chunk.
+			startChunk(marcWriter);
+		} else if (options.outputFormat == FORMAT_MARCXML) {
+			marcXmlWriter.writeHeader();
+		} else if (options.outputFormat == FORMAT_UNIMARCXML) {
+			unimarcXmlWriter.writeHeader();
+		} else if (options.outputFormat == FORMAT_ARCHIVE
+			&& !marcArchiveWriter.writeHeader())
+		{
+			throw marcArchiveWriter.getErrorMessage();
+		} else if (options.outputFormat == FORMAT_BINARY
+			&& !marcBinaryWriter.writeHeader())
+		{
+			throw marcBinaryWriter.getErrorMessage();
+		} else if ((options.outputFormat == FORMAT_JSON
+			|| options.outputFormat == FORMAT_JSONL)
+			&& !marcJsonWriter.writeHeader())
+		{
+			throw marcJsonWriter.getErrorMessage();
+		} else if (isTableFormat(options.outputFormat)
+			&& !marcColumnWriter.writeHeader())
+		{
+			throw marcColumnWriter.getErrorMessage();
+		}
+
+		// Skip records of archive with index of blocks (records are
+		// skipped by reading if input file is not seekable).
+		int firstRecNo = 1;
+		if (options.resume) {
+			firstRecNo = checkpoint.counters.recNo;
+			counters.numConvertedRecs =
+				checkpoint.counters.numConvertedRecs;
+			counters.numBadRecs = checkpoint.counters.numBadRecs;
+		} else if (options.inputFormat == FORMAT_ARCHIVE
+			&& options.skipRecs > 0)
+		{
+			if (marcArchiveReader.seekRecord(options.skipRecs + 1)) {
+				firstRecNo = options.skipRecs + 1;
+			} else if (marcArchiveReader.getNumBlocks() > 0
+				&& marcArchiveReader.getErrorCode()
+				!= MarcReader::END_OF_FILE)
+			{
+				throw marcArchiveReader.getErrorMessage();
+			}
+		}
+
 		// Get process start time.
-		time_t startTime, curTime, prevTime;
+		time_t startTime, curTime, prevTime, nextProgressTime;
+		time_t nextCheckpointTime;
 		time(&startTime);
 		prevTime = startTime;
+		nextProgressTime = startTime + options.progressInterval;
+		nextCheckpointTime = startTime + options.checkpointInterval;
 
 		// Convert records from input file to output file.
-		for (counters.recNo = 1; options.numRecs == 0
+		for (counters.recNo = firstRecNo; options.numRecs == 0
 			|| counters.numConvertedRecs < options.numRecs;
 			counters.recNo++)
 		{
@@ -261,6 +1742,34 @@ convertFile(void)
 
 				prevTime = curTime;
 				fflush(stderr);
+
+				// Flush converted records of followed input.
+				if (options.follow && !marcWriter->flush()) {
+					throw marcWriter->getErrorMessage();
+				}
+			}
+
+			// Write progress report.
+			if (curTime >= nextProgressTime && isProgressEnabled()) {
+				writeProgress(counters, "progress");
+				nextProgressTime = curTime + options.progressInterval;
+			}
+
+			// Save checkpoint.
+			if (curTime >= nextCheckpointTime
+				&& options.checkpointFileName != NULL)
+			{
+				saveCheckpoint(counters, marcWriter);
+				nextCheckpointTime = curTime
+					+ options.checkpointInterval;
+			}
+
+			// Start timing of record conversion.
+			int numConvertedRecs = counters.numConvertedRecs;
+			unsigned long long recordStartTime = 0;
+			if (options.statsFormat != NULL) {
+				startPhase();
+				recordStartTime = statistics.phaseStartTime;
 			}
 
 			if (options.permissiveRead) {
@@ -271,7 +1780,7 @@ convertFile(void)
 				} catch (std::string errorMessage) {
 					if (options.verboseLevel > 2) {
 						fprintf(stderr, "\rRecord: %d", counters.recNo);
-						fprintf(stderr, "\nError: %s\n", marcIsoReader.getErrorMessage().c_str());
+						fprintf(stderr, "\nError: %s\n", errorMessage.c_str());
 						fflush(stderr);
 					}
 					continue;
@@ -281,14 +1790,98 @@ convertFile(void)
 					break;
 				}
 			}
+
+			// Add latency of converted record to statistics.
+			if (options.statsFormat != NULL
+				&& counters.numConvertedRecs > numConvertedRecs)
+			{
+				statistics.latency.add(get_time_ns()
+					- recordStartTime);
+			}
+
+			// Collect converted record to chunk of split output.
+			if (isSplitMode()
+				&& counters.numConvertedRecs > numConvertedRecs)
+			{
+				writeChunkRecord(counters, marcWriter);
+			}
 		}
 
-		if (options.outputFormat == FORMAT_MARCXML) {
+		if (isSplitMode()) {
+			// Write last chunk and wait for chunk files.
+			finishChunk(marcWriter);
+		} else if (options.outputFormat == FORMAT_MARCXML) {
 			// Write MARCXML footer to output file.
 			marcXmlWriter.writeFooter();
 		} else if (options.outputFormat == FORMAT_UNIMARCXML) {
 			// Write UNIMARCXML footer to output file.
 			unimarcXmlWriter.writeFooter();
+		} else if (options.outputFormat == FORMAT_ARCHIVE) {
+			// Write last block and index to archive.
+			if (!marcArchiveWriter.writeFooter()) {
+				throw marcArchiveWriter.getErrorMessage();
+			}
+		} else if (options.outputFormat == FORMAT_JSON
+			|| options.outputFormat == FORMAT_JSONL)
+		{
+			// Close JSON array of records.
+			if (!marcJsonWriter.writeFooter()) {
+				throw marcJsonWriter.getErrorMessage();
+			}
+		} else if (options.outputFormat == FORMAT_ARROW) {
+			// Write dictionaries and footer of Arrow file.
+			if (!marcColumnWriter.writeFooter()) {
+				throw marcColumnWriter.getErrorMessage();
+			}
+		}
+
+		// Write buffered records to output file.
+		if (!marcWriter->flush()) {
+			throw marcWriter->getErrorMessage();
+		}
+		marcWriter->close();
+		if (outputCompression != COMPRESSION_NONE
+			&& !marcCompressedOutput.close())
+		{
+			throw marcCompressedOutput.getErrorMessage();
+		}
+#ifndef _WIN32
+		if (options.asyncBuffers > 0 && !marcAsyncOutput.close()) {
+			throw marcAsyncOutput.getErrorMessage();
+		}
+#endif
+		if (isSplitMode()) {
+			// Write list of chunk files.
+			std::string manifestFileName =
+				std::string(options.outputFileName) + ".manifest";
+			if (!marcChunkPool.close()
+				|| !marcChunkPool.writeManifest(
+				manifestFileName.c_str()))
+			{
+				throw marcChunkPool.getErrorMessage();
+			}
+		}
+
+		// Check decompression and read errors.
+		if (marcCompressedInput.isError()) {
+			throw marcCompressedInput.getErrorMessage();
+		}
+		marcCompressedInput.close();
+		marcFollowInput.close();
+#ifndef _WIN32
+		if (marcAsyncInput.isError()) {
+			throw marcAsyncInput.getErrorMessage();
+		}
+		marcAsyncInput.close();
+#endif
+
+		// Write summary to files of progress reports.
+		writeProgress(counters, "summary");
+		closeProgress();
+
+		// Remove checkpoint of completed conversion.
+		if (options.checkpointFileName != NULL) {
+			remove(options.checkpointFileName);
 		}
 
 		// Close files.
@@ -296,7 +1889,7 @@ convertFile(void)
 			fclose(inputFile);
 			inputFile = NULL;
 		}
-		if (outputFile != stdout) {
+		if (outputFile && outputFile != stdout) {
 			fclose(outputFile);
 			outputFile = NULL;
 		}
@@ -320,9 +1913,18 @@ convertFile(void)
 				counters.numConvertedRecs);
 			fprintf(stderr, "Records with errors: %d\n",
 				counters.numBadRecs);
+			if (isSplitMode()) {
+				fprintf(stderr, "Chunk files: %d\n", (int)
+					marcChunkPool.getChunks().size());
+			}
 			fprintf(stderr, "Done in %d:%02d:%02d.\n",
 				usedHours, usedMinutes, usedSeconds);
 		}
+
+		// Print conversion statistics.
+		if (options.statsFormat != NULL) {
+			printStatistics(counters, get_time_ns() - statsStartTime);
+		}
 	} catch (std::string errorMessage) {
 		// Print error message.
 		if (options.verboseLevel > 1) {
@@ -331,6 +1933,25 @@ convertFile(void)
 		fprintf(stderr, "Error in record %d: %s.\n",
 			counters.recNo, errorMessage.c_str());
 
+		// Write summary with error to files of progress reports.
+		writeProgress(counters, "summary", errorMessage.c_str());
+		closeProgress();
+
+		// Write buffered records to output file.
+		if (marcWriter != NULL) {
+			marcWriter->close();
+		}
+		marcCompressedOutput.close();
+#ifndef _WIN32
+		marcAsyncOutput.close();
+#endif
+		marcChunkPool.close();
+		marcCompressedInput.close();
+		marcFollowInput.close();
+#ifndef _WIN32
+		marcAsyncInput.close();
+#endif
+
 		// Close files.
 		if (inputFile && inputFile != stdin) {
 			fclose(inputFile);
@@ -365,11 +1986,162 @@ parseRecordFormat(const char *formatName)
 		return FORMAT_UNIMARCXML;
 	} else if (strcmp(formatName, "text") == 0) {
 		return FORMAT_TEXT;
+	} else if (strcmp(formatName, "archive") == 0) {
+		return FORMAT_ARCHIVE;
+	} else if (strcmp(formatName, "binary") == 0) {
+		return FORMAT_BINARY;
+	} else if (strcmp(formatName, "json") == 0) {
+		return FORMAT_JSON;
+	} else if (strcmp(formatName, "jsonl") == 0) {
+		return FORMAT_JSONL;
+	} else if (strcmp(formatName, "csv") == 0) {
+		return FORMAT_CSV;
+	} else if (strcmp(formatName, "tsv") == 0) {
+		return FORMAT_TSV;
+	} else if (strcmp(formatName, "arrow") == 0) {
+		return FORMAT_ARROW;
 	}
 
 	return FORMAT_NULL;
 }
 
+/*
+ * Convert record format code to name.
+ */
+static const char *
+getRecordFormatName(RecordFormat format)
+{
+	switch (format) {
+	case FORMAT_ISO2709:
+		return "iso2709";
+	case FORMAT_MARCXML:
+		return "marcxml";
+	case FORMAT_UNIMARCXML:
+		return "unimarcxml";
+	case FORMAT_TEXT:
+		return "text";
+	case FORMAT_ARCHIVE:
+		return "archive";
+	case FORMAT_BINARY:
+		return "binary";
+	case FORMAT_JSON:
+		return "json";
+	case FORMAT_JSONL:
+		return "jsonl";
+	case FORMAT_CSV:
+		return "csv";
+	case FORMAT_TSV:
+		return "tsv";
+	case FORMAT_ARROW:
+		return "arrow";
+	default:
+		return "";
+	}
+}
+
+/*
+ * Check if input arguments require batch conversion (several inputs,
+ * directory or glob pattern).
+ */
+static bool
+isBatchMode(void)
+{
+	if (inputArgs.size() > 1) {
+		return true;
+	} else if (inputArgs.empty() || strcmp(inputArgs[0], "-") == 0) {
+		return false;
+	}
+
+	struct stat inputStat;
+	if (stat(inputArgs[0], &inputStat) == 0) {
+		return S_ISDIR(inputStat.st_mode);
+	}
+	return strpbrk(inputArgs[0], "*?[") != NULL;
+}
+
+/*
+ * Convert several input files in parallel.
+ */
+static bool
+convertFiles(void)
+{
+#ifdef _WIN32
+	fprintf(stderr, "Error: batch mode is not supported.\n");
+	return false;
+#else
+	// Check options (records are converted by in-memory converters).
+	if (options.outputFileName == NULL) {
+		fprintf(stderr, "Error: template of output file names "
+			"is required in batch mode.\n");
+		return false;
+	}
+	if (strstr(options.outputFileName, "%b") == NULL
+		&& strstr(options.outputFileName, "%f") == NULL
+		&& strstr(options.outputFileName, "%n") == NULL)
+	{
+		fprintf(stderr, "Error: template of output file names must "
+			"contain %%b, %%f or %%n.\n");
+		return false;
+	}
+	if (options.inputFormat != FORMAT_ISO2709
+		&& options.inputFormat != FORMAT_MARCXML
+		&& options.inputFormat != FORMAT_JSON
+		&& options.inputFormat != FORMAT_JSONL)
+	{
+		fprintf(stderr, "Error: input format is not supported "
+			"in batch mode.\n");
+		return false;
+	}
+	if (options.outputFormat != FORMAT_ISO2709
+		&& options.outputFormat != FORMAT_MARCXML
+		&& options.outputFormat != FORMAT_UNIMARCXML
+		&& options.outputFormat != FORMAT_TEXT
+		&& options.outputFormat != FORMAT_JSON
+		&& options.outputFormat != FORMAT_JSONL)
+	{
+		fprintf(stderr, "Error: output format is not supported "
+			"in batch mode.\n");
+		return false;
+	}
+	if (options.skipRecs > 0 || options.numRecs > 0 || isSplitMode()
+		|| options.compressFormat != NULL
+		|| options.asyncBlocks > 0 || options.asyncBuffers > 0
+		|| options.checkpointFileName != NULL || options.resume
+		|| options.follow || options.statsFormat != NULL
+		|| options.progressFd >= 0 || options.metricsFileName != NULL)
+	{
+		fprintf(stderr, "Error: options of single file conversion "
+			"can't be used in batch mode.\n");
+		return false;
+	}
+
+	// Expand input arguments.
+	std::vector<std::string> inputFileNames;
+	if (!expandBatchInputs(inputArgs, inputFileNames)) {
+		return false;
+	}
+	if (inputFileNames.empty()) {
+		fprintf(stderr, "Error: no input files.\n");
+		return false;
+	}
+
+	// Run batch.
+	BatchOptions batchOptions;
+	batchOptions.inputFormat = getRecordFormatName(options.inputFormat);
+	batchOptions.outputFormat = getRecordFormatName(options.outputFormat);
+	batchOptions.inputEncoding = options.inputEncoding;
+	batchOptions.outputEncoding = options.outputEncoding;
+	batchOptions.outputTemplate = options.outputFileName;
+	batchOptions.numJobs = options.numJobs > 0
+		? options.numJobs : getNumProcessors();
+	batchOptions.splitSize = options.splitSize;
+	batchOptions.permissiveRead = options.permissiveRead;
+	batchOptions.verboseLevel = options.verboseLevel;
+
+	return convertBatch(batchOptions, inputFileNames);
+#endif
+}
+
 /*
  * Display usage information.
  */
@@ -384,23 +2156,84 @@ displayUsage(void)
 		"\n",
 		"usage: marc-convert [-hpv]\n",
 		"  [-f srcfmt] [-t destfmt] [-e srcenc] [-r destenc]\n",
-		"  [-s numrecs] [-n numrecs] [-o outfile] [infile]\n",
+		"  [-s numrecs] [-n numrecs] [-j jobs] [-o outfile] [infile...]\n",
 		"\n",
 		"  -h --help        give this help\n",
+		"  -j --jobs        number of worker threads of batch conversion\n",
+		"                   (default: number of processors)\n",
+		"     --split-records\n",
+		"                   maximum number of records in chunk files\n",
+		"                   (outfile-0001.ext, ..., list of chunks with\n",
+		"                   record ranges is written to outfile.manifest)\n",
+		"     --split-bytes maximum size of chunk files (before\n",
+		"                   compression, suffixes k, m, g)\n",
+		"     --split-size  size of parts of large ISO 2709 and jsonl\n",
+		"                   files converted in parallel in batch mode\n",
+		"                   (0: files are not split, default: 16777216)\n",
 		"  -e --encoding    encoding of input file\n",
 		"                   default encoding: utf-8\n",
 		"  -f --from        format of input file (default: iso2709)\n",
-		"                   (iso2709, marcxml)\n",
+		"                   (iso2709, marcxml, archive, binary, json,\n",
+		"                   jsonl)\n",
 		"  -n --numrecs     number of records to convert\n",
 		"  -o --output      name of output file ('-' for stdout)\n",
 		"  -p --permissive  permissive reading (skip minor errors)\n",
 		"  -r --recode      encoding of output file\n",
 		"  -s --skiprecs    number of records to skip\n",
 		"  -t --to          format of output file (default: text)\n",
-		"                   (iso2709, marcxml, unimarcxml, text)\n",
+		"                   (iso2709, marcxml, unimarcxml, text,\n",
+		"                   archive, binary, json, jsonl, csv, tsv,\n",
+		"                   arrow)\n",
 		"  -v --verbose     increase verbosity level (repeatable)\n",
+		"     --direct-io   write output file with direct i/o\n",
+		"     --async-output\n",
+		"                   number of buffers of asynchronous output\n",
+		"                   (0: synchronous output, default)\n",
+		"     --async-input number of blocks read ahead of parsing\n",
+		"                   (0: synchronous input, default)\n",
+		"     --async-block-size\n",
+		"                   size of blocks of asynchronous input\n",
+		"                   (default: 1048576)\n",
+		"     --stats[=FORMAT]\n",
+		"                   print timings of conversion phases, latency\n",
+		"                   of records, i/o and memory usage to stderr\n",
+		"                   (text, json; default: text)\n",
+		"     --progress-fd write progress reports (JSON lines) and\n",
+		"                   summary to file descriptor\n",
+		"     --metrics-file\n",
+		"                   write progress reports and summary to file\n",
+		"     --progress-interval\n",
+		"                   seconds between progress reports (default: 1)\n",
+		"     --checkpoint  file of checkpoints for resuming conversion\n",
+		"     --checkpoint-interval\n",
+		"                   seconds between checkpoints (default: 60)\n",
+		"     --resume      resume conversion from checkpoint\n",
+		"     --follow      wait for records appended to ISO 2709 input\n",
+		"                   file (until SIGINT or SIGTERM)\n",
+		"     --follow-interval\n",
+		"                   milliseconds between checks of input file\n",
+		"                   (default: 1000)\n",
+		"     --compress    compression of output file\n",
+		"                   (none, gzip, zstd; default: by extension)\n",
+		"     --compress-level\n",
+		"                   compression level\n",
+		"     --compress-threads\n",
+		"                   number of zstd compression threads\n",
+		"     --block-records\n",
+		"                   number of records in archive block\n",
+		"     --columns     columns of csv, tsv or arrow output\n",
+		"                   (e.g. 001,200a,210$d,700$a)\n",
+		"     --join        separator of repeated values (default: |)\n",
 		"  infile           name of input file ('-' for stdin)\n",
 		"\n",
+		"Several input files, directories or quoted glob patterns are\n",
+		"converted in batch mode, outfile is template of output file\n",
+		"names: %d (directory), %f (file name), %b (file name without\n",
+		"extension), %n (number of file), %e (extension of format).\n",
+		"Options -s, -n, --split-records, --split-bytes, --compress,\n",
+		"--async-*, --stats, progress, checkpoint and follow options\n",
+		"are not supported in batch mode.\n",
+		"\n",
 		NULL};
 
 	/*
@@ -418,11 +2251,12 @@ displayUsage(void)
 static int
 parseCommandLine(int argc, char **argv)
 {
-	static const char *short_options = "hf:e:n:o:pr:s:t:v";
+	static const char *short_options = "hf:e:j:n:o:pr:s:t:v";
 	static struct option long_options[] = {
 		{ "help", no_argument, 0, 'h' },
 		{ "encoding", required_argument, 0, 'e' },
 		{ "from", required_argument, 0, 'f' },
+		{ "jobs", required_argument, 0, 'j' },
 		{ "numrecs", required_argument, 0, 'n' },
 		{ "output", required_argument, 0, 'o' },
 		{ "permissive", no_argument, 0, 'p' },
@@ -430,6 +2264,38 @@ parseCommandLine(int argc, char **argv)
 		{ "skiprecs", required_argument, 0, 's' },
 		{ "to", required_argument, 0, 't' },
 		{ "verbose", no_argument, 0, 'v' },
+		{ "direct-io", no_argument, 0, OPTION_DIRECT_IO },
+		{ "compress", required_argument, 0, OPTION_COMPRESS },
+		{ "compress-level", required_argument, 0,
+			OPTION_COMPRESS_LEVEL },
+		{ "compress-threads", required_argument, 0,
+			OPTION_COMPRESS_THREADS },
+		{ "block-records", required_argument, 0,
+			OPTION_BLOCK_RECORDS },
+		{ "columns", required_argument, 0, OPTION_COLUMNS },
+		{ "join", required_argument, 0, OPTION_JOIN },
+		{ "async-output", required_argument, 0,
+			OPTION_ASYNC_OUTPUT },
+		{ "async-input", required_argument, 0, OPTION_ASYNC_INPUT },
+		{ "async-block-size", required_argument, 0,
+			OPTION_ASYNC_BLOCK_SIZE },
+		{ "stats", optional_argument, 0, OPTION_STATS },
+		{ "progress-fd", required_argument, 0, OPTION_PROGRESS_FD },
+		{ "metrics-file", required_argument, 0,
+			OPTION_METRICS_FILE },
+		{ "progress-interval", required_argument, 0,
+			OPTION_PROGRESS_INTERVAL },
+		{ "checkpoint", required_argument, 0, OPTION_CHECKPOINT },
+		{ "checkpoint-interval", required_argument, 0,
+			OPTION_CHECKPOINT_INTERVAL },
+		{ "resume", no_argument, 0, OPTION_RESUME },
+		{ "follow", no_argument, 0, OPTION_FOLLOW },
+		{ "follow-interval", required_argument, 0,
+			OPTION_FOLLOW_INTERVAL },
+		{ "split-size", required_argument, 0, OPTION_SPLIT_SIZE },
+		{ "split-records", required_argument, 0,
+			OPTION_SPLIT_RECORDS },
+		{ "split-bytes", required_argument, 0, OPTION_SPLIT_BYTES },
 		{ 0, 0, 0, 0 }
 	};
 	int option;
@@ -448,6 +2314,9 @@ parseCommandLine(int argc, char **argv)
 		case 'f':
 			options.inputFormat = parseRecordFormat(optarg);
 			break;
+		case 'j':
+			options.numJobs = atol(optarg);
+			break;
 		case 'n':
 			options.numRecs = atol(optarg);
 			break;
@@ -469,13 +2338,82 @@ parseCommandLine(int argc, char **argv)
 		case 'v':
 			options.verboseLevel++;
 			break;
+		case OPTION_DIRECT_IO:
+			options.directIo = true;
+			break;
+		case OPTION_COMPRESS:
+			options.compressFormat = optarg;
+			break;
+		case OPTION_COMPRESS_LEVEL:
+			options.compressLevel = atol(optarg);
+			break;
+		case OPTION_COMPRESS_THREADS:
+			options.compressThreads = atol(optarg);
+			break;
+		case OPTION_BLOCK_RECORDS:
+			options.blockRecords = atol(optarg);
+			break;
+		case OPTION_COLUMNS:
+			options.columns = optarg;
+			break;
+		case OPTION_JOIN:
+			options.joinSeparator = optarg;
+			break;
+		case OPTION_ASYNC_OUTPUT:
+			options.asyncBuffers = atol(optarg);
+			break;
+		case OPTION_ASYNC_INPUT:
+			options.asyncBlocks = atol(optarg);
+			break;
+		case OPTION_ASYNC_BLOCK_SIZE:
+			options.asyncBlockSize = atol(optarg);
+			break;
+		case OPTION_STATS:
+			options.statsFormat = optarg != NULL ? optarg : "text";
+			break;
+		case OPTION_PROGRESS_FD:
+			options.progressFd = atol(optarg);
+			break;
+		case OPTION_METRICS_FILE:
+			options.metricsFileName = optarg;
+			break;
+		case OPTION_PROGRESS_INTERVAL:
+			options.progressInterval = atol(optarg);
+			break;
+		case OPTION_CHECKPOINT:
+			options.checkpointFileName = optarg;
+			break;
+		case OPTION_CHECKPOINT_INTERVAL:
+			options.checkpointInterval = atol(optarg);
+			break;
+		case OPTION_RESUME:
+			options.resume = true;
+			break;
+		case OPTION_FOLLOW:
+			options.follow = true;
+			break;
+		case OPTION_FOLLOW_INTERVAL:
+			options.followInterval = atol(optarg);
+			break;
+		case OPTION_SPLIT_SIZE:
+			options.splitSize = parseSize(optarg);
+			break;
+		case OPTION_SPLIT_RECORDS:
+			options.splitRecords = atol(optarg);
+			break;
+		case OPTION_SPLIT_BYTES:
+			options.splitBytes = parseSize(optarg);
+			break;
 		default:
 			return 2;
 		}
 	}
 
 	if (optind < argc) {
-		options.inputFileName = argv[optind++];
+		options.inputFileName = argv[optind];
+	}
+	while (optind < argc) {
+		inputArgs.push_back(argv[optind++]);
 	}
 
 	// If only input encoding specified then use it as output encoding too.
@@ -501,8 +2439,8 @@ main(int argc, char **argv)
 		return result_code;
 	}
 
-	// Convert file.
-	if(!convertFile()) {
+	// Convert file or batch of files.
+	if (isBatchMode() ? !convertFiles() : !convertFile()) {
 		fprintf(stderr, "Operation failed.\n");
 		return 1;
 	}
@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+extern "C" {
+#include <getopt.h>
+}
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include "marcrecord/marc_converter.h"
+#include "marcrecord/marc_socket.h"
+
+// Timeout of reading request and writing response (seconds).
+#define SERVER_IO_TIMEOUT	10
+
+using namespace marcrecord;
+
+// Application options structure.
+struct Options {
+	const char *socketPath;
+	int numWorkers;
+	int cacheSize;
+	int verboseLevel;
+};
+typedef struct Options Options;
+
+// Application options.
+static Options options = { NULL, 0, 16, 0 };
+
+// Cache of converters keyed by formats and encodings.
+typedef std::map<std::string, MarcConverter *> ConverterCache;
+
+// Shared state of server.
+struct Server {
+	// Listening socket.
+	int listenFd;
+	// Pipe waking up main loop (connections returned by workers, stop).
+	int wakeFds[2];
+	// Mutex of connection queues.
+	pthread_mutex_t mutex;
+	// Condition of ready connections.
+	pthread_cond_t readyCond;
+	// Connections with pending request.
+	std::deque<int> readyFds;
+	// Connections returned by workers after response.
+	std::vector<int> returnedFds;
+	// Stop of workers requested flag.
+	bool stopped;
+};
+typedef struct Server Server;
+
+static Server server;
+
+// Stop of server requested flag.
+static volatile sig_atomic_t serverStopped = 0;
+
+/*
+ * Request stop of server (signal handler).
+ */
+static void
+stopServer(int)
+{
+	serverStopped = 1;
+	if (write(server.wakeFds[1], "", 1) < 0) {
+		// Main loop is woken up by interrupted poll.
+	}
+}
+
+/*
+ * Get converter for request from cache of worker (converter is created
+ * on first use).
+ */
+static MarcConverter *
+getConverter(ConverterCache &converters, const MarcSocketRequest &request,
+	std::string &key, std::string &errorMessage)
+{
+	key.assign(request.inputFormat).append(1, '\0');
+	key.append(request.outputFormat).append(1, '\0');
+	key.append(request.inputEncoding).append(1, '\0');
+	key.append(request.outputEncoding);
+	ConverterCache::iterator converterIt = converters.find(key);
+	if (converterIt != converters.end()) {
+		return converterIt->second;
+	}
+
+	// Create converter (cache is cleared when full).
+	MarcConverter *converter = new MarcConverter();
+	if (!converter->open(request.inputFormat, request.outputFormat,
+		request.inputEncoding, request.outputEncoding))
+	{
+		errorMessage = converter->getErrorMessage();
+		delete converter;
+		return NULL;
+	}
+	if ((int) converters.size() >= options.cacheSize) {
+		for (converterIt = converters.begin();
+			converterIt != converters.end(); converterIt++)
+		{
+			delete converterIt->second;
+		}
+		converters.clear();
+	}
+	converters[key] = converter;
+
+	return converter;
+}
+
+/*
+ * Read request from connection and send response (false if connection
+ * should be closed).
+ */
+static bool
+handleRequest(int clientFd, ConverterCache &converters,
+	std::string &request, std::string &output, std::string &key)
+{
+	if (!read_frame(clientFd, request)) {
+		return false;
+	}
+
+	// Parse request and convert records.
+	MarcSocketRequest parsedRequest;
+	std::string errorMessage;
+	bool status = false;
+	if (!parse_request(request, parsedRequest)) {
+		errorMessage = "malformed request";
+	} else {
+		MarcConverter *converter = getConverter(converters,
+			parsedRequest, key, errorMessage);
+		if (converter != NULL) {
+			status = converter->convert(parsedRequest.data,
+				parsedRequest.dataLen, output);
+			if (!status) {
+				errorMessage = converter->getErrorMessage();
+			} else if (output.size() >= MARC_SOCKET_MAX_FRAME) {
+				// Response with status byte must fit in frame.
+				errorMessage = "response too large";
+				status = false;
+			}
+		}
+	}
+	if (!status && options.verboseLevel > 0) {
+		fprintf(stderr, "Error: %s.\n", errorMessage.c_str());
+	}
+
+	// Send response.
+	char statusByte = status ? SOCKET_STATUS_OK : SOCKET_STATUS_ERROR;
+	const std::string &responseData = status ? output : errorMessage;
+	return write_frame(clientFd, &statusByte, 1, responseData.data(),
+		responseData.size());
+}
+
+/*
+ * Worker thread (converters are kept warm in cache of worker).
+ */
+static void *
+runWorker(void *)
+{
+	ConverterCache converters;
+	std::string request, output, key;
+
+	for (;;) {
+		// Get connection with pending request.
+		pthread_mutex_lock(&server.mutex);
+		while (server.readyFds.empty() && !server.stopped) {
+			pthread_cond_wait(&server.readyCond, &server.mutex);
+		}
+		if (server.readyFds.empty()) {
+			pthread_mutex_unlock(&server.mutex);
+			break;
+		}
+		int clientFd = server.readyFds.front();
+		server.readyFds.pop_front();
+		pthread_mutex_unlock(&server.mutex);
+
+		// Answer request and return connection to main loop.
+		if (!handleRequest(clientFd, converters, request, output,
+			key))
+		{
+			close(clientFd);
+			continue;
+		}
+		pthread_mutex_lock(&server.mutex);
+		server.returnedFds.push_back(clientFd);
+		pthread_mutex_unlock(&server.mutex);
+		if (write(server.wakeFds[1], "", 1) < 0) {
+			// Pipe is full, main loop is woken up anyway.
+		}
+	}
+
+	for (ConverterCache::iterator converterIt = converters.begin();
+		converterIt != converters.end(); converterIt++)
+	{
+		delete converterIt->second;
+	}
+
+	return NULL;
+}
+
+/*
+ * Create listening socket (stale socket file is removed).
+ */
+static int
+createSocket(const char *socketPath)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Error: socket path is too long.\n");
+		return -1;
+	}
+	strcpy(addr.sun_path, socketPath);
+
+	struct stat socketStat;
+	if (lstat(socketPath, &socketStat) == 0
+		&& S_ISSOCK(socketStat.st_mode))
+	{
+		unlink(socketPath);
+	}
+
+	int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0 || bind(listenFd, (struct sockaddr *) &addr,
+		sizeof(addr)) != 0 || listen(listenFd, SOMAXCONN) != 0)
+	{
+		fprintf(stderr, "Error: can't listen on socket: %s.\n",
+			strerror(errno));
+		if (listenFd >= 0) {
+			close(listenFd);
+		}
+		return -1;
+	}
+
+	return listenFd;
+}
+
+/*
+ * Accept connections and dispatch connections with pending requests
+ * to workers (idle connections are watched by main loop).
+ */
+static void
+runServer(void)
+{
+	std::vector<int> idleFds;
+	std::vector<struct pollfd> pollFds;
+
+	while (!serverStopped) {
+		// Watch listening socket, wake up pipe and idle connections.
+		pollFds.resize(2 + idleFds.size());
+		pollFds[0].fd = server.listenFd;
+		pollFds[1].fd = server.wakeFds[0];
+		for (size_t i = 0; i < idleFds.size(); i++) {
+			pollFds[2 + i].fd = idleFds[i];
+		}
+		for (size_t i = 0; i < pollFds.size(); i++) {
+			pollFds[i].events = POLLIN;
+			pollFds[i].revents = 0;
+		}
+		if (poll(&pollFds[0], pollFds.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Error: poll failed: %s.\n",
+				strerror(errno));
+			break;
+		}
+
+		// Pass connections with pending requests to workers.
+		size_t numIdleFds = 0;
+		pthread_mutex_lock(&server.mutex);
+		for (size_t i = 0; i < idleFds.size(); i++) {
+			if (pollFds[2 + i].revents != 0) {
+				server.readyFds.push_back(idleFds[i]);
+				pthread_cond_signal(&server.readyCond);
+			} else {
+				idleFds[numIdleFds++] = idleFds[i];
+			}
+		}
+		idleFds.resize(numIdleFds);
+
+		// Watch connections returned by workers.
+		if (pollFds[1].revents != 0) {
+			char wakeBuf[256];
+			while (read(server.wakeFds[0], wakeBuf,
+				sizeof(wakeBuf)) > 0)
+			{
+			}
+			idleFds.insert(idleFds.end(),
+				server.returnedFds.begin(),
+				server.returnedFds.end());
+			server.returnedFds.clear();
+		}
+		pthread_mutex_unlock(&server.mutex);
+
+		// Accept new connection.
+		if (pollFds[0].revents != 0) {
+			int clientFd = accept(server.listenFd, NULL, NULL);
+			if (clientFd >= 0) {
+				fcntl(clientFd, F_SETFD, FD_CLOEXEC);
+				// Workers read requests with blocking reads,
+				// stalled client is disconnected after timeout.
+				struct timeval timeout;
+				timeout.tv_sec = SERVER_IO_TIMEOUT;
+				timeout.tv_usec = 0;
+				setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO,
+					&timeout, sizeof(timeout));
+				setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO,
+					&timeout, sizeof(timeout));
+				idleFds.push_back(clientFd);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < idleFds.size(); i++) {
+		close(idleFds[i]);
+	}
+}
+
+/*
+ * Display usage information.
+ */
+static void
+displayUsage(void)
+{
+	int i;
+	const char *help[] = {
+		"marc-server 1.4 (29 Apr 2019)\n",
+		"Convert MARC records for clients connected to local "
+		"socket.\n",
+		"\n",
+		"usage: marc-server [-hv] [-j workers] [-c cachesize] "
+		"-s socket\n",
+		"\n",
+		"  -h --help        give this help\n",
+		"  -c --cache       number of converters cached by worker\n",
+		"                   (default: 16)\n",
+		"  -j --workers     number of worker threads\n",
+		"                   (default: number of processors)\n",
+		"  -s --socket      path of listening socket\n",
+		"  -v --verbose     increase verbosity level (repeatable)\n",
+		"\n",
+		NULL};
+
+	for (i = 0; help[i] != NULL; i++) {
+		fputs(help[i], stderr);
+	}
+}
+
+/*
+ * Parse command line arguments.
+ */
+static int
+parseCommandLine(int argc, char **argv)
+{
+	static const char *short_options = "hc:j:s:v";
+	static struct option long_options[] = {
+		{ "help", no_argument, 0, 'h' },
+		{ "cache", required_argument, 0, 'c' },
+		{ "workers", required_argument, 0, 'j' },
+		{ "socket", required_argument, 0, 's' },
+		{ "verbose", no_argument, 0, 'v' },
+		{ 0, 0, 0, 0 }
+	};
+	int option;
+
+	while ((option = getopt_long(argc, argv, short_options,
+		long_options, NULL)) != -1)
+	{
+		switch (option) {
+		case 'h':
+			displayUsage();
+			return 2;
+		case 'c':
+			options.cacheSize = atol(optarg);
+			break;
+		case 'j':
+			options.numWorkers = atol(optarg);
+			break;
+		case 's':
+			options.socketPath = optarg;
+			break;
+		case 'v':
+			options.verboseLevel++;
+			break;
+		default:
+			return 2;
+		}
+	}
+
+	if (options.socketPath == NULL) {
+		displayUsage();
+		return 2;
+	}
+	if (options.numWorkers <= 0) {
+		long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+		options.numWorkers = numProcessors > 0
+			? (int) numProcessors : 1;
+	}
+	if (options.cacheSize <= 0) {
+		options.cacheSize = 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Main function.
+ */
+int
+main(int argc, char **argv)
+{
+	int result_code;
+
+	// Parse command line arguments.
+	result_code = parseCommandLine(argc, argv);
+	if (result_code != 0) {
+		return result_code;
+	}
+
+	// Create listening socket and wake up pipe.
+	server.listenFd = createSocket(options.socketPath);
+	if (server.listenFd < 0) {
+		return 1;
+	}
+	if (pipe(server.wakeFds) != 0) {
+		fprintf(stderr, "Error: can't create pipe.\n");
+		return 1;
+	}
+	fcntl(server.wakeFds[0], F_SETFL, O_NONBLOCK);
+	fcntl(server.wakeFds[1], F_SETFL, O_NONBLOCK);
+	pthread_mutex_init(&server.mutex, NULL);
+	pthread_cond_init(&server.readyCond, NULL);
+	server.stopped = false;
+
+	// Stop server on SIGINT and SIGTERM, ignore closed connections.
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+	signal(SIGPIPE, SIG_IGN);
+
+	// Start workers.
+	std::vector<pthread_t> workers(options.numWorkers);
+	for (int i = 0; i < options.numWorkers; i++) {
+		if (pthread_create(&workers[i], NULL, runWorker, NULL) != 0) {
+			fprintf(stderr, "Error: can't create worker thread.\n");
+			return 1;
+		}
+	}
+	if (options.verboseLevel > 0) {
+		fprintf(stderr, "Listening on %s with %d workers.\n",
+			options.socketPath, options.numWorkers);
+	}
+
+	runServer();
+
+	// Stop workers (pending requests are answered).
+	pthread_mutex_lock(&server.mutex);
+	server.stopped = true;
+	pthread_cond_broadcast(&server.readyCond);
+	pthread_mutex_unlock(&server.mutex);
+	for (int i = 0; i < options.numWorkers; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	for (size_t i = 0; i < server.returnedFds.size(); i++) {
+		close(server.returnedFds[i]);
+	}
+
+	close(server.listenFd);
+	unlink(options.socketPath);
+
+	return 0;
+}
@@ -0,0 +1,1049 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#include "marc_async.h"
+
+#define MARC_ASYNC_ALIGNMENT		4096
+
+namespace marcrecord {
+
+#ifdef HAVE_IO_URING
+/*
+ * Ring of io_uring instance (submission and completion queues mapped
+ * from kernel).
+ */
+struct MarcIoRing {
+	// File descriptor of io_uring instance.
+	int fd;
+	// Mapped submission queue ring.
+	void *sqRing;
+	// Size of mapped submission queue ring.
+	size_t sqRingSize;
+	// Mapped completion queue ring (may be the same as sqRing).
+	void *cqRing;
+	// Size of mapped completion queue ring.
+	size_t cqRingSize;
+	// Mapped submission queue entries.
+	struct io_uring_sqe *sqes;
+	// Size of mapped submission queue entries.
+	size_t sqesSize;
+	// Pointers to submission queue fields.
+	unsigned *sqTail, *sqMask, *sqArray;
+	// Pointers to completion queue fields.
+	unsigned *cqHead, *cqTail, *cqMask;
+	// Completion queue entries.
+	struct io_uring_cqe *cqes;
+	// I/O vectors of submitted operations.
+	std::vector<struct iovec> iov;
+};
+#endif
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+#ifdef HAVE_IO_URING
+/*
+ * Release io_uring instance.
+ */
+static void
+ring_destroy(MarcIoRing *ring)
+{
+	if (ring->sqes != NULL) {
+		munmap(ring->sqes, ring->sqesSize);
+	}
+	if (ring->cqRing != NULL && ring->cqRing != ring->sqRing) {
+		munmap(ring->cqRing, ring->cqRingSize);
+	}
+	if (ring->sqRing != NULL) {
+		munmap(ring->sqRing, ring->sqRingSize);
+	}
+	if (ring->fd >= 0) {
+		::close(ring->fd);
+	}
+
+	delete ring;
+}
+
+/*
+ * Create io_uring instance with specified number of entries.
+ */
+static MarcIoRing *
+ring_create(unsigned numEntries)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	MarcIoRing *ring = new MarcIoRing;
+	ring->sqRing = ring->cqRing = NULL;
+	ring->sqes = NULL;
+	ring->fd = (int) syscall(__NR_io_uring_setup, numEntries, &params);
+	if (ring->fd < 0) {
+		ring_destroy(ring);
+		return NULL;
+	}
+
+	// Map submission and completion queues.
+	ring->sqRingSize = params.sq_off.array
+		+ params.sq_entries * sizeof(unsigned);
+	ring->cqRingSize = params.cq_off.cqes
+		+ params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->sqRingSize = ring->cqRingSize =
+			std::max(ring->sqRingSize, ring->cqRingSize);
+	}
+	void *ptr = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED) {
+		ring_destroy(ring);
+		return NULL;
+	}
+	ring->sqRing = ptr;
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cqRing = ring->sqRing;
+	} else {
+		ptr = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ptr == MAP_FAILED) {
+			ring_destroy(ring);
+			return NULL;
+		}
+		ring->cqRing = ptr;
+	}
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	ptr = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED) {
+		ring_destroy(ring);
+		return NULL;
+	}
+	ring->sqes = (struct io_uring_sqe *) ptr;
+
+	// Get pointers to fields of queues.
+	char *sq = (char *) ring->sqRing, *cq = (char *) ring->cqRing;
+	ring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+	ring->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned *) (sq + params.sq_off.array);
+	ring->cqHead = (unsigned *) (cq + params.cq_off.head);
+	ring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+	ring->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+	ring->iov.resize(numEntries);
+
+	return ring;
+}
+
+/*
+ * Submit read or write of data at position of file (slot identifies
+ * operation in completion, only one operation per slot may be in flight).
+ */
+static bool
+ring_submit(MarcIoRing *ring, int opcode, int fd, size_t slot,
+	const char *data, size_t dataLen, long long pos)
+{
+	ring->iov[slot].iov_base = (void *) data;
+	ring->iov[slot].iov_len = dataLen;
+
+	// Fill submission queue entry.
+	unsigned tail = *ring->sqTail;
+	unsigned index = tail & *ring->sqMask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = (unsigned char) opcode;
+	sqe->fd = fd;
+	sqe->off = (unsigned long long) pos;
+	sqe->addr = (unsigned long long) (size_t) &ring->iov[slot];
+	sqe->len = 1;
+	sqe->user_data = slot;
+	ring->sqArray[index] = index;
+	__atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	// Pass entry to kernel.
+	for (;;) {
+		long result = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0,
+			NULL, 0);
+		if (result >= 0) {
+			return true;
+		} else if (errno != EINTR && errno != EAGAIN) {
+			return false;
+		}
+	}
+}
+
+/*
+ * Wait for completion of operation (result is number of transferred
+ * bytes or negative error code).
+ */
+static bool
+ring_wait(MarcIoRing *ring, size_t &slot, int &result)
+{
+	unsigned head = *ring->cqHead;
+	while (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+		if (syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+			IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+		{
+			return false;
+		}
+	}
+
+	// Get completion queue entry.
+	struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+	slot = (size_t) cqe->user_data;
+	result = cqe->res;
+	__atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+#endif
+
+/*
+ * Constructor.
+ */
+MarcAsyncInput::MarcAsyncInput()
+{
+	m_input = NULL;
+	m_inputFd = -1;
+	m_inputPos = 0;
+	m_backend = ASYNC_BACKEND_NONE;
+	m_blockSize = 0;
+	m_numFilled = 0;
+	m_numConsumed = 0;
+	m_numPending = 0;
+	m_inputEnd = false;
+	m_error = false;
+	m_stopThread = false;
+	m_ring = NULL;
+}
+
+/*
+ * Destructor.
+ */
+MarcAsyncInput::~MarcAsyncInput()
+{
+	// Stop reading.
+	close();
+}
+
+/*
+ * Start asynchronous input from source (io_uring is used for input file
+ * descriptor of regular file if supported, otherwise source is read by
+ * thread).
+ */
+bool
+MarcAsyncInput::open(MarcInput *input, int inputFd, size_t blockSize,
+	size_t numBlocks)
+{
+	close();
+
+	m_input = input;
+	m_inputFd = -1;
+	m_inputPos = 0;
+	m_blockSize = blockSize;
+	m_numFilled = 0;
+	m_numConsumed = 0;
+	m_numPending = 0;
+	m_inputEnd = false;
+	m_error = false;
+	m_errorMessage = "";
+
+	if (blockSize == 0 || numBlocks < 2) {
+		setError("at least two blocks of non-zero size are required "
+			"for asynchronous input");
+		return false;
+	}
+
+	// Allocate blocks.
+	m_blockData.resize(numBlocks * blockSize + MARC_ASYNC_ALIGNMENT);
+	char *blockData = &m_blockData[0];
+	blockData += (MARC_ASYNC_ALIGNMENT
+		- (size_t) blockData % MARC_ASYNC_ALIGNMENT)
+		% MARC_ASYNC_ALIGNMENT;
+	m_blocks.resize(numBlocks);
+	for (size_t i = 0; i < numBlocks; i++) {
+		m_blocks[i].data = blockData + i * blockSize;
+		m_blocks[i].length = 0;
+		m_blocks[i].readLength = 0;
+		m_blocks[i].inputPos = 0;
+		m_blocks[i].done = false;
+		m_blocks[i].last = false;
+	}
+
+#ifdef HAVE_IO_URING
+	// Read regular file with io_uring at explicit positions.
+	struct stat fileStat;
+	off_t inputPos;
+	if (inputFd >= 0 && fstat(inputFd, &fileStat) == 0
+		&& S_ISREG(fileStat.st_mode)
+		&& (inputPos = lseek(inputFd, 0, SEEK_CUR)) >= 0)
+	{
+		m_ring = ring_create((unsigned) numBlocks);
+		if (m_ring != NULL) {
+			m_inputFd = inputFd;
+			m_inputPos = (long long) inputPos;
+			m_backend = ASYNC_BACKEND_IO_URING;
+
+			// Start reading of all blocks.
+			for (size_t i = 0; i < numBlocks; i++) {
+				m_blocks[i].inputPos = m_inputPos;
+				m_inputPos += (long long) blockSize;
+				m_numPending++;
+				if (!submitRingRead(i)) {
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+#else
+	(void) inputFd;
+#endif
+
+	// Start read-ahead thread.
+	m_stopThread = false;
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	if (pthread_create(&m_thread, NULL, threadMain, this) != 0) {
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+		setError("can't start read-ahead thread");
+		return false;
+	}
+	m_backend = ASYNC_BACKEND_THREAD;
+
+	return true;
+}
+
+/*
+ * Stop asynchronous input.
+ */
+void
+MarcAsyncInput::close(void)
+{
+	if (m_backend == ASYNC_BACKEND_THREAD) {
+		// Stop read-ahead thread.
+		pthread_mutex_lock(&m_mutex);
+		m_stopThread = true;
+		pthread_cond_broadcast(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+		pthread_join(m_thread, NULL);
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+	}
+#ifdef HAVE_IO_URING
+	if (m_ring != NULL) {
+		// Wait for reads in flight.
+		while (m_numPending > 0 && completeRingRead()) {
+		}
+		ring_destroy(m_ring);
+		m_ring = NULL;
+	}
+#endif
+
+	m_backend = ASYNC_BACKEND_NONE;
+}
+
+/*
+ * Get backend of asynchronous input.
+ */
+AsyncBackend
+MarcAsyncInput::getBackend(void)
+{
+	return m_backend;
+}
+
+/*
+ * Read data from input (less data is returned only at end of input).
+ */
+size_t
+MarcAsyncInput::read(char *buf, size_t bufLen)
+{
+	size_t readLen = 0;
+
+	// Copy data from completed blocks.
+	while (readLen < bufLen) {
+		Block *block = getReadBlock();
+		if (block == NULL) {
+			break;
+		}
+
+		size_t copyLen = std::min(bufLen - readLen,
+			block->length - block->readLength);
+		memcpy(buf + readLen, block->data + block->readLength, copyLen);
+		block->readLength += copyLen;
+		readLen += copyLen;
+
+		if (block->readLength == block->length) {
+			releaseReadBlock();
+		}
+	}
+
+	return readLen;
+}
+
+/*
+ * Check if read error occured.
+ */
+bool
+MarcAsyncInput::isError(void)
+{
+	return m_error;
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcAsyncInput::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+/*
+ * Get block with unread data (NULL at end of input).
+ */
+MarcAsyncInput::Block *
+MarcAsyncInput::getReadBlock(void)
+{
+	if (m_backend == ASYNC_BACKEND_NONE || m_inputEnd) {
+		return NULL;
+	}
+
+	Block *block = &m_blocks[m_numConsumed % m_blocks.size()];
+	if (m_backend == ASYNC_BACKEND_IO_URING) {
+		while (!block->done) {
+			if (!completeRingRead()) {
+				return NULL;
+			}
+		}
+		return block;
+	}
+
+	// Wait until block is filled by read-ahead thread.
+	pthread_mutex_lock(&m_mutex);
+	while (m_numConsumed == m_numFilled && !m_stopThread) {
+		pthread_cond_wait(&m_cond, &m_mutex);
+	}
+	pthread_mutex_unlock(&m_mutex);
+
+	return block;
+}
+
+/*
+ * Release block after all data is passed to reader (block is reused
+ * for reading of next data).
+ */
+void
+MarcAsyncInput::releaseReadBlock(void)
+{
+	size_t blockNo = m_numConsumed % m_blocks.size();
+	Block &block = m_blocks[blockNo];
+
+	if (m_backend == ASYNC_BACKEND_IO_URING) {
+		block.readLength = 0;
+		m_numConsumed++;
+		if (block.last) {
+			m_inputEnd = true;
+			return;
+		}
+
+		// Read next block (block is last if submission failed).
+		block.inputPos = m_inputPos;
+		block.length = 0;
+		block.done = false;
+		m_inputPos += (long long) m_blockSize;
+		m_numPending++;
+		submitRingRead(blockNo);
+		return;
+	}
+
+	// Block of read-ahead thread is released, end of input is reached
+	// after last (incomplete) block (length is checked before block
+	// can be refilled by read-ahead thread).
+	pthread_mutex_lock(&m_mutex);
+	m_inputEnd = block.length < m_blockSize;
+	block.readLength = 0;
+	m_numConsumed++;
+	pthread_cond_broadcast(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/*
+ * Read blocks in read-ahead thread (reading is stopped after last
+ * incomplete block).
+ */
+void
+MarcAsyncInput::runThread(void)
+{
+	pthread_mutex_lock(&m_mutex);
+	for (;;) {
+		while (!m_stopThread
+			&& m_numFilled - m_numConsumed == m_blocks.size())
+		{
+			pthread_cond_wait(&m_cond, &m_mutex);
+		}
+		if (m_stopThread) {
+			break;
+		}
+
+		// Read block without lock.
+		Block &block = m_blocks[m_numFilled % m_blocks.size()];
+		pthread_mutex_unlock(&m_mutex);
+		size_t length = m_input->read(block.data, m_blockSize);
+		pthread_mutex_lock(&m_mutex);
+
+		block.length = length;
+		block.readLength = 0;
+		m_numFilled++;
+		pthread_cond_broadcast(&m_cond);
+		if (length < m_blockSize) {
+			break;
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/*
+ * Entry point of read-ahead thread.
+ */
+void *
+MarcAsyncInput::threadMain(void *arg)
+{
+	((MarcAsyncInput *) arg)->runThread();
+	return NULL;
+}
+
+/*
+ * Submit read of block (rest of block) to io_uring.
+ */
+bool
+MarcAsyncInput::submitRingRead(size_t blockNo)
+{
+#ifdef HAVE_IO_URING
+	Block &block = m_blocks[blockNo];
+	if (!ring_submit(m_ring, IORING_OP_READV, m_inputFd, blockNo,
+		block.data + block.length, m_blockSize - block.length,
+		block.inputPos + (long long) block.length))
+	{
+		// Block is not in flight.
+		setError("submission of read to io_uring failed");
+		block.done = true;
+		block.last = true;
+		m_numPending--;
+		return false;
+	}
+
+	return true;
+#else
+	(void) blockNo;
+	return false;
+#endif
+}
+
+/*
+ * Wait for completion of io_uring read (partially read block is
+ * resubmitted, block is last at end of file or after read error).
+ */
+bool
+MarcAsyncInput::completeRingRead(void)
+{
+#ifdef HAVE_IO_URING
+	size_t blockNo;
+	int result;
+	if (!ring_wait(m_ring, blockNo, result)) {
+		setError("wait for io_uring completion failed");
+		m_numPending = 0;
+		m_inputEnd = true;
+		return false;
+	}
+
+	Block &block = m_blocks[blockNo];
+	if (result == -EINTR || result == -EAGAIN) {
+		return submitRingRead(blockNo);
+	} else if (result < 0) {
+		setError("read from input failed");
+		block.last = true;
+	} else {
+		block.length += (size_t) result;
+		if (result > 0 && block.length < m_blockSize) {
+			// Read rest of block.
+			return submitRingRead(blockNo);
+		}
+		block.last = result == 0;
+	}
+	block.done = true;
+	m_numPending--;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Set error message and error flag.
+ */
+void
+MarcAsyncInput::setError(const char *errorMessage)
+{
+	if (!m_error) {
+		m_error = true;
+		m_errorMessage = errorMessage;
+	}
+}
+
+/*
+ * Constructor.
+ */
+MarcAsyncOutput::MarcAsyncOutput()
+{
+	m_output = NULL;
+	m_outputFd = -1;
+	m_outputPos = 0;
+	m_backend = ASYNC_BACKEND_NONE;
+	m_numSubmitted = 0;
+	m_numWritten = 0;
+	m_error = false;
+	m_stopThread = false;
+	m_ring = NULL;
+}
+
+/*
+ * Destructor.
+ */
+MarcAsyncOutput::~MarcAsyncOutput()
+{
+	// Write buffered data.
+	close();
+}
+
+/*
+ * Start asynchronous output to sink (io_uring is used for output file
+ * descriptor if supported, otherwise data is written by thread).
+ */
+bool
+MarcAsyncOutput::open(MarcOutput *output, int outputFd, size_t numBuffers)
+{
+	close();
+
+	m_output = output;
+	m_outputFd = -1;
+	m_outputPos = 0;
+	m_numSubmitted = 0;
+	m_numWritten = 0;
+	m_error = false;
+	m_errorMessage = "";
+
+	if (numBuffers < 2) {
+		setError("at least two buffers are required "
+			"for asynchronous output");
+		return false;
+	}
+
+	// Allocate buffers aligned for direct i/o.
+	m_bufferData.resize(numBuffers * MARC_ASYNC_BUFFER_SIZE
+		+ MARC_ASYNC_ALIGNMENT);
+	char *bufferData = &m_bufferData[0];
+	bufferData += (MARC_ASYNC_ALIGNMENT
+		- (size_t) bufferData % MARC_ASYNC_ALIGNMENT)
+		% MARC_ASYNC_ALIGNMENT;
+	m_buffers.resize(numBuffers);
+	for (size_t i = 0; i < numBuffers; i++) {
+		m_buffers[i].data = bufferData + i * MARC_ASYNC_BUFFER_SIZE;
+		m_buffers[i].length = 0;
+		m_buffers[i].writtenLength = 0;
+		m_buffers[i].outputPos = 0;
+	}
+
+#ifdef HAVE_IO_URING
+	// Write regular file with io_uring at explicit positions.
+	struct stat fileStat;
+	off_t outputPos;
+	if (outputFd >= 0 && fstat(outputFd, &fileStat) == 0
+		&& S_ISREG(fileStat.st_mode)
+		&& (outputPos = lseek(outputFd, 0, SEEK_CUR)) >= 0)
+	{
+		m_ring = ring_create((unsigned) numBuffers);
+		if (m_ring != NULL) {
+			m_outputFd = outputFd;
+			m_outputPos = (long long) outputPos;
+			m_backend = ASYNC_BACKEND_IO_URING;
+			return true;
+		}
+	}
+#else
+	(void) outputFd;
+#endif
+
+	// Start writer thread.
+	m_stopThread = false;
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	if (pthread_create(&m_thread, NULL, threadMain, this) != 0) {
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+		setError("can't start writer thread");
+		return false;
+	}
+	m_backend = ASYNC_BACKEND_THREAD;
+
+	return true;
+}
+
+/*
+ * Write buffered data and stop asynchronous output.
+ */
+bool
+MarcAsyncOutput::close(void)
+{
+	if (m_backend == ASYNC_BACKEND_NONE) {
+		return true;
+	}
+
+	bool result = flush();
+
+	if (m_backend == ASYNC_BACKEND_THREAD) {
+		// Stop writer thread.
+		pthread_mutex_lock(&m_mutex);
+		m_stopThread = true;
+		pthread_cond_broadcast(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+		pthread_join(m_thread, NULL);
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+	}
+#ifdef HAVE_IO_URING
+	if (m_ring != NULL) {
+		ring_destroy(m_ring);
+		m_ring = NULL;
+	}
+#endif
+
+	m_backend = ASYNC_BACKEND_NONE;
+	return result;
+}
+
+/*
+ * Get backend of asynchronous output.
+ */
+AsyncBackend
+MarcAsyncOutput::getBackend(void)
+{
+	return m_backend;
+}
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcAsyncOutput::write(const MarcOutputBlock *blocks, size_t numBlocks)
+{
+	if (m_backend == ASYNC_BACKEND_NONE) {
+		return false;
+	}
+
+	// Copy data to buffers, filled buffers are passed to backend.
+	for (size_t i = 0; i < numBlocks; i++) {
+		const char *data = blocks[i].data;
+		size_t dataLen = blocks[i].length;
+		while (dataLen > 0) {
+			Buffer &buffer =
+				m_buffers[m_numSubmitted % m_buffers.size()];
+			size_t copyLen = std::min(dataLen,
+				MARC_ASYNC_BUFFER_SIZE - buffer.length);
+			memcpy(buffer.data + buffer.length, data, copyLen);
+			buffer.length += copyLen;
+			data += copyLen;
+			dataLen -= copyLen;
+
+			if (buffer.length == MARC_ASYNC_BUFFER_SIZE
+				&& !submitBuffer())
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Flush output (wait for completion of all writes).
+ */
+bool
+MarcAsyncOutput::flush(void)
+{
+	if (m_backend == ASYNC_BACKEND_NONE) {
+		return false;
+	}
+
+	Buffer &buffer = m_buffers[m_numSubmitted % m_buffers.size()];
+	size_t alignment = m_output->getAlignment();
+	if (m_backend == ASYNC_BACKEND_IO_URING && alignment > 0
+		&& buffer.length % alignment != 0)
+	{
+		// Unaligned end of data is written by output sink.
+		if (!waitBuffers(0)) {
+			return false;
+		}
+		MarcOutputBlock block = { buffer.data, buffer.length };
+		if (lseek(m_outputFd, (off_t) m_outputPos, SEEK_SET) < 0
+			|| !m_output->write(&block, 1))
+		{
+			setError("write to output failed");
+			return false;
+		}
+		m_outputPos += buffer.length;
+		buffer.length = 0;
+	} else if (buffer.length > 0 && !submitBuffer()) {
+		return false;
+	}
+
+	// Wait for completion of writes.
+	if (!waitBuffers(0)) {
+		return false;
+	}
+	if (m_backend == ASYNC_BACKEND_IO_URING
+		&& lseek(m_outputFd, (off_t) m_outputPos, SEEK_SET) < 0)
+	{
+		setError("write to output failed");
+		return false;
+	}
+	if (!m_output->flush()) {
+		setError("write to output failed");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcAsyncOutput::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+/*
+ * Pass filled buffer to backend (next buffer is cleared for filling).
+ */
+bool
+MarcAsyncOutput::submitBuffer(void)
+{
+	size_t bufferNo = m_numSubmitted % m_buffers.size();
+	Buffer &buffer = m_buffers[bufferNo];
+	buffer.writtenLength = 0;
+
+	if (m_backend == ASYNC_BACKEND_IO_URING) {
+		buffer.outputPos = m_outputPos;
+		m_outputPos += buffer.length;
+		m_numSubmitted++;
+		if (!submitRingWrite(bufferNo)) {
+			return false;
+		}
+	} else {
+		pthread_mutex_lock(&m_mutex);
+		m_numSubmitted++;
+		pthread_cond_broadcast(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+	}
+
+	// Wait until next buffer is written.
+	if (!waitBuffers(m_buffers.size() - 1)) {
+		return false;
+	}
+	m_buffers[m_numSubmitted % m_buffers.size()].length = 0;
+
+	return true;
+}
+
+/*
+ * Wait until number of buffers in flight drops to specified value.
+ */
+bool
+MarcAsyncOutput::waitBuffers(size_t maxPending)
+{
+	if (m_backend == ASYNC_BACKEND_IO_URING) {
+		while (m_numSubmitted - m_numWritten > maxPending) {
+			if (!completeRingWrite()) {
+				return false;
+			}
+		}
+		return !m_error;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	while (m_numSubmitted - m_numWritten > maxPending) {
+		pthread_cond_wait(&m_cond, &m_mutex);
+	}
+	bool result = !m_error;
+	pthread_mutex_unlock(&m_mutex);
+
+	return result;
+}
+
+/*
+ * Write buffers in writer thread (after write error buffers are
+ * skipped).
+ */
+void
+MarcAsyncOutput::runThread(void)
+{
+	pthread_mutex_lock(&m_mutex);
+	for (;;) {
+		while (m_numWritten == m_numSubmitted && !m_stopThread) {
+			pthread_cond_wait(&m_cond, &m_mutex);
+		}
+		if (m_numWritten == m_numSubmitted) {
+			break;
+		}
+
+		// Write buffer without lock.
+		Buffer &buffer = m_buffers[m_numWritten % m_buffers.size()];
+		bool skip = m_error;
+		pthread_mutex_unlock(&m_mutex);
+		MarcOutputBlock block = { buffer.data, buffer.length };
+		bool result = skip || m_output->write(&block, 1);
+		pthread_mutex_lock(&m_mutex);
+
+		if (!result) {
+			setError("write to output failed");
+		}
+		m_numWritten++;
+		pthread_cond_broadcast(&m_cond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/*
+ * Entry point of writer thread.
+ */
+void *
+MarcAsyncOutput::threadMain(void *arg)
+{
+	((MarcAsyncOutput *) arg)->runThread();
+	return NULL;
+}
+
+/*
+ * Submit write of buffer (rest of buffer) to io_uring.
+ */
+bool
+MarcAsyncOutput::submitRingWrite(size_t bufferNo)
+{
+#ifdef HAVE_IO_URING
+	Buffer &buffer = m_buffers[bufferNo];
+	if (!ring_submit(m_ring, IORING_OP_WRITEV, m_outputFd, bufferNo,
+		buffer.data + buffer.writtenLength,
+		buffer.length - buffer.writtenLength,
+		buffer.outputPos + (long long) buffer.writtenLength))
+	{
+		setError("submission of write to io_uring failed");
+		return false;
+	}
+
+	return true;
+#else
+	(void) bufferNo;
+	return false;
+#endif
+}
+
+/*
+ * Wait for completion of io_uring write (partially written buffer is
+ * resubmitted, after write error buffers are skipped).
+ */
+bool
+MarcAsyncOutput::completeRingWrite(void)
+{
+#ifdef HAVE_IO_URING
+	size_t bufferNo;
+	int result;
+	if (!ring_wait(m_ring, bufferNo, result)) {
+		setError("wait for io_uring completion failed");
+		m_numWritten = m_numSubmitted;
+		return false;
+	}
+
+	Buffer &buffer = m_buffers[bufferNo];
+	if (result == -EINTR || result == -EAGAIN) {
+		result = 0;
+	} else if (result < 0 || (result == 0 && buffer.length > 0)) {
+		setError("write to output failed");
+		result = 0;
+	}
+	buffer.writtenLength += (size_t) result;
+
+	// Write rest of buffer (skipped after write error).
+	if (buffer.writtenLength < buffer.length && !m_error) {
+		return submitRingWrite(bufferNo);
+	}
+	buffer.writtenLength = buffer.length;
+
+	// Release written buffers in order of submission.
+	while (m_numWritten < m_numSubmitted
+		&& m_buffers[m_numWritten % m_buffers.size()].writtenLength
+		== m_buffers[m_numWritten % m_buffers.size()].length)
+	{
+		m_numWritten++;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Set error message and error flag.
+ */
+void
+MarcAsyncOutput::setError(const char *errorMessage)
+{
+	if (!m_error) {
+		m_error = true;
+		m_errorMessage = errorMessage;
+	}
+}
+
+#endif // _WIN32
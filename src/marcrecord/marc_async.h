@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_ASYNC_H
+#define MARCRECORD_MARC_ASYNC_H
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "marc_reader.h"
+#include "marc_writer.h"
+
+// Size of buffers of asynchronous output.
+#define MARC_ASYNC_BUFFER_SIZE		1048576
+// Default size of blocks of asynchronous input.
+#define MARC_ASYNC_BLOCK_SIZE		1048576
+
+namespace marcrecord {
+
+// Backends of asynchronous i/o.
+enum AsyncBackend {
+	ASYNC_BACKEND_NONE = 0,
+	ASYNC_BACKEND_THREAD = 1,
+	ASYNC_BACKEND_IO_URING = 2
+};
+
+// Ring of io_uring instance (defined if io_uring is supported).
+struct MarcIoRing;
+
+/*
+ * Input source reading data asynchronously ahead of reader (several
+ * blocks are read by io_uring or by read-ahead thread while reader
+ * parses data of completed block).
+ */
+class MarcAsyncInput : public MarcInput {
+protected:
+	// Block of asynchronous input.
+	struct Block {
+		// Pointer to data.
+		char *data;
+		// Length of data.
+		size_t length;
+		// Length of data passed to reader.
+		size_t readLength;
+		// Position of block in input file (io_uring).
+		long long inputPos;
+		// Read completed flag (io_uring).
+		bool done;
+		// Last block of input flag (io_uring).
+		bool last;
+	};
+
+	// Input source for read-ahead thread.
+	MarcInput *m_input;
+	// Input file descriptor (io_uring).
+	int m_inputFd;
+	// Position of next block in input file (io_uring).
+	long long m_inputPos;
+	// Backend of asynchronous input.
+	AsyncBackend m_backend;
+	// Blocks memory.
+	std::vector<char> m_blockData;
+	// Rotating blocks.
+	std::vector<Block> m_blocks;
+	// Size of blocks.
+	size_t m_blockSize;
+	// Number of blocks filled by backend (read-ahead thread).
+	size_t m_numFilled;
+	// Number of blocks passed to reader.
+	size_t m_numConsumed;
+	// Number of reads in flight (io_uring).
+	size_t m_numPending;
+	// End of input reached flag.
+	bool m_inputEnd;
+	// Read error flag.
+	bool m_error;
+	// Message of last error.
+	std::string m_errorMessage;
+
+	// Read-ahead thread.
+	pthread_t m_thread;
+	// Mutex of blocks state.
+	pthread_mutex_t m_mutex;
+	// Condition of blocks state change.
+	pthread_cond_t m_cond;
+	// Stop flag of read-ahead thread.
+	bool m_stopThread;
+	// Ring of io_uring instance.
+	MarcIoRing *m_ring;
+
+	// Get block with unread data (NULL at end of input).
+	Block *getReadBlock(void);
+	// Release block after all data is passed to reader.
+	void releaseReadBlock(void);
+	// Read blocks in read-ahead thread.
+	void runThread(void);
+	// Entry point of read-ahead thread.
+	static void *threadMain(void *arg);
+	// Submit read of block (rest of block) to io_uring.
+	bool submitRingRead(size_t blockNo);
+	// Wait for completion of io_uring read.
+	bool completeRingRead(void);
+	// Set error message and error flag.
+	void setError(const char *errorMessage);
+
+public:
+	// Constructor.
+	MarcAsyncInput();
+	// Destructor.
+	~MarcAsyncInput();
+
+	// Start asynchronous input from source (io_uring is used for
+	// input file descriptor if supported).
+	bool open(MarcInput *input, int inputFd = -1,
+		size_t blockSize = MARC_ASYNC_BLOCK_SIZE, size_t numBlocks = 4);
+	// Stop asynchronous input.
+	void close(void);
+	// Get backend of asynchronous input.
+	AsyncBackend getBackend(void);
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen);
+
+	// Check if read error occured.
+	bool isError(void);
+	// Get last error message.
+	std::string & getErrorMessage(void);
+};
+
+/*
+ * Output sink writing data asynchronously to another sink (data is
+ * collected to rotating buffers, filled buffers are written by io_uring
+ * or by writer thread while next buffer is filled).
+ */
+class MarcAsyncOutput : public MarcOutput {
+protected:
+	// Buffer of asynchronous output.
+	struct Buffer {
+		// Pointer to data.
+		char *data;
+		// Length of data.
+		size_t length;
+		// Length of written data.
+		size_t writtenLength;
+		// Position of data in output file (io_uring).
+		long long outputPos;
+	};
+
+	// Output sink for written data.
+	MarcOutput *m_output;
+	// Output file descriptor (io_uring).
+	int m_outputFd;
+	// Position of next buffer in output file (io_uring).
+	long long m_outputPos;
+	// Backend of asynchronous output.
+	AsyncBackend m_backend;
+	// Buffers memory.
+	std::vector<char> m_bufferData;
+	// Rotating buffers.
+	std::vector<Buffer> m_buffers;
+	// Number of buffers passed to backend.
+	size_t m_numSubmitted;
+	// Number of buffers written by backend.
+	size_t m_numWritten;
+	// Write error flag.
+	bool m_error;
+	// Message of last error.
+	std::string m_errorMessage;
+
+	// Writer thread.
+	pthread_t m_thread;
+	// Mutex of buffers state.
+	pthread_mutex_t m_mutex;
+	// Condition of buffers state change.
+	pthread_cond_t m_cond;
+	// Stop flag of writer thread.
+	bool m_stopThread;
+	// Ring of io_uring instance.
+	MarcIoRing *m_ring;
+
+	// Get buffer being filled (wait for free buffer).
+	Buffer *getFillBuffer(void);
+	// Pass filled buffer to backend.
+	bool submitBuffer(void);
+	// Wait until number of buffers in flight drops to specified value.
+	bool waitBuffers(size_t maxPending);
+	// Write buffers in writer thread.
+	void runThread(void);
+	// Entry point of writer thread.
+	static void *threadMain(void *arg);
+	// Submit write of buffer (rest of buffer) to io_uring.
+	bool submitRingWrite(size_t bufferNo);
+	// Wait for completion of io_uring write.
+	bool completeRingWrite(void);
+	// Set error message and error flag.
+	void setError(const char *errorMessage);
+
+public:
+	// Constructor.
+	MarcAsyncOutput();
+	// Destructor.
+	~MarcAsyncOutput();
+
+	// Start asynchronous output to sink (io_uring is used for
+	// output file descriptor if supported).
+	bool open(MarcOutput *output, int outputFd = -1,
+		size_t numBuffers = 2);
+	// Write buffered data and stop asynchronous output.
+	bool close(void);
+	// Get backend of asynchronous output.
+	AsyncBackend getBackend(void);
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+	// Flush output (wait for completion of all writes).
+	bool flush(void);
+
+	// Get last error message.
+	std::string & getErrorMessage(void);
+};
+
+} // namespace marcrecord
+
+#endif // _WIN32
+
+#endif // MARCRECORD_MARC_ASYNC_H
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include "marc_chunk.h"
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcChunkPool::MarcChunkPool()
+{
+	m_format = COMPRESSION_NONE;
+	m_level = -1;
+	m_numActive = 0;
+	m_error = false;
+#ifndef _WIN32
+	m_stopThreads = false;
+#endif
+}
+
+/*
+ * Destructor.
+ */
+MarcChunkPool::~MarcChunkPool()
+{
+	close();
+}
+
+/*
+ * Start writer threads (chunks are written synchronously if number
+ * of threads is 0).
+ */
+bool
+MarcChunkPool::open(const char *outputFileName, CompressionFormat format,
+	int level, int numThreads)
+{
+	close();
+
+	m_outputFileName = outputFileName;
+	m_format = format;
+	m_level = level;
+	m_chunks.clear();
+	m_chunkData.clear();
+	m_numActive = 0;
+	m_error = false;
+	m_errorMessage = "";
+
+	if (!is_compression_supported(format)) {
+		m_error = true;
+		m_errorMessage = "compression format is not supported";
+		return false;
+	}
+
+#ifndef _WIN32
+	// Start writer threads.
+	m_stopThreads = false;
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	for (int i = 0; i < numThreads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, threadMain, this) != 0) {
+			break;
+		}
+		m_threads.push_back(thread);
+	}
+	if (numThreads > 0 && m_threads.empty()) {
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+		m_error = true;
+		m_errorMessage = "can't start writer thread";
+		return false;
+	}
+#else
+	(void) numThreads;
+#endif
+
+	return true;
+}
+
+/*
+ * Wait for written chunks and stop writer threads.
+ */
+bool
+MarcChunkPool::close(void)
+{
+#ifndef _WIN32
+	if (!m_threads.empty()) {
+		// Queued chunks are written before threads are stopped.
+		pthread_mutex_lock(&m_mutex);
+		m_stopThreads = true;
+		pthread_cond_broadcast(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+		for (size_t i = 0; i < m_threads.size(); i++) {
+			pthread_join(m_threads[i], NULL);
+		}
+		m_threads.clear();
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+	}
+#endif
+
+	return !m_error;
+}
+
+/*
+ * Write chunk to next chunk file (data is taken over, waits if too
+ * many chunks are queued).
+ */
+bool
+MarcChunkPool::write(std::string &data, unsigned int firstRecord,
+	unsigned int lastRecord, unsigned int numRecords)
+{
+	MarcChunkInfo chunk;
+	chunk.firstRecord = firstRecord;
+	chunk.lastRecord = lastRecord;
+	chunk.numRecords = numRecords;
+	chunk.dataLength = data.size();
+	chunk.fileLength = 0;
+
+#ifndef _WIN32
+	if (!m_threads.empty()) {
+		pthread_mutex_lock(&m_mutex);
+
+		// Limit memory used by chunks waiting for writing.
+		while (!m_error && m_queue.size() + m_numActive
+			>= 2 * m_threads.size())
+		{
+			pthread_cond_wait(&m_cond, &m_mutex);
+		}
+		if (m_error) {
+			pthread_mutex_unlock(&m_mutex);
+			return false;
+		}
+
+		// Queue chunk for writer threads.
+		chunk.fileName = makeChunkName(m_outputFileName.c_str(),
+			m_chunks.size() + 1);
+		m_chunks.push_back(chunk);
+		m_chunkData.push_back(std::string());
+		m_chunkData.back().swap(data);
+		m_queue.push_back(m_chunks.size() - 1);
+		pthread_cond_broadcast(&m_cond);
+
+		pthread_mutex_unlock(&m_mutex);
+		data.clear();
+		return true;
+	}
+#endif
+
+	// Write chunk synchronously.
+	if (m_error) {
+		return false;
+	}
+	chunk.fileName = makeChunkName(m_outputFileName.c_str(),
+		m_chunks.size() + 1);
+	m_error = !writeChunkFile(chunk, data, m_errorMessage);
+	m_chunks.push_back(chunk);
+	data.clear();
+
+	return !m_error;
+}
+
+#ifndef _WIN32
+/*
+ * Write chunks in writer thread.
+ */
+void
+MarcChunkPool::runThread(void)
+{
+	std::string data, errorMessage;
+
+	pthread_mutex_lock(&m_mutex);
+	for (;;) {
+		// Wait for queued chunk.
+		while (m_queue.empty() && !m_stopThreads) {
+			pthread_cond_wait(&m_cond, &m_mutex);
+		}
+		if (m_queue.empty()) {
+			break;
+		}
+
+		// Take chunk from queue.
+		size_t chunkNo = m_queue.front();
+		m_queue.pop_front();
+		MarcChunkInfo chunk = m_chunks[chunkNo];
+		data.swap(m_chunkData[chunkNo]);
+		m_numActive++;
+		pthread_mutex_unlock(&m_mutex);
+
+		// Compress and write chunk without lock.
+		bool status = m_error ? false
+			: writeChunkFile(chunk, data, errorMessage);
+		std::string().swap(data);
+
+		pthread_mutex_lock(&m_mutex);
+		m_chunks[chunkNo].fileLength = chunk.fileLength;
+		if (!status && !m_error) {
+			m_error = true;
+			m_errorMessage = errorMessage;
+		}
+		m_numActive--;
+		pthread_cond_broadcast(&m_cond);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+/*
+ * Entry point of writer thread.
+ */
+void *
+MarcChunkPool::threadMain(void *arg)
+{
+	((MarcChunkPool *) arg)->runThread();
+	return NULL;
+}
+#endif
+
+/*
+ * Write chunk data to chunk file.
+ */
+bool
+MarcChunkPool::writeChunkFile(MarcChunkInfo &chunk, const std::string &data,
+	std::string &errorMessage)
+{
+	FILE *chunkFile = fopen(chunk.fileName.c_str(), "wb");
+	if (chunkFile == NULL) {
+		errorMessage = "can't open chunk file '" + chunk.fileName + "'";
+		return false;
+	}
+
+	// Compress chunk data (each chunk is complete compressed stream).
+	MarcFileOutput fileOutput(chunkFile);
+	MarcCompressedOutput compressedOutput;
+	MarcOutput *output = &fileOutput;
+	bool status = true;
+	if (m_format != COMPRESSION_NONE) {
+		status = compressedOutput.open(&fileOutput, m_format, m_level);
+		output = &compressedOutput;
+	}
+	MarcOutputBlock block;
+	block.data = data.data();
+	block.length = data.size();
+	status = status && output->write(&block, 1);
+	if (m_format != COMPRESSION_NONE) {
+		status = compressedOutput.close() && status;
+	}
+	status = status && fileOutput.flush();
+
+	// Get length of chunk file.
+#ifdef _WIN32
+	long long fileLength = _ftelli64(chunkFile);
+#else
+	long long fileLength = (long long) ftello(chunkFile);
+#endif
+	chunk.fileLength = fileLength > 0
+		? (unsigned long long) fileLength : 0;
+	status = fclose(chunkFile) == 0 && status;
+
+	if (!status) {
+		errorMessage = "can't write chunk file '" + chunk.fileName + "'";
+		remove(chunk.fileName.c_str());
+	}
+
+	return status;
+}
+
+/*
+ * Write list of chunk files with record ranges (JSON lines).
+ */
+bool
+MarcChunkPool::writeManifest(const char *manifestFileName)
+{
+	FILE *manifestFile = fopen(manifestFileName, "wb");
+	if (manifestFile == NULL) {
+		m_errorMessage = "can't open manifest file";
+		return false;
+	}
+
+	for (size_t i = 0; i < m_chunks.size(); i++) {
+		const MarcChunkInfo &chunk = m_chunks[i];
+
+		// Escape chunk file name.
+		std::string fileName;
+		for (const char *p = chunk.fileName.c_str(); *p != '\0'; p++) {
+			if (*p == '"' || *p == '\\') {
+				fileName += '\\';
+			}
+			fileName += (unsigned char) *p < 0x20 ? ' ' : *p;
+		}
+
+		fprintf(manifestFile, "{\"chunk\":%u,\"file\":\"%s\","
+			"\"first_record\":%u,\"last_record\":%u,"
+			"\"records\":%u,\"data_bytes\":%llu,\"file_bytes\":%llu}\n",
+			(unsigned int) i + 1, fileName.c_str(), chunk.firstRecord,
+			chunk.lastRecord, chunk.numRecords, chunk.dataLength,
+			chunk.fileLength);
+	}
+
+	if (fclose(manifestFile) != 0) {
+		m_errorMessage = "can't write manifest file";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get written chunks.
+ */
+const std::vector<MarcChunkInfo> &
+MarcChunkPool::getChunks(void)
+{
+	return m_chunks;
+}
+
+/*
+ * Check if write error occured.
+ */
+bool
+MarcChunkPool::isError(void)
+{
+	return m_error;
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcChunkPool::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+/*
+ * Make name of chunk file (chunk number is inserted before extensions
+ * of output file name).
+ */
+std::string
+MarcChunkPool::makeChunkName(const char *outputFileName, size_t chunkNo)
+{
+	std::string fileName = outputFileName;
+	size_t namePos = fileName.find_last_of("/\\");
+	namePos = namePos == std::string::npos ? 0 : namePos + 1;
+	size_t extensionPos = fileName.find('.', namePos + 1);
+	if (extensionPos == std::string::npos) {
+		extensionPos = fileName.size();
+	}
+
+	char chunkSuffix[32];
+	sprintf(chunkSuffix, "-%04u", (unsigned int) chunkNo);
+	fileName.insert(extensionPos, chunkSuffix);
+
+	return fileName;
+}
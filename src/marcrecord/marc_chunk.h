@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_CHUNK_H
+#define MARCRECORD_MARC_CHUNK_H
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include <deque>
+#include <string>
+#include <vector>
+#include "marc_compress.h"
+
+namespace marcrecord {
+
+/*
+ * Chunk of output written to separate file.
+ */
+struct MarcChunkInfo {
+	// Name of chunk file.
+	std::string fileName;
+	// Numbers of first and last records of chunk in input.
+	unsigned int firstRecord;
+	unsigned int lastRecord;
+	// Number of records in chunk.
+	unsigned int numRecords;
+	// Length of chunk data (before compression).
+	unsigned long long dataLength;
+	// Length of chunk file.
+	unsigned long long fileLength;
+};
+typedef struct MarcChunkInfo MarcChunkInfo;
+
+/*
+ * Pool of threads writing chunks of output (complete files with header
+ * and footer) to separate files, chunks are compressed concurrently.
+ */
+class MarcChunkPool {
+protected:
+	// Template of chunk file names.
+	std::string m_outputFileName;
+	// Compression format of chunk files.
+	CompressionFormat m_format;
+	// Compression level.
+	int m_level;
+	// Written chunks.
+	std::vector<MarcChunkInfo> m_chunks;
+	// Data of chunks waiting for writing.
+	std::vector<std::string> m_chunkData;
+	// Numbers of chunks waiting for writing.
+	std::deque<size_t> m_queue;
+	// Number of chunks being written.
+	size_t m_numActive;
+	// Write error flag.
+	bool m_error;
+	// Message of first error.
+	std::string m_errorMessage;
+
+#ifndef _WIN32
+	// Writer threads.
+	std::vector<pthread_t> m_threads;
+	// Mutex of chunks queue.
+	pthread_mutex_t m_mutex;
+	// Condition of chunks queue change.
+	pthread_cond_t m_cond;
+	// Stop flag of writer threads.
+	bool m_stopThreads;
+
+	// Write chunks in writer thread.
+	void runThread(void);
+	// Entry point of writer thread.
+	static void *threadMain(void *arg);
+#endif
+
+	// Write chunk data to chunk file.
+	bool writeChunkFile(MarcChunkInfo &chunk, const std::string &data,
+		std::string &errorMessage);
+
+public:
+	// Constructor.
+	MarcChunkPool();
+	// Destructor.
+	~MarcChunkPool();
+
+	// Start writer threads (chunks are written synchronously if number
+	// of threads is 0).
+	bool open(const char *outputFileName, CompressionFormat format,
+		int level = -1, int numThreads = 0);
+	// Wait for written chunks and stop writer threads.
+	bool close(void);
+	// Write chunk to next chunk file (data is taken over, waits if too
+	// many chunks are queued).
+	bool write(std::string &data, unsigned int firstRecord,
+		unsigned int lastRecord, unsigned int numRecords);
+	// Write list of chunk files with record ranges (JSON lines).
+	bool writeManifest(const char *manifestFileName);
+
+	// Get written chunks.
+	const std::vector<MarcChunkInfo> & getChunks(void);
+	// Check if write error occured.
+	bool isError(void);
+	// Get last error message.
+	std::string & getErrorMessage(void);
+
+	// Make name of chunk file (chunk number is inserted before
+	// extensions of output file name).
+	static std::string makeChunkName(const char *outputFileName,
+		size_t chunkNo);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_CHUNK_H
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cctype>
+#include <map>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "marc_codec_cache.h"
+
+namespace marcrecord {
+
+/*
+ * Cache of iconv descriptors and compiled tables.
+ */
+struct MarcCodecCache {
+	// Free iconv descriptors by encoding pair.
+	std::map<std::string, std::vector<iconv_t> > iconvDescs;
+	// Encoding tables by output encoding.
+	std::map<std::string, MarcEncodingTable *> encodingTables;
+	// Byte maps by input encoding.
+	std::map<std::string, MarcByteMap *> byteMaps;
+};
+typedef struct MarcCodecCache MarcCodecCache;
+
+#ifndef _WIN32
+// Mutex of cache.
+static pthread_mutex_t codecCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+// Cache (created on first use and never destroyed, so readers and
+// writers in static objects can return descriptors at exit).
+static MarcCodecCache *codecCache = NULL;
+
+/*
+ * Lock cache (threads are not used on Windows).
+ */
+static void
+lockCodecCache(void)
+{
+#ifndef _WIN32
+	pthread_mutex_lock(&codecCacheMutex);
+#endif
+}
+
+/*
+ * Unlock cache.
+ */
+static void
+unlockCodecCache(void)
+{
+#ifndef _WIN32
+	pthread_mutex_unlock(&codecCacheMutex);
+#endif
+}
+
+/*
+ * Get cache (cache must be locked).
+ */
+static MarcCodecCache &
+getCodecCache(void)
+{
+	if (codecCache == NULL) {
+		codecCache = new MarcCodecCache();
+	}
+
+	return *codecCache;
+}
+
+#ifndef _WIN32
+/*
+ * Make key of encoding pair.
+ */
+static std::string
+makePairKey(const char *toEncoding, const char *fromEncoding)
+{
+	std::string key(toEncoding);
+	key.append(1, '\0');
+	key.append(fromEncoding);
+	return key;
+}
+#endif // _WIN32
+
+/*
+ * Check if iconv descriptors for encoding can be reused after reset
+ * (converters of Unicode encodings without specified byte order write
+ * byte order mark only once per descriptor, reset does not restore it).
+ */
+bool
+is_iconv_reusable(const char *encoding)
+{
+	std::string name;
+	for (const char *p = encoding; *p != '\0' && *p != '/'; p++) {
+		name.append(1, (char) toupper((unsigned char) *p));
+	}
+
+	bool unicode = name.find("UTF-16") == 0 || name.find("UTF16") == 0
+		|| name.find("UTF-32") == 0 || name.find("UTF32") == 0
+		|| name.find("UCS") == 0 || name.find("UNICODE") == 0;
+	size_t nameLen = name.size();
+	bool byteOrder = nameLen > 2
+		&& (name.compare(nameLen - 2, 2, "BE") == 0
+		|| name.compare(nameLen - 2, 2, "LE") == 0);
+
+	return !unicode || byteOrder;
+}
+
+/*
+ * Take iconv descriptor for encoding pair from cache (descriptor is
+ * created if no free descriptor is cached).
+ */
+iconv_t
+acquire_iconv(const char *toEncoding, const char *fromEncoding)
+{
+#ifndef _WIN32
+	std::string key = makePairKey(toEncoding, fromEncoding);
+	lockCodecCache();
+	std::vector<iconv_t> &iconvDescs = getCodecCache().iconvDescs[key];
+	if (!iconvDescs.empty()) {
+		iconv_t iconvDesc = iconvDescs.back();
+		iconvDescs.pop_back();
+		unlockCodecCache();
+		return iconvDesc;
+	}
+	unlockCodecCache();
+#endif
+
+	return iconv_open(toEncoding, fromEncoding);
+}
+
+/*
+ * Return iconv descriptor for encoding pair to cache (conversion state
+ * is reset).
+ */
+void
+release_iconv(iconv_t iconvDesc, const char *toEncoding,
+	const char *fromEncoding)
+{
+	if (iconvDesc == (iconv_t) -1) {
+		return;
+	}
+
+#ifndef _WIN32
+	// Reset conversion state.
+	::iconv(iconvDesc, NULL, NULL, NULL, NULL);
+
+	if (!is_iconv_reusable(toEncoding)
+		|| !is_iconv_reusable(fromEncoding))
+	{
+		iconv_close(iconvDesc);
+		return;
+	}
+
+	std::string key = makePairKey(toEncoding, fromEncoding);
+	lockCodecCache();
+	std::vector<iconv_t> &iconvDescs = getCodecCache().iconvDescs[key];
+	if (iconvDescs.size() < MARC_CODEC_CACHE_SIZE) {
+		iconvDescs.push_back(iconvDesc);
+		iconvDesc = (iconv_t) -1;
+	}
+	unlockCodecCache();
+	if (iconvDesc == (iconv_t) -1) {
+		return;
+	}
+#else
+	(void) (toEncoding);
+	(void) (fromEncoding);
+#endif
+
+	iconv_close(iconvDesc);
+}
+
+/*
+ * Find encoding table for output encoding (NULL if not cached).
+ */
+const MarcEncodingTable *
+find_encoding_table(const std::string &encoding)
+{
+	const MarcEncodingTable *encodingTable = NULL;
+
+	lockCodecCache();
+	MarcCodecCache &cache = getCodecCache();
+	std::map<std::string, MarcEncodingTable *>::const_iterator tableIt =
+		cache.encodingTables.find(encoding);
+	if (tableIt != cache.encodingTables.end()) {
+		encodingTable = tableIt->second;
+	}
+	unlockCodecCache();
+
+	return encodingTable;
+}
+
+/*
+ * Add encoding table for output encoding (cached table is returned if
+ * table was added by other thread).
+ */
+const MarcEncodingTable *
+add_encoding_table(const std::string &encoding,
+	const MarcEncodingTable &encodingTable)
+{
+	lockCodecCache();
+	MarcEncodingTable *&cachedTable =
+		getCodecCache().encodingTables[encoding];
+	if (cachedTable == NULL) {
+		cachedTable = new MarcEncodingTable(encodingTable);
+	}
+	const MarcEncodingTable *result = cachedTable;
+	unlockCodecCache();
+
+	return result;
+}
+
+/*
+ * Find byte map of input encoding (NULL if not cached).
+ */
+const MarcByteMap *
+find_byte_map(const std::string &encoding)
+{
+	const MarcByteMap *byteMap = NULL;
+
+	lockCodecCache();
+	MarcCodecCache &cache = getCodecCache();
+	std::map<std::string, MarcByteMap *>::const_iterator mapIt =
+		cache.byteMaps.find(encoding);
+	if (mapIt != cache.byteMaps.end()) {
+		byteMap = mapIt->second;
+	}
+	unlockCodecCache();
+
+	return byteMap;
+}
+
+/*
+ * Add byte map of input encoding (cached map is returned if map was
+ * added by other thread).
+ */
+const MarcByteMap *
+add_byte_map(const std::string &encoding, const MarcByteMap &byteMap)
+{
+	lockCodecCache();
+	MarcByteMap *&cachedMap = getCodecCache().byteMaps[encoding];
+	if (cachedMap == NULL) {
+		cachedMap = new MarcByteMap(byteMap);
+	}
+	const MarcByteMap *result = cachedMap;
+	unlockCodecCache();
+
+	return result;
+}
+
+} // namespace marcrecord
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_CODEC_CACHE_H
+#define MARCRECORD_MARC_CODEC_CACHE_H
+
+#include <iconv.h>
+#include <string>
+#include <vector>
+
+// Maximum number of free iconv descriptors cached for encoding pair.
+#define MARC_CODEC_CACHE_SIZE	16
+
+namespace marcrecord {
+
+/*
+ * Process-wide cache of iconv descriptors and tables compiled for
+ * encodings. Iconv descriptors are not thread-safe, so each descriptor
+ * is handed out to one user until it is returned to cache. Compiled
+ * tables are immutable once added and are shared by all threads.
+ * Without threads support (Windows) descriptors are not cached, tables
+ * are cached without locking.
+ */
+
+/*
+ * Encoding table compiled for output encoding.
+ */
+struct MarcEncodingTable {
+	// Encoding is single-byte and converted by table.
+	bool singleByte;
+	// ASCII characters are not changed by encoding.
+	bool asciiCompatible;
+	// Index of pages in encoding table (-1 if page is not mapped).
+	int pageIndex[256];
+	// Encoding table (pages of 256 characters, -1 if not mapped).
+	std::vector<short> table;
+};
+typedef struct MarcEncodingTable MarcEncodingTable;
+
+/*
+ * Map of bytes of single-byte encoding to Unicode characters (as expat
+ * XML_Encoding map, -1 if byte is not valid).
+ */
+struct MarcByteMap {
+	// Unicode characters of bytes.
+	int map[256];
+};
+typedef struct MarcByteMap MarcByteMap;
+
+// Check if iconv descriptors for encoding can be reused after reset.
+bool is_iconv_reusable(const char *encoding);
+// Take iconv descriptor for encoding pair from cache (descriptor is
+// created if no free descriptor is cached).
+iconv_t acquire_iconv(const char *toEncoding, const char *fromEncoding);
+// Return iconv descriptor for encoding pair to cache (conversion state
+// is reset).
+void release_iconv(iconv_t iconvDesc, const char *toEncoding,
+	const char *fromEncoding);
+
+// Find encoding table for output encoding (NULL if not cached).
+const MarcEncodingTable *find_encoding_table(const std::string &encoding);
+// Add encoding table for output encoding (cached table is returned if
+// table was added by other thread).
+const MarcEncodingTable *add_encoding_table(const std::string &encoding,
+	const MarcEncodingTable &encodingTable);
+
+// Find byte map of input encoding (NULL if not cached).
+const MarcByteMap *find_byte_map(const std::string &encoding);
+// Add byte map of input encoding (cached map is returned if map was
+// added by other thread).
+const MarcByteMap *add_byte_map(const std::string &encoding,
+	const MarcByteMap &byteMap);
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_CODEC_CACHE_H
@@ -0,0 +1,764 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "marc_compress.h"
+
+#define COMPRESS_BUFFER_SIZE		1048576
+#define COMPRESS_ALIGNMENT		4096
+
+#define COMPRESS_CONTINUE		0
+#define COMPRESS_FLUSH			1
+#define COMPRESS_END			2
+
+namespace marcrecord {
+
+/*
+ * Check if compression format is supported.
+ */
+bool
+is_compression_supported(CompressionFormat format)
+{
+	switch (format) {
+	case COMPRESSION_NONE:
+		return true;
+#ifdef HAVE_ZLIB
+	case COMPRESSION_GZIP:
+		return true;
+#endif
+#ifdef HAVE_ZSTD
+	case COMPRESSION_ZSTD:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+/*
+ * Compress block of data as a single frame (thread-safe).
+ */
+bool
+compress_block(CompressionFormat format, int level, const char *data,
+	size_t dataLen, std::string &compressedData)
+{
+	switch (format) {
+	case COMPRESSION_NONE:
+		compressedData.assign(data, dataLen);
+		return true;
+#ifdef HAVE_ZLIB
+	case COMPRESSION_GZIP:
+		{
+			uLongf destLen = compressBound(dataLen);
+			compressedData.resize(destLen);
+			if (compress2((Bytef *) &compressedData[0], &destLen,
+				(const Bytef *) data, dataLen,
+				level < 0 ? Z_DEFAULT_COMPRESSION : level) != Z_OK)
+			{
+				return false;
+			}
+			compressedData.resize(destLen);
+			return true;
+		}
+#endif
+#ifdef HAVE_ZSTD
+	case COMPRESSION_ZSTD:
+		{
+			size_t destLen = ZSTD_compressBound(dataLen);
+			compressedData.resize(destLen);
+			destLen = ZSTD_compress(&compressedData[0], destLen,
+				data, dataLen,
+				level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+			if (ZSTD_isError(destLen)) {
+				return false;
+			}
+			compressedData.resize(destLen);
+			return true;
+		}
+#endif
+	default:
+		(void) level;
+		return false;
+	}
+}
+
+/*
+ * Decompress single frame to buffer of known size (thread-safe).
+ */
+bool
+decompress_block(CompressionFormat format, const char *data, size_t dataLen,
+	char *buf, size_t bufLen)
+{
+	switch (format) {
+	case COMPRESSION_NONE:
+		if (dataLen != bufLen) {
+			return false;
+		}
+		memcpy(buf, data, dataLen);
+		return true;
+#ifdef HAVE_ZLIB
+	case COMPRESSION_GZIP:
+		{
+			uLongf destLen = bufLen;
+			return uncompress((Bytef *) buf, &destLen,
+				(const Bytef *) data, dataLen) == Z_OK
+				&& destLen == bufLen;
+		}
+#endif
+#ifdef HAVE_ZSTD
+	case COMPRESSION_ZSTD:
+		{
+			size_t destLen = ZSTD_decompress(buf, bufLen,
+				data, dataLen);
+			return !ZSTD_isError(destLen) && destLen == bufLen;
+		}
+#endif
+	default:
+		return false;
+	}
+}
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcCompressedInput::MarcCompressedInput()
+{
+	// Clear member variables.
+	m_stream = NULL;
+	close();
+}
+
+/*
+ * Destructor.
+ */
+MarcCompressedInput::~MarcCompressedInput()
+{
+	// Close input file.
+	close();
+}
+
+/*
+ * Open input file and detect compression format.
+ */
+bool
+MarcCompressedInput::open(FILE *inputFile)
+{
+	m_fileInput.open(inputFile);
+	return open(&m_fileInput);
+}
+
+/*
+ * Open input source and detect compression format.
+ */
+bool
+MarcCompressedInput::open(MarcInput *input)
+{
+	// Close previous input file.
+	close();
+
+	m_input = input;
+	m_inputBuf.resize(COMPRESS_BUFFER_SIZE);
+
+	// Detect compression format by magic bytes.
+	fillInputBuffer();
+	const unsigned char *magic = (const unsigned char *) &m_inputBuf[0];
+	if (m_inputBufLen >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+		m_format = COMPRESSION_GZIP;
+	} else if (m_inputBufLen >= 4 && magic[0] == 0x28 && magic[1] == 0xB5
+		&& magic[2] == 0x2F && magic[3] == 0xFD)
+	{
+		m_format = COMPRESSION_ZSTD;
+	} else {
+		m_format = COMPRESSION_NONE;
+	}
+
+	if (!is_compression_supported(m_format)) {
+		m_error = true;
+		m_errorMessage = m_format == COMPRESSION_GZIP
+			? "gzip compressed input is not supported"
+			: "zstd compressed input is not supported";
+		return false;
+	}
+
+	// Initialize decompression.
+	bool streamInitialized = true;
+	m_frameEnd = true;
+#ifdef HAVE_ZLIB
+	if (m_format == COMPRESSION_GZIP) {
+		z_stream *stream = new z_stream;
+		memset(stream, 0, sizeof(z_stream));
+		// Window bits 15 + 32: zlib and gzip headers are detected.
+		streamInitialized = inflateInit2(stream, 15 + 32) == Z_OK;
+		m_stream = stream;
+	}
+#endif
+#ifdef HAVE_ZSTD
+	if (m_format == COMPRESSION_ZSTD) {
+		ZSTD_DStream *stream = ZSTD_createDStream();
+		streamInitialized = stream != NULL
+			&& !ZSTD_isError(ZSTD_initDStream(stream));
+		m_stream = stream;
+	}
+#endif
+	if (!streamInitialized) {
+		m_error = true;
+		m_errorMessage = "decompression initialization failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Close input file.
+ */
+void
+MarcCompressedInput::close(void)
+{
+	// Finalize decompression.
+	if (m_stream != NULL) {
+#ifdef HAVE_ZLIB
+		if (m_format == COMPRESSION_GZIP) {
+			inflateEnd((z_stream *) m_stream);
+			delete (z_stream *) m_stream;
+		}
+#endif
+#ifdef HAVE_ZSTD
+		if (m_format == COMPRESSION_ZSTD) {
+			ZSTD_freeDStream((ZSTD_DStream *) m_stream);
+		}
+#endif
+	}
+
+	// Clear member variables.
+	m_input = NULL;
+	m_format = COMPRESSION_NONE;
+	m_stream = NULL;
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputEof = false;
+	m_frameEnd = true;
+	m_error = false;
+	m_errorMessage = "";
+}
+
+/*
+ * Read data from input (less data is returned only at end of input).
+ */
+size_t
+MarcCompressedInput::read(char *buf, size_t bufLen)
+{
+	if (m_error) {
+		return 0;
+	}
+
+	switch (m_format) {
+	case COMPRESSION_GZIP:
+		return readGzip(buf, bufLen);
+	case COMPRESSION_ZSTD:
+		return readZstd(buf, bufLen);
+	default:
+		break;
+	}
+
+	// Copy buffered data, read the rest directly from file.
+	size_t readLen = std::min(bufLen, m_inputBufLen - m_inputBufPos);
+	memcpy(buf, &m_inputBuf[m_inputBufPos], readLen);
+	m_inputBufPos += readLen;
+	if (readLen < bufLen && !m_inputEof) {
+		readLen += m_input->read(buf + readLen, bufLen - readLen);
+	}
+
+	return readLen;
+}
+
+/*
+ * Set position in input (only uncompressed input is seekable).
+ */
+bool
+MarcCompressedInput::seek(unsigned long long inputPos)
+{
+	if (m_format != COMPRESSION_NONE || !m_input->seek(inputPos)) {
+		return false;
+	}
+
+	// Discard buffered data.
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputEof = false;
+	return true;
+}
+
+/*
+ * Get compression format of input file.
+ */
+CompressionFormat
+MarcCompressedInput::getFormat(void)
+{
+	return m_format;
+}
+
+/*
+ * Check if decompression error occured.
+ */
+bool
+MarcCompressedInput::isError(void)
+{
+	return m_error;
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcCompressedInput::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+/*
+ * Fill input buffer with data from file (unread data is kept).
+ */
+bool
+MarcCompressedInput::fillInputBuffer(void)
+{
+	if (m_inputEof) {
+		return false;
+	}
+
+	// Move unread data to the beginning of buffer.
+	m_inputBufLen -= m_inputBufPos;
+	memmove(&m_inputBuf[0], &m_inputBuf[m_inputBufPos], m_inputBufLen);
+	m_inputBufPos = 0;
+
+	// Read next block of data from file.
+	size_t readLen = m_input->read(&m_inputBuf[m_inputBufLen],
+		m_inputBuf.size() - m_inputBufLen);
+	m_inputBufLen += readLen;
+	if (readLen == 0) {
+		m_inputEof = true;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read and decompress gzip data.
+ */
+size_t
+MarcCompressedInput::readGzip(char *buf, size_t bufLen)
+{
+	size_t readLen = 0;
+
+#ifdef HAVE_ZLIB
+	z_stream *stream = (z_stream *) m_stream;
+	while (readLen < bufLen) {
+		// Refill input buffer when it is empty.
+		if (m_inputBufPos == m_inputBufLen && !fillInputBuffer()) {
+			break;
+		}
+
+		if (m_frameEnd) {
+			// Next gzip member must start with magic bytes,
+			// other trailing data is ignored (as gzip does).
+			if (m_inputBufLen - m_inputBufPos < 2) {
+				fillInputBuffer();
+			}
+			const unsigned char *magic = (const unsigned char *)
+				&m_inputBuf[m_inputBufPos];
+			if (m_inputBufLen - m_inputBufPos < 2
+				|| magic[0] != 0x1F || magic[1] != 0x8B)
+			{
+				m_inputBufPos = m_inputBufLen;
+				m_inputEof = true;
+				break;
+			}
+			m_frameEnd = false;
+		}
+
+		// Decompress data.
+		stream->next_in = (Bytef *) &m_inputBuf[m_inputBufPos];
+		stream->avail_in = (uInt) (m_inputBufLen - m_inputBufPos);
+		stream->next_out = (Bytef *) buf + readLen;
+		stream->avail_out = (uInt) (bufLen - readLen);
+		int result = inflate(stream, Z_NO_FLUSH);
+		m_inputBufPos = m_inputBufLen - stream->avail_in;
+		readLen = bufLen - stream->avail_out;
+
+		if (result == Z_STREAM_END) {
+			// Prepare for next gzip member.
+			m_frameEnd = true;
+			inflateReset(stream);
+		} else if (result != Z_OK && result != Z_BUF_ERROR) {
+			m_error = true;
+			m_errorMessage = "gzip data decompression failed";
+			return readLen;
+		}
+	}
+
+	if (m_inputEof && !m_frameEnd && readLen < bufLen) {
+		m_error = true;
+		m_errorMessage = "gzip data incomplete";
+	}
+#else
+	(void) buf;
+	(void) bufLen;
+#endif
+
+	return readLen;
+}
+
+/*
+ * Read and decompress zstd data.
+ */
+size_t
+MarcCompressedInput::readZstd(char *buf, size_t bufLen)
+{
+	size_t readLen = 0;
+
+#ifdef HAVE_ZSTD
+	ZSTD_DStream *stream = (ZSTD_DStream *) m_stream;
+	while (readLen < bufLen) {
+		// Refill input buffer when it is empty.
+		if (m_inputBufPos == m_inputBufLen && !fillInputBuffer()) {
+			break;
+		}
+
+		// Decompress data (concatenated frames are supported).
+		ZSTD_inBuffer input = { &m_inputBuf[0], m_inputBufLen,
+			m_inputBufPos };
+		ZSTD_outBuffer output = { buf, bufLen, readLen };
+		size_t result = ZSTD_decompressStream(stream, &output, &input);
+		m_inputBufPos = input.pos;
+		readLen = output.pos;
+
+		if (ZSTD_isError(result)) {
+			m_error = true;
+			m_errorMessage = "zstd data decompression failed";
+			return readLen;
+		}
+		m_frameEnd = result == 0;
+	}
+
+	if (m_inputEof && !m_frameEnd && readLen < bufLen) {
+		m_error = true;
+		m_errorMessage = "zstd data incomplete";
+	}
+#else
+	(void) buf;
+	(void) bufLen;
+#endif
+
+	return readLen;
+}
+
+/*
+ * Constructor.
+ */
+MarcCompressedOutput::MarcCompressedOutput()
+{
+	// Clear member variables.
+	m_output = NULL;
+	m_format = COMPRESSION_NONE;
+	m_stream = NULL;
+	m_outputBuf = NULL;
+	m_outputBufLen = 0;
+}
+
+/*
+ * Destructor.
+ */
+MarcCompressedOutput::~MarcCompressedOutput()
+{
+	// Finish compressed stream.
+	close();
+}
+
+/*
+ * Initialize compression to output sink.
+ */
+bool
+MarcCompressedOutput::open(MarcOutput *output, CompressionFormat format,
+	int level, int numThreads)
+{
+	// Finish previous compressed stream.
+	close();
+
+	m_output = output;
+	m_format = format;
+	m_errorMessage = "";
+
+	if (!is_compression_supported(format)) {
+		m_errorMessage = "compression format is not supported";
+		return false;
+	}
+
+	// Allocate output buffer aligned for direct i/o.
+	if (m_outputBufData.empty()) {
+		m_outputBufData.resize(COMPRESS_BUFFER_SIZE
+			+ COMPRESS_ALIGNMENT);
+		char *bufData = &m_outputBufData[0];
+		m_outputBuf = bufData + (COMPRESS_ALIGNMENT
+			- (size_t) bufData % COMPRESS_ALIGNMENT)
+			% COMPRESS_ALIGNMENT;
+	}
+	m_outputBufLen = 0;
+
+	// Initialize compression.
+	bool streamInitialized = true;
+#ifdef HAVE_ZLIB
+	if (format == COMPRESSION_GZIP) {
+		z_stream *stream = new z_stream;
+		memset(stream, 0, sizeof(z_stream));
+		// Window bits 15 + 16: gzip header is written.
+		streamInitialized = deflateInit2(stream,
+			level < 0 ? Z_DEFAULT_COMPRESSION : level,
+			Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+		m_stream = stream;
+	}
+#endif
+#ifdef HAVE_ZSTD
+	if (format == COMPRESSION_ZSTD) {
+		ZSTD_CCtx *stream = ZSTD_createCCtx();
+		streamInitialized = stream != NULL;
+		m_stream = stream;
+		if (streamInitialized && level >= 0) {
+			streamInitialized = !ZSTD_isError(
+				ZSTD_CCtx_setParameter(stream,
+				ZSTD_c_compressionLevel, level));
+		}
+		if (streamInitialized && numThreads > 1) {
+			// Compress with worker threads.
+			if (ZSTD_isError(ZSTD_CCtx_setParameter(stream,
+				ZSTD_c_nbWorkers, numThreads)))
+			{
+				m_errorMessage = "multi-threaded compression "
+					"is not supported";
+				return false;
+			}
+		}
+	}
+#endif
+	(void) level;
+	(void) numThreads;
+	if (!streamInitialized) {
+		m_errorMessage = "compression initialization failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Finish compressed stream.
+ */
+bool
+MarcCompressedOutput::close(void)
+{
+	bool result = true;
+
+	if (m_stream != NULL) {
+		// Write end of stream.
+		result = compress(NULL, 0, COMPRESS_END)
+			&& writeOutputBuffer() && m_output->flush();
+
+		// Finalize compression.
+#ifdef HAVE_ZLIB
+		if (m_format == COMPRESSION_GZIP) {
+			deflateEnd((z_stream *) m_stream);
+			delete (z_stream *) m_stream;
+		}
+#endif
+#ifdef HAVE_ZSTD
+		if (m_format == COMPRESSION_ZSTD) {
+			ZSTD_freeCCtx((ZSTD_CCtx *) m_stream);
+		}
+#endif
+	}
+
+	// Clear member variables.
+	m_output = NULL;
+	m_format = COMPRESSION_NONE;
+	m_stream = NULL;
+	m_outputBufLen = 0;
+
+	return result;
+}
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcCompressedOutput::write(const MarcOutputBlock *blocks, size_t numBlocks)
+{
+	for (size_t i = 0; i < numBlocks; i++) {
+		if (!compress(blocks[i].data, blocks[i].length,
+			COMPRESS_CONTINUE))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Flush output.
+ */
+bool
+MarcCompressedOutput::flush(void)
+{
+	return compress(NULL, 0, COMPRESS_FLUSH) && writeOutputBuffer()
+		&& m_output->flush();
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcCompressedOutput::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+/*
+ * Write data from output buffer to output sink.
+ */
+bool
+MarcCompressedOutput::writeOutputBuffer(void)
+{
+	if (m_outputBufLen == 0) {
+		return true;
+	}
+
+	MarcOutputBlock block = { m_outputBuf, m_outputBufLen };
+	m_outputBufLen = 0;
+	if (!m_output->write(&block, 1)) {
+		m_errorMessage = "i/o operation failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Compress data (mode: continue, flush or finish stream).
+ */
+bool
+MarcCompressedOutput::compress(const char *data, size_t dataLen, int mode)
+{
+	if (m_stream == NULL) {
+		return false;
+	}
+
+#ifdef HAVE_ZLIB
+	if (m_format == COMPRESSION_GZIP) {
+		z_stream *stream = (z_stream *) m_stream;
+		int flush = mode == COMPRESS_END ? Z_FINISH
+			: mode == COMPRESS_FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+		stream->next_in = (Bytef *) data;
+		stream->avail_in = (uInt) dataLen;
+		for (;;) {
+			// Write output buffer when it is full.
+			if (m_outputBufLen == COMPRESS_BUFFER_SIZE
+				&& !writeOutputBuffer())
+			{
+				return false;
+			}
+
+			stream->next_out = (Bytef *) m_outputBuf + m_outputBufLen;
+			stream->avail_out =
+				(uInt) (COMPRESS_BUFFER_SIZE - m_outputBufLen);
+			int result = deflate(stream, flush);
+			m_outputBufLen = COMPRESS_BUFFER_SIZE - stream->avail_out;
+			if (result == Z_STREAM_ERROR) {
+				m_errorMessage = "data compression failed";
+				return false;
+			}
+
+			// Finish when all data is compressed and flushed.
+			if (stream->avail_in == 0 && stream->avail_out > 0
+				&& (flush != Z_FINISH || result == Z_STREAM_END))
+			{
+				break;
+			}
+		}
+	}
+#endif
+#ifdef HAVE_ZSTD
+	if (m_format == COMPRESSION_ZSTD) {
+		ZSTD_CCtx *stream = (ZSTD_CCtx *) m_stream;
+		ZSTD_EndDirective endOp = mode == COMPRESS_END ? ZSTD_e_end
+			: mode == COMPRESS_FLUSH ? ZSTD_e_flush : ZSTD_e_continue;
+		ZSTD_inBuffer input = { data, dataLen, 0 };
+		for (;;) {
+			// Write output buffer when it is full.
+			if (m_outputBufLen == COMPRESS_BUFFER_SIZE
+				&& !writeOutputBuffer())
+			{
+				return false;
+			}
+
+			ZSTD_outBuffer output = { m_outputBuf,
+				COMPRESS_BUFFER_SIZE, m_outputBufLen };
+			size_t result = ZSTD_compressStream2(stream, &output,
+				&input, endOp);
+			m_outputBufLen = output.pos;
+			if (ZSTD_isError(result)) {
+				m_errorMessage = "data compression failed";
+				return false;
+			}
+
+			// Finish when all data is compressed and flushed.
+			if (endOp == ZSTD_e_continue
+				? input.pos == input.size : result == 0)
+			{
+				break;
+			}
+		}
+	}
+#endif
+	(void) data;
+	(void) dataLen;
+	(void) mode;
+
+	return true;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_COMPRESS_H
+#define MARCRECORD_MARC_COMPRESS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "marc_reader.h"
+#include "marc_writer.h"
+
+namespace marcrecord {
+
+// Compression formats of streams.
+enum CompressionFormat {
+	COMPRESSION_NONE = 0,
+	COMPRESSION_GZIP = 1,
+	COMPRESSION_ZSTD = 2
+};
+
+// Check if compression format is supported.
+bool is_compression_supported(CompressionFormat format);
+// Compress block of data as a single frame (thread-safe).
+bool compress_block(CompressionFormat format, int level,
+	const char *data, size_t dataLen, std::string &compressedData);
+// Decompress single frame to buffer of known size (thread-safe).
+bool decompress_block(CompressionFormat format, const char *data,
+	size_t dataLen, char *buf, size_t bufLen);
+
+/*
+ * Input source with transparent decompression (format is detected by
+ * magic bytes).
+ */
+class MarcCompressedInput : public MarcInput {
+protected:
+	// Input source of compressed data.
+	MarcInput *m_input;
+	// Input source for input file.
+	MarcFileInput m_fileInput;
+	// Compression format of input file.
+	CompressionFormat m_format;
+	// Decompression stream (z_stream or ZSTD_DStream).
+	void *m_stream;
+	// Input buffer.
+	std::vector<char> m_inputBuf;
+	// Position of unread data in input buffer.
+	size_t m_inputBufPos;
+	// Length of data in input buffer.
+	size_t m_inputBufLen;
+	// End of input file reached flag.
+	bool m_inputEof;
+	// End of compressed frame reached flag.
+	bool m_frameEnd;
+	// Decompression error flag.
+	bool m_error;
+	// Message of last error.
+	std::string m_errorMessage;
+
+	// Fill input buffer with data from file (unread data is kept).
+	bool fillInputBuffer(void);
+	// Read and decompress gzip data.
+	size_t readGzip(char *buf, size_t bufLen);
+	// Read and decompress zstd data.
+	size_t readZstd(char *buf, size_t bufLen);
+
+public:
+	// Constructor.
+	MarcCompressedInput();
+	// Destructor.
+	~MarcCompressedInput();
+
+	// Open input file and detect compression format.
+	bool open(FILE *inputFile);
+	// Open input source and detect compression format.
+	bool open(MarcInput *input);
+	// Close input file.
+	void close(void);
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen);
+	// Set position in input (only uncompressed input is seekable).
+	bool seek(unsigned long long inputPos);
+
+	// Get compression format of input file.
+	CompressionFormat getFormat(void);
+	// Check if decompression error occured.
+	bool isError(void);
+	// Get last error message.
+	std::string & getErrorMessage(void);
+};
+
+/*
+ * Output sink with compression.
+ */
+class MarcCompressedOutput : public MarcOutput {
+protected:
+	// Output sink for compressed data.
+	MarcOutput *m_output;
+	// Compression format.
+	CompressionFormat m_format;
+	// Compression stream (z_stream or ZSTD_CStream).
+	void *m_stream;
+	// Output buffer memory.
+	std::vector<char> m_outputBufData;
+	// Output buffer (aligned).
+	char *m_outputBuf;
+	// Length of data in output buffer.
+	size_t m_outputBufLen;
+	// Message of last error.
+	std::string m_errorMessage;
+
+	// Write data from output buffer to output sink.
+	bool writeOutputBuffer(void);
+	// Compress data (mode: continue, flush or finish stream).
+	bool compress(const char *data, size_t dataLen, int mode);
+
+public:
+	// Constructor.
+	MarcCompressedOutput();
+	// Destructor.
+	~MarcCompressedOutput();
+
+	// Initialize compression to output sink.
+	bool open(MarcOutput *output, CompressionFormat format,
+		int level = -1, int numThreads = 0);
+	// Finish compressed stream.
+	bool close(void);
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+	// Flush output.
+	bool flush(void);
+
+	// Get last error message.
+	std::string & getErrorMessage(void);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_COMPRESS_H
@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "marciso_reader.h"
+#include "marcjson_reader.h"
+#include "marcxml_reader.h"
+#include "marciso_writer.h"
+#include "marcjson_writer.h"
+#include "marctext_writer.h"
+#include "marcxml_writer.h"
+#include "unimarcxml_writer.h"
+#include "marc_converter.h"
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcConverter::MarcConverter()
+{
+	m_inputFormat = FORMAT_NULL;
+	m_outputFormat = FORMAT_NULL;
+	m_reader = NULL;
+	m_writer = NULL;
+	m_permissiveMode = false;
+	m_numRecords = 0;
+	m_numBadRecords = 0;
+	m_output.open(&m_outputData);
+}
+
+/*
+ * Destructor.
+ */
+MarcConverter::~MarcConverter()
+{
+	close();
+}
+
+/*
+ * Convert format name to format code.
+ */
+MarcConverter::RecordFormat
+MarcConverter::parseFormat(const char *formatName)
+{
+	if (formatName == NULL) {
+		return FORMAT_NULL;
+	} else if (strcmp(formatName, "iso2709") == 0) {
+		return FORMAT_ISO2709;
+	} else if (strcmp(formatName, "marcxml") == 0) {
+		return FORMAT_MARCXML;
+	} else if (strcmp(formatName, "unimarcxml") == 0) {
+		return FORMAT_UNIMARCXML;
+	} else if (strcmp(formatName, "text") == 0) {
+		return FORMAT_TEXT;
+	} else if (strcmp(formatName, "json") == 0) {
+		return FORMAT_JSON;
+	} else if (strcmp(formatName, "jsonl") == 0) {
+		return FORMAT_JSONL;
+	}
+
+	return FORMAT_NULL;
+}
+
+/*
+ * Open reader and writer for formats and encodings (NULL or empty
+ * encoding is UTF-8).
+ */
+bool
+MarcConverter::open(const char *inputFormat, const char *outputFormat,
+	const char *inputEncoding, const char *outputEncoding)
+{
+	close();
+
+	if (inputEncoding != NULL && *inputEncoding == '\0') {
+		inputEncoding = NULL;
+	}
+	if (outputEncoding != NULL && *outputEncoding == '\0') {
+		outputEncoding = NULL;
+	}
+
+	// Create records reader.
+	m_inputFormat = parseFormat(inputFormat);
+	switch (m_inputFormat) {
+	case FORMAT_ISO2709:
+		{
+			MarcIsoReader *isoReader = new MarcIsoReader();
+			m_reader = isoReader;
+			if (!isoReader->open(NULL, inputEncoding)) {
+				break;
+			}
+			// Fields are copied to ISO 2709 output without decoding.
+			isoReader->setLazyMode(
+				parseFormat(outputFormat) == FORMAT_ISO2709);
+		}
+		break;
+	case FORMAT_MARCXML:
+		m_reader = new MarcXmlReader();
+		m_reader->open(NULL, inputEncoding);
+		break;
+	case FORMAT_JSON:
+	case FORMAT_JSONL:
+		m_reader = new MarcJsonReader();
+		m_reader->open(NULL, inputEncoding);
+		break;
+	default:
+		m_errorMessage = "wrong input format specified";
+		close();
+		return false;
+	}
+	if (m_reader->getErrorCode() != MarcReader::OK) {
+		m_errorMessage = m_reader->getErrorMessage();
+		close();
+		return false;
+	}
+	m_reader->setInput(&m_input);
+	m_reader->setAutoCorrectionMode(m_permissiveMode);
+
+	// Create records writer.
+	m_outputFormat = parseFormat(outputFormat);
+	switch (m_outputFormat) {
+	case FORMAT_ISO2709:
+		m_writer = new MarcIsoWriter();
+		break;
+	case FORMAT_MARCXML:
+		m_writer = new MarcXmlWriter();
+		break;
+	case FORMAT_UNIMARCXML:
+		m_writer = new UnimarcXmlWriter();
+		break;
+	case FORMAT_TEXT:
+		m_writer = new MarcTextWriter();
+		((MarcTextWriter *) m_writer)->setRecordFooter("\n");
+		break;
+	case FORMAT_JSON:
+	case FORMAT_JSONL:
+		m_writer = new MarcJsonWriter();
+		((MarcJsonWriter *) m_writer)->setLinesMode(
+			m_outputFormat == FORMAT_JSONL);
+		break;
+	default:
+		m_errorMessage = "wrong output format specified";
+		close();
+		return false;
+	}
+	if (!m_writer->open(NULL, outputEncoding)) {
+		m_errorMessage = m_writer->getErrorMessage();
+		close();
+		return false;
+	}
+	m_writer->setOutput(&m_output);
+
+	return true;
+}
+
+/*
+ * Close reader and writer.
+ */
+void
+MarcConverter::close(void)
+{
+	if (m_reader != NULL) {
+		m_reader->close();
+		delete m_reader;
+		m_reader = NULL;
+	}
+	if (m_writer != NULL) {
+		m_writer->close();
+		delete m_writer;
+		m_writer = NULL;
+	}
+
+	m_inputFormat = FORMAT_NULL;
+	m_outputFormat = FORMAT_NULL;
+	m_outputData.clear();
+	m_numRecords = 0;
+	m_numBadRecords = 0;
+}
+
+/*
+ * Set permissive mode (errors of reader are corrected, invalid records
+ * and records which can't be written are skipped).
+ */
+void
+MarcConverter::setPermissiveMode(bool permissiveMode)
+{
+	m_permissiveMode = permissiveMode;
+	if (m_reader != NULL) {
+		m_reader->setAutoCorrectionMode(permissiveMode);
+	}
+}
+
+/*
+ * Convert records from input data to output data (header and footer
+ * of output format are omitted for parts of output except first and
+ * last).
+ */
+bool
+MarcConverter::convert(const char *data, size_t dataLen,
+	std::string &outputData, bool withHeader, bool withFooter)
+{
+	// Convert records from memory buffer to output data (buffer is
+	// reused).
+	m_input.open(data, dataLen);
+	bool status = convert(&m_input, &m_output, withHeader, withFooter);
+	if (status) {
+		outputData.swap(m_outputData);
+	}
+	m_outputData.clear();
+
+	return status;
+}
+
+/*
+ * Convert records from input source to output sink (output is flushed
+ * after conversion).
+ */
+bool
+MarcConverter::convert(MarcInput *input, MarcOutput *output,
+	bool withHeader, bool withFooter)
+{
+	m_numRecords = 0;
+	m_numBadRecords = 0;
+	m_errorMessage = "";
+	if (m_reader == NULL || m_writer == NULL) {
+		m_errorMessage = "converter is not opened";
+		return false;
+	}
+
+	// Start reading of input source and writing of new output.
+	m_reader->setInput(input);
+	m_reader->reset();
+	m_writer->setOutput(output);
+	if (!m_writer->reset()) {
+		m_errorMessage = m_writer->getErrorMessage();
+		return false;
+	}
+
+	// Convert records (conversion fails at first error of reader or
+	// writer, invalid records and records which can't be written are
+	// skipped in permissive mode, as in marc-convert).
+	bool status = withHeader ? writeHeader() : true;
+	while (status) {
+		if (!m_reader->next(m_record)) {
+			if (m_permissiveMode && m_reader->getErrorCode()
+				== MarcReader::ERROR_INVALID_RECORD)
+			{
+				m_numBadRecords++;
+				continue;
+			}
+			break;
+		}
+
+		if (m_outputFormat == FORMAT_TEXT) {
+			// Records are numbered in input (with skipped records).
+			char recordHeader[30];
+			sprintf(recordHeader, m_numRecords > 0
+				? "\nRecord %u\n" : "Record %u\n",
+				m_numRecords + m_numBadRecords + 1);
+			((MarcTextWriter *) m_writer)->setRecordHeader(
+				recordHeader);
+		}
+		if (m_writer->write(m_record)) {
+			m_numRecords++;
+		} else if (m_permissiveMode) {
+			m_numBadRecords++;
+		} else {
+			m_errorMessage = m_writer->getErrorMessage();
+			status = false;
+		}
+	}
+	if (status && m_reader->getErrorCode() != MarcReader::END_OF_FILE) {
+		m_errorMessage = m_reader->getErrorMessage();
+		status = false;
+	}
+	if (status && withFooter) {
+		status = writeFooter();
+	}
+
+	// Write buffered data to output sink.
+	if (!m_writer->flush() && status) {
+		m_errorMessage = m_writer->getErrorMessage();
+		status = false;
+	}
+
+	return status;
+}
+
+/*
+ * Get number of records in last conversion.
+ */
+unsigned int
+MarcConverter::getNumRecords(void)
+{
+	return m_numRecords;
+}
+
+/*
+ * Get number of skipped invalid records in last conversion.
+ */
+unsigned int
+MarcConverter::getNumBadRecords(void)
+{
+	return m_numBadRecords;
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcConverter::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+/*
+ * Write header of output format.
+ */
+bool
+MarcConverter::writeHeader(void)
+{
+	bool status = true;
+	switch (m_outputFormat) {
+	case FORMAT_MARCXML:
+		status = ((MarcXmlWriter *) m_writer)->writeHeader();
+		break;
+	case FORMAT_UNIMARCXML:
+		status = ((UnimarcXmlWriter *) m_writer)->writeHeader();
+		break;
+	case FORMAT_JSON:
+	case FORMAT_JSONL:
+		status = ((MarcJsonWriter *) m_writer)->writeHeader();
+		break;
+	default:
+		break;
+	}
+	if (!status) {
+		m_errorMessage = m_writer->getErrorMessage();
+	}
+
+	return status;
+}
+
+/*
+ * Write footer of output format.
+ */
+bool
+MarcConverter::writeFooter(void)
+{
+	bool status = true;
+	switch (m_outputFormat) {
+	case FORMAT_MARCXML:
+		status = ((MarcXmlWriter *) m_writer)->writeFooter();
+		break;
+	case FORMAT_UNIMARCXML:
+		status = ((UnimarcXmlWriter *) m_writer)->writeFooter();
+		break;
+	case FORMAT_JSON:
+	case FORMAT_JSONL:
+		status = ((MarcJsonWriter *) m_writer)->writeFooter();
+		break;
+	default:
+		break;
+	}
+	if (!status) {
+		m_errorMessage = m_writer->getErrorMessage();
+	}
+
+	return status;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_CONVERTER_H
+#define MARCRECORD_MARC_CONVERTER_H
+
+#include <string>
+#include "marc_reader.h"
+#include "marc_writer.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * Converter of MARC records in memory buffers or streams (reader and
+ * writer are kept open between conversions, so iconv descriptors and XML
+ * parser are reused).
+ */
+class MarcConverter {
+public:
+	// Formats of records.
+	enum RecordFormat {
+		FORMAT_NULL = 0,
+		FORMAT_ISO2709,
+		FORMAT_MARCXML,
+		FORMAT_UNIMARCXML,
+		FORMAT_TEXT,
+		FORMAT_JSON,
+		FORMAT_JSONL
+	};
+
+protected:
+	// Format of input records.
+	RecordFormat m_inputFormat;
+	// Format of output records.
+	RecordFormat m_outputFormat;
+	// Records reader.
+	MarcReader *m_reader;
+	// Records writer.
+	MarcWriter *m_writer;
+	// Input source for input data.
+	MarcMemoryInput m_input;
+	// Output sink for output data.
+	MarcMemoryOutput m_output;
+	// Output data.
+	std::string m_outputData;
+	// Converted record.
+	MarcRecord m_record;
+	// Permissive mode flag.
+	bool m_permissiveMode;
+	// Number of records in last conversion.
+	unsigned int m_numRecords;
+	// Number of skipped invalid records in last conversion.
+	unsigned int m_numBadRecords;
+	// Message of last error.
+	std::string m_errorMessage;
+
+	// Write header of output format.
+	bool writeHeader(void);
+	// Write footer of output format.
+	bool writeFooter(void);
+
+public:
+	// Constructor.
+	MarcConverter();
+	// Destructor.
+	~MarcConverter();
+
+	// Convert format name to format code.
+	static RecordFormat parseFormat(const char *formatName);
+
+	// Open reader and writer for formats and encodings (NULL or empty
+	// encoding is UTF-8).
+	bool open(const char *inputFormat, const char *outputFormat,
+		const char *inputEncoding, const char *outputEncoding);
+	// Close reader and writer.
+	void close(void);
+	// Set permissive mode (errors of reader are corrected, invalid
+	// records and records which can't be written are skipped).
+	void setPermissiveMode(bool permissiveMode = true);
+	// Convert records from input data to output data (header and footer
+	// of output format are omitted for parts of output except first and
+	// last).
+	bool convert(const char *data, size_t dataLen,
+		std::string &outputData, bool withHeader = true,
+		bool withFooter = true);
+	// Convert records from input source to output sink (output is
+	// flushed after conversion).
+	bool convert(MarcInput *input, MarcOutput *output,
+		bool withHeader = true, bool withFooter = true);
+
+	// Get number of records in last conversion.
+	unsigned int getNumRecords(void);
+	// Get number of skipped invalid records in last conversion.
+	unsigned int getNumBadRecords(void);
+	// Get last error message.
+	std::string & getErrorMessage(void);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_CONVERTER_H
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include "marc_codec_cache.h"
+#include "marc_encoder.h"
+
+#define ENCODER_PAGE_SIZE	256
+#define ENCODER_RESET_SIZE	16
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcEncoder::MarcEncoder()
+{
+	// Clear member variables.
+	m_iconvDesc = (iconv_t) -1;
+	close();
+}
+
+/*
+ * Destructor.
+ */
+MarcEncoder::~MarcEncoder()
+{
+	// Finalize encoder.
+	close();
+}
+
+/*
+ * Initialize encoder for output encoding.
+ */
+bool
+MarcEncoder::open(const char *encoding)
+{
+	// Finalize previous encoder.
+	close();
+
+	// UTF-8 data is written without encoding conversion.
+	if (encoding == NULL
+		|| strcmp(encoding, "UTF-8") == 0
+		|| strcmp(encoding, "utf-8") == 0)
+	{
+		return true;
+	}
+
+	// Create iconv descriptor for output encoding conversion.
+	m_encoding = encoding;
+	m_iconvDesc = acquire_iconv(encoding, "UTF-8");
+	if (m_iconvDesc == (iconv_t) -1) {
+		return false;
+	}
+
+	// Use encoding table compiled by previous encoder.
+	const MarcEncodingTable *encodingTable =
+		find_encoding_table(m_encoding);
+	if (encodingTable == NULL) {
+		MarcEncodingTable newTable;
+		newTable.singleByte = buildEncodingTable(encoding);
+		newTable.asciiCompatible = newTable.singleByte
+			|| checkAsciiCompatibility();
+		std::copy(m_pageIndex, m_pageIndex + 256, newTable.pageIndex);
+		newTable.table.swap(m_encodingTable);
+		encodingTable = add_encoding_table(m_encoding, newTable);
+	}
+
+	if (encodingTable->singleByte) {
+		// Single-byte encoding is converted by table.
+		release_iconv(m_iconvDesc, m_encoding.c_str(), "UTF-8");
+		m_iconvDesc = (iconv_t) -1;
+		m_mode = MODE_TABLE;
+		std::copy(encodingTable->pageIndex,
+			encodingTable->pageIndex + 256, m_pageIndex);
+		m_encodingTable = encodingTable->table;
+	} else {
+		// Other encodings are converted by iconv.
+		m_mode = MODE_ICONV;
+	}
+	m_asciiCompatible = encodingTable->asciiCompatible;
+
+	return true;
+}
+
+/*
+ * Finalize encoder.
+ */
+void
+MarcEncoder::close(void)
+{
+	// Return iconv descriptor to cache.
+	release_iconv(m_iconvDesc, m_encoding.c_str(), "UTF-8");
+
+	// Clear member variables.
+	m_mode = MODE_NONE;
+	m_encoding.clear();
+	m_iconvDesc = (iconv_t) -1;
+	m_asciiCompatible = true;
+	std::fill(m_pageIndex, m_pageIndex + 256, -1);
+	m_encodingTable.clear();
+}
+
+/*
+ * Reset conversion state for new output.
+ */
+bool
+MarcEncoder::reset(void)
+{
+	if (m_mode != MODE_ICONV) {
+		return true;
+	}
+
+	// Byte order mark is written only by new iconv descriptor.
+	if (!is_iconv_reusable(m_encoding.c_str())) {
+		iconv_close(m_iconvDesc);
+		m_iconvDesc = iconv_open(m_encoding.c_str(), "UTF-8");
+		if (m_iconvDesc == (iconv_t) -1) {
+			m_mode = MODE_NONE;
+			return false;
+		}
+		return true;
+	}
+
+	::iconv(m_iconvDesc, NULL, NULL, NULL, NULL);
+	return true;
+}
+
+/*
+ * Build encoding table for single-byte encoding.
+ */
+bool
+MarcEncoder::buildEncodingTable(const char *encoding)
+{
+	// Encodings with conversion options (//TRANSLIT etc.) need iconv.
+	if (strstr(encoding, "//") != NULL) {
+		return false;
+	}
+
+	// Create iconv descriptor for reverse conversion.
+	iconv_t decodeDesc = acquire_iconv("UTF-8", encoding);
+	if (decodeDesc == (iconv_t) -1) {
+		return false;
+	}
+
+	// Decode every byte value separately.
+	bool singleByte = true;
+	for (unsigned int byte = 0; singleByte && byte < 256; byte++) {
+		char srcBuf[1] = { (char) byte }, destBuf[8];
+#ifndef ICONV_CONST_CHAR
+		char *src = srcBuf;
+#else
+		const char *src = srcBuf;
+#endif
+		char *dest = destBuf;
+		size_t srcLen = 1, destLen = sizeof(destBuf);
+
+		::iconv(decodeDesc, NULL, NULL, NULL, NULL);
+		if (::iconv(decodeDesc, &src, &srcLen, &dest, &destLen)
+			== (size_t) -1)
+		{
+			// Bytes not defined in encoding are skipped.
+			singleByte = errno == EILSEQ && byte >= 0x80;
+			continue;
+		}
+
+		// Decode character code from UTF-8.
+		const unsigned char *utf8 = (const unsigned char *) destBuf;
+		size_t utf8Len = sizeof(destBuf) - destLen;
+		unsigned int code;
+		if (utf8Len == 1) {
+			code = utf8[0];
+		} else if (utf8Len == 2 && utf8[0] >= 0xC0) {
+			code = ((utf8[0] & 0x1F) << 6) | (utf8[1] & 0x3F);
+		} else if (utf8Len == 3 && utf8[0] >= 0xE0) {
+			code = ((utf8[0] & 0x0F) << 12)
+				| ((utf8[1] & 0x3F) << 6) | (utf8[2] & 0x3F);
+		} else {
+			// Byte is decoded to several characters or to nothing.
+			singleByte = false;
+			break;
+		}
+
+		// ASCII characters must not be changed.
+		if (byte < 0x80 && code != byte) {
+			singleByte = false;
+			break;
+		}
+
+		// Add character to encoding table (first byte wins).
+		int &page = m_pageIndex[code / ENCODER_PAGE_SIZE];
+		if (page < 0) {
+			page = (int) (m_encodingTable.size() / ENCODER_PAGE_SIZE);
+			m_encodingTable.resize(m_encodingTable.size()
+				+ ENCODER_PAGE_SIZE, -1);
+		}
+		short &entry = m_encodingTable[page * ENCODER_PAGE_SIZE
+			+ code % ENCODER_PAGE_SIZE];
+		if (entry < 0) {
+			entry = (short) byte;
+		}
+	}
+
+	release_iconv(decodeDesc, "UTF-8", encoding);
+
+	if (!singleByte) {
+		std::fill(m_pageIndex, m_pageIndex + 256, -1);
+		m_encodingTable.clear();
+	}
+
+	return singleByte;
+}
+
+/*
+ * Check if ASCII characters are not changed by iconv.
+ */
+bool
+MarcEncoder::checkAsciiCompatibility(void)
+{
+	char srcBuf[128], destBuf[1024];
+	size_t asciiLen = 0;
+
+	// Printable ASCII characters and line breaks.
+	srcBuf[asciiLen++] = '\t';
+	srcBuf[asciiLen++] = '\n';
+	srcBuf[asciiLen++] = '\r';
+	for (char c = ' '; c <= '~'; c++) {
+		srcBuf[asciiLen++] = c;
+	}
+
+#ifndef ICONV_CONST_CHAR
+	char *src = srcBuf;
+#else
+	const char *src = srcBuf;
+#endif
+	char *dest = destBuf;
+	size_t srcLen = asciiLen, destLen = sizeof(destBuf);
+	bool compatible = ::iconv(m_iconvDesc, &src, &srcLen, &dest, &destLen)
+		!= (size_t) -1
+		&& ::iconv(m_iconvDesc, NULL, NULL, &dest, &destLen)
+		!= (size_t) -1
+		&& sizeof(destBuf) - destLen == asciiLen
+		&& memcmp(srcBuf, destBuf, asciiLen) == 0;
+
+	// Reset conversion state.
+	::iconv(m_iconvDesc, NULL, NULL, NULL, NULL);
+
+	return compatible;
+}
+
+/*
+ * Encode UTF-8 data (stops when destination buffer is full).
+ */
+bool
+MarcEncoder::encode(const char *&src, size_t &srcLen,
+	char *&dest, size_t &destLen)
+{
+	if (m_mode == MODE_NONE) {
+		// Copy data without conversion.
+		size_t copyLen = std::min(srcLen, destLen);
+		memcpy(dest, src, copyLen);
+		src += copyLen;
+		srcLen -= copyLen;
+		dest += copyLen;
+		destLen -= copyLen;
+	} else if (m_mode == MODE_TABLE) {
+		// Convert characters by encoding table.
+		while (srcLen > 0 && destLen > 0) {
+			const unsigned char *s = (const unsigned char *) src;
+			unsigned int code;
+			size_t charLen;
+
+			if (s[0] < 0x80) {
+				// Copy ASCII character.
+				*(dest++) = (char) s[0];
+				destLen--;
+				src++;
+				srcLen--;
+				continue;
+			} else if (s[0] >= 0xC2 && s[0] < 0xE0 && srcLen >= 2
+				&& (s[1] & 0xC0) == 0x80)
+			{
+				code = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+				charLen = 2;
+			} else if (s[0] >= 0xE0 && s[0] < 0xF0 && srcLen >= 3
+				&& (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80)
+			{
+				code = ((s[0] & 0x0F) << 12)
+					| ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+				charLen = 3;
+			} else {
+				// Invalid UTF-8 sequence or character beyond BMP.
+				errno = EILSEQ;
+				return false;
+			}
+
+			// Find character in encoding table.
+			int page = m_pageIndex[code / ENCODER_PAGE_SIZE];
+			short entry = page < 0 ? -1 : m_encodingTable[
+				page * ENCODER_PAGE_SIZE + code % ENCODER_PAGE_SIZE];
+			if (entry < 0) {
+				errno = EILSEQ;
+				return false;
+			}
+
+			*(dest++) = (char) entry;
+			destLen--;
+			src += charLen;
+			srcLen -= charLen;
+		}
+	} else {
+		// Convert characters by iconv.
+#ifndef ICONV_CONST_CHAR
+		char *p = (char *) src;
+#else
+		const char *p = src;
+#endif
+		// Space for shift sequence returning to initial state.
+		size_t resetLen = m_asciiCompatible ? ENCODER_RESET_SIZE : 0;
+		if (destLen <= resetLen) {
+			return true;
+		}
+
+		size_t convertLen = destLen - resetLen;
+		size_t result = ::iconv(m_iconvDesc, &p, &srcLen,
+			&dest, &convertLen);
+		src = p;
+		destLen = convertLen + resetLen;
+		if (result == (size_t) -1) {
+			return errno == E2BIG;
+		}
+
+		// Return to initial state at the end of data (ASCII markup
+		// is written without conversion after it).
+		if (m_asciiCompatible && ::iconv(m_iconvDesc, NULL, NULL,
+			&dest, &destLen) == (size_t) -1)
+		{
+			return errno == E2BIG;
+		}
+	}
+
+	return true;
+}
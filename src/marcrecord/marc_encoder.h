@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_ENCODER_H
+#define MARCRECORD_MARC_ENCODER_H
+
+#include <iconv.h>
+#include <string>
+#include <vector>
+
+namespace marcrecord {
+
+/*
+ * Encoder of UTF-8 data to output encoding.
+ */
+class MarcEncoder {
+public:
+	// Encoding modes.
+	enum EncodingMode {
+		MODE_NONE = 0,
+		MODE_TABLE = 1,
+		MODE_ICONV = 2
+	};
+
+protected:
+	// Encoding mode.
+	EncodingMode m_mode;
+	// Output encoding.
+	std::string m_encoding;
+	// Iconv descriptor for output encoding.
+	iconv_t m_iconvDesc;
+	// ASCII characters are not changed by encoding.
+	bool m_asciiCompatible;
+	// Index of pages in encoding table (-1 if page is not mapped).
+	int m_pageIndex[256];
+	// Encoding table (pages of 256 characters, -1 if not mapped).
+	std::vector<short> m_encodingTable;
+
+	// Build encoding table for single-byte encoding.
+	bool buildEncodingTable(const char *encoding);
+	// Check if ASCII characters are not changed by iconv.
+	bool checkAsciiCompatibility(void);
+
+public:
+	// Constructor.
+	MarcEncoder();
+	// Destructor.
+	~MarcEncoder();
+
+	// Initialize encoder for output encoding.
+	bool open(const char *encoding);
+	// Finalize encoder.
+	void close(void);
+	// Reset conversion state for new output.
+	bool reset(void);
+
+	// Get encoding mode.
+	inline EncodingMode getMode(void)
+	{
+		return m_mode;
+	}
+
+	// Check if ASCII characters are not changed by encoding.
+	inline bool isAsciiCompatible(void)
+	{
+		return m_asciiCompatible;
+	}
+
+	// Get upper bound of size of encoded UTF-8 data (characters of
+	// single-byte encodings are not longer than in UTF-8, iconv may
+	// encode each byte to 4 bytes).
+	inline size_t getEncodedSizeBound(size_t dataLen)
+	{
+		return m_mode == MODE_ICONV ? 4 * dataLen : dataLen;
+	}
+
+	// Encode UTF-8 data (stops when destination buffer is full).
+	bool encode(const char *&src, size_t &srcLen,
+		char *&dest, size_t &destLen);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_ENCODER_H
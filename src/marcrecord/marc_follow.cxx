@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <csignal>
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+#include "marc_follow.h"
+
+namespace marcrecord {
+
+// Stop of following requested flag.
+static volatile sig_atomic_t followStopped = 0;
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcFollowInput::MarcFollowInput()
+{
+	m_inputFile = NULL;
+	m_flushWriter = NULL;
+	m_pollInterval = MARC_FOLLOW_POLL_INTERVAL;
+	m_inotifyFd = -1;
+	m_dataRead = false;
+}
+
+/*
+ * Destructor.
+ */
+MarcFollowInput::~MarcFollowInput()
+{
+	close();
+}
+
+/*
+ * Open input file (name is used to watch file changes).
+ */
+void
+MarcFollowInput::open(FILE *inputFile, const char *inputFileName,
+	int pollInterval)
+{
+	close();
+
+	m_inputFile = inputFile;
+	m_pollInterval = pollInterval > 0
+		? pollInterval : MARC_FOLLOW_POLL_INTERVAL;
+	m_dataRead = false;
+	followStopped = 0;
+
+#ifdef __linux__
+	// Watch modifications of input file (polling is used if inotify
+	// is not available).
+	m_inotifyFd = inotify_init();
+	if (m_inotifyFd >= 0 && inotify_add_watch(m_inotifyFd, inputFileName,
+		IN_MODIFY | IN_CLOSE_WRITE) < 0)
+	{
+		::close(m_inotifyFd);
+		m_inotifyFd = -1;
+	}
+#else
+	(void) (inputFileName);
+#endif
+}
+
+/*
+ * Set writer flushed before waiting for data (NULL if not used).
+ */
+void
+MarcFollowInput::setFlushWriter(MarcWriter *flushWriter)
+{
+	m_flushWriter = flushWriter;
+}
+
+/*
+ * Stop watching input file.
+ */
+void
+MarcFollowInput::close(void)
+{
+#ifdef __linux__
+	if (m_inotifyFd >= 0) {
+		::close(m_inotifyFd);
+	}
+#endif
+
+	m_inputFile = NULL;
+	m_flushWriter = NULL;
+	m_inotifyFd = -1;
+	m_dataRead = false;
+}
+
+/*
+ * Read data from input (available data is returned, at end of file
+ * reading waits for more data until stop is requested).
+ */
+size_t
+MarcFollowInput::read(char *buf, size_t bufLen)
+{
+	for (;;) {
+		size_t readLen = fread(buf, 1, bufLen, m_inputFile);
+		if (readLen > 0) {
+			m_dataRead = true;
+			return readLen;
+		}
+		if (ferror(m_inputFile) || followStopped) {
+			return 0;
+		}
+
+		// Flush converted records before waiting for more data.
+		if (m_dataRead && m_flushWriter != NULL) {
+			m_flushWriter->flush();
+			m_dataRead = false;
+		}
+
+		// Wait for appended data and clear end of file flag.
+		waitData();
+		clearerr(m_inputFile);
+	}
+}
+
+/*
+ * Set position in input (false if input is not seekable).
+ */
+bool
+MarcFollowInput::seek(unsigned long long inputPos)
+{
+#ifdef _WIN32
+	return _fseeki64(m_inputFile, (long long) inputPos, SEEK_SET) == 0;
+#else
+	return fseeko(m_inputFile, (off_t) inputPos, SEEK_SET) == 0;
+#endif
+}
+
+/*
+ * Wait for data appended to input file (or for stop request).
+ */
+void
+MarcFollowInput::waitData(void)
+{
+	if (followStopped) {
+		return;
+	}
+
+#ifdef _WIN32
+	Sleep(m_pollInterval);
+#else
+	if (m_inotifyFd < 0) {
+		// Poll input file.
+		usleep(m_pollInterval * 1000);
+		return;
+	}
+
+	// Wait for modification events (with timeout for stop request).
+	struct pollfd pollFd;
+	pollFd.fd = m_inotifyFd;
+	pollFd.events = POLLIN;
+	pollFd.revents = 0;
+	if (poll(&pollFd, 1, m_pollInterval) > 0) {
+		char eventBuf[4096];
+		if (::read(m_inotifyFd, eventBuf, sizeof(eventBuf)) < 0
+			&& errno != EINTR)
+		{
+			usleep(m_pollInterval * 1000);
+		}
+	}
+#endif
+}
+
+/*
+ * Request stop of following (end of input is returned, may be called
+ * from signal handler).
+ */
+void
+MarcFollowInput::stop(void)
+{
+	followStopped = 1;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_FOLLOW_H
+#define MARCRECORD_MARC_FOLLOW_H
+
+#include <cstdio>
+#include "marc_reader.h"
+#include "marc_writer.h"
+
+// Default interval of checking input file for appended data (ms).
+#define MARC_FOLLOW_POLL_INTERVAL	1000
+
+namespace marcrecord {
+
+/*
+ * Input source following continuously appended file (at end of file
+ * reading waits for more data, inotify is used on Linux and polling
+ * elsewhere). Available data is returned without waiting for full
+ * buffer, so reader must accept short reads (ISO 2709 reader does).
+ */
+class MarcFollowInput : public MarcInput {
+protected:
+	// Input file.
+	FILE *m_inputFile;
+	// Writer flushed before waiting for data (NULL if not used).
+	MarcWriter *m_flushWriter;
+	// Interval of checking input file for appended data (ms).
+	int m_pollInterval;
+	// Inotify descriptor (-1 if not used).
+	int m_inotifyFd;
+	// Data was read since writer flush flag.
+	bool m_dataRead;
+
+	// Wait for data appended to input file (or for stop request).
+	void waitData(void);
+
+public:
+	// Constructor.
+	MarcFollowInput();
+	// Destructor.
+	~MarcFollowInput();
+
+	// Open input file (name is used to watch file changes).
+	void open(FILE *inputFile, const char *inputFileName,
+		int pollInterval = MARC_FOLLOW_POLL_INTERVAL);
+	// Set writer flushed before waiting for data (NULL if not used).
+	void setFlushWriter(MarcWriter *flushWriter);
+	// Stop watching input file.
+	void close(void);
+	// Read data from input (available data is returned, at end of file
+	// reading waits for more data until stop is requested).
+	size_t read(char *buf, size_t bufLen);
+	// Set position in input (false if input is not seekable).
+	bool seek(unsigned long long inputPos);
+
+	// Request stop of following (end of input is returned, may be
+	// called from signal handler).
+	static void stop(void);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_FOLLOW_H
@@ -29,12 +29,213 @@
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
 #include "marc_reader.h"
 
 using namespace marcrecord;
 
+/*
+ * Destructor.
+ */
+MarcInput::~MarcInput()
+{
+}
+
+/*
+ * Set position in input (false if input is not seekable).
+ */
+bool
+MarcInput::seek(unsigned long long inputPos)
+{
+	(void) (inputPos);
+	return false;
+}
+
+/*
+ * Constructor.
+ */
+MarcFileInput::MarcFileInput(FILE *inputFile)
+{
+	m_inputFile = inputFile;
+}
+
+/*
+ * Open input file.
+ */
+void
+MarcFileInput::open(FILE *inputFile)
+{
+	m_inputFile = inputFile;
+}
+
+/*
+ * Read data from input (less data is returned only at end of input).
+ */
+size_t
+MarcFileInput::read(char *buf, size_t bufLen)
+{
+	return fread(buf, 1, bufLen, m_inputFile);
+}
+
+/*
+ * Set position in input (false if input is not seekable).
+ */
+bool
+MarcFileInput::seek(unsigned long long inputPos)
+{
+#ifdef _WIN32
+	return _fseeki64(m_inputFile, (long long) inputPos, SEEK_SET) == 0;
+#else
+	return fseeko(m_inputFile, (off_t) inputPos, SEEK_SET) == 0;
+#endif
+}
+
+/*
+ * Constructor.
+ */
+MarcMemoryInput::MarcMemoryInput(const char *data, size_t dataLen)
+{
+	open(data, dataLen);
+}
+
+/*
+ * Open memory buffer (data must be valid until reading is finished).
+ */
+void
+MarcMemoryInput::open(const char *data, size_t dataLen)
+{
+	m_data = data;
+	m_dataLen = dataLen;
+	m_dataPos = 0;
+}
+
+/*
+ * Read data from input (less data is returned only at end of input).
+ */
+size_t
+MarcMemoryInput::read(char *buf, size_t bufLen)
+{
+	size_t readLen = std::min(bufLen, m_dataLen - m_dataPos);
+	memcpy(buf, m_data + m_dataPos, readLen);
+	m_dataPos += readLen;
+	return readLen;
+}
+
+/*
+ * Set position in input (false if input is not seekable).
+ */
+bool
+MarcMemoryInput::seek(unsigned long long inputPos)
+{
+	if (inputPos > m_dataLen) {
+		return false;
+	}
+
+	m_dataPos = (size_t) inputPos;
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcRangeInput::MarcRangeInput()
+{
+	m_input = NULL;
+	m_startPos = 0;
+	m_endPos = 0;
+	m_inputPos = 0;
+}
+
+/*
+ * Open range of input source (false if input is not seekable).
+ */
+bool
+MarcRangeInput::open(MarcInput *input, unsigned long long startPos,
+	unsigned long long endPos)
+{
+	m_input = input;
+	m_startPos = startPos;
+	m_endPos = endPos;
+	m_inputPos = startPos;
+	return m_input->seek(startPos);
+}
+
+/*
+ * Read data from input (less data is returned only at end of input).
+ */
+size_t
+MarcRangeInput::read(char *buf, size_t bufLen)
+{
+	if (m_inputPos >= m_endPos) {
+		return 0;
+	}
+
+	size_t readLen = m_input->read(buf,
+		(size_t) std::min((unsigned long long) bufLen,
+		m_endPos - m_inputPos));
+	m_inputPos += readLen;
+	return readLen;
+}
+
+/*
+ * Set position in input (false if input is not seekable).
+ */
+bool
+MarcRangeInput::seek(unsigned long long inputPos)
+{
+	if (inputPos > m_endPos - m_startPos
+		|| !m_input->seek(m_startPos + inputPos))
+	{
+		return false;
+	}
+
+	m_inputPos = m_startPos + inputPos;
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcStatsInput::MarcStatsInput()
+{
+	m_input = NULL;
+	m_stats = NULL;
+}
+
+/*
+ * Open input source.
+ */
+void
+MarcStatsInput::open(MarcInput *input, MarcStats *stats)
+{
+	m_input = input;
+	m_stats = stats;
+}
+
+/*
+ * Read data from input (less data is returned only at end of input).
+ */
+size_t
+MarcStatsInput::read(char *buf, size_t bufLen)
+{
+	unsigned long long startTime = get_time_ns();
+	size_t readLen = m_input->read(buf, bufLen);
+	m_stats->readTime += get_time_ns() - startTime;
+	m_stats->inputBytes += readLen;
+	return readLen;
+}
+
+/*
+ * Set position in input (false if input is not seekable).
+ */
+bool
+MarcStatsInput::seek(unsigned long long inputPos)
+{
+	return m_input->seek(inputPos);
+}
+
 /*
  * Constructor.
  */
@@ -42,7 +243,17 @@ MarcReader::MarcReader()
 {
 	// Clear member variables.
 	m_errorCode = OK;
+	m_inputFile = NULL;
+	m_input = NULL;
 	m_autoCorrectionMode = false;
+	m_stats = NULL;
+}
+
+/*
+ * Destructor.
+ */
+MarcReader::~MarcReader()
+{
 }
 
 /*
@@ -80,3 +291,62 @@ MarcReader::setAutoCorrectionMode(bool autoCorrectionMode)
 {
 	m_autoCorrectionMode = autoCorrectionMode;
 }
+
+/*
+ * Set statistics of reading (NULL to disable).
+ */
+void
+MarcReader::setStats(MarcStats *stats)
+{
+	m_stats = stats;
+}
+
+/*
+ * Reset state of reading to start new input from input source
+ * (iconv descriptors and parsers are reused, false if reset is not
+ * supported by reader).
+ */
+bool
+MarcReader::reset(void)
+{
+	return false;
+}
+
+/*
+ * Set input source (replaces input file, must be set before reading).
+ */
+void
+MarcReader::setInput(MarcInput *input)
+{
+	m_input = input == NULL ? &m_fileInput : input;
+}
+
+/*
+ * Initialize input from file.
+ */
+void
+MarcReader::openInput(FILE *inputFile)
+{
+	m_fileInput.open(inputFile);
+	m_input = &m_fileInput;
+}
+
+/*
+ * Convert data to internal encoding (time is sampled for statistics).
+ */
+bool
+MarcReader::decodeData(iconv_t iconvDesc, const char *data, size_t dataLen,
+	std::string &dest)
+{
+	if (m_stats == NULL
+		|| m_stats->numDecodes++ % MARC_STATS_SAMPLE_INTERVAL != 0)
+	{
+		return iconv(iconvDesc, data, dataLen, dest);
+	}
+
+	unsigned long long startTime = get_time_ns();
+	bool result = iconv(iconvDesc, data, dataLen, dest);
+	m_stats->decodeTime += get_elapsed_ns(startTime)
+		* MARC_STATS_SAMPLE_INTERVAL;
+	return result;
+}
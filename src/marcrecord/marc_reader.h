@@ -29,11 +29,121 @@
 #ifndef MARCRECORD_MARC_READER_H
 #define MARCRECORD_MARC_READER_H
 
+#include <cstdio>
+#include <iconv.h>
 #include <string>
+#include "marc_stats.h"
 #include "marcrecord.h"
 
 namespace marcrecord {
 
+/*
+ * Input source for MARC records readers.
+ */
+class MarcInput {
+public:
+	// Destructor.
+	virtual ~MarcInput();
+
+	// Read data from input (less data is returned only at end of input).
+	virtual size_t read(char *buf, size_t bufLen) = 0;
+	// Set position in input (false if input is not seekable).
+	virtual bool seek(unsigned long long inputPos);
+};
+
+/*
+ * Input source for stdio file.
+ */
+class MarcFileInput : public MarcInput {
+protected:
+	// Input file.
+	FILE *m_inputFile;
+
+public:
+	// Constructor.
+	MarcFileInput(FILE *inputFile = NULL);
+
+	// Open input file.
+	void open(FILE *inputFile);
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen);
+	// Set position in input (false if input is not seekable).
+	bool seek(unsigned long long inputPos);
+};
+
+/*
+ * Input source reading data from memory buffer.
+ */
+class MarcMemoryInput : public MarcInput {
+protected:
+	// Input data.
+	const char *m_data;
+	// Length of input data.
+	size_t m_dataLen;
+	// Position of unread data.
+	size_t m_dataPos;
+
+public:
+	// Constructor.
+	MarcMemoryInput(const char *data = NULL, size_t dataLen = 0);
+
+	// Open memory buffer (data must be valid until reading is finished).
+	void open(const char *data, size_t dataLen);
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen);
+	// Set position in input (false if input is not seekable).
+	bool seek(unsigned long long inputPos);
+};
+
+/*
+ * Input source reading range of other input source.
+ */
+class MarcRangeInput : public MarcInput {
+protected:
+	// Input source.
+	MarcInput *m_input;
+	// Start and end positions of range in input source.
+	unsigned long long m_startPos;
+	unsigned long long m_endPos;
+	// Position of unread data in input source.
+	unsigned long long m_inputPos;
+
+public:
+	// Constructor.
+	MarcRangeInput();
+
+	// Open range of input source (false if input is not seekable).
+	bool open(MarcInput *input, unsigned long long startPos,
+		unsigned long long endPos);
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen);
+	// Set position in input (false if input is not seekable).
+	bool seek(unsigned long long inputPos);
+};
+
+/*
+ * Input source which counts bytes and time of reading from other input
+ * source.
+ */
+class MarcStatsInput : public MarcInput {
+protected:
+	// Input source.
+	MarcInput *m_input;
+	// Statistics of reading.
+	MarcStats *m_stats;
+
+public:
+	// Constructor.
+	MarcStatsInput();
+
+	// Open input source.
+	void open(MarcInput *input, MarcStats *stats);
+	// Read data from input (less data is returned only at end of input).
+	size_t read(char *buf, size_t bufLen);
+	// Set position in input (false if input is not seekable).
+	bool seek(unsigned long long inputPos);
+};
+
 /*
  * MARC records reader.
  */
@@ -58,13 +168,28 @@ protected:
 	FILE *m_inputFile;
 	// Encoding of input file.
 	std::string m_inputEncoding;
+	// Input source.
+	MarcInput *m_input;
+	// Input source for input file.
+	MarcFileInput m_fileInput;
 
 	// Automatic error correction mode.
 	bool m_autoCorrectionMode;
 
+	// Statistics of reading (NULL if not collected).
+	MarcStats *m_stats;
+
+	// Initialize input from file.
+	void openInput(FILE *inputFile);
+	// Convert data to internal encoding (time is sampled for statistics).
+	bool decodeData(iconv_t iconvDesc, const char *data, size_t dataLen,
+		std::string &dest);
+
 public:
 	// Constructor.
 	MarcReader();
+	// Destructor.
+	virtual ~MarcReader();
 
 	// Get last error code.
 	ErrorCode getErrorCode(void);
@@ -74,9 +199,20 @@ public:
 	// Return input file handle.
 	FILE *getInputFile();
 
+	// Set input source (replaces input file, must be set before reading).
+	void setInput(MarcInput *input);
+
 	// Set automatic error correction mode.
 	void setAutoCorrectionMode(bool autoCorrectionMode = true);
 
+	// Set statistics of reading (NULL to disable).
+	void setStats(MarcStats *stats);
+
+	// Reset state of reading to start new input from input source
+	// (iconv descriptors and parsers are reused, false if reset is not
+	// supported by reader).
+	virtual bool reset(void);
+
 	// Open input file.
 	virtual bool open(FILE *inputFile, const char *inputEncoding) = 0;
 	// Close input file.
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "marc_socket.h"
+
+namespace marcrecord {
+
+/*
+ * Read exactly specified length of data from socket.
+ */
+static bool
+readFull(int socketFd, char *buf, size_t bufLen)
+{
+	while (bufLen > 0) {
+		ssize_t readLen = ::read(socketFd, buf, bufLen);
+		if (readLen < 0 && errno == EINTR) {
+			continue;
+		}
+		if (readLen <= 0) {
+			return false;
+		}
+		buf += readLen;
+		bufLen -= readLen;
+	}
+
+	return true;
+}
+
+/*
+ * Read frame from socket (false at end of connection or on error).
+ */
+bool
+read_frame(int socketFd, std::string &payload)
+{
+	// Read length of payload.
+	unsigned char lengthBuf[4];
+	if (!readFull(socketFd, (char *) lengthBuf, sizeof(lengthBuf))) {
+		return false;
+	}
+	size_t payloadLen = ((size_t) lengthBuf[0] << 24)
+		| ((size_t) lengthBuf[1] << 16)
+		| ((size_t) lengthBuf[2] << 8) | (size_t) lengthBuf[3];
+	if (payloadLen > MARC_SOCKET_MAX_FRAME) {
+		return false;
+	}
+
+	// Read payload.
+	payload.resize(payloadLen);
+	return payloadLen == 0
+		|| readFull(socketFd, &payload[0], payloadLen);
+}
+
+/*
+ * Write frame with payload consisting of header and data to socket.
+ */
+bool
+write_frame(int socketFd, const char *header, size_t headerLen,
+	const char *data, size_t dataLen)
+{
+	size_t payloadLen = headerLen + dataLen;
+	if (payloadLen > MARC_SOCKET_MAX_FRAME) {
+		return false;
+	}
+
+	// Write length, header and data with gathered writes.
+	unsigned char lengthBuf[4];
+	lengthBuf[0] = (unsigned char) (payloadLen >> 24);
+	lengthBuf[1] = (unsigned char) (payloadLen >> 16);
+	lengthBuf[2] = (unsigned char) (payloadLen >> 8);
+	lengthBuf[3] = (unsigned char) payloadLen;
+	struct iovec iov[3];
+	iov[0].iov_base = lengthBuf;
+	iov[0].iov_len = sizeof(lengthBuf);
+	iov[1].iov_base = (void *) header;
+	iov[1].iov_len = headerLen;
+	iov[2].iov_base = (void *) data;
+	iov[2].iov_len = dataLen;
+	struct iovec *iovPtr = iov;
+	int iovCount = 3;
+	while (iovCount > 0) {
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iovPtr;
+		msg.msg_iovlen = iovCount;
+#ifdef MSG_NOSIGNAL
+		ssize_t writtenLen = sendmsg(socketFd, &msg, MSG_NOSIGNAL);
+#else
+		ssize_t writtenLen = sendmsg(socketFd, &msg, 0);
+#endif
+		if (writtenLen < 0 && errno == EINTR) {
+			continue;
+		}
+		if (writtenLen < 0) {
+			return false;
+		}
+
+		// Skip written blocks.
+		size_t skipLen = (size_t) writtenLen;
+		while (iovCount > 0 && skipLen >= iovPtr->iov_len) {
+			skipLen -= iovPtr->iov_len;
+			iovPtr++;
+			iovCount--;
+		}
+		if (iovCount > 0) {
+			iovPtr->iov_base = (char *) iovPtr->iov_base + skipLen;
+			iovPtr->iov_len -= skipLen;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Parse payload of request frame.
+ */
+bool
+parse_request(const std::string &payload, MarcSocketRequest &request)
+{
+	const char *fields[4];
+	size_t pos = 0;
+	for (int i = 0; i < 4; i++) {
+		size_t endPos = payload.find('\0', pos);
+		if (endPos == std::string::npos) {
+			return false;
+		}
+		fields[i] = payload.data() + pos;
+		pos = endPos + 1;
+	}
+
+	request.inputFormat = fields[0];
+	request.outputFormat = fields[1];
+	request.inputEncoding = fields[2];
+	request.outputEncoding = fields[3];
+	request.data = payload.data() + pos;
+	request.dataLen = payload.size() - pos;
+	return true;
+}
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcSocketClient::MarcSocketClient()
+{
+	m_socketFd = -1;
+}
+
+/*
+ * Destructor.
+ */
+MarcSocketClient::~MarcSocketClient()
+{
+	close();
+}
+
+/*
+ * Connect to server listening on local socket.
+ */
+bool
+MarcSocketClient::connect(const char *socketPath)
+{
+	close();
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+		m_errorMessage = "socket path is too long";
+		return false;
+	}
+	strcpy(addr.sun_path, socketPath);
+
+	m_socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_socketFd < 0 || ::connect(m_socketFd,
+		(struct sockaddr *) &addr, sizeof(addr)) != 0)
+	{
+		m_errorMessage = std::string("can't connect to server: ")
+			+ strerror(errno);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Close connection.
+ */
+void
+MarcSocketClient::close(void)
+{
+	if (m_socketFd >= 0) {
+		::close(m_socketFd);
+		m_socketFd = -1;
+	}
+}
+
+/*
+ * Convert records by server (NULL encoding is UTF-8).
+ */
+bool
+MarcSocketClient::convert(const char *inputFormat, const char *outputFormat,
+	const char *inputEncoding, const char *outputEncoding,
+	const char *data, size_t dataLen, std::string &outputData)
+{
+	if (m_socketFd < 0) {
+		m_errorMessage = "client is not connected";
+		return false;
+	}
+
+	// Send request.
+	m_requestHeader.clear();
+	m_requestHeader.append(inputFormat).append(1, '\0');
+	m_requestHeader.append(outputFormat).append(1, '\0');
+	m_requestHeader.append(inputEncoding == NULL ? "" : inputEncoding)
+		.append(1, '\0');
+	m_requestHeader.append(outputEncoding == NULL ? "" : outputEncoding)
+		.append(1, '\0');
+	if (!write_frame(m_socketFd, m_requestHeader.data(),
+		m_requestHeader.size(), data, dataLen))
+	{
+		m_errorMessage = "can't send request";
+		close();
+		return false;
+	}
+
+	// Receive response.
+	if (!read_frame(m_socketFd, m_response) || m_response.empty()) {
+		m_errorMessage = "can't receive response";
+		close();
+		return false;
+	}
+	if (m_response[0] != SOCKET_STATUS_OK) {
+		m_errorMessage = m_response.substr(1);
+		return false;
+	}
+	outputData.assign(m_response, 1, std::string::npos);
+
+	return true;
+}
+
+/*
+ * Get last error message.
+ */
+std::string &
+MarcSocketClient::getErrorMessage(void)
+{
+	return m_errorMessage;
+}
+
+#endif // _WIN32
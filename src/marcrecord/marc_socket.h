@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_SOCKET_H
+#define MARCRECORD_MARC_SOCKET_H
+
+#ifndef _WIN32
+
+#include <string>
+
+// Maximum length of request or response frame.
+#define MARC_SOCKET_MAX_FRAME	(64 * 1048576)
+
+namespace marcrecord {
+
+/*
+ * Frames of conversion protocol are sent over local stream socket, each
+ * frame is 4-byte length (big-endian) followed by payload. Payload of
+ * request is input format, output format, input encoding and output
+ * encoding (each terminated by zero byte, empty encoding is UTF-8)
+ * followed by records data. Payload of response is status byte ('0' for
+ * success, '1' for error) followed by records data or error message.
+ * Requests are answered in order, so connection can be reused.
+ */
+
+// Status codes of response.
+enum MarcSocketStatus {
+	SOCKET_STATUS_OK = '0',
+	SOCKET_STATUS_ERROR = '1'
+};
+
+/*
+ * Parsed conversion request (fields point into request frame).
+ */
+struct MarcSocketRequest {
+	// Format of input records.
+	const char *inputFormat;
+	// Format of output records.
+	const char *outputFormat;
+	// Encoding of input records.
+	const char *inputEncoding;
+	// Encoding of output records.
+	const char *outputEncoding;
+	// Records data.
+	const char *data;
+	// Length of records data.
+	size_t dataLen;
+};
+typedef struct MarcSocketRequest MarcSocketRequest;
+
+// Read frame from socket (false at end of connection or on error).
+bool read_frame(int socketFd, std::string &payload);
+// Write frame with payload consisting of header and data to socket.
+bool write_frame(int socketFd, const char *header, size_t headerLen,
+	const char *data, size_t dataLen);
+// Parse payload of request frame.
+bool parse_request(const std::string &payload, MarcSocketRequest &request);
+
+/*
+ * Client of conversion server.
+ */
+class MarcSocketClient {
+protected:
+	// Socket descriptor (-1 if not connected).
+	int m_socketFd;
+	// Header of request payload.
+	std::string m_requestHeader;
+	// Payload of response.
+	std::string m_response;
+	// Message of last error.
+	std::string m_errorMessage;
+
+public:
+	// Constructor.
+	MarcSocketClient();
+	// Destructor.
+	~MarcSocketClient();
+
+	// Connect to server listening on local socket.
+	bool connect(const char *socketPath);
+	// Close connection.
+	void close(void);
+	// Convert records by server (NULL encoding is UTF-8).
+	bool convert(const char *inputFormat, const char *outputFormat,
+		const char *inputEncoding, const char *outputEncoding,
+		const char *data, size_t dataLen, std::string &outputData);
+
+	// Get last error message.
+	std::string & getErrorMessage(void);
+};
+
+} // namespace marcrecord
+
+#endif // _WIN32
+
+#endif // MARCRECORD_MARC_SOCKET_H
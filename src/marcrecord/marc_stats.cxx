@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "marc_stats.h"
+
+// Number of sub-buckets per power of two in latency histogram.
+#define MARC_STATS_SUBBUCKETS		16
+// Binary logarithm of number of sub-buckets.
+#define MARC_STATS_SUBBUCKET_BITS	4
+// Number of buckets in latency histogram.
+#define MARC_STATS_BUCKETS		(MARC_STATS_SUBBUCKETS \
+	* (64 - MARC_STATS_SUBBUCKET_BITS + 1))
+
+namespace marcrecord {
+
+/*
+ * Get value of monotonic clock in nanoseconds.
+ */
+unsigned long long
+get_time_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+	return (unsigned long long) ((double) counter.QuadPart * 1e9
+		/ (double) frequency.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL
+		+ (unsigned long long) ts.tv_nsec;
+#endif
+}
+
+/*
+ * Get time elapsed since start time in nanoseconds (without overhead of
+ * reading clock, for timing of short operations).
+ */
+unsigned long long
+get_elapsed_ns(unsigned long long startTime)
+{
+	static unsigned long long clockOverhead = (unsigned long long) -1;
+
+	// Measure minimal time between two readings of clock.
+	if (clockOverhead == (unsigned long long) -1) {
+		unsigned long long minTime = (unsigned long long) -1;
+		for (int i = 0; i < 16; i++) {
+			unsigned long long time = get_time_ns();
+			time = get_time_ns() - time;
+			if (time < minTime) {
+				minTime = time;
+			}
+		}
+		clockOverhead = minTime;
+	}
+
+	unsigned long long elapsedTime = get_time_ns() - startTime;
+	return elapsedTime > clockOverhead ? elapsedTime - clockOverhead : 0;
+}
+
+/*
+ * Constructor.
+ */
+MarcStats::MarcStats()
+{
+	clear();
+}
+
+/*
+ * Clear statistics.
+ */
+void
+MarcStats::clear(void)
+{
+	inputBytes = 0;
+	outputBytes = 0;
+	readTime = 0;
+	frameTime = 0;
+	decodeTime = 0;
+	encodeTime = 0;
+	writeTime = 0;
+	numDecodes = 0;
+	numEncodes = 0;
+}
+
+/*
+ * Constructor.
+ */
+MarcLatencyHistogram::MarcLatencyHistogram()
+	: m_buckets(MARC_STATS_BUCKETS, 0)
+{
+	m_count = 0;
+	m_sum = 0;
+	m_max = 0;
+}
+
+/*
+ * Get index of bucket for value.
+ */
+size_t
+MarcLatencyHistogram::getBucket(unsigned long long value)
+{
+	if (value < MARC_STATS_SUBBUCKETS) {
+		return (size_t) value;
+	}
+
+	// Find most significant bit of value.
+	int exponent = 0;
+	for (unsigned long long v = value; v > 1; v >>= 1) {
+		exponent++;
+	}
+
+	// Use next bits of value as index of sub-bucket.
+	int shift = exponent - MARC_STATS_SUBBUCKET_BITS;
+	return (size_t) (shift + 1) * MARC_STATS_SUBBUCKETS
+		+ (size_t) ((value >> shift) & (MARC_STATS_SUBBUCKETS - 1));
+}
+
+/*
+ * Get value in the middle of bucket.
+ */
+unsigned long long
+MarcLatencyHistogram::getBucketValue(size_t bucket)
+{
+	if (bucket < MARC_STATS_SUBBUCKETS) {
+		return bucket;
+	}
+
+	int shift = (int) (bucket / MARC_STATS_SUBBUCKETS) - 1;
+	unsigned long long lowValue = (unsigned long long)
+		(MARC_STATS_SUBBUCKETS + bucket % MARC_STATS_SUBBUCKETS) << shift;
+	return lowValue + ((1ULL << shift) >> 1);
+}
+
+/*
+ * Clear histogram.
+ */
+void
+MarcLatencyHistogram::clear(void)
+{
+	m_buckets.assign(MARC_STATS_BUCKETS, 0);
+	m_count = 0;
+	m_sum = 0;
+	m_max = 0;
+}
+
+/*
+ * Add value to histogram.
+ */
+void
+MarcLatencyHistogram::add(unsigned long long value)
+{
+	m_buckets[getBucket(value)]++;
+	m_count++;
+	m_sum += value;
+	if (value > m_max) {
+		m_max = value;
+	}
+}
+
+/*
+ * Get number of values.
+ */
+unsigned long long
+MarcLatencyHistogram::getCount(void)
+{
+	return m_count;
+}
+
+/*
+ * Get mean value.
+ */
+unsigned long long
+MarcLatencyHistogram::getMean(void)
+{
+	return m_count > 0 ? m_sum / m_count : 0;
+}
+
+/*
+ * Get maximal value.
+ */
+unsigned long long
+MarcLatencyHistogram::getMax(void)
+{
+	return m_max;
+}
+
+/*
+ * Get percentile (0.0 - 1.0) of values.
+ */
+unsigned long long
+MarcLatencyHistogram::getPercentile(double percentile)
+{
+	if (m_count == 0) {
+		return 0;
+	}
+
+	// Get rank of value (at least 1).
+	unsigned long long rank =
+		(unsigned long long) (percentile * (double) m_count + 0.999999);
+	if (rank < 1) {
+		rank = 1;
+	} else if (rank > m_count) {
+		rank = m_count;
+	}
+
+	// Find bucket containing value.
+	unsigned long long count = 0;
+	for (size_t bucket = 0; bucket < m_buckets.size(); bucket++) {
+		count += m_buckets[bucket];
+		if (count >= rank) {
+			unsigned long long value = getBucketValue(bucket);
+			return value < m_max ? value : m_max;
+		}
+	}
+
+	return m_max;
+}
+
+} // namespace marcrecord
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARC_STATS_H
+#define MARCRECORD_MARC_STATS_H
+
+#include <cstddef>
+#include <vector>
+
+// Interval of timed encoding conversions (conversions of short data are
+// faster than reading of clock, so time of sampled conversions is scaled).
+#define MARC_STATS_SAMPLE_INTERVAL	16
+
+namespace marcrecord {
+
+// Get value of monotonic clock in nanoseconds.
+unsigned long long get_time_ns(void);
+// Get time elapsed since start time in nanoseconds (without overhead of
+// reading clock, for timing of short operations).
+unsigned long long get_elapsed_ns(unsigned long long startTime);
+
+/*
+ * Statistics of reading and writing records (times are in nanoseconds).
+ */
+struct MarcStats {
+	// Number of bytes read from input.
+	unsigned long long inputBytes;
+	// Number of bytes written to output.
+	unsigned long long outputBytes;
+	// Time of reading data from input.
+	unsigned long long readTime;
+	// Time of framing records (including reading data from input).
+	unsigned long long frameTime;
+	// Time of conversion of input data to internal encoding (estimated
+	// by sampled conversions).
+	unsigned long long decodeTime;
+	// Time of conversion of output data to output encoding (estimated
+	// by sampled conversions).
+	unsigned long long encodeTime;
+	// Time of writing data to output.
+	unsigned long long writeTime;
+	// Number of conversions to internal encoding.
+	unsigned long long numDecodes;
+	// Number of conversions to output encoding.
+	unsigned long long numEncodes;
+
+	// Constructor.
+	MarcStats();
+
+	// Clear statistics.
+	void clear(void);
+};
+typedef struct MarcStats MarcStats;
+
+/*
+ * Histogram of latencies (log-linear buckets, relative error is below
+ * 1/16 of value).
+ */
+class MarcLatencyHistogram {
+protected:
+	// Counters of buckets.
+	std::vector<unsigned long long> m_buckets;
+	// Number of values.
+	unsigned long long m_count;
+	// Sum of values.
+	unsigned long long m_sum;
+	// Maximal value.
+	unsigned long long m_max;
+
+	// Get index of bucket for value.
+	static size_t getBucket(unsigned long long value);
+	// Get value in the middle of bucket.
+	static unsigned long long getBucketValue(size_t bucket);
+
+public:
+	// Constructor.
+	MarcLatencyHistogram();
+
+	// Clear histogram.
+	void clear(void);
+	// Add value to histogram.
+	void add(unsigned long long value);
+
+	// Get number of values.
+	unsigned long long getCount(void);
+	// Get mean value.
+	unsigned long long getMean(void);
+	// Get maximal value.
+	unsigned long long getMax(void);
+	// Get percentile (0.0 - 1.0) of values.
+	unsigned long long getPercentile(double percentile);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARC_STATS_H
@@ -29,12 +29,288 @@
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+#include "marciso_reader.h"
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
 #include "marc_writer.h"
 
+#define MARC_OUTPUT_ALIGNMENT		4096
+#define MARC_OUTPUT_MAX_IOV		16
+
 using namespace marcrecord;
 
+/*
+ * Destructor.
+ */
+MarcOutput::~MarcOutput()
+{
+}
+
+/*
+ * Get required alignment of written data (0 if not required).
+ */
+size_t
+MarcOutput::getAlignment(void)
+{
+	return 0;
+}
+
+/*
+ * Flush output.
+ */
+bool
+MarcOutput::flush(void)
+{
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcFileOutput::MarcFileOutput(FILE *outputFile)
+{
+	m_outputFile = outputFile;
+}
+
+/*
+ * Open output file.
+ */
+void
+MarcFileOutput::open(FILE *outputFile)
+{
+	m_outputFile = outputFile;
+}
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcFileOutput::write(const MarcOutputBlock *blocks, size_t numBlocks)
+{
+	for (size_t i = 0; i < numBlocks; i++) {
+		if (blocks[i].length > 0 && fwrite(blocks[i].data,
+			blocks[i].length, 1, m_outputFile) != 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Flush output.
+ */
+bool
+MarcFileOutput::flush(void)
+{
+	return fflush(m_outputFile) == 0;
+}
+
+/*
+ * Constructor.
+ */
+MarcMemoryOutput::MarcMemoryOutput(std::string *data)
+{
+	m_data = data;
+}
+
+/*
+ * Open output string (written data is appended).
+ */
+void
+MarcMemoryOutput::open(std::string *data)
+{
+	m_data = data;
+}
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcMemoryOutput::write(const MarcOutputBlock *blocks, size_t numBlocks)
+{
+	for (size_t i = 0; i < numBlocks; i++) {
+		m_data->append(blocks[i].data, blocks[i].length);
+	}
+
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcStatsOutput::MarcStatsOutput()
+{
+	m_output = NULL;
+	m_stats = NULL;
+}
+
+/*
+ * Open output sink.
+ */
+void
+MarcStatsOutput::open(MarcOutput *output, MarcStats *stats)
+{
+	m_output = output;
+	m_stats = stats;
+}
+
+/*
+ * Get required alignment of written data (0 if not required).
+ */
+size_t
+MarcStatsOutput::getAlignment(void)
+{
+	return m_output->getAlignment();
+}
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcStatsOutput::write(const MarcOutputBlock *blocks, size_t numBlocks)
+{
+	unsigned long long startTime = get_time_ns();
+	bool result = m_output->write(blocks, numBlocks);
+	m_stats->writeTime += get_time_ns() - startTime;
+	if (result) {
+		for (size_t i = 0; i < numBlocks; i++) {
+			m_stats->outputBytes += blocks[i].length;
+		}
+	}
+	return result;
+}
+
+/*
+ * Flush output.
+ */
+bool
+MarcStatsOutput::flush(void)
+{
+	unsigned long long startTime = get_time_ns();
+	bool result = m_output->flush();
+	m_stats->writeTime += get_time_ns() - startTime;
+	return result;
+}
+
+#ifndef _WIN32
+/*
+ * Constructor.
+ */
+MarcFdOutput::MarcFdOutput(int outputFd, bool directIo)
+{
+	m_outputFd = -1;
+	m_directIo = false;
+
+	if (outputFd >= 0) {
+		open(outputFd, directIo);
+	}
+}
+
+/*
+ * Open output file descriptor.
+ */
+bool
+MarcFdOutput::open(int outputFd, bool directIo)
+{
+	m_outputFd = outputFd;
+	m_directIo = false;
+
+	if (directIo) {
+#ifdef O_DIRECT
+		// Enable direct i/o for file descriptor.
+		int flags = fcntl(m_outputFd, F_GETFL);
+		if (flags == -1
+			|| fcntl(m_outputFd, F_SETFL, flags | O_DIRECT) == -1)
+		{
+			return false;
+		}
+		m_directIo = true;
+#else
+		return false;
+#endif
+	}
+
+	return true;
+}
+
+/*
+ * Get required alignment of written data (0 if not required).
+ */
+size_t
+MarcFdOutput::getAlignment(void)
+{
+	return m_directIo ? MARC_OUTPUT_ALIGNMENT : 0;
+}
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcFdOutput::write(const MarcOutputBlock *blocks, size_t numBlocks)
+{
+#ifdef O_DIRECT
+	// Unaligned data (end of output) is written without direct i/o.
+	for (size_t i = 0; m_directIo && i < numBlocks; i++) {
+		if ((size_t) blocks[i].data % MARC_OUTPUT_ALIGNMENT != 0
+			|| blocks[i].length % MARC_OUTPUT_ALIGNMENT != 0)
+		{
+			int flags = fcntl(m_outputFd, F_GETFL);
+			if (flags == -1 || fcntl(m_outputFd, F_SETFL,
+				flags & ~O_DIRECT) == -1)
+			{
+				return false;
+			}
+			m_directIo = false;
+		}
+	}
+#endif
+
+	// Write blocks with writev() (partially written blocks are resumed).
+	size_t blockNo = 0, blockPos = 0;
+	while (blockNo < numBlocks) {
+		struct iovec iov[MARC_OUTPUT_MAX_IOV];
+		int iovCount = 0;
+		for (size_t i = blockNo;
+			i < numBlocks && iovCount < MARC_OUTPUT_MAX_IOV; i++)
+		{
+			size_t pos = i == blockNo ? blockPos : 0;
+			iov[iovCount].iov_base = (void *) (blocks[i].data + pos);
+			iov[iovCount].iov_len = blocks[i].length - pos;
+			iovCount++;
+		}
+
+		ssize_t writtenLen = writev(m_outputFd, iov, iovCount);
+		if (writtenLen < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		// Skip written data.
+		size_t skipLen = (size_t) writtenLen;
+		while (blockNo < numBlocks
+			&& skipLen >= blocks[blockNo].length - blockPos)
+		{
+			skipLen -= blocks[blockNo].length - blockPos;
+			blockNo++;
+			blockPos = 0;
+		}
+		blockPos += skipLen;
+	}
+
+	return true;
+}
+#endif
+
 /*
  * Constructor.
  */
@@ -42,6 +318,19 @@ MarcWriter::MarcWriter()
 {
 	// Clear member variables.
 	m_errorCode = OK;
+	m_outputFile = NULL;
+	m_output = NULL;
+	m_outputBuf = NULL;
+	m_outputBufLen = 0;
+	m_outputBufMark = (size_t) -1;
+	m_stats = NULL;
+}
+
+/*
+ * Destructor.
+ */
+MarcWriter::~MarcWriter()
+{
 }
 
 /*
@@ -70,3 +359,458 @@ MarcWriter::getOutputFile()
 {
 	return m_outputFile;
 }
+
+/*
+ * Set output sink (replaces output file, buffered data is flushed).
+ */
+bool
+MarcWriter::setOutput(MarcOutput *output)
+{
+	// Write buffered data to previous output sink.
+	if (!writeOutputBuffer(true)) {
+		return false;
+	}
+
+	m_output = output == NULL ? &m_fileOutput : output;
+	return true;
+}
+
+/*
+ * Write buffered data to output sink.
+ */
+bool
+MarcWriter::flush(void)
+{
+	if (m_output == NULL) {
+		return true;
+	}
+
+	// Write buffered data and flush output sink.
+	if (!writeOutputBuffer(true)) {
+		return false;
+	}
+	if (!m_output->flush()) {
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "i/o operation failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Reset encoding state to start new output (buffered data must be
+ * flushed).
+ */
+bool
+MarcWriter::reset(void)
+{
+	if (!m_encoder.reset()) {
+		m_errorCode = ERROR_ICONV;
+		m_errorMessage = "iconv initialization failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Set statistics of writing (NULL to disable).
+ */
+void
+MarcWriter::setStats(MarcStats *stats)
+{
+	m_stats = stats;
+}
+
+/*
+ * Initialize output to file.
+ */
+void
+MarcWriter::openOutput(FILE *outputFile)
+{
+	// Allocate output buffer aligned for direct i/o.
+	if (m_outputBufData.empty()) {
+		m_outputBufData.resize(MARC_WRITER_BUFFER_SIZE
+			+ MARC_OUTPUT_ALIGNMENT);
+		char *bufData = &m_outputBufData[0];
+		m_outputBuf = bufData + (MARC_OUTPUT_ALIGNMENT
+			- (size_t) bufData % MARC_OUTPUT_ALIGNMENT)
+			% MARC_OUTPUT_ALIGNMENT;
+	}
+
+	m_fileOutput.open(outputFile);
+	m_output = &m_fileOutput;
+	m_outputBufLen = 0;
+	m_outputBufMark = (size_t) -1;
+}
+
+/*
+ * Flush and release output.
+ */
+void
+MarcWriter::closeOutput(void)
+{
+	if (m_output != NULL) {
+		writeOutputBuffer(true);
+		m_output->flush();
+	}
+
+	m_output = NULL;
+	m_outputBufLen = 0;
+	m_outputBufMark = (size_t) -1;
+}
+
+/*
+ * Write data from output buffer to output sink.
+ */
+bool
+MarcWriter::writeOutputBuffer(bool flushAll)
+{
+	if (m_output == NULL || m_outputBufLen == 0) {
+		return true;
+	}
+
+	// Only aligned part of buffer is written if output requires it.
+	size_t alignment = m_output->getAlignment();
+	size_t writeLen = m_outputBufLen;
+	if (!flushAll && alignment > 0) {
+		writeLen -= writeLen % alignment;
+		if (writeLen == 0) {
+			return true;
+		}
+	}
+
+	MarcOutputBlock block = { m_outputBuf, writeLen };
+	if (!m_output->write(&block, 1)) {
+		m_outputBufLen = 0;
+		m_outputBufMark = (size_t) -1;
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "i/o operation failed";
+		return false;
+	}
+
+	// Move rest of data to the beginning of buffer.
+	m_outputBufLen -= writeLen;
+	m_outputBufMark = (size_t) -1;
+	memmove(m_outputBuf, m_outputBuf + writeLen, m_outputBufLen);
+
+	return true;
+}
+
+/*
+ * Reserve space at the end of output buffer.
+ */
+char *
+MarcWriter::reserveOutput(size_t dataLen)
+{
+	if (dataLen > MARC_WRITER_BUFFER_SIZE - m_outputBufLen) {
+		if (!writeOutputBuffer(false)) {
+			return NULL;
+		}
+		if (dataLen > MARC_WRITER_BUFFER_SIZE - m_outputBufLen) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "data size exceed output buffer size";
+			return NULL;
+		}
+	}
+
+	return m_outputBuf + m_outputBufLen;
+}
+
+/*
+ * Make space for record of specified size (before encoding) in output
+ * buffer, so record is appended without writing of buffer (records
+ * larger than buffer are written by parts).
+ */
+bool
+MarcWriter::reserveRecord(size_t recordSize)
+{
+	recordSize = m_encoder.getEncodedSizeBound(recordSize);
+	return recordSize > MARC_WRITER_BUFFER_SIZE
+		|| reserveOutput(recordSize) != NULL;
+}
+
+/*
+ * Commit data written to reserved space of output buffer.
+ */
+void
+MarcWriter::commitOutput(size_t dataLen)
+{
+	m_outputBufLen += dataLen;
+}
+
+/*
+ * Mark current position in output buffer.
+ */
+void
+MarcWriter::markOutput(void)
+{
+	m_outputBufMark = m_outputBufLen;
+}
+
+/*
+ * Discard data appended to output buffer after marked position
+ * (if it wasn't written to output yet).
+ */
+void
+MarcWriter::rollbackOutput(void)
+{
+	if (m_outputBufMark != (size_t) -1) {
+		m_outputBufLen = m_outputBufMark;
+	}
+}
+
+/*
+ * Append data to output buffer.
+ */
+bool
+MarcWriter::appendOutput(const char *data, size_t dataLen)
+{
+	if (dataLen > MARC_WRITER_BUFFER_SIZE - m_outputBufLen) {
+		if (m_output->getAlignment() == 0) {
+			// Write buffered and new data in one operation.
+			MarcOutputBlock blocks[2] = {
+				{ m_outputBuf, m_outputBufLen },
+				{ data, dataLen } };
+			m_outputBufLen = 0;
+			m_outputBufMark = (size_t) -1;
+			if (!m_output->write(blocks, 2)) {
+				m_errorCode = ERROR_IO;
+				m_errorMessage = "i/o operation failed";
+				return false;
+			}
+			return true;
+		}
+
+		// Copy data to output buffer by parts.
+		while (dataLen > MARC_WRITER_BUFFER_SIZE - m_outputBufLen) {
+			size_t partLen = MARC_WRITER_BUFFER_SIZE - m_outputBufLen;
+			memcpy(m_outputBuf + m_outputBufLen, data, partLen);
+			m_outputBufLen += partLen;
+			data += partLen;
+			dataLen -= partLen;
+			if (!writeOutputBuffer(false)) {
+				return false;
+			}
+		}
+	}
+
+	memcpy(m_outputBuf + m_outputBufLen, data, dataLen);
+	m_outputBufLen += dataLen;
+
+	return true;
+}
+
+/*
+ * Convert data to output encoding (time is sampled for statistics).
+ */
+bool
+MarcWriter::encodeData(const char *&src, size_t &srcLen,
+	char *&dest, size_t &destLen)
+{
+	if (m_stats == NULL
+		|| m_stats->numEncodes++ % MARC_STATS_SAMPLE_INTERVAL != 0)
+	{
+		return m_encoder.encode(src, srcLen, dest, destLen);
+	}
+
+	unsigned long long startTime = get_time_ns();
+	bool result = m_encoder.encode(src, srcLen, dest, destLen);
+	m_stats->encodeTime += get_elapsed_ns(startTime)
+		* MARC_STATS_SAMPLE_INTERVAL;
+	return result;
+}
+
+/*
+ * Append data to output buffer with encoding conversion.
+ */
+bool
+MarcWriter::appendEncoded(const char *data, size_t dataLen)
+{
+	if (m_encoder.getMode() == MarcEncoder::MODE_NONE) {
+		return appendOutput(data, dataLen);
+	}
+
+	// Encode data directly to the output buffer.
+	while (dataLen > 0) {
+		char *dest = m_outputBuf + m_outputBufLen;
+		size_t destLen = MARC_WRITER_BUFFER_SIZE - m_outputBufLen;
+		bool result = encodeData(data, dataLen, dest, destLen);
+		m_outputBufLen = MARC_WRITER_BUFFER_SIZE - destLen;
+		if (!result) {
+			m_errorCode = ERROR_ICONV;
+			m_errorMessage = "encoding conversion failed";
+			return false;
+		}
+
+		// Write output buffer when it is full.
+		if (dataLen > 0 && !writeOutputBuffer(false)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Append data to output buffer with encoding conversion.
+ */
+bool
+MarcWriter::appendEncoded(const std::string &data)
+{
+	return appendEncoded(data.data(), data.size());
+}
+
+/*
+ * Append ASCII markup to output buffer.
+ */
+bool
+MarcWriter::appendMarkup(const char *markup)
+{
+	if (m_encoder.isAsciiCompatible()) {
+		return appendOutput(markup, strlen(markup));
+	}
+
+	return appendEncoded(markup, strlen(markup));
+}
+
+/*
+ * Decode raw data of field (error of reader is copied to writer).
+ */
+bool
+MarcWriter::decodeField(MarcRecord::Field &field)
+{
+	// Reader is detached from field while data is decoded.
+	MarcIsoReader *rawReader = field.m_rawReader;
+	if (!field.decode()) {
+		m_errorCode = ERROR_ICONV;
+		m_errorMessage = rawReader->getErrorMessage();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Decode raw data of all fields of record.
+ */
+bool
+MarcWriter::decodeRecord(MarcRecord &record)
+{
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		if (!decodeField(*fieldIt)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Append data with XML special characters replaced to output buffer.
+ */
+bool
+MarcWriter::appendXmlData(const std::string &data)
+{
+	const char *s = data.data();
+	size_t len = data.size(), start = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		const char *entity;
+
+		// Find special characters (see serialize_xml()).
+		switch (s[i]) {
+		case '"':
+			entity = "&quot;";
+			break;
+		case '&':
+			entity = i + 1 == len || s[i + 1] != '#' ? "&amp;" : NULL;
+			break;
+		case '\'':
+			entity = "&apos;";
+			break;
+		case '<':
+			entity = "&lt;";
+			break;
+		case '>':
+			entity = "&gt;";
+			break;
+		default:
+			entity = NULL;
+			break;
+		}
+
+		if (entity != NULL) {
+			// Append preceding data and entity.
+			if (!appendEncoded(s + start, i - start)
+				|| !appendMarkup(entity))
+			{
+				return false;
+			}
+			start = i + 1;
+		}
+	}
+
+	return appendEncoded(s + start, len - start);
+}
+
+/*
+ * Append data as JSON string contents (escaped) to output buffer.
+ */
+bool
+MarcWriter::appendJsonData(const char *data, size_t dataLen)
+{
+	size_t start = 0;
+
+	for (size_t i = 0; i < dataLen; i++) {
+		unsigned char c = (unsigned char) data[i];
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		// Replace special character with escape sequence.
+		char escape[7];
+		switch (c) {
+		case '"':
+			strcpy(escape, "\\\"");
+			break;
+		case '\\':
+			strcpy(escape, "\\\\");
+			break;
+		case '\n':
+			strcpy(escape, "\\n");
+			break;
+		case '\r':
+			strcpy(escape, "\\r");
+			break;
+		case '\t':
+			strcpy(escape, "\\t");
+			break;
+		default:
+			sprintf(escape, "\\u%04x", c);
+			break;
+		}
+
+		// Append preceding data and escape sequence.
+		if (!appendEncoded(data + start, i - start)
+			|| !appendMarkup(escape))
+		{
+			return false;
+		}
+		start = i + 1;
+	}
+
+	return appendEncoded(data + start, dataLen - start);
+}
+
+/*
+ * Append data as JSON string contents (escaped) to output buffer.
+ */
+bool
+MarcWriter::appendJsonData(const std::string &data)
+{
+	return appendJsonData(data.data(), data.size());
+}
@@ -29,11 +29,132 @@
 #ifndef MARCRECORD_MARC_WRITER_H
 #define MARCRECORD_MARC_WRITER_H
 
+#include <cstdio>
 #include <string>
+#include <vector>
+#include "marc_encoder.h"
+#include "marc_stats.h"
 #include "marcrecord.h"
 
+// Size of output buffer of writers.
+#define MARC_WRITER_BUFFER_SIZE		1048576
+
 namespace marcrecord {
 
+/*
+ * Block of data for output sink.
+ */
+struct MarcOutputBlock {
+	// Pointer to data.
+	const char *data;
+	// Length of data.
+	size_t length;
+};
+typedef struct MarcOutputBlock MarcOutputBlock;
+
+/*
+ * Output sink for MARC records writers.
+ */
+class MarcOutput {
+public:
+	// Destructor.
+	virtual ~MarcOutput();
+
+	// Get required alignment of written data (0 if not required).
+	virtual size_t getAlignment(void);
+	// Write blocks of data to output.
+	virtual bool write(const MarcOutputBlock *blocks,
+		size_t numBlocks) = 0;
+	// Flush output.
+	virtual bool flush(void);
+};
+
+/*
+ * Output sink for stdio file.
+ */
+class MarcFileOutput : public MarcOutput {
+protected:
+	// Output file.
+	FILE *m_outputFile;
+
+public:
+	// Constructor.
+	MarcFileOutput(FILE *outputFile = NULL);
+
+	// Open output file.
+	void open(FILE *outputFile);
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+	// Flush output.
+	bool flush(void);
+};
+
+/*
+ * Output sink which counts bytes and time of writing to other output sink.
+ */
+class MarcStatsOutput : public MarcOutput {
+protected:
+	// Output sink.
+	MarcOutput *m_output;
+	// Statistics of writing.
+	MarcStats *m_stats;
+
+public:
+	// Constructor.
+	MarcStatsOutput();
+
+	// Open output sink.
+	void open(MarcOutput *output, MarcStats *stats);
+	// Get required alignment of written data (0 if not required).
+	size_t getAlignment(void);
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+	// Flush output.
+	bool flush(void);
+};
+
+/*
+ * Output sink appending data to string in memory.
+ */
+class MarcMemoryOutput : public MarcOutput {
+protected:
+	// Output data.
+	std::string *m_data;
+
+public:
+	// Constructor.
+	MarcMemoryOutput(std::string *data = NULL);
+
+	// Open output string (written data is appended).
+	void open(std::string *data);
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+};
+
+#ifndef _WIN32
+/*
+ * Output sink for file descriptor (with optional direct i/o).
+ */
+class MarcFdOutput : public MarcOutput {
+protected:
+	// Output file descriptor.
+	int m_outputFd;
+	// Direct i/o mode (O_DIRECT, aligned writes).
+	bool m_directIo;
+
+public:
+	// Constructor.
+	MarcFdOutput(int outputFd = -1, bool directIo = false);
+
+	// Open output file descriptor.
+	bool open(int outputFd, bool directIo = false);
+	// Get required alignment of written data (0 if not required).
+	size_t getAlignment(void);
+	// Write blocks of data to output.
+	bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+};
+#endif
+
 /*
  * MARC records writer.
  */
@@ -44,7 +165,8 @@ public:
 		OK = 0,
 		ERROR_ICONV = -1,
 		ERROR_DATASIZE = -2,
-		ERROR_IO = -3
+		ERROR_IO = -3,
+		ERROR_PARAMETER = -4
 	};
 
 protected:
@@ -57,10 +179,69 @@ protected:
 	FILE *m_outputFile;
 	// Encoding of output file.
 	std::string m_outputEncoding;
+	// Encoder for output encoding.
+	MarcEncoder m_encoder;
+
+	// Output sink.
+	MarcOutput *m_output;
+	// Output sink for output file.
+	MarcFileOutput m_fileOutput;
+	// Output buffer memory.
+	std::vector<char> m_outputBufData;
+	// Output buffer (aligned).
+	char *m_outputBuf;
+	// Length of data in output buffer.
+	size_t m_outputBufLen;
+	// Marked position in output buffer (-1 if data was written).
+	size_t m_outputBufMark;
+
+	// Statistics of writing (NULL if not collected).
+	MarcStats *m_stats;
+
+	// Initialize output to file.
+	void openOutput(FILE *outputFile);
+	// Flush and release output.
+	void closeOutput(void);
+	// Write data from output buffer to output sink.
+	bool writeOutputBuffer(bool flushAll);
+	// Reserve space at the end of output buffer.
+	char *reserveOutput(size_t dataLen);
+	// Make space for record of specified size (before encoding) in
+	// output buffer.
+	bool reserveRecord(size_t recordSize);
+	// Commit data written to reserved space of output buffer.
+	void commitOutput(size_t dataLen);
+	// Mark current position in output buffer.
+	void markOutput(void);
+	// Discard data appended to output buffer after marked position.
+	void rollbackOutput(void);
+	// Append data to output buffer.
+	bool appendOutput(const char *data, size_t dataLen);
+	// Convert data to output encoding (time is sampled for statistics).
+	bool encodeData(const char *&src, size_t &srcLen,
+		char *&dest, size_t &destLen);
+	// Append data to output buffer with encoding conversion.
+	bool appendEncoded(const char *data, size_t dataLen);
+	// Append data to output buffer with encoding conversion.
+	bool appendEncoded(const std::string &data);
+	// Append ASCII markup to output buffer.
+	bool appendMarkup(const char *markup);
+	// Decode raw data of field (error of reader is copied to writer).
+	bool decodeField(MarcRecord::Field &field);
+	// Decode raw data of all fields of record.
+	bool decodeRecord(MarcRecord &record);
+	// Append data with XML special characters replaced to output buffer.
+	bool appendXmlData(const std::string &data);
+	// Append data as JSON string contents (escaped) to output buffer.
+	bool appendJsonData(const char *data, size_t dataLen);
+	// Append data as JSON string contents (escaped) to output buffer.
+	bool appendJsonData(const std::string &data);
 
 public:
 	// Constructor.
 	MarcWriter();
+	// Destructor.
+	virtual ~MarcWriter();
 
 	// Get last error code.
 	ErrorCode getErrorCode(void);
@@ -70,6 +251,17 @@ public:
 	// Return output file handle.
 	FILE *getOutputFile();
 
+	// Set output sink (replaces output file, buffered data is flushed).
+	bool setOutput(MarcOutput *output);
+	// Write buffered data to output sink.
+	bool flush(void);
+	// Reset encoding state to start new output (buffered data must be
+	// flushed).
+	bool reset(void);
+
+	// Set statistics of writing (NULL to disable).
+	void setStats(MarcStats *stats);
+
 	// Open output file.
 	virtual bool open(FILE *outputFile,
 		const char *outputEncoding = NULL) = 0;
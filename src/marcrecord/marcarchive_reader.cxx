@@ -0,0 +1,664 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcarchive_reader.h"
+
+namespace marcrecord {
+
+#define ARCHIVE_MAGIC			"MARCARC1"
+#define ARCHIVE_HEADER_SIZE		16
+#define ARCHIVE_BLOCK_TAG		"MBLK"
+#define ARCHIVE_INDEX_TAG		"MIDX"
+#define ARCHIVE_BLOCK_HEADER_SIZE	16
+#define ARCHIVE_INDEX_ENTRY_SIZE	28
+#define ARCHIVE_TRAILER_MAGIC		"MARCIDX1"
+#define ARCHIVE_TRAILER_SIZE		16
+
+#define ARCHIVE_MAX_BLOCK_SIZE		268435456
+
+#define ISO2709_MIN_RECORD_LENGTH	24
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcArchiveReader::MarcArchiveReader(FILE *inputFile,
+	const char *inputEncoding)
+	: MarcReader()
+{
+	// Clear member variables.
+
+	if (inputFile) {
+		// Open input file.
+		open(inputFile, inputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcArchiveReader::~MarcArchiveReader()
+{
+	// Close input file.
+	close();
+}
+
+/*
+ * Open input file (encoding of archive is used by default).
+ */
+bool
+MarcArchiveReader::open(FILE *inputFile, const char *inputEncoding)
+{
+	// Clear object state.
+	close();
+
+	// Initialize input stream parameters.
+	m_inputFile = inputFile == NULL ? stdin : inputFile;
+	openInput(m_inputFile);
+
+	// Read and check archive header.
+	char header[ARCHIVE_HEADER_SIZE];
+	if (!readInput(header, sizeof(header))
+		|| memcmp(header, ARCHIVE_MAGIC, 8) != 0)
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid archive header";
+		return false;
+	}
+	m_compression = (CompressionFormat) header[8];
+	if (!is_compression_supported(m_compression)) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "compression of archive is not supported";
+		return false;
+	}
+
+	// Read encoding of records in archive.
+	char archiveEncoding[256];
+	size_t archiveEncodingLen = (unsigned char) header[9];
+	if (!readInput(archiveEncoding, archiveEncodingLen)) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid archive header";
+		return false;
+	}
+	m_archiveEncoding.assign(archiveEncoding, archiveEncodingLen);
+	m_inputEncoding = inputEncoding == NULL
+		? m_archiveEncoding : inputEncoding;
+
+	// Initialize parser of records.
+	if (!m_recordParser.open(m_inputFile, m_inputEncoding.empty()
+		? NULL : m_inputEncoding.c_str()))
+	{
+		m_errorCode = m_recordParser.getErrorCode();
+		m_errorMessage = m_recordParser.getErrorMessage();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Close input file.
+ */
+void
+MarcArchiveReader::close(void)
+{
+	// Close parser of records.
+	m_recordParser.close();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_inputFile = NULL;
+	m_input = NULL;
+	m_inputEncoding = "";
+	m_autoCorrectionMode = false;
+	m_compression = COMPRESSION_NONE;
+	m_archiveEncoding = "";
+	m_blocks.clear();
+	m_indexLoaded = false;
+	m_blockData.clear();
+	m_blockDataPos = 0;
+	m_nextRecordNo = 1;
+}
+
+/*
+ * Read next record from archive.
+ */
+bool
+MarcArchiveReader::next(MarcRecord &record)
+{
+	// Read next block if all records of current block are read.
+	if (m_blockDataPos >= m_blockData.size() && !readNextBlock()) {
+		return false;
+	}
+
+	// Get next record from block.
+	const char *recordBuf;
+	unsigned int recordLen;
+	if (!nextBlockRecord(m_blockData, m_blockDataPos,
+		recordBuf, recordLen))
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record length in archive block";
+		// Skip rest of block.
+		m_blockDataPos = m_blockData.size();
+		return false;
+	}
+	m_nextRecordNo++;
+
+	// Parse record.
+	m_recordParser.setAutoCorrectionMode(m_autoCorrectionMode);
+	if (!m_recordParser.parse(recordBuf, recordLen, record)) {
+		m_errorCode = m_recordParser.getErrorCode();
+		m_errorMessage = m_recordParser.getErrorMessage();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Set lazy mode (fields are decoded on first access).
+ */
+void
+MarcArchiveReader::setLazyMode(bool lazyMode)
+{
+	m_recordParser.setLazyMode(lazyMode);
+}
+
+/*
+ * Get compression format of blocks.
+ */
+CompressionFormat
+MarcArchiveReader::getCompression(void)
+{
+	return m_compression;
+}
+
+/*
+ * Get encoding of records in archive.
+ */
+std::string &
+MarcArchiveReader::getArchiveEncoding(void)
+{
+	return m_archiveEncoding;
+}
+
+/*
+ * Load index of blocks (input file must be seekable).
+ */
+bool
+MarcArchiveReader::loadIndex(void)
+{
+	if (m_indexLoaded) {
+		return true;
+	}
+
+	// Index is read directly from input file.
+	if (m_input != &m_fileInput) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "random access to archive is not supported "
+			"for input source";
+		return false;
+	}
+
+	// Save current position in input file.
+#ifdef _WIN32
+	long long inputPos = _ftelli64(m_inputFile);
+#else
+	long long inputPos = ftello(m_inputFile);
+#endif
+	if (inputPos < 0) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "input file is not seekable";
+		return false;
+	}
+
+	try {
+		// Read trailer with offset of index.
+		char trailer[ARCHIVE_TRAILER_SIZE];
+#ifdef _WIN32
+		bool seekStatus = _fseeki64(m_inputFile,
+			-ARCHIVE_TRAILER_SIZE, SEEK_END) == 0;
+#else
+		bool seekStatus = fseeko(m_inputFile,
+			-ARCHIVE_TRAILER_SIZE, SEEK_END) == 0;
+#endif
+		if (!seekStatus || !readInput(trailer, sizeof(trailer))
+			|| memcmp(trailer + 8, ARCHIVE_TRAILER_MAGIC, 8) != 0)
+		{
+			throw std::string("archive index is not found");
+		}
+
+		// Read index header.
+		char indexHeader[ARCHIVE_BLOCK_HEADER_SIZE];
+		if (!seekInput(load_uint64(trailer))
+			|| !readInput(indexHeader, sizeof(indexHeader))
+			|| memcmp(indexHeader, ARCHIVE_INDEX_TAG, 4) != 0)
+		{
+			throw std::string("archive index is not found");
+		}
+		unsigned int indexSize = load_uint32(indexHeader + 4);
+		unsigned int numBlocks = load_uint32(indexHeader + 8);
+		if (indexSize > ARCHIVE_MAX_BLOCK_SIZE
+			|| numBlocks > indexSize / ARCHIVE_INDEX_ENTRY_SIZE)
+		{
+			throw std::string("invalid archive index");
+		}
+
+		// Read and parse index entries.
+		std::vector<char> index(indexSize);
+		if (indexSize > 0 && !readInput(&index[0], indexSize)) {
+			throw std::string("invalid archive index");
+		}
+		m_blocks.resize(numBlocks);
+		size_t indexPos = 0;
+		unsigned int nextRecordNo = 1;
+		for (unsigned int blockNo = 0; blockNo < numBlocks; blockNo++) {
+			if (indexSize - indexPos < ARCHIVE_INDEX_ENTRY_SIZE) {
+				throw std::string("invalid archive index");
+			}
+
+			const char *entry = &index[indexPos];
+			BlockInfo &blockInfo = m_blocks[blockNo];
+			blockInfo.offset = load_uint64(entry);
+			blockInfo.compressedSize = load_uint32(entry + 8);
+			blockInfo.dataSize = load_uint32(entry + 12);
+			blockInfo.firstRecordNo = load_uint32(entry + 16);
+			blockInfo.numRecords = load_uint32(entry + 20);
+			size_t firstIdLen = (unsigned char) entry[24]
+				| ((unsigned char) entry[25] << 8);
+			size_t lastIdLen = (unsigned char) entry[26]
+				| ((unsigned char) entry[27] << 8);
+			indexPos += ARCHIVE_INDEX_ENTRY_SIZE;
+
+			if (indexSize - indexPos < firstIdLen + lastIdLen
+				|| blockInfo.firstRecordNo != nextRecordNo)
+			{
+				throw std::string("invalid archive index");
+			}
+			blockInfo.firstId.assign(&index[indexPos], firstIdLen);
+			indexPos += firstIdLen;
+			blockInfo.lastId.assign(&index[indexPos], lastIdLen);
+			indexPos += lastIdLen;
+			nextRecordNo += blockInfo.numRecords;
+		}
+
+		// Restore position in input file.
+		if (!seekInput(inputPos)) {
+			throw std::string("input file is not seekable");
+		}
+	} catch (std::string errorMessage) {
+		m_blocks.clear();
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = errorMessage;
+		return false;
+	}
+
+	m_indexLoaded = true;
+	return true;
+}
+
+/*
+ * Get number of blocks in archive.
+ */
+size_t
+MarcArchiveReader::getNumBlocks(void)
+{
+	return m_blocks.size();
+}
+
+/*
+ * Get index entry of block.
+ */
+const MarcArchiveReader::BlockInfo &
+MarcArchiveReader::getBlockInfo(size_t blockNo)
+{
+	return m_blocks[blockNo];
+}
+
+/*
+ * Set position to record with specified number (starting from 1).
+ */
+bool
+MarcArchiveReader::seekRecord(unsigned int recordNo)
+{
+	// Load index and find block containing the record.
+	if (!loadIndex()) {
+		return false;
+	}
+	size_t blockNo = findBlock(recordNo);
+	if (blockNo == m_blocks.size()) {
+		m_errorCode = END_OF_FILE;
+		m_errorMessage = "record is not found";
+		return false;
+	}
+
+	// Load block and skip preceding records.
+	if (!loadBlock(blockNo)) {
+		return false;
+	}
+	while (m_nextRecordNo < recordNo) {
+		const char *recordBuf;
+		unsigned int recordLen;
+		if (!nextBlockRecord(m_blockData, m_blockDataPos,
+			recordBuf, recordLen))
+		{
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage = "invalid record length in archive block";
+			return false;
+		}
+		m_nextRecordNo++;
+	}
+
+	return true;
+}
+
+/*
+ * Set position to record with specified control number (001).
+ */
+bool
+MarcArchiveReader::seekRecordId(const std::string &recordId)
+{
+	if (!loadIndex()) {
+		return false;
+	}
+
+	// Check blocks which range of control numbers includes the record.
+	MarcIsoReader recordParser(m_inputFile, m_inputEncoding.empty()
+		? NULL : m_inputEncoding.c_str());
+	recordParser.setLazyMode();
+	for (size_t blockNo = 0; blockNo < m_blocks.size(); blockNo++) {
+		const BlockInfo &blockInfo = m_blocks[blockNo];
+		if (recordId < blockInfo.firstId
+			|| recordId > blockInfo.lastId)
+		{
+			continue;
+		}
+
+		if (!loadBlock(blockNo)) {
+			return false;
+		}
+
+		// Find record in block.
+		size_t recordPos = m_blockDataPos;
+		const char *recordBuf;
+		unsigned int recordLen;
+		while (nextBlockRecord(m_blockData, m_blockDataPos,
+			recordBuf, recordLen))
+		{
+			MarcRecord record;
+			if (recordParser.parse(recordBuf, recordLen, record)) {
+				MarcRecord::FieldIt fieldIt =
+					record.getField("001");
+				if (fieldIt != record.nullField()
+					&& fieldIt->decode()
+					&& fieldIt->m_data == recordId)
+				{
+					m_blockDataPos = recordPos;
+					return true;
+				}
+			}
+
+			recordPos = m_blockDataPos;
+			m_nextRecordNo++;
+		}
+	}
+
+	m_errorCode = END_OF_FILE;
+	m_errorMessage = "record is not found";
+	return false;
+}
+
+/*
+ * Read compressed data of block from input file.
+ */
+bool
+MarcArchiveReader::readBlock(size_t blockNo,
+	std::vector<char> &compressedData)
+{
+	if (!loadIndex()) {
+		return false;
+	}
+
+	// Read and check block header.
+	const BlockInfo &blockInfo = m_blocks[blockNo];
+	char blockHeader[ARCHIVE_BLOCK_HEADER_SIZE];
+	if (!seekInput(blockInfo.offset)
+		|| !readInput(blockHeader, sizeof(blockHeader))
+		|| memcmp(blockHeader, ARCHIVE_BLOCK_TAG, 4) != 0
+		|| load_uint32(blockHeader + 4) != blockInfo.compressedSize
+		|| load_uint32(blockHeader + 8) != blockInfo.dataSize
+		|| load_uint32(blockHeader + 12) != blockInfo.numRecords)
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid archive block";
+		return false;
+	}
+
+	// Read compressed data of block.
+	compressedData.resize(blockInfo.compressedSize);
+	return blockInfo.compressedSize == 0
+		|| readInput(&compressedData[0], blockInfo.compressedSize);
+}
+
+/*
+ * Decompress data of block (thread-safe, blocks can be decoded
+ * in parallel and parsed by separate MarcIsoReader objects).
+ */
+bool
+MarcArchiveReader::decodeBlock(size_t blockNo,
+	const std::vector<char> &compressedData,
+	std::vector<char> &blockData) const
+{
+	const BlockInfo &blockInfo = m_blocks[blockNo];
+	if (blockInfo.dataSize > ARCHIVE_MAX_BLOCK_SIZE
+		|| compressedData.size() != blockInfo.compressedSize)
+	{
+		return false;
+	}
+
+	blockData.resize(blockInfo.dataSize);
+	if (blockInfo.dataSize == 0) {
+		return compressedData.empty();
+	}
+
+	return decompress_block(m_compression, compressedData.empty()
+		? NULL : &compressedData[0], compressedData.size(),
+		&blockData[0], blockData.size());
+}
+
+/*
+ * Get next ISO 2709 record from uncompressed data of block.
+ */
+bool
+MarcArchiveReader::nextBlockRecord(const std::vector<char> &blockData,
+	size_t &blockDataPos, const char *&recordBuf, unsigned int &recordLen)
+{
+	if (blockData.size() - blockDataPos < ISO2709_MIN_RECORD_LENGTH) {
+		return false;
+	}
+
+	// Get record length from leader.
+	recordBuf = &blockData[blockDataPos];
+	if (!parse_decimal(recordBuf, 5, recordLen)
+		|| recordLen < ISO2709_MIN_RECORD_LENGTH
+		|| recordLen > blockData.size() - blockDataPos)
+	{
+		return false;
+	}
+	blockDataPos += recordLen;
+
+	return true;
+}
+
+/*
+ * Read data from input (error is set at unexpected end of input).
+ */
+bool
+MarcArchiveReader::readInput(char *buf, size_t bufLen)
+{
+	if (m_input->read(buf, bufLen) != bufLen) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "unexpected end of archive";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read next block of records from input.
+ */
+bool
+MarcArchiveReader::readNextBlock(void)
+{
+	// Read block header (index follows the last block).
+	char blockHeader[ARCHIVE_BLOCK_HEADER_SIZE];
+	size_t headerLen = m_input->read(blockHeader, sizeof(blockHeader));
+	if (headerLen == 0 || (headerLen == sizeof(blockHeader)
+		&& memcmp(blockHeader, ARCHIVE_INDEX_TAG, 4) == 0))
+	{
+		m_errorCode = END_OF_FILE;
+		m_errorMessage = "end of file";
+		return false;
+	} else if (headerLen != sizeof(blockHeader)
+		|| memcmp(blockHeader, ARCHIVE_BLOCK_TAG, 4) != 0)
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid archive block";
+		return false;
+	}
+
+	// Read compressed data of block.
+	unsigned int compressedSize = load_uint32(blockHeader + 4);
+	unsigned int dataSize = load_uint32(blockHeader + 8);
+	if (compressedSize > ARCHIVE_MAX_BLOCK_SIZE
+		|| dataSize > ARCHIVE_MAX_BLOCK_SIZE)
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid archive block";
+		return false;
+	}
+	m_compressedData.resize(compressedSize);
+	if (compressedSize > 0
+		&& !readInput(&m_compressedData[0], compressedSize))
+	{
+		return false;
+	}
+
+	// Decompress data of block.
+	m_blockData.resize(dataSize);
+	m_blockDataPos = 0;
+	if (dataSize > 0 && !decompress_block(m_compression,
+		compressedSize > 0 ? &m_compressedData[0] : NULL,
+		compressedSize, &m_blockData[0], dataSize))
+	{
+		m_blockData.clear();
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "decompression of archive block failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Set position in input file.
+ */
+bool
+MarcArchiveReader::seekInput(unsigned long long offset)
+{
+#ifdef _WIN32
+	return _fseeki64(m_inputFile, (long long) offset, SEEK_SET) == 0;
+#else
+	return fseeko(m_inputFile, (off_t) offset, SEEK_SET) == 0;
+#endif
+}
+
+/*
+ * Load block to the current block data.
+ */
+bool
+MarcArchiveReader::loadBlock(size_t blockNo)
+{
+	m_blockData.clear();
+	m_blockDataPos = 0;
+
+	if (!readBlock(blockNo, m_compressedData)) {
+		return false;
+	}
+	if (!decodeBlock(blockNo, m_compressedData, m_blockData)) {
+		m_blockData.clear();
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "decompression of archive block failed";
+		return false;
+	}
+	m_nextRecordNo = m_blocks[blockNo].firstRecordNo;
+
+	return true;
+}
+
+/*
+ * Find block containing specified record (number of blocks is returned
+ * if record is not found).
+ */
+size_t
+MarcArchiveReader::findBlock(unsigned int recordNo)
+{
+	// Binary search by number of first record in block.
+	size_t lowBlockNo = 0, highBlockNo = m_blocks.size();
+	while (lowBlockNo < highBlockNo) {
+		size_t blockNo = lowBlockNo + (highBlockNo - lowBlockNo) / 2;
+		const BlockInfo &blockInfo = m_blocks[blockNo];
+		if (recordNo < blockInfo.firstRecordNo) {
+			highBlockNo = blockNo;
+		} else if (recordNo - blockInfo.firstRecordNo
+			>= blockInfo.numRecords)
+		{
+			lowBlockNo = blockNo + 1;
+		} else {
+			return blockNo;
+		}
+	}
+
+	return m_blocks.size();
+}
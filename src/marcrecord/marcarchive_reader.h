@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCARCHIVE_READER_H
+#define MARCRECORD_MARCARCHIVE_READER_H
+
+#include <string>
+#include <vector>
+#include "marc_compress.h"
+#include "marc_reader.h"
+#include "marciso_reader.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * MARC archive reader (blocks of ISO 2709 records compressed independently,
+ * trailing index of blocks allows random access).
+ */
+class MarcArchiveReader : public MarcReader {
+public:
+	/*
+	 * Index entry of block of records.
+	 */
+	struct BlockInfo {
+		// Offset of block in archive file.
+		unsigned long long offset;
+		// Size of compressed data of block.
+		unsigned int compressedSize;
+		// Size of uncompressed data of block.
+		unsigned int dataSize;
+		// Number of first record in block (starting from 1).
+		unsigned int firstRecordNo;
+		// Number of records in block.
+		unsigned int numRecords;
+		// Lowest control number (001) of records in block.
+		std::string firstId;
+		// Highest control number (001) of records in block.
+		std::string lastId;
+	};
+	typedef struct BlockInfo BlockInfo;
+
+protected:
+	// Compression format of blocks.
+	CompressionFormat m_compression;
+	// Encoding of records in archive.
+	std::string m_archiveEncoding;
+	// Parser of ISO 2709 records.
+	MarcIsoReader m_recordParser;
+
+	// Index of blocks.
+	std::vector<BlockInfo> m_blocks;
+	// Index of blocks is loaded flag.
+	bool m_indexLoaded;
+
+	// Compressed data of current block.
+	std::vector<char> m_compressedData;
+	// Uncompressed data of current block.
+	std::vector<char> m_blockData;
+	// Position of next record in current block.
+	size_t m_blockDataPos;
+	// Number of next record.
+	unsigned int m_nextRecordNo;
+
+private:
+	// Read data from input (error is set at unexpected end of input).
+	bool readInput(char *buf, size_t bufLen);
+	// Read next block of records from input.
+	bool readNextBlock(void);
+	// Set position in input file.
+	bool seekInput(unsigned long long offset);
+	// Load block to the current block data.
+	bool loadBlock(size_t blockNo);
+	// Find block containing specified record.
+	size_t findBlock(unsigned int recordNo);
+
+public:
+	// Constructor.
+	MarcArchiveReader(FILE *inputFile = NULL,
+		const char *inputEncoding = NULL);
+	// Destructor.
+	~MarcArchiveReader();
+
+	// Open input file (encoding of archive is used by default).
+	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Close input file.
+	void close(void);
+	// Read next record from file.
+	bool next(MarcRecord &record);
+
+	// Set lazy mode (fields are decoded on first access).
+	void setLazyMode(bool lazyMode = true);
+
+	// Get compression format of blocks.
+	CompressionFormat getCompression(void);
+	// Get encoding of records in archive.
+	std::string & getArchiveEncoding(void);
+
+	// Load index of blocks (input file must be seekable).
+	bool loadIndex(void);
+	// Get number of blocks in archive.
+	size_t getNumBlocks(void);
+	// Get index entry of block.
+	const BlockInfo & getBlockInfo(size_t blockNo);
+
+	// Set position to record with specified number (starting from 1).
+	bool seekRecord(unsigned int recordNo);
+	// Set position to record with specified control number (001).
+	bool seekRecordId(const std::string &recordId);
+
+	// Read compressed data of block from input file.
+	bool readBlock(size_t blockNo, std::vector<char> &compressedData);
+	// Decompress data of block (thread-safe, blocks can be decoded
+	// in parallel and parsed by separate MarcIsoReader objects).
+	bool decodeBlock(size_t blockNo, const std::vector<char> &compressedData,
+		std::vector<char> &blockData) const;
+	// Get next ISO 2709 record from uncompressed data of block.
+	static bool nextBlockRecord(const std::vector<char> &blockData,
+		size_t &blockDataPos, const char *&recordBuf,
+		unsigned int &recordLen);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCARCHIVE_READER_H
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcarchive_writer.h"
+
+namespace marcrecord {
+
+#define ARCHIVE_MAGIC			"MARCARC1"
+#define ARCHIVE_HEADER_SIZE		16
+#define ARCHIVE_BLOCK_TAG		"MBLK"
+#define ARCHIVE_INDEX_TAG		"MIDX"
+#define ARCHIVE_BLOCK_HEADER_SIZE	16
+#define ARCHIVE_INDEX_ENTRY_SIZE	28
+#define ARCHIVE_TRAILER_MAGIC		"MARCIDX1"
+#define ARCHIVE_TRAILER_SIZE		16
+
+#define ARCHIVE_DEFAULT_BLOCK_RECORDS	1000
+#define ARCHIVE_MAX_BLOCK_DATA_SIZE	67108864
+#define ARCHIVE_MAX_ID_LENGTH		65535
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Write blocks of data to output.
+ */
+bool
+MarcArchiveWriter::BlockOutput::write(const MarcOutputBlock *blocks,
+	size_t numBlocks)
+{
+	for (size_t i = 0; i < numBlocks; i++) {
+		m_data.append(blocks[i].data, blocks[i].length);
+	}
+
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcArchiveWriter::MarcArchiveWriter(FILE *outputFile,
+	const char *outputEncoding)
+	: MarcWriter()
+{
+	// Clear member variables.
+
+	if (outputFile) {
+		// Open output file.
+		open(outputFile, outputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcArchiveWriter::~MarcArchiveWriter()
+{
+	// Close output file.
+	close();
+}
+
+/*
+ * Open output file.
+ */
+bool
+MarcArchiveWriter::open(FILE *outputFile, const char *outputEncoding)
+{
+	// Clear object state.
+	close();
+
+	// Initialize output stream parameters.
+	m_outputFile = outputFile == NULL ? stdout : outputFile;
+	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
+
+	// Initialize writer of records to the block buffer.
+	if (!m_recordWriter.open(m_outputFile, outputEncoding)) {
+		m_errorCode = m_recordWriter.getErrorCode();
+		m_errorMessage = m_recordWriter.getErrorMessage();
+		return false;
+	}
+	m_recordWriter.setOutput(&m_blockOutput);
+
+	return true;
+}
+
+/*
+ * Close output file.
+ */
+void
+MarcArchiveWriter::close(void)
+{
+	// Write buffered data to output.
+	closeOutput();
+
+	// Close writer of records.
+	m_recordWriter.close();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_outputFile = NULL;
+	m_outputEncoding = "";
+	m_compression = is_compression_supported(COMPRESSION_ZSTD)
+		? COMPRESSION_ZSTD : is_compression_supported(COMPRESSION_GZIP)
+		? COMPRESSION_GZIP : COMPRESSION_NONE;
+	m_compressionLevel = -1;
+	m_blockRecords = ARCHIVE_DEFAULT_BLOCK_RECORDS;
+	m_blockOutput.m_data.clear();
+	m_blockInfo = MarcArchiveReader::BlockInfo();
+	m_blockInfo.firstRecordNo = 1;
+	m_blockInfo.numRecords = 0;
+	m_blocks.clear();
+	m_archiveOffset = 0;
+}
+
+/*
+ * Write record to archive.
+ */
+bool
+MarcArchiveWriter::write(MarcRecord &record)
+{
+	// Serialize record to the block buffer.
+	if (!m_recordWriter.write(record) || !m_recordWriter.flush()) {
+		m_errorCode = m_recordWriter.getErrorCode();
+		m_errorMessage = m_recordWriter.getErrorMessage();
+		return false;
+	}
+
+	// Update range of control numbers in block.
+	MarcRecord::FieldIt fieldIt = record.getField("001");
+	if (fieldIt != record.nullField() && fieldIt->decode()
+		&& !fieldIt->m_data.empty()
+		&& fieldIt->m_data.size() <= ARCHIVE_MAX_ID_LENGTH)
+	{
+		const std::string &recordId = fieldIt->m_data;
+		if (m_blockInfo.firstId.empty()
+			|| recordId < m_blockInfo.firstId)
+		{
+			m_blockInfo.firstId = recordId;
+		}
+		if (m_blockInfo.lastId.empty()
+			|| recordId > m_blockInfo.lastId)
+		{
+			m_blockInfo.lastId = recordId;
+		}
+	}
+
+	// Write block when it is full.
+	m_blockInfo.numRecords++;
+	if (m_blockInfo.numRecords >= m_blockRecords
+		|| m_blockOutput.m_data.size() >= ARCHIVE_MAX_BLOCK_DATA_SIZE)
+	{
+		return writeBlock();
+	}
+
+	return true;
+}
+
+/*
+ * Get compression format of blocks.
+ */
+CompressionFormat
+MarcArchiveWriter::getCompression(void)
+{
+	return m_compression;
+}
+
+/*
+ * Set compression of blocks (must be set before header is written).
+ */
+bool
+MarcArchiveWriter::setCompression(CompressionFormat compression, int level)
+{
+	if (!is_compression_supported(compression)) {
+		return false;
+	}
+
+	m_compression = compression;
+	m_compressionLevel = level;
+
+	return true;
+}
+
+/*
+ * Set maximal number of records in block.
+ */
+void
+MarcArchiveWriter::setBlockRecords(unsigned int blockRecords)
+{
+	m_blockRecords = blockRecords == 0
+		? ARCHIVE_DEFAULT_BLOCK_RECORDS : blockRecords;
+}
+
+/*
+ * Write header to output file.
+ */
+bool
+MarcArchiveWriter::writeHeader(void)
+{
+	if (m_outputEncoding.size() > 255) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "name of encoding is too long";
+		return false;
+	}
+
+	// Create archive header.
+	std::string header(ARCHIVE_HEADER_SIZE, '\0');
+	memcpy(&header[0], ARCHIVE_MAGIC, 8);
+	header[8] = (char) m_compression;
+	header[9] = (char) m_outputEncoding.size();
+	store_uint32(&header[12], m_blockRecords);
+	header += m_outputEncoding;
+
+	// Append archive header to output buffer.
+	if (!appendOutput(header.data(), header.size())) {
+		return false;
+	}
+	m_archiveOffset += header.size();
+
+	return true;
+}
+
+/*
+ * Write last block and index of blocks to output file.
+ */
+bool
+MarcArchiveWriter::writeFooter(void)
+{
+	// Write last block.
+	if (!writeBlock()) {
+		return false;
+	}
+
+	// Create index of blocks.
+	std::string index(ARCHIVE_BLOCK_HEADER_SIZE, '\0');
+	std::vector<MarcArchiveReader::BlockInfo>::iterator blockIt =
+		m_blocks.begin();
+	for (; blockIt != m_blocks.end(); blockIt++) {
+		char entry[ARCHIVE_INDEX_ENTRY_SIZE];
+		store_uint64(entry, blockIt->offset);
+		store_uint32(entry + 8, blockIt->compressedSize);
+		store_uint32(entry + 12, blockIt->dataSize);
+		store_uint32(entry + 16, blockIt->firstRecordNo);
+		store_uint32(entry + 20, blockIt->numRecords);
+		entry[24] = (char) (blockIt->firstId.size() & 0xFF);
+		entry[25] = (char) (blockIt->firstId.size() >> 8);
+		entry[26] = (char) (blockIt->lastId.size() & 0xFF);
+		entry[27] = (char) (blockIt->lastId.size() >> 8);
+		index.append(entry, sizeof(entry));
+		index += blockIt->firstId;
+		index += blockIt->lastId;
+	}
+	memcpy(&index[0], ARCHIVE_INDEX_TAG, 4);
+	store_uint32(&index[4], index.size() - ARCHIVE_BLOCK_HEADER_SIZE);
+	store_uint32(&index[8], m_blocks.size());
+
+	// Create trailer with offset of index.
+	char trailer[ARCHIVE_TRAILER_SIZE];
+	store_uint64(trailer, m_archiveOffset);
+	memcpy(trailer + 8, ARCHIVE_TRAILER_MAGIC, 8);
+
+	// Append index and trailer to output buffer.
+	if (!appendOutput(index.data(), index.size())
+		|| !appendOutput(trailer, sizeof(trailer)))
+	{
+		return false;
+	}
+	m_archiveOffset += index.size() + sizeof(trailer);
+
+	return true;
+}
+
+/*
+ * Compress current block and append it to output buffer.
+ */
+bool
+MarcArchiveWriter::writeBlock(void)
+{
+	if (m_blockInfo.numRecords == 0) {
+		return true;
+	}
+
+	// Compress data of block.
+	const std::string &blockData = m_blockOutput.m_data;
+	if (!compress_block(m_compression, m_compressionLevel,
+		blockData.data(), blockData.size(), m_compressedData))
+	{
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "compression of archive block failed";
+		return false;
+	}
+
+	// Create block header.
+	char blockHeader[ARCHIVE_BLOCK_HEADER_SIZE];
+	memcpy(blockHeader, ARCHIVE_BLOCK_TAG, 4);
+	store_uint32(blockHeader + 4, m_compressedData.size());
+	store_uint32(blockHeader + 8, blockData.size());
+	store_uint32(blockHeader + 12, m_blockInfo.numRecords);
+
+	// Append block to output buffer.
+	if (!appendOutput(blockHeader, sizeof(blockHeader))
+		|| !appendOutput(m_compressedData.data(),
+		m_compressedData.size()))
+	{
+		return false;
+	}
+
+	// Append block to index.
+	m_blockInfo.offset = m_archiveOffset;
+	m_blockInfo.compressedSize = m_compressedData.size();
+	m_blockInfo.dataSize = blockData.size();
+	m_blocks.push_back(m_blockInfo);
+	m_archiveOffset += sizeof(blockHeader) + m_compressedData.size();
+
+	// Start next block.
+	m_blockInfo.firstRecordNo += m_blockInfo.numRecords;
+	m_blockInfo.numRecords = 0;
+	m_blockInfo.firstId = "";
+	m_blockInfo.lastId = "";
+	m_blockOutput.m_data.clear();
+
+	return true;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCARCHIVE_WRITER_H
+#define MARCRECORD_MARCARCHIVE_WRITER_H
+
+#include <string>
+#include <vector>
+#include "marc_compress.h"
+#include "marc_writer.h"
+#include "marcarchive_reader.h"
+#include "marciso_writer.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * MARC archive writer (blocks of ISO 2709 records compressed independently,
+ * trailing index of blocks allows random access).
+ */
+class MarcArchiveWriter : public MarcWriter {
+private:
+	/*
+	 * Output sink for data of current block.
+	 */
+	class BlockOutput : public MarcOutput {
+	public:
+		// Data of current block.
+		std::string m_data;
+
+		// Write blocks of data to output.
+		bool write(const MarcOutputBlock *blocks, size_t numBlocks);
+	};
+
+protected:
+	// Compression format of blocks.
+	CompressionFormat m_compression;
+	// Compression level (-1 for default level).
+	int m_compressionLevel;
+	// Maximal number of records in block.
+	unsigned int m_blockRecords;
+
+	// Output sink for data of current block.
+	BlockOutput m_blockOutput;
+	// Writer of ISO 2709 records to the current block.
+	MarcIsoWriter m_recordWriter;
+	// Compressed data of current block.
+	std::string m_compressedData;
+	// Index entry of current block.
+	MarcArchiveReader::BlockInfo m_blockInfo;
+	// Index of written blocks.
+	std::vector<MarcArchiveReader::BlockInfo> m_blocks;
+	// Offset of next block in archive file.
+	unsigned long long m_archiveOffset;
+
+private:
+	// Compress current block and append it to output buffer.
+	bool writeBlock(void);
+
+public:
+	// Constructor.
+	MarcArchiveWriter(FILE *outputFile = NULL,
+		const char *outputEncoding = NULL);
+	// Destructor.
+	~MarcArchiveWriter();
+
+	// Open output file.
+	bool open(FILE *outputFile, const char *outputEncoding = NULL);
+	// Close output file.
+	void close(void);
+	// Write record to output file.
+	bool write(MarcRecord &record);
+
+	// Get compression format of blocks.
+	CompressionFormat getCompression(void);
+	// Set compression of blocks (must be set before header is written).
+	bool setCompression(CompressionFormat compression, int level = -1);
+	// Set maximal number of records in block.
+	void setBlockRecords(unsigned int blockRecords);
+
+	// Write header to output file.
+	bool writeHeader(void);
+	// Write last block and index of blocks to output file.
+	bool writeFooter(void);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCARCHIVE_WRITER_H
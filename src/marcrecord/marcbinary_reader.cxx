@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcbinary_reader.h"
+
+namespace marcrecord {
+
+#define BINARY_MAGIC			"MARCBIN1"
+#define BINARY_MAGIC_SIZE		8
+#define BINARY_FIELD_CONTROL		0
+#define BINARY_FIELD_DATA		1
+#define BINARY_CHECKSUM_SIZE		4
+#define BINARY_MAX_VARINT_SIZE		10
+
+// Sanity limit of record length (protects from corrupted lengths).
+#define BINARY_MAX_RECORD_LENGTH	0x7FFFFFF0
+#define BINARY_INPUT_BUFFER_SIZE	262144
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Get next subfield of data field.
+ */
+bool
+MarcBinaryReader::FieldView::nextSubfield(SubfieldView &subfield)
+{
+	if (subfieldPos >= dataLength) {
+		return false;
+	}
+
+	// Decode subfield identifier and length of data.
+	unsigned long long subfieldLength;
+	subfield.id = data[subfieldPos++];
+	subfieldPos += decode_varint(data + subfieldPos,
+		dataLength - subfieldPos, subfieldLength);
+	subfield.data = data + subfieldPos;
+	subfield.dataLength = (size_t) subfieldLength;
+	subfieldPos += subfield.dataLength;
+
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcBinaryReader::RecordView::RecordView()
+{
+	m_leader = NULL;
+	m_numFields = 0;
+	m_fieldPos = NULL;
+	m_recordEnd = NULL;
+	m_tags = NULL;
+}
+
+/*
+ * Get record leader.
+ */
+const MarcRecord::Leader &
+MarcBinaryReader::RecordView::getLeader(void)
+{
+	return *(const MarcRecord::Leader *) m_leader;
+}
+
+/*
+ * Get number of fields.
+ */
+size_t
+MarcBinaryReader::RecordView::getNumFields(void)
+{
+	return m_numFields;
+}
+
+/*
+ * Get next field (record data is validated already).
+ */
+bool
+MarcBinaryReader::RecordView::nextField(FieldView &field)
+{
+	if (m_fieldPos >= m_recordEnd) {
+		return false;
+	}
+
+	// Decode field tag (defined inline or referenced in dictionary).
+	unsigned long long value;
+	m_fieldPos += decode_varint(m_fieldPos, m_recordEnd - m_fieldPos, value);
+	if (value == 0) {
+		m_fieldPos += decode_varint(m_fieldPos,
+			m_recordEnd - m_fieldPos, value);
+		field.tag = m_fieldPos;
+		field.tagLength = (size_t) value;
+		m_fieldPos += field.tagLength;
+	} else {
+		const std::string &tag = (*m_tags)[(size_t) value - 1];
+		field.tag = tag.data();
+		field.tagLength = tag.size();
+	}
+
+	// Decode type and indicators of field.
+	field.controlField = *(m_fieldPos++) == BINARY_FIELD_CONTROL;
+	if (field.controlField) {
+		field.ind1 = ' ';
+		field.ind2 = ' ';
+	} else {
+		field.ind1 = m_fieldPos[0];
+		field.ind2 = m_fieldPos[1];
+		m_fieldPos += 2;
+	}
+
+	// Decode field data.
+	m_fieldPos += decode_varint(m_fieldPos, m_recordEnd - m_fieldPos, value);
+	field.data = m_fieldPos;
+	field.dataLength = (size_t) value;
+	field.subfieldPos = 0;
+	m_fieldPos += field.dataLength;
+
+	return true;
+}
+
+/*
+ * Constructor.
+ */
+MarcBinaryReader::MarcBinaryReader(FILE *inputFile,
+	const char *inputEncoding)
+	: MarcReader()
+{
+	// Clear member variables.
+	m_inputBuf.resize(BINARY_INPUT_BUFFER_SIZE);
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputEof = false;
+	m_headerRead = false;
+
+	if (inputFile) {
+		// Open input file.
+		open(inputFile, inputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcBinaryReader::~MarcBinaryReader()
+{
+	// Close input file.
+	close();
+}
+
+/*
+ * Open input file (data is always in UTF-8, encoding is ignored).
+ */
+bool
+MarcBinaryReader::open(FILE *inputFile, const char *inputEncoding)
+{
+	// Clear object state.
+	close();
+
+	// Initialize input stream parameters.
+	m_inputFile = inputFile == NULL ? stdin : inputFile;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+	openInput(m_inputFile);
+
+	return true;
+}
+
+/*
+ * Close input file.
+ */
+void
+MarcBinaryReader::close(void)
+{
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_inputFile = NULL;
+	m_input = NULL;
+	m_inputEncoding = "";
+	m_autoCorrectionMode = false;
+	m_inputBuf.resize(BINARY_INPUT_BUFFER_SIZE);
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputEof = false;
+	m_headerRead = false;
+	m_tags.clear();
+}
+
+/*
+ * Read next record from file.
+ */
+bool
+MarcBinaryReader::next(MarcRecord &record)
+{
+	// Read record view.
+	RecordView recordView;
+	if (!nextView(recordView)) {
+		return false;
+	}
+
+	// Copy record leader.
+	record.clear();
+	memcpy(&record.m_leader, recordView.m_leader,
+		sizeof(MarcRecord::Leader));
+
+	// Copy fields.
+	FieldView fieldView;
+	while (recordView.nextField(fieldView)) {
+		record.m_fieldList.push_back(MarcRecord::Field());
+		MarcRecord::Field &field = record.m_fieldList.back();
+		field.m_tag.assign(fieldView.tag, fieldView.tagLength);
+
+		if (fieldView.controlField) {
+			field.m_type = MarcRecord::Field::CONTROLFIELD;
+			field.m_data.assign(fieldView.data,
+				fieldView.dataLength);
+			continue;
+		}
+
+		field.m_type = MarcRecord::Field::DATAFIELD;
+		field.m_ind1 = fieldView.ind1;
+		field.m_ind2 = fieldView.ind2;
+
+		// Copy subfields.
+		SubfieldView subfieldView;
+		while (fieldView.nextSubfield(subfieldView)) {
+			field.m_subfieldList.push_back(
+				MarcRecord::Subfield(subfieldView.id));
+			field.m_subfieldList.back().m_data.assign(
+				subfieldView.data, subfieldView.dataLength);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Read next record from file without copying data.
+ */
+bool
+MarcBinaryReader::nextView(RecordView &recordView)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Read record.
+	const char *recordData;
+	size_t recordLen, numFields;
+	if (!readRecord(recordData, recordLen)) {
+		return false;
+	}
+
+	// Validate record.
+	if (!scanRecord(recordData, recordLen, numFields)) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record structure";
+		return false;
+	}
+
+	// Initialize record view.
+	recordView.m_leader = recordData;
+	recordView.m_numFields = numFields;
+	recordView.m_fieldPos = recordData + sizeof(MarcRecord::Leader);
+	recordView.m_fieldPos += varint_size(numFields);
+	recordView.m_recordEnd = recordData + recordLen;
+	recordView.m_tags = &m_tags;
+
+	return true;
+}
+
+/*
+ * Fill input buffer to make data of specified length available
+ * (returns length of available data).
+ */
+size_t
+MarcBinaryReader::fillInput(size_t dataLen)
+{
+	size_t availableLen = m_inputBufLen - m_inputBufPos;
+	if (availableLen >= dataLen || m_inputEof) {
+		return availableLen;
+	}
+
+	// Move unread data to the beginning of buffer.
+	memmove(&m_inputBuf[0], &m_inputBuf[0] + m_inputBufPos,
+		availableLen);
+	m_inputBufPos = 0;
+	m_inputBufLen = availableLen;
+
+	// Enlarge buffer for large record.
+	if (dataLen > m_inputBuf.size()) {
+		m_inputBuf.resize(dataLen);
+	}
+
+	// Read data from input.
+	while (m_inputBufLen < dataLen && !m_inputEof) {
+		size_t readLen = m_inputBuf.size() - m_inputBufLen;
+		size_t dataReadLen = m_input->read(&m_inputBuf[m_inputBufLen],
+			readLen);
+		m_inputBufLen += dataReadLen;
+		m_inputEof = dataReadLen < readLen;
+	}
+
+	return m_inputBufLen;
+}
+
+/*
+ * Read record from input buffer (data is valid until next read).
+ */
+bool
+MarcBinaryReader::readRecord(const char *&recordData, size_t &recordLen)
+{
+	// Check file header at the beginning of file.
+	if (!m_headerRead) {
+		m_headerRead = true;
+		size_t headerLen = fillInput(BINARY_MAGIC_SIZE);
+		if (headerLen > 0 && (headerLen < BINARY_MAGIC_SIZE
+			|| memcmp(&m_inputBuf[0], BINARY_MAGIC,
+			BINARY_MAGIC_SIZE) != 0))
+		{
+			m_inputBufPos = m_inputBufLen;
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage = "invalid binary file header";
+			return false;
+		}
+		m_inputBufPos += std::min(headerLen, (size_t) BINARY_MAGIC_SIZE);
+	}
+
+	// Read length of record.
+	size_t availableLen = fillInput(BINARY_MAX_VARINT_SIZE);
+	if (availableLen == 0) {
+		m_errorCode = END_OF_FILE;
+		m_errorMessage = "end of file";
+		return false;
+	}
+
+	unsigned long long value;
+	size_t lengthSize = decode_varint(&m_inputBuf[m_inputBufPos],
+		availableLen, value);
+	if (lengthSize == 0 || value < sizeof(MarcRecord::Leader) + 1
+		|| value > BINARY_MAX_RECORD_LENGTH)
+	{
+		// Records can't be separated after invalid length.
+		m_inputBufPos = m_inputBufLen;
+		m_inputEof = true;
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record length";
+		return false;
+	}
+	recordLen = (size_t) value;
+
+	// Read record data and checksum.
+	size_t totalLen = lengthSize + recordLen + BINARY_CHECKSUM_SIZE;
+	if (fillInput(totalLen) < totalLen) {
+		m_inputBufPos = m_inputBufLen;
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "record data incomplete";
+		return false;
+	}
+	recordData = &m_inputBuf[m_inputBufPos] + lengthSize;
+	m_inputBufPos += totalLen;
+
+	// Verify checksum of record.
+	if (load_uint32(recordData + recordLen)
+		!= crc32c(0, recordData, recordLen))
+	{
+		// Tags defined in damaged record are used by next records.
+		size_t numFields;
+		scanRecord(recordData, recordLen, numFields, true);
+
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "record checksum mismatch";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Validate record data and add new tags to dictionary (only fields are
+ * scanned in damaged record, tags found before error are kept).
+ */
+bool
+MarcBinaryReader::scanRecord(const char *recordData, size_t recordLen,
+	size_t &numFields, bool damaged)
+{
+	const char *pos = recordData + sizeof(MarcRecord::Leader);
+	const char *end = recordData + recordLen;
+	size_t numTags = m_tags.size();
+	unsigned long long value;
+	size_t valueSize;
+
+	// Decode number of fields.
+	valueSize = decode_varint(pos, end - pos, value);
+	if (valueSize == 0 || value > recordLen) {
+		return false;
+	}
+	pos += valueSize;
+	numFields = (size_t) value;
+
+	size_t fieldNo = 0;
+	for (; fieldNo < numFields; fieldNo++) {
+		// Decode field tag.
+		valueSize = decode_varint(pos, end - pos, value);
+		if (valueSize == 0 || value > m_tags.size()) {
+			break;
+		}
+		pos += valueSize;
+		if (value == 0) {
+			// Add new tag to dictionary.
+			valueSize = decode_varint(pos, end - pos, value);
+			if (valueSize == 0
+				|| value > (unsigned long long) (end - pos))
+			{
+				break;
+			}
+			pos += valueSize;
+			m_tags.push_back(std::string(pos, (size_t) value));
+			pos += (size_t) value;
+		}
+
+		// Check type and indicators of field.
+		if (pos >= end || (*pos != BINARY_FIELD_CONTROL
+			&& *pos != BINARY_FIELD_DATA))
+		{
+			break;
+		}
+		bool controlField = *(pos++) == BINARY_FIELD_CONTROL;
+		if (!controlField) {
+			if (end - pos < 2) {
+				break;
+			}
+			pos += 2;
+		}
+
+		// Check field data.
+		valueSize = decode_varint(pos, end - pos, value);
+		if (valueSize == 0
+			|| value > (unsigned long long) (end - pos - valueSize))
+		{
+			break;
+		}
+		pos += valueSize;
+		const char *fieldEnd = pos + (size_t) value;
+		if (controlField || damaged) {
+			pos = fieldEnd;
+		}
+
+		// Check subfields of data field.
+		while (pos < fieldEnd) {
+			valueSize = decode_varint(pos + 1, fieldEnd - pos - 1,
+				value);
+			if (valueSize == 0 || value > (unsigned long long)
+				(fieldEnd - pos - 1 - valueSize))
+			{
+				break;
+			}
+			pos += 1 + valueSize + (size_t) value;
+		}
+		if (pos != fieldEnd) {
+			break;
+		}
+	}
+
+	if (fieldNo < numFields || pos != end) {
+		// Remove tags of invalid record from dictionary.
+		if (!damaged) {
+			m_tags.resize(numTags);
+		}
+		return false;
+	}
+
+	return true;
+}
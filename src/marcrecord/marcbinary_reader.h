@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCBINARY_READER_H
+#define MARCRECORD_MARCBINARY_READER_H
+
+#include <string>
+#include <vector>
+#include "marc_reader.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * Binary records reader (records are read to MarcRecord or viewed without
+ * copying data).
+ */
+class MarcBinaryReader : public MarcReader {
+public:
+	/*
+	 * View of subfield.
+	 */
+	struct SubfieldView {
+		// Subfield identifier.
+		char id;
+		// Subfield data (UTF-8, not null-terminated).
+		const char *data;
+		// Length of subfield data.
+		size_t dataLength;
+	};
+	typedef struct SubfieldView SubfieldView;
+
+	/*
+	 * View of field.
+	 */
+	struct FieldView {
+		// Field tag (not null-terminated).
+		const char *tag;
+		// Length of field tag.
+		size_t tagLength;
+		// Control field flag.
+		bool controlField;
+		// Indicator 1 of data field.
+		char ind1;
+		// Indicator 2 of data field.
+		char ind2;
+		// Data of control field or encoded subfields of data field.
+		const char *data;
+		// Length of field data.
+		size_t dataLength;
+		// Position of next subfield in field data.
+		size_t subfieldPos;
+
+		// Get next subfield of data field.
+		bool nextSubfield(SubfieldView &subfield);
+	};
+	typedef struct FieldView FieldView;
+
+	/*
+	 * View of record (valid until next read).
+	 */
+	class RecordView {
+		friend class MarcBinaryReader;
+
+	protected:
+		// Record leader.
+		const char *m_leader;
+		// Number of fields.
+		size_t m_numFields;
+		// Position of next field.
+		const char *m_fieldPos;
+		// End of record data.
+		const char *m_recordEnd;
+		// Dictionary of field tags.
+		const std::vector<std::string> *m_tags;
+
+	public:
+		// Constructor.
+		RecordView();
+
+		// Get record leader.
+		const MarcRecord::Leader & getLeader(void);
+		// Get number of fields.
+		size_t getNumFields(void);
+		// Get next field.
+		bool nextField(FieldView &field);
+	};
+
+protected:
+	// Input buffer.
+	std::vector<char> m_inputBuf;
+	// Position of unread data in input buffer.
+	size_t m_inputBufPos;
+	// Length of data in input buffer.
+	size_t m_inputBufLen;
+	// End of input file reached flag.
+	bool m_inputEof;
+	// File header is read flag.
+	bool m_headerRead;
+
+	// Dictionary of field tags.
+	std::vector<std::string> m_tags;
+
+private:
+	// Fill input buffer to make data of specified length available
+	// (returns length of available data).
+	size_t fillInput(size_t dataLen);
+	// Read record from input buffer.
+	bool readRecord(const char *&recordData, size_t &recordLen);
+	// Validate record data and add new tags to dictionary.
+	bool scanRecord(const char *recordData, size_t recordLen,
+		size_t &numFields, bool damaged = false);
+
+public:
+	// Constructor.
+	MarcBinaryReader(FILE *inputFile = NULL,
+		const char *inputEncoding = NULL);
+	// Destructor.
+	~MarcBinaryReader();
+
+	// Open input file (data is always in UTF-8, encoding is ignored).
+	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Close input file.
+	void close(void);
+	// Read next record from file.
+	bool next(MarcRecord &record);
+	// Read next record from file without copying data.
+	bool nextView(RecordView &recordView);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCBINARY_READER_H
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcbinary_writer.h"
+
+namespace marcrecord {
+
+#define BINARY_MAGIC			"MARCBIN1"
+#define BINARY_MAGIC_SIZE		8
+#define BINARY_FIELD_CONTROL		0
+#define BINARY_FIELD_DATA		1
+#define BINARY_CHECKSUM_SIZE		4
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcBinaryWriter::MarcBinaryWriter(FILE *outputFile,
+	const char *outputEncoding)
+	: MarcWriter()
+{
+	// Clear member variables.
+
+	if (outputFile) {
+		// Open output file.
+		open(outputFile, outputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcBinaryWriter::~MarcBinaryWriter()
+{
+	// Close output file.
+	close();
+}
+
+/*
+ * Open output file (data is always in UTF-8, encoding is ignored).
+ */
+bool
+MarcBinaryWriter::open(FILE *outputFile, const char *outputEncoding)
+{
+	// Clear object state.
+	close();
+
+	// Initialize output stream parameters.
+	m_outputFile = outputFile == NULL ? stdout : outputFile;
+	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
+
+	return true;
+}
+
+/*
+ * Close output file.
+ */
+void
+MarcBinaryWriter::close(void)
+{
+	// Write buffered data to output.
+	closeOutput();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_outputFile = NULL;
+	m_outputEncoding = "";
+	m_numericTagRefs.assign(1000, 0);
+	m_tagRefs.clear();
+	m_numTags = 0;
+}
+
+/*
+ * Write record to binary file.
+ */
+bool
+MarcBinaryWriter::write(MarcRecord &record)
+{
+	// Calculate length of record data.
+	size_t recordLen = sizeof(MarcRecord::Leader)
+		+ varint_size(record.m_fieldList.size());
+	m_fieldTagRefs.clear();
+	m_fieldLengths.clear();
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		// Decode raw data of field.
+		if (!decodeField(*fieldIt)) {
+			return false;
+		}
+
+		// Length of field tag (defined inline or referenced).
+		unsigned int tagRef = getTagRef(fieldIt->m_tag);
+		m_fieldTagRefs.push_back(tagRef);
+		if (tagRef == 0) {
+			recordLen += 1 + varint_size(fieldIt->m_tag.size())
+				+ fieldIt->m_tag.size();
+		} else {
+			recordLen += varint_size(tagRef);
+		}
+
+		// Length of field data.
+		size_t fieldLength = 0;
+		if (fieldIt->m_type == MarcRecord::Field::CONTROLFIELD) {
+			fieldLength = fieldIt->m_data.size();
+			recordLen++;
+		} else {
+			MarcRecord::SubfieldIt subfieldIt =
+				fieldIt->m_subfieldList.begin();
+			for (; subfieldIt != fieldIt->m_subfieldList.end();
+				subfieldIt++)
+			{
+				fieldLength += 1
+					+ varint_size(subfieldIt->m_data.size())
+					+ subfieldIt->m_data.size();
+			}
+			recordLen += 3;
+		}
+		m_fieldLengths.push_back(fieldLength);
+		recordLen += varint_size(fieldLength) + fieldLength;
+	}
+	size_t totalLen = varint_size(recordLen) + recordLen
+		+ BINARY_CHECKSUM_SIZE;
+
+	// Encode record directly to output buffer (large records are
+	// encoded to separate buffer).
+	char *recordBuf;
+	if (totalLen <= MARC_WRITER_BUFFER_SIZE) {
+		recordBuf = reserveOutput(totalLen);
+		if (recordBuf == NULL) {
+			return false;
+		}
+	} else {
+		m_recordBuf.resize(totalLen);
+		recordBuf = &m_recordBuf[0];
+	}
+
+	char *recordData = recordBuf + encode_varint(recordBuf, recordLen);
+	encodeRecord(recordData, record);
+	store_uint32(recordData + recordLen, crc32c(0, recordData, recordLen));
+
+	if (totalLen <= MARC_WRITER_BUFFER_SIZE) {
+		commitOutput(totalLen);
+		return true;
+	}
+
+	return appendOutput(recordBuf, totalLen);
+}
+
+/*
+ * Write header to output file.
+ */
+bool
+MarcBinaryWriter::writeHeader(void)
+{
+	return appendOutput(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+}
+
+/*
+ * Get reference to tag in dictionary (0 if tag is added).
+ */
+unsigned int
+MarcBinaryWriter::getTagRef(const std::string &tag)
+{
+	// Numeric tags are looked up in array.
+	unsigned int tagNo;
+	if (tag.size() == 3 && parse_decimal(tag.data(), 3, tagNo)) {
+		unsigned int &tagRef = m_numericTagRefs[tagNo];
+		if (tagRef != 0) {
+			return tagRef;
+		}
+		tagRef = ++m_numTags;
+		return 0;
+	}
+
+	std::map<std::string, unsigned int>::iterator tagIt =
+		m_tagRefs.find(tag);
+	if (tagIt != m_tagRefs.end()) {
+		return tagIt->second;
+	}
+	m_tagRefs[tag] = ++m_numTags;
+
+	return 0;
+}
+
+/*
+ * Encode record data to buffer.
+ */
+char *
+MarcBinaryWriter::encodeRecord(char *recordBuf, MarcRecord &record)
+{
+	char *p = recordBuf;
+
+	// Copy record leader.
+	memcpy(p, (char *) &record.m_leader, sizeof(MarcRecord::Leader));
+	p += sizeof(MarcRecord::Leader);
+	p += encode_varint(p, record.m_fieldList.size());
+
+	// Encode fields.
+	size_t fieldNo = 0;
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++, fieldNo++)
+	{
+		// Encode field tag.
+		unsigned int tagRef = m_fieldTagRefs[fieldNo];
+		p += encode_varint(p, tagRef);
+		if (tagRef == 0) {
+			p += encode_varint(p, fieldIt->m_tag.size());
+			memcpy(p, fieldIt->m_tag.data(), fieldIt->m_tag.size());
+			p += fieldIt->m_tag.size();
+		}
+
+		if (fieldIt->m_type == MarcRecord::Field::CONTROLFIELD) {
+			// Encode control field.
+			*(p++) = BINARY_FIELD_CONTROL;
+			p += encode_varint(p, fieldIt->m_data.size());
+			memcpy(p, fieldIt->m_data.data(), fieldIt->m_data.size());
+			p += fieldIt->m_data.size();
+			continue;
+		}
+
+		// Encode indicators of data field.
+		*(p++) = BINARY_FIELD_DATA;
+		*(p++) = fieldIt->m_ind1;
+		*(p++) = fieldIt->m_ind2;
+		p += encode_varint(p, m_fieldLengths[fieldNo]);
+
+		// Encode subfields.
+		MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->m_subfieldList.begin();
+		for (; subfieldIt != fieldIt->m_subfieldList.end();
+			subfieldIt++)
+		{
+			*(p++) = subfieldIt->m_id;
+			p += encode_varint(p, subfieldIt->m_data.size());
+			memcpy(p, subfieldIt->m_data.data(),
+				subfieldIt->m_data.size());
+			p += subfieldIt->m_data.size();
+		}
+	}
+
+	return p;
+}
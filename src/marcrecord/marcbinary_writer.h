@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCBINARY_WRITER_H
+#define MARCRECORD_MARCBINARY_WRITER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "marc_writer.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * Binary records writer.
+ */
+class MarcBinaryWriter : public MarcWriter {
+protected:
+	// References to tags in dictionary (numeric tags).
+	std::vector<unsigned int> m_numericTagRefs;
+	// References to tags in dictionary (other tags).
+	std::map<std::string, unsigned int> m_tagRefs;
+	// Number of tags in dictionary.
+	unsigned int m_numTags;
+
+	// References to tags of fields in current record.
+	std::vector<unsigned int> m_fieldTagRefs;
+	// Lengths of data of fields in current record.
+	std::vector<size_t> m_fieldLengths;
+	// Buffer for records larger than output buffer.
+	std::vector<char> m_recordBuf;
+
+private:
+	// Get reference to tag in dictionary (0 if tag is added).
+	unsigned int getTagRef(const std::string &tag);
+	// Encode record data to buffer.
+	char *encodeRecord(char *recordBuf, MarcRecord &record);
+
+public:
+	// Constructor.
+	MarcBinaryWriter(FILE *outputFile = NULL,
+		const char *outputEncoding = NULL);
+	// Destructor.
+	~MarcBinaryWriter();
+
+	// Open output file (data is always in UTF-8, encoding is ignored).
+	bool open(FILE *outputFile, const char *outputEncoding = NULL);
+	// Close output file.
+	void close(void);
+	// Write record to output file.
+	bool write(MarcRecord &record);
+
+	// Write header to output file.
+	bool writeHeader(void);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCBINARY_WRITER_H
@@ -0,0 +1,965 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marccolumn_writer.h"
+
+namespace marcrecord {
+
+// Number of rows in Arrow record batch.
+#define ARROW_BATCH_ROWS		65536
+
+#define ARROW_MAGIC			"ARROW1"
+#define ARROW_MAGIC_SIZE		6
+#define ARROW_CONTINUATION		0xFFFFFFFF
+#define ARROW_METADATA_V5		4
+
+// Types of Arrow message headers.
+#define ARROW_HEADER_SCHEMA		1
+#define ARROW_HEADER_DICTIONARY_BATCH	2
+#define ARROW_HEADER_RECORD_BATCH	3
+
+// Arrow data type of string values.
+#define ARROW_TYPE_UTF8			5
+
+/*
+ * Builder of flatbuffers (objects are prepended, so children are built
+ * before parents; data is kept in reverse order until finished).
+ */
+class FlatBuilder {
+private:
+	// Reversed data of buffer.
+	std::string m_data;
+	// Maximal alignment of data.
+	size_t m_maxAlignment;
+	// Positions of fields of current table (from end, 0 if absent).
+	std::vector<size_t> m_fieldRefs;
+	// Position of current table end (from end of buffer).
+	size_t m_tableEnd;
+
+	// Add padding for alignment of data which follows.
+	void align(size_t alignment, size_t dataLen = 0);
+	// Prepend raw data.
+	void prependData(const char *data, size_t dataLen);
+	// Prepend little-endian scalar.
+	void prependScalar(unsigned long long value, size_t size);
+	// Prepend offset of object.
+	void prependOffset(size_t ref);
+
+public:
+	// Constructor.
+	FlatBuilder();
+
+	// Create string (returns reference to object).
+	size_t createString(const std::string &s);
+	// Create vector of structs from serialized data.
+	size_t createStructVector(const std::string &data, size_t numItems);
+	// Create vector of objects.
+	size_t createOffsetVector(const std::vector<size_t> &refs);
+
+	// Start table with specified number of fields.
+	void startTable(size_t numFields);
+	// Add scalar field to current table.
+	void addScalar(size_t field, unsigned long long value, size_t size);
+	// Add object field to current table.
+	void addOffset(size_t field, size_t ref);
+	// Finish current table (returns reference to object).
+	size_t endTable(void);
+
+	// Finish buffer with root object.
+	std::string finish(size_t rootRef);
+};
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+FlatBuilder::FlatBuilder()
+{
+	m_maxAlignment = 1;
+	m_tableEnd = 0;
+}
+
+/*
+ * Add padding for alignment of data which follows.
+ */
+void
+FlatBuilder::align(size_t alignment, size_t dataLen)
+{
+	if (alignment > m_maxAlignment) {
+		m_maxAlignment = alignment;
+	}
+	m_data.append((alignment - (m_data.size() + dataLen) % alignment)
+		% alignment, '\0');
+}
+
+/*
+ * Prepend raw data.
+ */
+void
+FlatBuilder::prependData(const char *data, size_t dataLen)
+{
+	for (size_t i = dataLen; i > 0; i--) {
+		m_data += data[i - 1];
+	}
+}
+
+/*
+ * Prepend little-endian scalar.
+ */
+void
+FlatBuilder::prependScalar(unsigned long long value, size_t size)
+{
+	align(size);
+	for (size_t i = size; i > 0; i--) {
+		m_data += (char) (value >> (8 * (i - 1)));
+	}
+}
+
+/*
+ * Prepend offset of object.
+ */
+void
+FlatBuilder::prependOffset(size_t ref)
+{
+	align(4);
+	prependScalar(m_data.size() + 4 - ref, 4);
+}
+
+/*
+ * Create string (returns reference to object).
+ */
+size_t
+FlatBuilder::createString(const std::string &s)
+{
+	align(4, s.size() + 1);
+	m_data += '\0';
+	prependData(s.data(), s.size());
+	prependScalar(s.size(), 4);
+
+	return m_data.size();
+}
+
+/*
+ * Create vector of structs from serialized data (structs are aligned
+ * to 8 bytes).
+ */
+size_t
+FlatBuilder::createStructVector(const std::string &data, size_t numItems)
+{
+	align(8, data.size());
+	prependData(data.data(), data.size());
+	prependScalar(numItems, 4);
+
+	return m_data.size();
+}
+
+/*
+ * Create vector of objects.
+ */
+size_t
+FlatBuilder::createOffsetVector(const std::vector<size_t> &refs)
+{
+	align(4, 4 * refs.size());
+	for (size_t i = refs.size(); i > 0; i--) {
+		prependOffset(refs[i - 1]);
+	}
+	prependScalar(refs.size(), 4);
+
+	return m_data.size();
+}
+
+/*
+ * Start table with specified number of fields.
+ */
+void
+FlatBuilder::startTable(size_t numFields)
+{
+	m_fieldRefs.assign(numFields, 0);
+	m_tableEnd = m_data.size();
+}
+
+/*
+ * Add scalar field to current table.
+ */
+void
+FlatBuilder::addScalar(size_t field, unsigned long long value, size_t size)
+{
+	prependScalar(value, size);
+	m_fieldRefs[field] = m_data.size();
+}
+
+/*
+ * Add object field to current table.
+ */
+void
+FlatBuilder::addOffset(size_t field, size_t ref)
+{
+	prependOffset(ref);
+	m_fieldRefs[field] = m_data.size();
+}
+
+/*
+ * Finish current table (returns reference to object).
+ */
+size_t
+FlatBuilder::endTable(void)
+{
+	// Prepend placeholder of vtable offset.
+	prependScalar(0, 4);
+	size_t tableRef = m_data.size();
+
+	// Prepend vtable (offsets of fields, size of table and vtable).
+	for (size_t i = m_fieldRefs.size(); i > 0; i--) {
+		prependScalar(m_fieldRefs[i - 1] == 0
+			? 0 : tableRef - m_fieldRefs[i - 1], 2);
+	}
+	prependScalar(tableRef - m_tableEnd, 2);
+	prependScalar(4 + 2 * m_fieldRefs.size(), 2);
+
+	// Store offset of vtable (it precedes table).
+	size_t vtableOffset = m_data.size() - tableRef;
+	for (size_t i = 0; i < 4; i++) {
+		m_data[tableRef - 1 - i] = (char) (vtableOffset >> (8 * i));
+	}
+
+	return tableRef;
+}
+
+/*
+ * Finish buffer with root object.
+ */
+std::string
+FlatBuilder::finish(size_t rootRef)
+{
+	align(m_maxAlignment, 4);
+	prependOffset(rootRef);
+
+	return std::string(m_data.rbegin(), m_data.rend());
+}
+
+/*
+ * Constructor.
+ */
+MarcColumnWriter::MarcColumnWriter(FILE *outputFile,
+	const char *outputEncoding)
+	: MarcWriter()
+{
+	// Clear member variables.
+	m_format = TABLE_CSV;
+	m_joinSeparator = "|";
+	m_batchRows = 0;
+	m_arrowOffset = 0;
+
+	if (outputFile) {
+		// Open output file.
+		open(outputFile, outputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcColumnWriter::~MarcColumnWriter()
+{
+	// Close output file.
+	close();
+}
+
+/*
+ * Open output file.
+ */
+bool
+MarcColumnWriter::open(FILE *outputFile, const char *outputEncoding)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Initialize output stream parameters.
+	m_outputFile = outputFile == NULL ? stdout : outputFile;
+	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
+	m_arrowColumns.clear();
+	m_batchRows = 0;
+	m_recordBatches.clear();
+	m_arrowOffset = 0;
+
+	// Initialize encoding conversion.
+	if (!m_encoder.open(outputEncoding)) {
+		m_errorCode = ERROR_ICONV;
+		if (errno == EINVAL) {
+			m_errorMessage = "encoding conversion is not supported";
+		} else {
+			m_errorMessage = "iconv initialization failed";
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Close output file.
+ */
+void
+MarcColumnWriter::close(void)
+{
+	// Write buffered data to output.
+	closeOutput();
+
+	// Finalize encoder.
+	m_encoder.close();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_outputFile = NULL;
+	m_outputEncoding = "";
+	m_format = TABLE_CSV;
+	m_columns.clear();
+	m_joinSeparator = "|";
+	m_arrowColumns.clear();
+	m_batchRows = 0;
+	m_recordBatches.clear();
+	m_arrowOffset = 0;
+}
+
+/*
+ * Write record to output file.
+ */
+bool
+MarcColumnWriter::write(MarcRecord &record)
+{
+	// Extract values of columns.
+	if (!extractValues(record)) {
+		return false;
+	}
+
+	if (m_format == TABLE_ARROW) {
+		return addArrowRow();
+	}
+
+	// Discard partially written row in case of error.
+	markOutput();
+	if (!appendTextRow()) {
+		rollbackOutput();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Set format of output table.
+ */
+void
+MarcColumnWriter::setTableFormat(TableFormat format)
+{
+	m_format = format;
+}
+
+/*
+ * Set columns from specification (comma-separated list of field tags
+ * with optional subfield identifiers, e.g. "001,200a,700$a").
+ */
+bool
+MarcColumnWriter::setColumns(const std::string &columnSpec)
+{
+	m_columns.clear();
+
+	size_t start = 0;
+	while (start <= columnSpec.size()) {
+		size_t end = columnSpec.find(',', start);
+		if (end == std::string::npos) {
+			end = columnSpec.size();
+		}
+
+		// Parse field tag and subfield identifier.
+		Column column;
+		column.name = columnSpec.substr(start, end - start);
+		column.tag = column.name.substr(0, 3);
+		column.subfieldId = 0;
+		size_t idPos = column.name.size() > 4 && column.name[3] == '$'
+			? 4 : 3;
+		if (column.name.size() == idPos + 1) {
+			column.subfieldId = column.name[idPos];
+		}
+		if (column.name.size() < 3 || (column.name.size() > 3
+			&& column.subfieldId == 0))
+		{
+			m_columns.clear();
+			m_errorCode = ERROR_PARAMETER;
+			m_errorMessage = "invalid column '" + column.name + "'";
+			return false;
+		}
+
+		m_columns.push_back(column);
+		start = end + 1;
+	}
+
+	m_values.resize(m_columns.size());
+	m_valuesPresent.resize(m_columns.size());
+
+	return true;
+}
+
+/*
+ * Set separator of repeated values.
+ */
+void
+MarcColumnWriter::setJoinSeparator(const std::string &joinSeparator)
+{
+	m_joinSeparator = joinSeparator;
+}
+
+/*
+ * Write header to output file (names of columns or Arrow schema).
+ */
+bool
+MarcColumnWriter::writeHeader(void)
+{
+	if (m_format == TABLE_ARROW) {
+		// Initialize dictionaries of columns.
+		m_arrowColumns.resize(m_columns.size());
+		for (size_t i = 0; i < m_arrowColumns.size(); i++) {
+			m_arrowColumns[i].dictionaryOffsets.assign(1, 0);
+			m_arrowColumns[i].nullCount = 0;
+		}
+
+		// Write file magic and schema message.
+		char magic[8] = ARROW_MAGIC;
+		if (!appendOutput(magic, sizeof(magic))) {
+			return false;
+		}
+		m_arrowOffset = sizeof(magic);
+
+		FlatBuilder builder;
+		size_t schema = buildArrowSchema(builder);
+		return appendArrowMessage(builder, ARROW_HEADER_SCHEMA, schema,
+			"", NULL);
+	}
+
+	// Write names of columns.
+	for (size_t i = 0; i < m_columns.size(); i++) {
+		m_values[i] = m_columns[i].name;
+	}
+
+	return appendTextRow();
+}
+
+/*
+ * Write footer to output file.
+ */
+bool
+MarcColumnWriter::writeFooter(void)
+{
+	if (m_format != TABLE_ARROW) {
+		return true;
+	}
+
+	// Write last record batch, dictionaries and footer.
+	return (m_batchRows == 0 || appendArrowRecordBatch())
+		&& appendArrowFooter();
+}
+
+/*
+ * Extract values of columns from record (only matching fields are
+ * decoded, repeated values are joined, false if decoding failed).
+ */
+bool
+MarcColumnWriter::extractValues(MarcRecord &record)
+{
+	for (size_t i = 0; i < m_columns.size(); i++) {
+		m_values[i].clear();
+		m_valuesPresent[i] = false;
+	}
+
+	MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+	for (; fieldIt != record.m_fieldList.end(); fieldIt++) {
+		bool decoded = false;
+
+		for (size_t i = 0; i < m_columns.size(); i++) {
+			const Column &column = m_columns[i];
+			if (fieldIt->m_tag != column.tag) {
+				continue;
+			}
+
+			// Decode raw data of field on first match.
+			if (!decoded) {
+				if (!decodeField(*fieldIt)) {
+					return false;
+				}
+				decoded = true;
+			}
+
+			std::string &value = m_values[i];
+			if (fieldIt->isControlField()) {
+				if (column.subfieldId == 0) {
+					if (m_valuesPresent[i]) {
+						value += m_joinSeparator;
+					}
+					value += fieldIt->m_data;
+					m_valuesPresent[i] = true;
+				}
+				continue;
+			}
+
+			// Append matching subfields (all subfields are
+			// separated by space if identifier is not specified).
+			bool fieldFound = false;
+			MarcRecord::SubfieldIt subfieldIt =
+				fieldIt->m_subfieldList.begin();
+			for (; subfieldIt != fieldIt->m_subfieldList.end();
+				subfieldIt++)
+			{
+				if (column.subfieldId != 0
+					&& subfieldIt->m_id != column.subfieldId)
+				{
+					continue;
+				}
+
+				if (column.subfieldId == 0 && fieldFound) {
+					value += ' ';
+				} else if (m_valuesPresent[i]) {
+					value += m_joinSeparator;
+				}
+				value += subfieldIt->m_data;
+				m_valuesPresent[i] = true;
+				fieldFound = true;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Append row of CSV or TSV table to output buffer.
+ */
+bool
+MarcColumnWriter::appendTextRow(void)
+{
+	const char *separator = m_format == TABLE_TSV ? "\t" : ",";
+
+	for (size_t i = 0; i < m_values.size(); i++) {
+		if ((i > 0 && !appendMarkup(separator))
+			|| !appendTextValue(m_values[i]))
+		{
+			return false;
+		}
+	}
+
+	return appendMarkup("\n");
+}
+
+/*
+ * Append value of CSV or TSV table to output buffer (CSV values are
+ * quoted if needed, special characters of TSV values are escaped).
+ */
+bool
+MarcColumnWriter::appendTextValue(const std::string &value)
+{
+	const char *special = m_format == TABLE_TSV ? "\t\n\r\\" : ",\"\n\r";
+	size_t pos = value.find_first_of(special);
+	if (pos == std::string::npos) {
+		return appendEncoded(value);
+	}
+
+	if (m_format == TABLE_CSV) {
+		// Quote value and double quotes inside.
+		if (!appendMarkup("\"")) {
+			return false;
+		}
+		size_t start = 0;
+		while ((pos = value.find('"', start)) != std::string::npos) {
+			if (!appendEncoded(value.data() + start, pos - start)
+				|| !appendMarkup("\"\""))
+			{
+				return false;
+			}
+			start = pos + 1;
+		}
+		return appendEncoded(value.data() + start, value.size() - start)
+			&& appendMarkup("\"");
+	}
+
+	// Escape special characters of TSV value.
+	size_t start = 0;
+	for (; pos != std::string::npos;
+		pos = value.find_first_of(special, start))
+	{
+		const char *escape = value[pos] == '\t' ? "\\t"
+			: value[pos] == '\n' ? "\\n"
+			: value[pos] == '\r' ? "\\r" : "\\\\";
+		if (!appendEncoded(value.data() + start, pos - start)
+			|| !appendMarkup(escape))
+		{
+			return false;
+		}
+		start = pos + 1;
+	}
+
+	return appendEncoded(value.data() + start, value.size() - start);
+}
+
+/*
+ * Add row to current Arrow record batch (values are added to dictionaries
+ * of columns).
+ */
+bool
+MarcColumnWriter::addArrowRow(void)
+{
+	size_t bitmapPos = m_batchRows / 8;
+	unsigned char bitmapMask = (unsigned char) (1 << (m_batchRows % 8));
+
+	for (size_t i = 0; i < m_arrowColumns.size(); i++) {
+		ArrowColumn &column = m_arrowColumns[i];
+		if (bitmapMask == 1) {
+			column.validity.push_back(0);
+		}
+
+		if (!m_valuesPresent[i]) {
+			column.indices.push_back(0);
+			column.nullCount++;
+			continue;
+		}
+
+		// Find value in dictionary or add it.
+		const std::string &value = m_values[i];
+		std::map<std::string, int>::iterator dictionaryIt =
+			column.dictionaryIndex.find(value);
+		int index;
+		if (dictionaryIt != column.dictionaryIndex.end()) {
+			index = dictionaryIt->second;
+		} else {
+			if (column.dictionaryData.size() + value.size()
+				> 0x7FFFFFFF)
+			{
+				m_errorCode = ERROR_DATASIZE;
+				m_errorMessage = "dictionary of column '"
+					+ m_columns[i].name + "' is too large";
+				return false;
+			}
+
+			index = (int) column.dictionaryIndex.size();
+			column.dictionaryIndex.insert(
+				std::make_pair(value, index));
+			column.dictionaryData += value;
+			column.dictionaryOffsets.push_back(
+				(int) column.dictionaryData.size());
+		}
+
+		column.indices.push_back(index);
+		column.validity[bitmapPos] |= bitmapMask;
+	}
+
+	// Write full record batch.
+	if (++m_batchRows == ARROW_BATCH_ROWS) {
+		return appendArrowRecordBatch();
+	}
+
+	return true;
+}
+
+/*
+ * Build Arrow schema in flatbuffer (string columns with int32 dictionary
+ * indices, dictionary id is number of column).
+ */
+size_t
+MarcColumnWriter::buildArrowSchema(FlatBuilder &builder)
+{
+	std::vector<size_t> fields;
+
+	for (size_t i = 0; i < m_columns.size(); i++) {
+		size_t name = builder.createString(m_columns[i].name);
+
+		// Build Utf8 and Int types.
+		builder.startTable(0);
+		size_t utf8Type = builder.endTable();
+		builder.startTable(2);
+		builder.addScalar(0, 32, 4);
+		builder.addScalar(1, 1, 1);
+		size_t indexType = builder.endTable();
+
+		// Build DictionaryEncoding.
+		builder.startTable(4);
+		builder.addScalar(0, i, 8);
+		builder.addOffset(1, indexType);
+		size_t dictionary = builder.endTable();
+
+		// Build Field.
+		size_t children = builder.createOffsetVector(
+			std::vector<size_t>());
+		builder.startTable(7);
+		builder.addOffset(0, name);
+		builder.addScalar(1, 1, 1);
+		builder.addScalar(2, ARROW_TYPE_UTF8, 1);
+		builder.addOffset(3, utf8Type);
+		builder.addOffset(4, dictionary);
+		builder.addOffset(5, children);
+		fields.push_back(builder.endTable());
+	}
+
+	// Build Schema.
+	size_t fieldsVector = builder.createOffsetVector(fields);
+	builder.startTable(4);
+	builder.addOffset(1, fieldsVector);
+
+	return builder.endTable();
+}
+
+/*
+ * Append Arrow IPC message to output buffer (location of message is
+ * stored to block if it is not NULL).
+ */
+bool
+MarcColumnWriter::appendArrowMessage(FlatBuilder &builder, size_t headerType,
+	size_t header, const std::string &body, ArrowBlock *block)
+{
+	// Build Message.
+	builder.startTable(5);
+	builder.addScalar(3, body.size(), 8);
+	builder.addOffset(2, header);
+	builder.addScalar(0, ARROW_METADATA_V5, 2);
+	builder.addScalar(1, headerType, 1);
+	std::string metadata = builder.finish(builder.endTable());
+	metadata.append((8 - metadata.size() % 8) % 8, '\0');
+
+	// Write message prefix, metadata and body.
+	char prefix[8];
+	store_uint32(prefix, ARROW_CONTINUATION);
+	store_uint32(prefix + 4, (unsigned int) metadata.size());
+	if (!appendOutput(prefix, sizeof(prefix))
+		|| !appendOutput(metadata.data(), metadata.size())
+		|| !appendOutput(body.data(), body.size()))
+	{
+		return false;
+	}
+
+	if (block != NULL) {
+		block->offset = m_arrowOffset;
+		block->metadataLength = sizeof(prefix) + metadata.size();
+		block->bodyLength = body.size();
+	}
+	m_arrowOffset += sizeof(prefix) + metadata.size() + body.size();
+
+	return true;
+}
+
+/*
+ * Append buffer to body of Arrow message (data is padded to 8 bytes,
+ * location of buffer is appended to list of buffers).
+ */
+static void
+appendArrowBuffer(std::string &body, std::string &buffers, const char *data,
+	size_t dataLen)
+{
+	char buffer[16];
+	store_uint64(buffer, body.size());
+	store_uint64(buffer + 8, dataLen);
+	buffers.append(buffer, sizeof(buffer));
+
+	body.append(data, dataLen);
+	body.append((8 - dataLen % 8) % 8, '\0');
+}
+
+/*
+ * Build Arrow RecordBatch in flatbuffer.
+ */
+static size_t
+buildArrowRecordBatch(FlatBuilder &builder, size_t length,
+	const std::string &nodes, const std::string &buffers)
+{
+	size_t nodesVector = builder.createStructVector(nodes,
+		nodes.size() / 16);
+	size_t buffersVector = builder.createStructVector(buffers,
+		buffers.size() / 16);
+	builder.startTable(5);
+	builder.addScalar(0, length, 8);
+	builder.addOffset(1, nodesVector);
+	builder.addOffset(2, buffersVector);
+
+	return builder.endTable();
+}
+
+/*
+ * Append current Arrow record batch to output buffer (dictionary indices
+ * with validity bitmaps).
+ */
+bool
+MarcColumnWriter::appendArrowRecordBatch(void)
+{
+	std::string body, nodes, buffers;
+
+	for (size_t i = 0; i < m_arrowColumns.size(); i++) {
+		ArrowColumn &column = m_arrowColumns[i];
+
+		// Add field node (length and number of nulls).
+		char node[16];
+		store_uint64(node, m_batchRows);
+		store_uint64(node + 8, column.nullCount);
+		nodes.append(node, sizeof(node));
+
+		// Add validity bitmap and little-endian indices.
+		appendArrowBuffer(body, buffers,
+			(const char *) &column.validity[0], column.validity.size());
+		std::string indices(4 * column.indices.size(), '\0');
+		for (size_t j = 0; j < column.indices.size(); j++) {
+			store_uint32(&indices[4 * j], column.indices[j]);
+		}
+		appendArrowBuffer(body, buffers, indices.data(),
+			indices.size());
+
+		// Clear batch data of column.
+		column.indices.clear();
+		column.validity.clear();
+		column.nullCount = 0;
+	}
+
+	// Write RecordBatch message.
+	FlatBuilder builder;
+	size_t recordBatch = buildArrowRecordBatch(builder, m_batchRows,
+		nodes, buffers);
+	m_recordBatches.push_back(ArrowBlock());
+	m_batchRows = 0;
+
+	return appendArrowMessage(builder, ARROW_HEADER_RECORD_BATCH,
+		recordBatch, body, &m_recordBatches.back());
+}
+
+/*
+ * Append Arrow dictionaries and file footer to output buffer.
+ */
+bool
+MarcColumnWriter::appendArrowFooter(void)
+{
+	std::vector<ArrowBlock> dictionaries(m_arrowColumns.size());
+
+	// Write DictionaryBatch messages.
+	for (size_t i = 0; i < m_arrowColumns.size(); i++) {
+		ArrowColumn &column = m_arrowColumns[i];
+		std::string body, nodes, buffers;
+		size_t length = column.dictionaryOffsets.size() - 1;
+
+		// Add field node and buffers of string array (no validity
+		// bitmap, offsets, data).
+		char node[16];
+		store_uint64(node, length);
+		store_uint64(node + 8, 0);
+		nodes.append(node, sizeof(node));
+		appendArrowBuffer(body, buffers, "", 0);
+		std::string offsets(4 * column.dictionaryOffsets.size(), '\0');
+		for (size_t j = 0; j < column.dictionaryOffsets.size(); j++) {
+			store_uint32(&offsets[4 * j],
+				column.dictionaryOffsets[j]);
+		}
+		appendArrowBuffer(body, buffers, offsets.data(),
+			offsets.size());
+		appendArrowBuffer(body, buffers, column.dictionaryData.data(),
+			column.dictionaryData.size());
+
+		FlatBuilder builder;
+		size_t recordBatch = buildArrowRecordBatch(builder, length,
+			nodes, buffers);
+		builder.startTable(3);
+		builder.addScalar(0, i, 8);
+		builder.addOffset(1, recordBatch);
+		size_t dictionaryBatch = builder.endTable();
+		if (!appendArrowMessage(builder, ARROW_HEADER_DICTIONARY_BATCH,
+			dictionaryBatch, body, &dictionaries[i]))
+		{
+			return false;
+		}
+	}
+
+	// Write end of stream marker.
+	char eos[8];
+	store_uint32(eos, ARROW_CONTINUATION);
+	store_uint32(eos + 4, 0);
+	if (!appendOutput(eos, sizeof(eos))) {
+		return false;
+	}
+
+	// Build Footer with locations of messages.
+	std::string dictionaryBlocks, recordBatchBlocks;
+	for (size_t i = 0; i < dictionaries.size()
+		+ m_recordBatches.size(); i++)
+	{
+		const ArrowBlock &block = i < dictionaries.size()
+			? dictionaries[i]
+			: m_recordBatches[i - dictionaries.size()];
+		char blockData[24];
+		store_uint64(blockData, block.offset);
+		store_uint32(blockData + 8, block.metadataLength);
+		store_uint32(blockData + 12, 0);
+		store_uint64(blockData + 16, block.bodyLength);
+		(i < dictionaries.size() ? dictionaryBlocks
+			: recordBatchBlocks).append(blockData,
+			sizeof(blockData));
+	}
+
+	FlatBuilder builder;
+	size_t schema = buildArrowSchema(builder);
+	size_t dictionariesVector = builder.createStructVector(
+		dictionaryBlocks, dictionaries.size());
+	size_t recordBatchesVector = builder.createStructVector(
+		recordBatchBlocks, m_recordBatches.size());
+	builder.startTable(5);
+	builder.addOffset(1, schema);
+	builder.addOffset(2, dictionariesVector);
+	builder.addOffset(3, recordBatchesVector);
+	builder.addScalar(0, ARROW_METADATA_V5, 2);
+	std::string footer = builder.finish(builder.endTable());
+
+	// Write footer, its length and file magic.
+	char trailer[4 + ARROW_MAGIC_SIZE];
+	store_uint32(trailer, (unsigned int) footer.size());
+	memcpy(trailer + 4, ARROW_MAGIC, ARROW_MAGIC_SIZE);
+	if (!appendOutput(footer.data(), footer.size())
+		|| !appendOutput(trailer, sizeof(trailer)))
+	{
+		return false;
+	}
+	m_arrowOffset += sizeof(eos) + footer.size() + sizeof(trailer);
+
+	return true;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCCOLUMN_WRITER_H
+#define MARCRECORD_MARCCOLUMN_WRITER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "marc_writer.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+// Builder of flatbuffers for Arrow IPC metadata.
+class FlatBuilder;
+
+/*
+ * Columnar writer of selected fields and subfields (CSV, TSV or Arrow IPC
+ * file with dictionary-encoded columns).
+ */
+class MarcColumnWriter : public MarcWriter {
+public:
+	// Formats of output table.
+	enum TableFormat {
+		TABLE_CSV,
+		TABLE_TSV,
+		TABLE_ARROW
+	};
+
+	/*
+	 * Column of output table.
+	 */
+	struct Column {
+		// Column name (field specification).
+		std::string name;
+		// Field tag.
+		std::string tag;
+		// Subfield identifier (0 for whole field).
+		char subfieldId;
+	};
+	typedef struct Column Column;
+
+private:
+	/*
+	 * Dictionary-encoded Arrow column.
+	 */
+	struct ArrowColumn {
+		// Index of dictionary values.
+		std::map<std::string, int> dictionaryIndex;
+		// Data of dictionary values.
+		std::string dictionaryData;
+		// Offsets of dictionary values (with end of last value).
+		std::vector<int> dictionaryOffsets;
+		// Dictionary indices of values in current batch.
+		std::vector<int> indices;
+		// Validity bitmap of values in current batch.
+		std::vector<unsigned char> validity;
+		// Number of null values in current batch.
+		int nullCount;
+	};
+	typedef struct ArrowColumn ArrowColumn;
+
+	/*
+	 * Location of Arrow IPC message in file.
+	 */
+	struct ArrowBlock {
+		// Offset of message.
+		unsigned long long offset;
+		// Length of message metadata (with prefix and padding).
+		unsigned int metadataLength;
+		// Length of message body.
+		unsigned long long bodyLength;
+	};
+	typedef struct ArrowBlock ArrowBlock;
+
+protected:
+	// Format of output table.
+	TableFormat m_format;
+	// Columns of output table.
+	std::vector<Column> m_columns;
+	// Separator of repeated values.
+	std::string m_joinSeparator;
+
+	// Values of current row.
+	std::vector<std::string> m_values;
+	// Presence flags of values of current row.
+	std::vector<bool> m_valuesPresent;
+
+	// Arrow columns.
+	std::vector<ArrowColumn> m_arrowColumns;
+	// Number of rows in current record batch.
+	size_t m_batchRows;
+	// Written record batches.
+	std::vector<ArrowBlock> m_recordBatches;
+	// Offset of next message in Arrow file.
+	unsigned long long m_arrowOffset;
+
+private:
+	// Extract values of columns from record (only matching fields are
+	// decoded, false if decoding failed).
+	bool extractValues(MarcRecord &record);
+	// Append row of CSV or TSV table to output buffer.
+	bool appendTextRow(void);
+	// Append value of CSV or TSV table to output buffer.
+	bool appendTextValue(const std::string &value);
+
+	// Add row to current Arrow record batch.
+	bool addArrowRow(void);
+	// Build Arrow schema in flatbuffer.
+	size_t buildArrowSchema(FlatBuilder &builder);
+	// Append Arrow IPC message to output buffer.
+	bool appendArrowMessage(FlatBuilder &builder, size_t headerType,
+		size_t header, const std::string &body, ArrowBlock *block);
+	// Append current Arrow record batch to output buffer.
+	bool appendArrowRecordBatch(void);
+	// Append Arrow dictionaries and file footer to output buffer.
+	bool appendArrowFooter(void);
+
+public:
+	// Constructor.
+	MarcColumnWriter(FILE *outputFile = NULL,
+		const char *outputEncoding = NULL);
+	// Destructor.
+	~MarcColumnWriter();
+
+	// Open output file.
+	bool open(FILE *outputFile, const char *outputEncoding = NULL);
+	// Close output file.
+	void close(void);
+	// Write record to output file.
+	bool write(MarcRecord &record);
+
+	// Set format of output table.
+	void setTableFormat(TableFormat format);
+	// Set columns from specification (e.g. "001,200a,700$a").
+	bool setColumns(const std::string &columnSpec);
+	// Set separator of repeated values.
+	void setJoinSeparator(const std::string &joinSeparator);
+
+	// Write header to output file.
+	bool writeHeader(void);
+	// Write footer to output file.
+	bool writeFooter(void);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCCOLUMN_WRITER_H
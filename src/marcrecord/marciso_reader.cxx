@@ -26,9 +26,13 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
+#include <vector>
+#include "marc_codec_cache.h"
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
 #include "marciso_reader.h"
@@ -39,6 +43,9 @@ namespace marcrecord {
 #define ISO2709_FIELD_SEPARATOR		'\x1E'
 #define ISO2709_IDENTIFIER_DELIMITER	'\x1F'
 
+#define ISO2709_MAX_RECORD_LENGTH	99999
+#define ISO2709_INPUT_BUFFER_SIZE	262144
+
 #pragma pack(1)
 
 /* Structure of record directory entry. */
@@ -66,6 +73,12 @@ MarcIsoReader::MarcIsoReader(FILE *inputFile, const char *inputEncoding)
 {
 	// Clear member variables.
 	m_iconvDesc = (iconv_t) -1;
+	m_lazyMode = false;
+	m_inputBuf.resize(ISO2709_INPUT_BUFFER_SIZE);
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
 
 	if (inputFile) {
 		// Open input file.
@@ -98,6 +111,11 @@ MarcIsoReader::open(FILE *inputFile, const char *inputEncoding)
 	// Initialize input stream parameters.
 	m_inputFile = inputFile == NULL ? stdin : inputFile;
 	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+	openInput(m_inputFile);
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
 
 	// Initialize encoding conversion.
 	if (inputEncoding == NULL
@@ -107,7 +125,7 @@ MarcIsoReader::open(FILE *inputFile, const char *inputEncoding)
 		m_iconvDesc = (iconv_t) -1;
 	} else {
 		// Create iconv descriptor for input encoding conversion.
-		m_iconvDesc = iconv_open("UTF-8", inputEncoding);
+		m_iconvDesc = acquire_iconv("UTF-8", inputEncoding);
 		if (m_iconvDesc == (iconv_t) -1) {
 			m_errorCode = ERROR_ICONV;
 			if (errno == EINVAL) {
@@ -129,18 +147,79 @@ MarcIsoReader::open(FILE *inputFile, const char *inputEncoding)
 void
 MarcIsoReader::close(void)
 {
-	// Finalize iconv.
-	if (m_iconvDesc != (iconv_t) -1) {
-		iconv_close(m_iconvDesc);
-	}
+	// Return iconv descriptor to cache.
+	release_iconv(m_iconvDesc, "UTF-8", m_inputEncoding.c_str());
 
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_inputFile = NULL;
+	m_input = NULL;
 	m_inputEncoding = "";
 	m_iconvDesc = (iconv_t) -1;
 	m_autoCorrectionMode = false;
+	m_lazyMode = false;
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
+}
+
+/*
+ * Reset state of reading to start new input from input source.
+ */
+bool
+MarcIsoReader::reset(void)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Discard buffered data.
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
+
+	return true;
+}
+
+/*
+ * Get position in input after last read record.
+ */
+unsigned long long
+MarcIsoReader::getInputPos(void)
+{
+	return m_inputBufStart + m_inputBufPos;
+}
+
+/*
+ * Set position in input (at start of record).
+ */
+bool
+MarcIsoReader::seekInput(unsigned long long inputPos)
+{
+	if (!m_input->seek(inputPos)) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "input file is not seekable";
+		return false;
+	}
+
+	// Discard buffered data.
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = inputPos;
+	m_inputEof = false;
+	return true;
+}
+
+/*
+ * Set lazy mode (fields are decoded on first access).
+ */
+void
+MarcIsoReader::setLazyMode(bool lazyMode)
+{
+	m_lazyMode = lazyMode;
 }
 
 /*
@@ -149,29 +228,130 @@ MarcIsoReader::close(void)
 bool
 MarcIsoReader::next(MarcRecord &record)
 {
-	int symbol;
-	char recordBuf[100000];
 	unsigned int recordLen;
 
+	// Read record.
+	if (!readRecordTimed(recordLen)) {
+		return false;
+	}
+
+	// Parse record.
+	return parse(m_recordBuf, recordLen, record);
+}
+
+/*
+ * Read next record from file without parsing (only leader and directory
+ * are validated).
+ */
+bool
+MarcIsoReader::nextRaw(const char *&recordBuf, unsigned int &recordLen)
+{
+	// Read record.
+	if (!readRecordTimed(recordLen)) {
+		return false;
+	}
+
+	// Validate record leader and directory.
+	recordBuf = m_recordBuf;
+	return validate(m_recordBuf, recordLen);
+}
+
+/*
+ * Fill input buffer with data from file.
+ */
+bool
+MarcIsoReader::fillInputBuffer(void)
+{
+	if (m_inputEof) {
+		return false;
+	}
+
+	// Read next block of data from file.
+	m_inputBufStart += m_inputBufLen;
+	m_inputBufPos = 0;
+	m_inputBufLen = m_input->read(&m_inputBuf[0], m_inputBuf.size());
+	if (m_inputBufLen == 0) {
+		m_inputEof = true;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read data from input buffer.
+ */
+size_t
+MarcIsoReader::readInput(char *buf, size_t bufLen)
+{
+	size_t readLen = 0;
+
+	while (readLen < bufLen) {
+		// Refill input buffer when it is empty.
+		if (m_inputBufPos == m_inputBufLen && !fillInputBuffer()) {
+			break;
+		}
+
+		// Copy available data from input buffer.
+		size_t chunkLen = std::min(bufLen - readLen,
+			m_inputBufLen - m_inputBufPos);
+		memcpy(buf + readLen, &m_inputBuf[m_inputBufPos], chunkLen);
+		m_inputBufPos += chunkLen;
+		readLen += chunkLen;
+	}
+
+	return readLen;
+}
+
+/*
+ * Skip input data until record separator.
+ */
+void
+MarcIsoReader::skipRecord(void)
+{
+	for (;;) {
+		// Refill input buffer when it is empty.
+		if (m_inputBufPos == m_inputBufLen && !fillInputBuffer()) {
+			break;
+		}
+
+		// Search record separator in input buffer.
+		const char *chunk = &m_inputBuf[m_inputBufPos];
+		size_t chunkLen = m_inputBufLen - m_inputBufPos;
+		const char *separator = static_cast<const char *>(
+			memchr(chunk, ISO2709_RECORD_SEPARATOR, chunkLen));
+		if (separator != NULL) {
+			m_inputBufPos += separator - chunk + 1;
+			break;
+		}
+		m_inputBufPos = m_inputBufLen;
+	}
+}
+
+/*
+ * Read record from file to the record buffer.
+ */
+bool
+MarcIsoReader::readRecord(unsigned int &recordLen)
+{
+	char *recordBuf = m_recordBuf;
+
 	// Clear error code and message.
 	m_errorCode = OK;
 	m_errorMessage = "";
 
 	if (!m_autoCorrectionMode) {
 		// Read record length.
-		if (fread(recordBuf, 1, 5, m_inputFile) != 5) {
+		if (readInput(recordBuf, 5) != 5) {
 			m_errorCode = END_OF_FILE;
 			return false;
 		}
 
 		// Parse record length.
-		if (!is_numeric(recordBuf, 5)
-			|| sscanf(recordBuf, "%5u", &recordLen) != 1)
+		if (!parse_decimal(recordBuf, 5, recordLen) || recordLen < 5)
 		{
 			// Skip until record separator.
-			do {
-				symbol = fgetc(m_inputFile);
-			} while (symbol >= 0 && symbol != ISO2709_RECORD_SEPARATOR);
+			skipRecord();
 
 			m_errorCode = ERROR_INVALID_RECORD;
 			m_errorMessage = "invalid record length";
@@ -179,13 +359,9 @@ MarcIsoReader::next(MarcRecord &record)
 		}
 
 		// Read record.
-		if (fread(recordBuf + 5, 1, recordLen - 5, m_inputFile)
-			!= recordLen - 5)
-		{
+		if (readInput(recordBuf + 5, recordLen - 5) != recordLen - 5) {
 			// Skip until record separator.
-			do {
-				symbol = fgetc(m_inputFile);
-			} while (!feof(m_inputFile) && symbol != ISO2709_RECORD_SEPARATOR);
+			skipRecord();
 
 			m_errorCode = ERROR_INVALID_RECORD;
 			m_errorMessage =
@@ -194,35 +370,97 @@ MarcIsoReader::next(MarcRecord &record)
 		}
 	} else {
 		// Read record until record separator.
-		char* recordBufPtr = recordBuf;
+		bool separatorFound = false;
+		bool significantData = false;
 		recordLen = 0;
-		do {
-			symbol = fgetc(m_inputFile);
-			if (!feof(m_inputFile)) {
-				*recordBufPtr = static_cast<char>(symbol);
-				recordBufPtr++;
-				recordLen++;
+		while (!separatorFound) {
+			// Refill input buffer when it is empty.
+			if (m_inputBufPos == m_inputBufLen && !fillInputBuffer()) {
+				break;
+			}
+
+			// Search record separator in input buffer.
+			const char *chunk = &m_inputBuf[m_inputBufPos];
+			size_t chunkLen = m_inputBufLen - m_inputBufPos;
+			const char *separator = static_cast<const char *>(
+				memchr(chunk, ISO2709_RECORD_SEPARATOR, chunkLen));
+			if (separator != NULL) {
+				chunkLen = separator - chunk + 1;
+				separatorFound = true;
 			}
-		} while (!feof(m_inputFile) && symbol != ISO2709_RECORD_SEPARATOR);
+			m_inputBufPos += chunkLen;
 
-		if (feof(m_inputFile)) {
+			// Check for data other than line breaks and spaces.
+			for (size_t i = 0; !significantData && i < chunkLen; i++) {
+				significantData = !isspace((unsigned char) chunk[i]);
+			}
+
+			// Append data to the record buffer (excess is dropped).
+			if (recordLen < ISO2709_MAX_RECORD_LENGTH) {
+				size_t copyLen = std::min(chunkLen,
+					(size_t) (ISO2709_MAX_RECORD_LENGTH - recordLen));
+				memcpy(recordBuf + recordLen, chunk, copyLen);
+			}
+			recordLen = (unsigned int) std::min(recordLen + chunkLen,
+				(size_t) ISO2709_MAX_RECORD_LENGTH + 1);
+		}
+
+		if (!separatorFound) {
 			m_errorCode = END_OF_FILE;
+			if (significantData) {
+				// Report truncated record at the end of file.
+				m_errorCode = ERROR_INVALID_RECORD;
+				m_errorMessage = "record data incomplete";
+			}
 			return false;
 		}
- 		if (recordLen == 0) {
+		if (recordLen > ISO2709_MAX_RECORD_LENGTH) {
 			m_errorCode = ERROR_INVALID_RECORD;
-			m_errorMessage = "invalid record length";
+			m_errorMessage = "record is too long";
 			return false;
- 		}
+		}
 
 		// Replace record length.
-		char lengthBuf[6];
-		sprintf(lengthBuf, "%05d", recordLen);
-		memcpy(recordBuf, lengthBuf, 5);
+		format_decimal(recordBuf, 5, recordLen);
 	}
 
-	// Parse record.
-	return parse(recordBuf, recordLen, record);
+	return true;
+}
+
+/*
+ * Read record to the record buffer (time is counted in statistics).
+ */
+bool
+MarcIsoReader::readRecordTimed(unsigned int &recordLen)
+{
+	if (m_stats == NULL) {
+		return readRecord(recordLen);
+	}
+
+	unsigned long long startTime = get_time_ns();
+	bool result = readRecord(recordLen);
+	m_stats->frameTime += get_time_ns() - startTime;
+	return result;
+}
+
+/*
+ * Validate record leader and directory in ISO 2709 buffer.
+ */
+bool
+MarcIsoReader::validate(const char *recordBuf, unsigned int recordBufLen)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	try {
+		// Parse record leader and directory.
+		parseDirectory(recordBuf, recordBufLen);
+	} catch (ErrorCode errorCode) {
+		return false;
+	}
+
+	return true;
 }
 
 /*
@@ -240,17 +478,8 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 	record.clear();
 
 	try {
-		// Check record length.
-		unsigned int recordLen;
-		if (!is_numeric(recordBuf, 5)
-			|| sscanf(recordBuf, "%5u", &recordLen) != 1
-			|| recordLen != recordBufLen
-			|| recordLen < sizeof(MarcRecord::Leader))
-		{
-			m_errorCode = ERROR_INVALID_RECORD;
-			m_errorMessage = "invalid record length";
-			throw m_errorCode;
-		}
+		// Parse record leader and directory.
+		parseDirectory(recordBuf, recordBufLen);
 
 		// Copy record leader.
 		memcpy(&record.m_leader, recordBuf,
@@ -270,157 +499,217 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 			}
 		}
 
-		// Get base address of data.
-		unsigned int baseAddress;
-		if (!m_autoCorrectionMode) {
-			if (!is_numeric(record.m_leader.baseAddress, 5)
-				|| sscanf(record.m_leader.baseAddress, "%05u",
-					&baseAddress) != 1
-				|| recordLen < baseAddress)
-			{
-				m_errorCode = ERROR_INVALID_RECORD;
-				m_errorMessage = "invalid base address of data";
-				throw m_errorCode;
-			}
-		} else {
-			baseAddress = 24;
-			while (baseAddress < recordLen -1
-				&& recordBuf[baseAddress] != ISO2709_FIELD_SEPARATOR)
-			{
-				baseAddress++;
-			}
-			if (recordBuf[baseAddress] != ISO2709_FIELD_SEPARATOR) {
-				m_errorCode = ERROR_INVALID_RECORD;
-				m_errorMessage = "base address of data cannot be found";
-				throw m_errorCode;
-			}
-			baseAddress++;
+		// Build index of delimiters in data (if it isn't built yet).
+		if (!m_lazyMode && !m_autoCorrectionMode) {
+			scan_delimiters(recordBuf, m_baseAddress, recordBufLen,
+				m_delimiters);
 		}
 
-		// Get number of fields.
-		int numFields = (baseAddress - sizeof(MarcRecord::Leader) - 1)
-			/ sizeof(RecordDirectoryEntry);
-		if (recordLen < sizeof(MarcRecord::Leader)
-			+ (sizeof(RecordDirectoryEntry) * numFields))
+		// Parse list of fields.
+		std::vector<FieldEntry>::iterator fieldEntryIt =
+			m_fieldEntries.begin();
+		for (; fieldEntryIt != m_fieldEntries.end(); fieldEntryIt++) {
+			std::string fieldTag(recordBuf + fieldEntryIt->tagPos, 3);
+
+			// Append field to list and parse it.
+			record.m_fieldList.push_back(MarcRecord::Field());
+			parseField(record.m_fieldList.back(), fieldTag,
+				recordBuf + fieldEntryIt->startPos,
+				fieldEntryIt->length, fieldEntryIt->startPos);
+		}
+	} catch (ErrorCode errorCode) {
+		record.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Parse record leader and directory from ISO 2709 buffer.
+ */
+void
+MarcIsoReader::parseDirectory(const char *recordBuf,
+	unsigned int recordBufLen)
+{
+	// Clear list of directory entries.
+	m_fieldEntries.clear();
+
+	// Check record length.
+	unsigned int recordLen;
+	if (!parse_decimal(recordBuf, 5, recordLen)
+		|| recordLen != recordBufLen
+		|| recordLen < sizeof(MarcRecord::Leader))
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record length";
+		throw m_errorCode;
+	}
+
+	// Get base address of data.
+	unsigned int baseAddress;
+	std::vector<unsigned int>::const_iterator delimiterIt;
+	if (!m_autoCorrectionMode) {
+		if (!parse_decimal(recordBuf + 12, 5, baseAddress)
+			|| baseAddress <= sizeof(MarcRecord::Leader)
+			|| recordLen < baseAddress)
 		{
 			m_errorCode = ERROR_INVALID_RECORD;
-			m_errorMessage = "invalid record length";
+			m_errorMessage = "invalid base address of data";
 			throw m_errorCode;
 		}
+	} else {
+		// Build index of delimiters in directory and data.
+		scan_delimiters(recordBuf, sizeof(MarcRecord::Leader), recordLen,
+			m_delimiters);
+
+		// Find field separator at the end of directory.
+		delimiterIt = findFieldSeparator(recordBuf,
+			m_delimiters.begin(), m_delimiters.end());
+		if (delimiterIt == m_delimiters.end()) {
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage = "base address of data cannot be found";
+			throw m_errorCode;
+		}
+		baseAddress = *(delimiterIt++) + 1;
+	}
+	m_baseAddress = baseAddress;
 
-		// Parse list of fields.
-		RecordDirectoryEntry *directoryEntry = 
-			(RecordDirectoryEntry *) (recordBuf
-			+ sizeof(MarcRecord::Leader));
-		const char *recordData = recordBuf + baseAddress;
-		unsigned int recordDataPos = baseAddress;
-		int fieldNo = 0;
-		for (; fieldNo < numFields; fieldNo++, directoryEntry++) {
-			std::string fieldTag(directoryEntry->fieldTag, 0, 3);
-			unsigned int fieldLength, fieldStartPos;
-			if (!m_autoCorrectionMode) {
-				// Check directory entry.
-				if (!is_numeric((const char *) directoryEntry,
-					sizeof(RecordDirectoryEntry)))
-				{
-					std::string errorPos;
-					snprintf(errorPos, 11, "%d",
-						(char *) directoryEntry - recordBuf);
-
-					m_errorCode = ERROR_INVALID_RECORD;
-					m_errorMessage = "invalid directory entry at "
-						+ errorPos;
-					throw m_errorCode;
-				}
-
-				// Parse directory entry.
-				if (sscanf(directoryEntry->fieldLength, "%4u%5u",
-					&fieldLength, &fieldStartPos) != 2)
-				{
-					std::string errorPos;
-					snprintf(errorPos, 11, "%d",
-						(char *) directoryEntry->fieldLength
-						- recordBuf);
-
-					m_errorCode = ERROR_INVALID_RECORD;
-					m_errorMessage = 
-						"invalid base address of data at "
-						+ errorPos;
-					throw m_errorCode;
-				}
-			} else {
-				fieldStartPos = recordDataPos - baseAddress;
-				while (recordDataPos < recordLen -1
-					&& recordBuf[recordDataPos] != ISO2709_FIELD_SEPARATOR)
-				{
-					recordDataPos++;
-				}
-				if (recordBuf[recordDataPos] != ISO2709_FIELD_SEPARATOR) {
-					break;
-				}
-				fieldLength = recordDataPos - baseAddress - fieldStartPos + 1;
-				recordDataPos++;
-			}
+	// Get number of fields.
+	int numFields = (baseAddress - sizeof(MarcRecord::Leader) - 1)
+		/ sizeof(RecordDirectoryEntry);
+	if (recordLen < sizeof(MarcRecord::Leader)
+		+ (sizeof(RecordDirectoryEntry) * numFields))
+	{
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record length";
+		throw m_errorCode;
+	}
 
-			// Check field starting position and length.
-			unsigned int fieldEndPos =
-			       baseAddress + fieldStartPos + fieldLength;
-			if (fieldEndPos > recordLen
-				|| (fieldTag < "010" && fieldLength < 2))
+	// Parse list of directory entries.
+	RecordDirectoryEntry *directoryEntry = 
+		(RecordDirectoryEntry *) (recordBuf
+		+ sizeof(MarcRecord::Leader));
+	unsigned int recordDataPos = baseAddress;
+	int fieldNo = 0;
+	for (; fieldNo < numFields; fieldNo++, directoryEntry++) {
+		std::string fieldTag(directoryEntry->fieldTag, 3);
+		unsigned int fieldLength, fieldStartPos;
+		if (!m_autoCorrectionMode) {
+			// Check directory entry.
+			if (!is_numeric((const char *) directoryEntry,
+				sizeof(RecordDirectoryEntry)))
 			{
 				std::string errorPos;
-				if (!m_autoCorrectionMode) {
-					snprintf(errorPos, 11, "%d",
-						(char *) directoryEntry->fieldLength
-						- recordBuf);
-				} else {
-					snprintf(errorPos, 11, "%d",
-						fieldStartPos);
-				}
+				snprintf(errorPos, 11, "%d",
+					(char *) directoryEntry - recordBuf);
 
 				m_errorCode = ERROR_INVALID_RECORD;
-				m_errorMessage = "invalid field starting "
-					"position or length at " + errorPos;
+				m_errorMessage = "invalid directory entry at "
+					+ errorPos;
 				throw m_errorCode;
 			}
 
-			// Check data field length.
-			if (fieldTag < "010" && fieldLength < 2) {
+			// Parse directory entry.
+			if (!parse_decimal(directoryEntry->fieldLength, 4,
+					fieldLength)
+				|| !parse_decimal(
+					directoryEntry->fieldStartingPosition, 5,
+					fieldStartPos))
+			{
 				std::string errorPos;
 				snprintf(errorPos, 11, "%d",
 					(char *) directoryEntry->fieldLength
 					- recordBuf);
 
 				m_errorCode = ERROR_INVALID_RECORD;
-				m_errorMessage = "invalid length of data field"
-					" at " + errorPos;
+				m_errorMessage = 
+					"invalid base address of data at "
+					+ errorPos;
 				throw m_errorCode;
 			}
+		} else {
+			// Find field separator at the end of field.
+			fieldStartPos = recordDataPos - baseAddress;
+			delimiterIt = findFieldSeparator(recordBuf,
+				delimiterIt, m_delimiters.end());
+			if (delimiterIt == m_delimiters.end()) {
+				break;
+			}
+			recordDataPos = *(delimiterIt++);
+			fieldLength = recordDataPos - baseAddress - fieldStartPos + 1;
+			recordDataPos++;
+		}
 
-			// Parse field.
-			MarcRecord::Field field = parseField(fieldTag,
-				recordData + fieldStartPos, fieldLength,
-				baseAddress + fieldStartPos);
-			// Append field to list.
-			record.m_fieldList.push_back(field);
+		// Check field starting position and length.
+		unsigned int fieldEndPos =
+		       baseAddress + fieldStartPos + fieldLength;
+		if (fieldEndPos > recordLen || fieldLength == 0
+			|| (fieldTag < "010" && fieldLength < 2))
+		{
+			std::string errorPos;
+			if (!m_autoCorrectionMode) {
+				snprintf(errorPos, 11, "%d",
+					(char *) directoryEntry->fieldLength
+					- recordBuf);
+			} else {
+				snprintf(errorPos, 11, "%d",
+					fieldStartPos);
+			}
+
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage = "invalid field starting "
+				"position or length at " + errorPos;
+			throw m_errorCode;
 		}
-	} catch (ErrorCode errorCode) {
-		record.clear();
-		return false;
+
+		// Check data field length.
+		if (fieldTag < "010" && fieldLength < 2) {
+			std::string errorPos;
+			snprintf(errorPos, 11, "%d",
+				(char *) directoryEntry->fieldLength
+				- recordBuf);
+
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage = "invalid length of data field"
+				" at " + errorPos;
+			throw m_errorCode;
+		}
+
+		// Append directory entry to list.
+		FieldEntry fieldEntry;
+		fieldEntry.tagPos = (char *) directoryEntry - recordBuf;
+		fieldEntry.startPos = baseAddress + fieldStartPos;
+		fieldEntry.length = fieldLength;
+		m_fieldEntries.push_back(fieldEntry);
 	}
+}
 
-	return true;
+/*
+ * Find next field separator in delimiter index.
+ */
+std::vector<unsigned int>::const_iterator
+MarcIsoReader::findFieldSeparator(const char *recordBuf,
+	std::vector<unsigned int>::const_iterator delimiterIt,
+	std::vector<unsigned int>::const_iterator delimiterEnd)
+{
+	while (delimiterIt != delimiterEnd
+		&& recordBuf[*delimiterIt] != ISO2709_FIELD_SEPARATOR)
+	{
+		delimiterIt++;
+	}
+
+	return delimiterIt;
 }
 
 /*
  * Parse field from ISO 2709 buffer.
  */
-MarcRecord::Field
-MarcIsoReader::parseField(const std::string &fieldTag, const char *fieldData,
+void
+MarcIsoReader::parseField(MarcRecord::Field &field,
+	const std::string &fieldTag, const char *fieldData,
 	unsigned int fieldLength, unsigned int fieldAbsoluteStartPos)
 {
-	MarcRecord::Field field;
-
 	// Adjust field length.
 	if (fieldData[fieldLength - 1] == '\x1E') {
 		fieldLength--;
@@ -441,26 +730,8 @@ MarcIsoReader::parseField(const std::string &fieldTag, const char *fieldData,
 	}
 
 	if (fieldTag < "010") {
-		// Parse control field.
 		field.m_type = MarcRecord::Field::CONTROLFIELD;
-		if (m_iconvDesc == (iconv_t) -1) {
-			field.m_data.assign(fieldData, fieldLength);
-		} else {
-			if (!iconv(m_iconvDesc, fieldData, fieldLength,
-				field.m_data))
-			{
-				std::string errorPos;
-				snprintf(errorPos, 11, "%d",
-					fieldAbsoluteStartPos);
-
-				m_errorCode = ERROR_ICONV;
-				m_errorMessage = "encoding conversion failed "
-					"at " + errorPos;
-				throw m_errorCode;
-			}
-		}
 	} else {
-		// Parse data field.
 		field.m_type = MarcRecord::Field::DATAFIELD;
 		field.m_ind1 = fieldData[0];
 		field.m_ind2 = fieldData[1];
@@ -481,31 +752,126 @@ MarcIsoReader::parseField(const std::string &fieldTag, const char *fieldData,
 				field.m_ind2 = '?';
 			}
 		}
+	}
+
+	if (m_lazyMode) {
+		// Keep raw field data until first access to the field.
+		field.m_rawData.assign(fieldData, fieldLength);
+		field.m_rawReader = this;
+	} else {
+		// Parse field data.
+		parseFieldData(field, fieldData, fieldLength,
+			fieldAbsoluteStartPos, m_delimiters);
+	}
+}
+
+/*
+ * Parse data of control field or subfields of data field.
+ */
+void
+MarcIsoReader::parseFieldData(MarcRecord::Field &field,
+	const char *fieldData, unsigned int fieldLength,
+	unsigned int fieldAbsoluteStartPos,
+	const std::vector<unsigned int> &delimiters)
+{
+	if (field.m_type == MarcRecord::Field::CONTROLFIELD) {
+		// Parse control field.
+		if (m_iconvDesc == (iconv_t) -1) {
+			field.m_data.assign(fieldData, fieldLength);
+		} else {
+			if (!decodeData(m_iconvDesc, fieldData, fieldLength,
+				field.m_data))
+			{
+				std::string errorPos;
+				snprintf(errorPos, 11, "%d",
+					fieldAbsoluteStartPos);
+
+				m_errorCode = ERROR_ICONV;
+				m_errorMessage = "encoding conversion failed "
+					"at " + errorPos;
+				throw m_errorCode;
+			}
+		}
+	} else {
+		// Find first delimiter after indicators in delimiter index.
+		std::vector<unsigned int>::const_iterator delimiterIt =
+			std::lower_bound(delimiters.begin(), delimiters.end(),
+			fieldAbsoluteStartPos + 2);
+		unsigned int fieldAbsoluteEndPos =
+			fieldAbsoluteStartPos + fieldLength;
 
 		// Parse list of subfields.
 		unsigned int subfieldStartPos = 0;
 		unsigned int symbolPos;
-		for (symbolPos = 2; symbolPos <= fieldLength; symbolPos++) {
-			// Skip symbols of subfield data.
-			if (fieldData[symbolPos] != '\x1F'
-				&& symbolPos != fieldLength)
+		for (;; delimiterIt++) {
+			if (delimiterIt != delimiters.end()
+				&& *delimiterIt < fieldAbsoluteEndPos)
 			{
-				continue;
+				// Skip delimiters other than subfield delimiter.
+				symbolPos = *delimiterIt - fieldAbsoluteStartPos;
+				if (fieldData[symbolPos] != '\x1F') {
+					continue;
+				}
+			} else {
+				symbolPos = fieldLength;
 			}
 
 			if (symbolPos > 2) {
 				// Parse regular subfield.
-				MarcRecord::Subfield subfield;
-				subfield = parseSubfield(fieldData,
-					subfieldStartPos, symbolPos);
-				field.m_subfieldList.push_back(subfield);
+				field.m_subfieldList.push_back(
+					parseSubfield(fieldData,
+					subfieldStartPos, symbolPos));
 			}
 
+			if (symbolPos == fieldLength) {
+				break;
+			}
 			subfieldStartPos = symbolPos;
 		}
 	}
+}
+
+/*
+ * Decode raw data of field parsed in lazy mode.
+ */
+bool
+MarcIsoReader::decodeField(MarcRecord::Field &field)
+{
+	// Detach raw data from field.
+	std::string rawData;
+	rawData.swap(field.m_rawData);
+	field.m_rawReader = NULL;
+
+	try {
+		// Build index of delimiters and parse field data.
+		scan_delimiters(rawData.c_str(), 0, rawData.size(),
+			m_fieldDelimiters);
+		parseFieldData(field, rawData.c_str(), rawData.size(), 0,
+			m_fieldDelimiters);
+	} catch (ErrorCode errorCode) {
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Check if raw data of fields can be written in specified encoding.
+ */
+bool
+MarcIsoReader::isRawDataCompatible(const std::string &outputEncoding)
+{
+	// Raw data is not corrected in automatic error correction mode.
+	if (m_autoCorrectionMode) {
+		return false;
+	}
+
+	if (m_iconvDesc == (iconv_t) -1) {
+		return outputEncoding == "" || outputEncoding == "UTF-8"
+			|| outputEncoding == "utf-8";
+	}
 
-	return field;
+	return outputEncoding == m_inputEncoding;
 }
 
 /*
@@ -547,7 +913,7 @@ MarcIsoReader::parseSubfield(const char *fieldData,
 			subfieldEndPos - subfieldStartPos - 2);
 	} else {
 		// Copy subfield data with encoding conversion.
-		if (!iconv(m_iconvDesc,
+		if (!decodeData(m_iconvDesc,
 			fieldData + subfieldStartPos + 2,
 			subfieldEndPos - subfieldStartPos - 2,
 			subfield.m_data))
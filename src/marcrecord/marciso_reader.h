@@ -31,6 +31,7 @@
 
 #include <iconv.h>
 #include <string>
+#include <vector>
 #include "marc_reader.h"
 #include "marcrecord.h"
 
@@ -44,11 +45,70 @@ protected:
 	// Iconv descriptor for input encoding.
 	iconv_t m_iconvDesc;
 
+	// Lazy mode (fields are decoded on first access).
+	bool m_lazyMode;
+
+	// Record buffer.
+	char m_recordBuf[100000];
+
+	// Input buffer.
+	std::vector<char> m_inputBuf;
+	// Position of unread data in input buffer.
+	size_t m_inputBufPos;
+	// Length of data in input buffer.
+	size_t m_inputBufLen;
+	// Position of input buffer in input.
+	unsigned long long m_inputBufStart;
+	// End of input file reached flag.
+	bool m_inputEof;
+
 private:
+	// Structure of parsed directory entry.
+	struct FieldEntry {
+		// Position of field tag in record.
+		unsigned int tagPos;
+		// Position of field data in record.
+		unsigned int startPos;
+		// Length of field data (including field separator).
+		unsigned int length;
+	};
+	typedef struct FieldEntry FieldEntry;
+
+	// List of parsed directory entries.
+	std::vector<FieldEntry> m_fieldEntries;
+	// Base address of data in parsed record.
+	unsigned int m_baseAddress;
+	// Index of delimiters positions in parsed record.
+	std::vector<unsigned int> m_delimiters;
+	// Index of delimiters positions in decoded field.
+	std::vector<unsigned int> m_fieldDelimiters;
+
+	// Fill input buffer with data from file.
+	bool fillInputBuffer(void);
+	// Read data from input buffer.
+	size_t readInput(char *buf, size_t bufLen);
+	// Skip input data until record separator.
+	void skipRecord(void);
+	// Read record from file to the record buffer.
+	bool readRecord(unsigned int &recordLen);
+	// Read record to the record buffer (time is counted in statistics).
+	bool readRecordTimed(unsigned int &recordLen);
+	// Parse record leader and directory from ISO 2709 buffer.
+	void parseDirectory(const char *recordBuf, unsigned int recordBufLen);
+	// Find next field separator in delimiter index.
+	inline std::vector<unsigned int>::const_iterator findFieldSeparator(
+		const char *recordBuf,
+		std::vector<unsigned int>::const_iterator delimiterIt,
+		std::vector<unsigned int>::const_iterator delimiterEnd);
 	// Parse field from ISO 2709 buffer.
-	inline MarcRecord::Field parseField(const std::string &fieldTag,
+	inline void parseField(MarcRecord::Field &field,
+		const std::string &fieldTag, const char *fieldData,
+		unsigned int fieldLength, unsigned int fieldAbsoluteStartPos);
+	// Parse data of control field or subfields of data field.
+	void parseFieldData(MarcRecord::Field &field,
 		const char *fieldData, unsigned int fieldLength,
-		unsigned int fieldAbsoluteStartPos);
+		unsigned int fieldAbsoluteStartPos,
+		const std::vector<unsigned int> &delimiters);
 	// Parse subfield.
 	MarcRecord::Subfield parseSubfield(const char *fieldData,
 		unsigned int subfieldStartPos, unsigned int subfieldEndPos);
@@ -66,10 +126,29 @@ public:
 	void close(void);
 	// Read next record from file.
 	bool next(MarcRecord &record);
+	// Read next record from file without parsing (only leader and
+	// directory are validated, buffer is valid until next read).
+	bool nextRaw(const char *&recordBuf, unsigned int &recordLen);
+
+	// Get position in input after last read record.
+	unsigned long long getInputPos(void);
+	// Set position in input (at start of record).
+	bool seekInput(unsigned long long inputPos);
+	// Reset state of reading to start new input from input source.
+	bool reset(void);
+
+	// Set lazy mode (fields are decoded on first access).
+	void setLazyMode(bool lazyMode = true);
 
+	// Validate record leader and directory in ISO 2709 buffer.
+	bool validate(const char *recordBuf, unsigned int recordBufLen);
 	// Parse record from ISO 2709 buffer.
 	bool parse(const char *recordBuf, unsigned int recordBufLen,
 		MarcRecord &record);
+	// Decode raw data of field parsed in lazy mode.
+	bool decodeField(MarcRecord::Field &field);
+	// Check if raw data of fields can be written in specified encoding.
+	bool isRawDataCompatible(const std::string &outputEncoding);
 };
 
 } // namespace marcrecord
@@ -29,8 +29,10 @@
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
+#include "marciso_reader.h"
 #include "marciso_writer.h"
 
 namespace marcrecord {
@@ -39,6 +41,9 @@ namespace marcrecord {
 #define ISO2709_FIELD_SEPARATOR		'\x1E'
 #define ISO2709_IDENTIFIER_DELIMITER	'\x1F'
 
+#define ISO2709_MAX_RECORD_SIZE		99999
+#define ISO2709_MAX_FIELD_SIZE		9999
+
 #pragma pack(1)
 
 /*
@@ -67,7 +72,6 @@ MarcIsoWriter::MarcIsoWriter(FILE *outputFile, const char *outputEncoding)
 	: MarcWriter()
 {
 	// Clear member variables.
-	m_iconvDesc = (iconv_t) -1;
 
 	if (outputFile) {
 		// Open output file.
@@ -100,26 +104,17 @@ MarcIsoWriter::open(FILE *outputFile, const char *outputEncoding)
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
 	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
 
 	// Initialize encoding conversion.
-	if (outputEncoding == NULL
-		|| strcmp(outputEncoding, "UTF-8") == 0
-		|| strcmp(outputEncoding, "utf-8") == 0)
-	{
-		m_iconvDesc = (iconv_t) -1;
-	} else {
-		// Create iconv descriptor for output encoding conversion.
-		m_iconvDesc = iconv_open(outputEncoding, "UTF-8");
-		if (m_iconvDesc == (iconv_t) -1) {
-			m_errorCode = ERROR_ICONV;
-			if (errno == EINVAL) {
-				m_errorMessage =
-					"encoding conversion is not supported";
-			} else {
-				m_errorMessage = "iconv initialization failed";
-			}
-			return false;
+	if (!m_encoder.open(outputEncoding)) {
+		m_errorCode = ERROR_ICONV;
+		if (errno == EINVAL) {
+			m_errorMessage = "encoding conversion is not supported";
+		} else {
+			m_errorMessage = "iconv initialization failed";
 		}
+		return false;
 	}
 
 	return true;
@@ -131,17 +126,17 @@ MarcIsoWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 MarcIsoWriter::close(void)
 {
-	// Finalize iconv.
-	if (m_iconvDesc != (iconv_t) -1) {
-		iconv_close(m_iconvDesc);
-	}
+	// Write buffered data to output.
+	closeOutput();
+
+	// Finalize encoder.
+	m_encoder.close();
 
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_outputFile = NULL;
 	m_outputEncoding = "";
-	m_iconvDesc = (iconv_t) -1;
 }
 
 /*
@@ -150,19 +145,57 @@ MarcIsoWriter::close(void)
 bool
 MarcIsoWriter::write(MarcRecord &record)
 {
-	char recordBuf[100000];
+	// Decode raw data of fields which can't be copied without decoding.
+	MarcIsoReader *rawReader = NULL;
+	bool rawDataCompatible = false;
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		if (fieldIt->isRaw() && fieldIt->m_rawReader != rawReader) {
+			rawReader = fieldIt->m_rawReader;
+			rawDataCompatible =
+				rawReader->isRawDataCompatible(m_outputEncoding);
+		}
+		if (fieldIt->isRaw() && !rawDataCompatible
+			&& !decodeField(*fieldIt))
+		{
+			return false;
+		}
+	}
 
-	// Copy record leader to buffer.
-	memcpy(recordBuf, (char *) &record.m_leader,
-		sizeof(MarcRecord::Leader));
+	// Calculate record size (exact if data is not recoded, upper bound
+	// otherwise, recoded data is checked while it is written).
+	size_t recordSize = m_encoder.getEncodedSizeBound(record.getIsoSize());
+	if (recordSize > ISO2709_MAX_RECORD_SIZE) {
+		if (m_encoder.getMode() == MarcEncoder::MODE_NONE) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "record size exceed ISO2709 limit";
+			return false;
+		}
+		recordSize = ISO2709_MAX_RECORD_SIZE;
+	}
 
-	// Calculate base address of data and copy it to record buffer.
+	// Calculate base address of data.
 	unsigned int baseAddress = sizeof(MarcRecord::Leader)
 		+ record.m_fieldList.size()
 		* sizeof(RecordDirectoryEntry) + 1;
-	char baseAddressBuf[6];
-	sprintf(baseAddressBuf, "%05d", baseAddress);
-	memcpy(recordBuf + 12, baseAddressBuf, 5);
+	if (baseAddress + 1 > recordSize) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "record size exceed ISO2709 limit";
+		return false;
+	}
+
+	// Reserve space for record in output buffer.
+	char *recordBuf = reserveOutput(recordSize);
+	if (recordBuf == NULL) {
+		return false;
+	}
+	char *recordBufEnd = recordBuf + recordSize;
+
+	// Copy record leader and base address to buffer.
+	memcpy(recordBuf, (char *) &record.m_leader,
+		sizeof(MarcRecord::Leader));
+	format_decimal(recordBuf + 12, 5, baseAddress);
 
 	// Iterate all fields.
 	char *directoryData = recordBuf + sizeof(MarcRecord::Leader);
@@ -170,15 +203,32 @@ MarcIsoWriter::write(MarcRecord &record)
 	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
 		fieldIt != record.m_fieldList.end(); fieldIt++)
 	{
+		// Space for field data (separators of field and record are
+		// reserved at the end).
+		if (recordBufEnd - fieldData < 2) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "record size exceed ISO2709 limit";
+			return false;
+		}
+		size_t fieldDataSize = recordBufEnd - fieldData - 2;
+
 		int fieldLength = 0;
-		if (fieldIt->m_tag < "010") {
-			fieldLength = appendControlField(fieldData, fieldIt);
-			fieldData += fieldLength;
+		if (fieldIt->isRaw()) {
+			// Copy raw data of field without decoding.
+			fieldLength = appendRawField(fieldData, fieldDataSize,
+				fieldIt);
+		} else if (fieldIt->m_tag < "010") {
+			fieldLength = appendControlField(fieldData,
+				fieldDataSize, fieldIt);
+		} else if (fieldDataSize < 2) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "record size exceed ISO2709 limit";
+			return false;
 		} else {
 			// Copy indicators of data field to buffer.
-			*(fieldData++) = fieldIt->m_ind1;
-			*(fieldData++) = fieldIt->m_ind2;
-			fieldLength += 2;
+			fieldData[0] = fieldIt->m_ind1;
+			fieldData[1] = fieldIt->m_ind2;
+			fieldLength = 2;
 
 			// Iterate all subfields.
 			MarcRecord::SubfieldIt subfieldIt =
@@ -186,26 +236,43 @@ MarcIsoWriter::write(MarcRecord &record)
 			for (; subfieldIt != fieldIt->m_subfieldList.end();
 				subfieldIt++)
 			{
-				int subfieldLength =
-					appendSubfield(fieldData, subfieldIt);
-				fieldData += subfieldLength;
+				int subfieldLength = appendSubfield(
+					fieldData + fieldLength,
+					fieldDataSize - fieldLength, subfieldIt);
+				if (subfieldLength < 0) {
+					return false;
+				}
 				fieldLength += subfieldLength;
 			}
 		}
+		if (fieldLength < 0) {
+			return false;
+		}
+		fieldData += fieldLength;
 
 		// Set field separator at the end of field.
 		*(fieldData++) = ISO2709_FIELD_SEPARATOR;
 		fieldLength++;
+		if (fieldLength > ISO2709_MAX_FIELD_SIZE) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "field size exceed ISO2709 limit";
+			return false;
+		}
 
-		/*
-		 * Fill directory entry (it is safe to do this way because
-		 * null character will be overwritten in next iteration and
-		 * right after the cycle).
-		 */
+		// Fill directory entry.
 		int fieldOffset = (int) (fieldData - recordBuf) - baseAddress
 			- fieldLength;
-		sprintf(directoryData, "%.3s%04d%05d",
-			fieldIt->m_tag.c_str(), fieldLength, fieldOffset);
+		RecordDirectoryEntry *directoryEntry =
+			(RecordDirectoryEntry *) directoryData;
+		size_t tagLength = std::min(fieldIt->m_tag.size(),
+			sizeof(directoryEntry->fieldTag));
+		memset(directoryEntry->fieldTag, ' ',
+			sizeof(directoryEntry->fieldTag));
+		memcpy(directoryEntry->fieldTag, fieldIt->m_tag.c_str(),
+			tagLength);
+		format_decimal(directoryEntry->fieldLength, 4, fieldLength);
+		format_decimal(directoryEntry->fieldStartingPosition, 5,
+			fieldOffset);
 		directoryData += sizeof(RecordDirectoryEntry);
 	}
 
@@ -216,95 +283,115 @@ MarcIsoWriter::write(MarcRecord &record)
 
 	// Calculate directory length and copy it to record buffer.
 	int recordLength = (int) (fieldData - recordBuf);
-	char recordLengthBuf[6];
-	sprintf(recordLengthBuf, "%05d", recordLength);
-	memcpy(recordBuf, recordLengthBuf, 5);
-
-	// Write record buffer to file.
-	if (fwrite(recordBuf, recordLength, 1, m_outputFile) != 1) {
-		m_errorCode = ERROR_IO;
-		m_errorMessage = "i/o operation failed";
-		return false;
-	}
+	format_decimal(recordBuf, 5, recordLength);
+
+	// Commit record to output buffer.
+	commitOutput(recordLength);
 
 	return true;
 }
 
 /*
- * Append control field data to the write buffer.
+ * Write raw ISO 2709 record to output file.
+ */
+bool
+MarcIsoWriter::writeRaw(const char *recordBuf, unsigned int recordLen)
+{
+	// Append record buffer to output buffer.
+	return appendOutput(recordBuf, recordLen);
+}
+
+/*
+ * Append control field data to the write buffer
+ * (returns -1 in case of error).
  */
 int
-MarcIsoWriter::appendControlField(char *fieldData,
+MarcIsoWriter::appendControlField(char *fieldData, size_t fieldDataSize,
 	MarcRecord::FieldIt &fieldIt)
 {
-	int fieldLength;
+	// Copy control field to buffer with encoding conversion.
+	return appendEncodedData(fieldData, fieldDataSize, fieldIt->m_data);
+}
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Copy control field to buffer.
-		fieldLength = fieldIt->m_data.size();
-		if (fieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
-		}
-		memcpy(fieldData, fieldIt->m_data.c_str(), fieldLength);
-	} else {
-		// Copy control field to buffer with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, fieldIt->m_data, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		fieldLength = iconvBuf.size();
-		if (fieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
-		}
-		memcpy(fieldData, iconvBuf.c_str(), fieldLength);
+/*
+ * Append raw field data (not decoded) to the write buffer
+ * (returns -1 in case of error).
+ */
+int
+MarcIsoWriter::appendRawField(char *fieldData, size_t fieldDataSize,
+	MarcRecord::FieldIt &fieldIt)
+{
+	if (fieldIt->m_rawData.size() > fieldDataSize) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "record size exceed ISO2709 limit";
+		return -1;
+	}
+	int fieldLength = (int) fieldIt->m_rawData.size();
+
+	// Copy raw field data to buffer.
+	memcpy(fieldData, fieldIt->m_rawData.c_str(), fieldLength);
+
+	// Indicators of data field could be changed after parsing.
+	if (fieldIt->m_type == MarcRecord::Field::DATAFIELD
+		&& fieldLength >= 2)
+	{
+		fieldData[0] = fieldIt->m_ind1;
+		fieldData[1] = fieldIt->m_ind2;
 	}
 
 	return fieldLength;
 }
 
 /*
- * Append subfield data to the write buffer.
+ * Append subfield data to the write buffer
+ * (returns -1 in case of error).
  */
 int
-MarcIsoWriter::appendSubfield(char *fieldData,
+MarcIsoWriter::appendSubfield(char *fieldData, size_t fieldDataSize,
 	MarcRecord::SubfieldIt &subfieldIt)
 {
-	int subfieldLength;
+	if (fieldDataSize < 2) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "record size exceed ISO2709 limit";
+		return -1;
+	}
 
+	// Copy subfield to buffer with encoding conversion.
 	*(fieldData) = ISO2709_IDENTIFIER_DELIMITER;
 	*(fieldData + 1) = subfieldIt->m_id;
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Copy subfield to buffer.
-		subfieldLength = subfieldIt->m_data.size();
-		if (subfieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
-		}
-		memcpy(fieldData + 2, subfieldIt->m_data.c_str(),
-			subfieldLength);
-	} else {
-		// Copy subfield to buffer with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, subfieldIt->m_data, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		subfieldLength = iconvBuf.size();
-		if (subfieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
-		}
-		memcpy(fieldData + 2, iconvBuf.c_str(), subfieldLength);
+	int subfieldLength = appendEncodedData(fieldData + 2,
+		fieldDataSize - 2, subfieldIt->m_data);
+	if (subfieldLength < 0) {
+		return -1;
 	}
 
 	return subfieldLength + 2;
 }
+
+/*
+ * Append data to the write buffer with encoding conversion
+ * (returns -1 in case of error).
+ */
+int
+MarcIsoWriter::appendEncodedData(char *fieldData, size_t fieldDataSize,
+	const std::string &data)
+{
+	const char *src = data.data();
+	size_t srcLen = data.size();
+	char *dest = fieldData;
+	size_t destLen = fieldDataSize;
+
+	// Encode data directly to the write buffer.
+	if (!encodeData(src, srcLen, dest, destLen)) {
+		m_errorCode = ERROR_ICONV;
+		m_errorMessage = "encoding conversion failed";
+		return -1;
+	}
+	if (srcLen > 0) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "record size exceed ISO2709 limit";
+		return -1;
+	}
+
+	return (int) (dest - fieldData);
+}
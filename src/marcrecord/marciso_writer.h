@@ -29,7 +29,6 @@
 #ifndef MARCRECORD_MARCISO_WRITER_H
 #define MARCRECORD_MARCISO_WRITER_H
 
-#include <iconv.h>
 #include <string>
 #include "marc_writer.h"
 #include "marcrecord.h"
@@ -40,16 +39,19 @@ namespace marcrecord {
  *ISO 2709 records writer.
  */
 class MarcIsoWriter : public MarcWriter {
-protected:
-	// Iconv descriptor for output encoding.
-	iconv_t m_iconvDesc;
-
 private:
 	// Append control field data to the write buffer.
-	int appendControlField(char *fieldData, MarcRecord::FieldIt &fieldIt);
+	int appendControlField(char *fieldData, size_t fieldDataSize,
+		MarcRecord::FieldIt &fieldIt);
+	// Append raw field data (not decoded) to the write buffer.
+	int appendRawField(char *fieldData, size_t fieldDataSize,
+		MarcRecord::FieldIt &fieldIt);
 	// Append subfield data to the write buffer.
-	int appendSubfield(char *fieldData,
+	int appendSubfield(char *fieldData, size_t fieldDataSize,
 		MarcRecord::SubfieldIt &subfieldIt);
+	// Append data to the write buffer with encoding conversion.
+	int appendEncodedData(char *fieldData, size_t fieldDataSize,
+		const std::string &data);
 
 public:
 	// Constructor.
@@ -64,6 +66,8 @@ public:
 	void close(void);
 	// Write record to output file.
 	bool write(MarcRecord &record);
+	// Write raw ISO 2709 record to output file.
+	bool writeRaw(const char *recordBuf, unsigned int recordLen);
 };
 
 } // namespace marcrecord
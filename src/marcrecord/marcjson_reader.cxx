@@ -0,0 +1,705 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "marc_codec_cache.h"
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcjson_reader.h"
+
+namespace marcrecord {
+
+#define JSON_INPUT_BUFFER_SIZE		262144
+#define JSON_MAX_NESTING_DEPTH		64
+
+// Sanity limit of record length (protects from unterminated records).
+#define JSON_MAX_RECORD_LENGTH		0x7FFFFFF0
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcJsonReader::MarcJsonReader(FILE *inputFile, const char *inputEncoding)
+	: MarcReader()
+{
+	// Clear member variables.
+	m_iconvDesc = (iconv_t) -1;
+	m_inputBuf.resize(JSON_INPUT_BUFFER_SIZE);
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
+	m_recordData = NULL;
+
+	if (inputFile) {
+		// Open input file.
+		open(inputFile, inputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcJsonReader::~MarcJsonReader()
+{
+	// Close input file.
+	close();
+}
+
+/*
+ * Open input file.
+ */
+bool
+MarcJsonReader::open(FILE *inputFile, const char *inputEncoding)
+{
+	// Clear object state.
+	close();
+
+	// Initialize input stream parameters.
+	m_inputFile = inputFile == NULL ? stdin : inputFile;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+	openInput(m_inputFile);
+
+	// Initialize encoding conversion.
+	if (inputEncoding != NULL
+		&& strcmp(inputEncoding, "UTF-8") != 0
+		&& strcmp(inputEncoding, "utf-8") != 0)
+	{
+		// Create iconv descriptor for input encoding conversion.
+		m_iconvDesc = acquire_iconv("UTF-8", inputEncoding);
+		if (m_iconvDesc == (iconv_t) -1) {
+			m_errorCode = ERROR_ICONV;
+			if (errno == EINVAL) {
+				m_errorMessage =
+					"encoding conversion is not supported";
+			} else {
+				m_errorMessage = "iconv initialization failed";
+			}
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Close input file.
+ */
+void
+MarcJsonReader::close(void)
+{
+	// Return iconv descriptor to cache.
+	release_iconv(m_iconvDesc, "UTF-8", m_inputEncoding.c_str());
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_inputFile = NULL;
+	m_input = NULL;
+	m_inputEncoding = "";
+	m_iconvDesc = (iconv_t) -1;
+	m_autoCorrectionMode = false;
+	m_inputBuf.resize(JSON_INPUT_BUFFER_SIZE);
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
+	m_recordData = NULL;
+}
+
+/*
+ * Reset state of reading to start new input from input source.
+ */
+bool
+MarcJsonReader::reset(void)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Discard buffered data.
+	m_inputBufPos = 0;
+	m_inputBufLen = 0;
+	m_inputBufStart = 0;
+	m_inputEof = false;
+	m_recordData = NULL;
+
+	return true;
+}
+
+/*
+ * Read next record from file.
+ */
+bool
+MarcJsonReader::next(MarcRecord &record)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Read text of record and parse it.
+	const char *recordData;
+	size_t recordLen;
+	unsigned long long startTime = m_stats != NULL ? get_time_ns() : 0;
+	bool result = readRecord(recordData, recordLen);
+	if (m_stats != NULL) {
+		m_stats->frameTime += get_time_ns() - startTime;
+	}
+	if (!result) {
+		return false;
+	}
+
+	return parseRecord(recordData, recordLen, record);
+}
+
+/*
+ * Parse record from JSON text (lines of JSON Lines file can be
+ * parsed in parallel by separate readers).
+ */
+bool
+MarcJsonReader::parseRecord(const char *recordData, size_t recordLen,
+	MarcRecord &record)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	const char *pos = recordData;
+	const char *end = recordData + recordLen;
+	m_recordData = recordData;
+	record.clear();
+
+	try {
+		bool leaderFound = false;
+
+		// Parse record object (keys may be in any order).
+		expectChar(pos, end, '{');
+		if (!skipChar(pos, end, '}')) {
+			do {
+				parseString(pos, end, m_keyBuf, false);
+				expectChar(pos, end, ':');
+
+				if (m_keyBuf == "leader") {
+					const char *valuePos = pos;
+					parseString(pos, end, m_stringBuf, false);
+					if (m_stringBuf.size()
+						!= sizeof(MarcRecord::Leader))
+					{
+						throwError(valuePos,
+							"invalid record leader");
+					}
+					memcpy(&record.m_leader,
+						m_stringBuf.data(),
+						sizeof(MarcRecord::Leader));
+					leaderFound = true;
+				} else if (m_keyBuf == "fields") {
+					parseFields(pos, end, record);
+				} else {
+					skipValue(pos, end, 0);
+				}
+			} while (skipChar(pos, end, ','));
+			expectChar(pos, end, '}');
+		}
+
+		if (!leaderFound) {
+			throwError(recordData, "record leader not found");
+		}
+		skipSpace(pos, end);
+		if (pos != end) {
+			throwError(pos, "unexpected data after record");
+		}
+	} catch (ErrorCode errorCode) {
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get position in input after last read record.
+ */
+unsigned long long
+MarcJsonReader::getInputPos(void)
+{
+	return m_inputBufStart + m_inputBufPos;
+}
+
+/*
+ * Read more data to input buffer (returns false at end of input).
+ */
+bool
+MarcJsonReader::readInput(void)
+{
+	if (m_inputEof) {
+		return false;
+	}
+
+	// Move unread data to the beginning of buffer.
+	if (m_inputBufPos > 0) {
+		memmove(&m_inputBuf[0], &m_inputBuf[0] + m_inputBufPos,
+			m_inputBufLen - m_inputBufPos);
+		m_inputBufStart += m_inputBufPos;
+		m_inputBufLen -= m_inputBufPos;
+		m_inputBufPos = 0;
+	}
+
+	// Enlarge buffer for large record.
+	if (m_inputBufLen == m_inputBuf.size()) {
+		m_inputBuf.resize(m_inputBuf.size() * 2);
+	}
+
+	// Read data from input.
+	size_t readLen = m_inputBuf.size() - m_inputBufLen;
+	size_t dataReadLen = m_input->read(&m_inputBuf[m_inputBufLen],
+		readLen);
+	m_inputBufLen += dataReadLen;
+	m_inputEof = dataReadLen < readLen;
+
+	return dataReadLen > 0;
+}
+
+/*
+ * Read text of record from input buffer (data is valid until next read).
+ * Records are objects in JSON array or lines of JSON Lines file.
+ */
+bool
+MarcJsonReader::readRecord(const char *&recordData, size_t &recordLen)
+{
+	// Skip whitespace and punctuation of array between records.
+	for (;;) {
+		if (m_inputBufPos == m_inputBufLen && !readInput()) {
+			m_errorCode = END_OF_FILE;
+			m_errorMessage = "end of file";
+			return false;
+		}
+
+		char c = m_inputBuf[m_inputBufPos];
+		if (c != ' ' && c != '\t' && c != '\r' && c != '\n'
+			&& c != '[' && c != ']' && c != ',')
+		{
+			break;
+		}
+		m_inputBufPos++;
+	}
+
+	if (m_inputBuf[m_inputBufPos] != '{') {
+		// Skip rest of line to find next record.
+		while (m_inputBufPos < m_inputBufLen || readInput()) {
+			if (m_inputBuf[m_inputBufPos++] == '\n') {
+				break;
+			}
+		}
+
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record start";
+		return false;
+	}
+
+	// Find end of record object (braces in strings are ignored).
+	size_t scanLen = 1;
+	int depth = 1;
+	bool inString = false, escaped = false;
+	while (depth > 0) {
+		if (m_inputBufPos + scanLen == m_inputBufLen) {
+			if (scanLen >= JSON_MAX_RECORD_LENGTH) {
+				m_inputBufPos = m_inputBufLen;
+				m_inputEof = true;
+				m_errorCode = ERROR_INVALID_RECORD;
+				m_errorMessage = "record is too long";
+				return false;
+			}
+			if (!readInput()) {
+				m_inputBufPos = m_inputBufLen;
+				m_errorCode = ERROR_INVALID_RECORD;
+				m_errorMessage = "record data incomplete";
+				return false;
+			}
+		}
+
+		const char *data = &m_inputBuf[m_inputBufPos];
+		size_t dataLen = m_inputBufLen - m_inputBufPos;
+		for (; scanLen < dataLen && depth > 0; scanLen++) {
+			char c = data[scanLen];
+			if (escaped) {
+				escaped = false;
+			} else if (inString) {
+				if (c == '"') {
+					inString = false;
+				} else if (c == '\\') {
+					escaped = true;
+				}
+			} else if (c == '"') {
+				inString = true;
+			} else if (c == '{') {
+				depth++;
+			} else if (c == '}') {
+				depth--;
+			}
+		}
+	}
+
+	recordData = &m_inputBuf[m_inputBufPos];
+	recordLen = scanLen;
+	m_inputBufPos += scanLen;
+
+	return true;
+}
+
+/*
+ * Throw syntax error at specified position.
+ */
+void
+MarcJsonReader::throwError(const char *pos, const char *message)
+{
+	std::string errorPos;
+	snprintf(errorPos, 11, "%u", (unsigned int) (pos - m_recordData));
+
+	m_errorCode = ERROR_INVALID_RECORD;
+	m_errorMessage = std::string(message) + " at " + errorPos;
+	throw m_errorCode;
+}
+
+/*
+ * Skip whitespace.
+ */
+void
+MarcJsonReader::skipSpace(const char *&pos, const char *end)
+{
+	while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'
+		|| *pos == '\n'))
+	{
+		pos++;
+	}
+}
+
+/*
+ * Skip whitespace and check next character (it is skipped if matches).
+ */
+bool
+MarcJsonReader::skipChar(const char *&pos, const char *end, char c)
+{
+	skipSpace(pos, end);
+	if (pos < end && *pos == c) {
+		pos++;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Skip whitespace and required character.
+ */
+void
+MarcJsonReader::expectChar(const char *&pos, const char *end, char c)
+{
+	if (!skipChar(pos, end, c)) {
+		char message[] = "'?' expected";
+		message[1] = c;
+		throwError(pos, message);
+	}
+}
+
+/*
+ * Parse JSON string (data is converted from input encoding if recode
+ * flag is set, escaped characters are decoded to UTF-8).
+ */
+void
+MarcJsonReader::parseString(const char *&pos, const char *end,
+	std::string &value, bool recode)
+{
+	if (!skipChar(pos, end, '"')) {
+		throwError(pos, "string expected");
+	}
+
+	// Find end of string without escaped characters.
+	const char *start = pos;
+	while (pos < end && *pos != '"' && *pos != '\\') {
+		pos++;
+	}
+
+	const char *data = start;
+	size_t dataLen = pos - start;
+	if (pos < end && *pos == '\\') {
+		// Decode escaped characters.
+		m_stringBuf.assign(start, pos - start);
+		while (pos < end && *pos != '"') {
+			if (*pos != '\\') {
+				const char *runStart = pos;
+				while (pos < end && *pos != '"' && *pos != '\\') {
+					pos++;
+				}
+				m_stringBuf.append(runStart, pos - runStart);
+				continue;
+			}
+
+			if (end - pos < 2) {
+				pos = end;
+				break;
+			}
+			const char *escapePos = pos;
+			pos += 2;
+			switch (pos[-1]) {
+			case '"':
+			case '\\':
+			case '/':
+				m_stringBuf += pos[-1];
+				break;
+			case 'b':
+				m_stringBuf += '\b';
+				break;
+			case 'f':
+				m_stringBuf += '\f';
+				break;
+			case 'n':
+				m_stringBuf += '\n';
+				break;
+			case 'r':
+				m_stringBuf += '\r';
+				break;
+			case 't':
+				m_stringBuf += '\t';
+				break;
+			case 'u':
+				{
+					unsigned int code = 0;
+					for (int i = 0; i < 4; i++, pos++) {
+						int digit = pos < end
+							? hex_digit(*pos) : -1;
+						if (digit < 0) {
+							throwError(escapePos,
+								"invalid escape");
+						}
+						code = (code << 4) | digit;
+					}
+
+					// Combine surrogate pair.
+					if (code >= 0xD800 && code < 0xDC00
+						&& end - pos >= 6
+						&& pos[0] == '\\' && pos[1] == 'u')
+					{
+						unsigned int low = 0;
+						int i = 2;
+						for (; i < 6; i++) {
+							int digit = hex_digit(pos[i]);
+							if (digit < 0) {
+								break;
+							}
+							low = (low << 4) | digit;
+						}
+						if (i == 6 && low >= 0xDC00
+							&& low < 0xE000)
+						{
+							code = 0x10000
+								+ ((code - 0xD800) << 10)
+								+ (low - 0xDC00);
+							pos += 6;
+						}
+					}
+
+					char utf8[4];
+					m_stringBuf.append(utf8,
+						encode_utf8(utf8, code));
+				}
+				break;
+			default:
+				throwError(escapePos, "invalid escape");
+			}
+		}
+
+		data = m_stringBuf.data();
+		dataLen = m_stringBuf.size();
+	}
+
+	if (pos >= end) {
+		throwError(start - 1, "unterminated string");
+	}
+	pos++;
+
+	// Copy string with encoding conversion.
+	if (recode && m_iconvDesc != (iconv_t) -1) {
+		if (!decodeData(m_iconvDesc, data, dataLen, value)) {
+			m_errorCode = ERROR_ICONV;
+			m_errorMessage = "encoding conversion failed";
+			throw m_errorCode;
+		}
+	} else if (&value != &m_stringBuf || data != m_stringBuf.data()) {
+		value.assign(data, dataLen);
+	}
+}
+
+/*
+ * Skip JSON value of any type.
+ */
+void
+MarcJsonReader::skipValue(const char *&pos, const char *end, int depth)
+{
+	if (depth > JSON_MAX_NESTING_DEPTH) {
+		throwError(pos, "nesting is too deep");
+	}
+
+	if (skipChar(pos, end, '{')) {
+		// Skip object.
+		if (!skipChar(pos, end, '}')) {
+			do {
+				parseString(pos, end, m_stringBuf, false);
+				expectChar(pos, end, ':');
+				skipValue(pos, end, depth + 1);
+			} while (skipChar(pos, end, ','));
+			expectChar(pos, end, '}');
+		}
+	} else if (skipChar(pos, end, '[')) {
+		// Skip array.
+		if (!skipChar(pos, end, ']')) {
+			do {
+				skipValue(pos, end, depth + 1);
+			} while (skipChar(pos, end, ','));
+			expectChar(pos, end, ']');
+		}
+	} else if (pos < end && *pos == '"') {
+		// Skip string.
+		parseString(pos, end, m_stringBuf, false);
+	} else {
+		// Skip number or literal.
+		const char *start = pos;
+		while (pos < end && (isalnum((unsigned char) *pos)
+			|| *pos == '-' || *pos == '+' || *pos == '.'))
+		{
+			pos++;
+		}
+		if (pos == start) {
+			throwError(pos, "value expected");
+		}
+	}
+}
+
+/*
+ * Parse array of fields.
+ */
+void
+MarcJsonReader::parseFields(const char *&pos, const char *end,
+	MarcRecord &record)
+{
+	expectChar(pos, end, '[');
+	if (skipChar(pos, end, ']')) {
+		return;
+	}
+
+	do {
+		// Add field with tag from key of field object.
+		record.m_fieldList.push_back(MarcRecord::Field());
+		MarcRecord::Field &field = record.m_fieldList.back();
+		expectChar(pos, end, '{');
+		parseString(pos, end, field.m_tag, false);
+		expectChar(pos, end, ':');
+
+		// Parse control field (string) or data field (object).
+		if (skipChar(pos, end, '{')) {
+			field.m_type = MarcRecord::Field::DATAFIELD;
+			parseDataField(pos, end, field);
+		} else if (pos < end && *pos == '"') {
+			field.m_type = MarcRecord::Field::CONTROLFIELD;
+			parseString(pos, end, field.m_data, true);
+		} else {
+			throwError(pos, "invalid field value");
+		}
+		expectChar(pos, end, '}');
+	} while (skipChar(pos, end, ','));
+	expectChar(pos, end, ']');
+}
+
+/*
+ * Parse indicators and subfields of data field (opening brace is
+ * skipped already).
+ */
+void
+MarcJsonReader::parseDataField(const char *&pos, const char *end,
+	MarcRecord::Field &field)
+{
+	field.m_ind1 = ' ';
+	field.m_ind2 = ' ';
+	if (skipChar(pos, end, '}')) {
+		return;
+	}
+
+	do {
+		parseString(pos, end, m_keyBuf, false);
+		expectChar(pos, end, ':');
+
+		if (m_keyBuf == "ind1" || m_keyBuf == "ind2") {
+			// Parse indicator.
+			const char *valuePos = pos;
+			parseString(pos, end, m_stringBuf, false);
+			if (m_stringBuf.size() != 1) {
+				throwError(valuePos, "invalid indicator");
+			}
+			if (m_keyBuf[3] == '1') {
+				field.m_ind1 = m_stringBuf[0];
+			} else {
+				field.m_ind2 = m_stringBuf[0];
+			}
+		} else if (m_keyBuf == "subfields") {
+			// Parse array of subfields.
+			expectChar(pos, end, '[');
+			if (skipChar(pos, end, ']')) {
+				continue;
+			}
+			do {
+				expectChar(pos, end, '{');
+				const char *idPos = pos;
+				parseString(pos, end, m_keyBuf, false);
+				if (m_keyBuf.size() != 1) {
+					throwError(idPos,
+						"invalid subfield identifier");
+				}
+				expectChar(pos, end, ':');
+
+				field.m_subfieldList.push_back(
+					MarcRecord::Subfield(m_keyBuf[0]));
+				parseString(pos, end,
+					field.m_subfieldList.back().m_data, true);
+				expectChar(pos, end, '}');
+			} while (skipChar(pos, end, ','));
+			expectChar(pos, end, ']');
+		} else {
+			skipValue(pos, end, 0);
+		}
+	} while (skipChar(pos, end, ','));
+	expectChar(pos, end, '}');
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCJSON_READER_H
+#define MARCRECORD_MARCJSON_READER_H
+
+#include <iconv.h>
+#include <string>
+#include <vector>
+#include "marc_reader.h"
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * MARC-in-JSON records reader (JSON array or JSON Lines).
+ */
+class MarcJsonReader : public MarcReader {
+protected:
+	// Iconv descriptor for input encoding conversion.
+	iconv_t m_iconvDesc;
+
+	// Input buffer.
+	std::vector<char> m_inputBuf;
+	// Position of unread data in input buffer.
+	size_t m_inputBufPos;
+	// Length of data in input buffer.
+	size_t m_inputBufLen;
+	// Position in input of data at beginning of input buffer.
+	unsigned long long m_inputBufStart;
+	// End of input file reached flag.
+	bool m_inputEof;
+
+	// Beginning of parsed record (for error positions).
+	const char *m_recordData;
+	// Buffer for keys of objects.
+	std::string m_keyBuf;
+	// Buffer for unescaped and skipped strings.
+	std::string m_stringBuf;
+
+private:
+	// Read more data to input buffer (returns false at end of input).
+	bool readInput(void);
+	// Read text of record from input buffer.
+	bool readRecord(const char *&recordData, size_t &recordLen);
+
+	// Throw syntax error at specified position.
+	void throwError(const char *pos, const char *message);
+	// Skip whitespace.
+	void skipSpace(const char *&pos, const char *end);
+	// Skip whitespace and check next character.
+	bool skipChar(const char *&pos, const char *end, char c);
+	// Skip whitespace and required character.
+	void expectChar(const char *&pos, const char *end, char c);
+	// Parse JSON string.
+	void parseString(const char *&pos, const char *end,
+		std::string &value, bool recode);
+	// Skip JSON value of any type.
+	void skipValue(const char *&pos, const char *end, int depth);
+	// Parse array of fields.
+	void parseFields(const char *&pos, const char *end,
+		MarcRecord &record);
+	// Parse indicators and subfields of data field.
+	void parseDataField(const char *&pos, const char *end,
+		MarcRecord::Field &field);
+
+public:
+	// Constructor.
+	MarcJsonReader(FILE *inputFile = NULL,
+		const char *inputEncoding = NULL);
+	// Destructor.
+	~MarcJsonReader();
+
+	// Open input file.
+	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Close input file.
+	void close(void);
+	// Read next record from file.
+	bool next(MarcRecord &record);
+	// Reset state of reading to start new input from input source.
+	bool reset(void);
+	// Get position in input after last read record.
+	unsigned long long getInputPos(void);
+
+	// Parse record from JSON text (lines of JSON Lines file can be
+	// parsed in parallel by separate readers).
+	bool parseRecord(const char *recordData, size_t recordLen,
+		MarcRecord &record);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCJSON_READER_H
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcjson_writer.h"
+
+namespace marcrecord {
+
+// Maximal length of escaped character ("\u001f").
+#define JSON_ESCAPE_SIZE		6
+// Maximal length of markup of record, field and subfield.
+#define JSON_RECORD_MARKUP_SIZE		32
+#define JSON_FIELD_MARKUP_SIZE		48
+#define JSON_SUBFIELD_MARKUP_SIZE	8
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcJsonWriter::MarcJsonWriter(FILE *outputFile, const char *outputEncoding)
+	: MarcWriter()
+{
+	// Clear member variables.
+	m_linesMode = false;
+	m_numRecords = 0;
+
+	if (outputFile) {
+		// Open output file.
+		open(outputFile, outputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcJsonWriter::~MarcJsonWriter()
+{
+	// Close output file.
+	close();
+}
+
+/*
+ * Open output file.
+ */
+bool
+MarcJsonWriter::open(FILE *outputFile, const char *outputEncoding)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Initialize output stream parameters.
+	m_outputFile = outputFile == NULL ? stdout : outputFile;
+	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	m_numRecords = 0;
+	openOutput(m_outputFile);
+
+	// Initialize encoding conversion.
+	if (!m_encoder.open(outputEncoding)) {
+		m_errorCode = ERROR_ICONV;
+		if (errno == EINVAL) {
+			m_errorMessage = "encoding conversion is not supported";
+		} else {
+			m_errorMessage = "iconv initialization failed";
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Close output file.
+ */
+void
+MarcJsonWriter::close(void)
+{
+	// Write buffered data to output.
+	closeOutput();
+
+	// Finalize encoder.
+	m_encoder.close();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_outputFile = NULL;
+	m_outputEncoding = "";
+	m_linesMode = false;
+	m_numRecords = 0;
+}
+
+/*
+ * Write record to output file.
+ */
+bool
+MarcJsonWriter::write(MarcRecord &record)
+{
+	// Decode raw data of fields.
+	if (!decodeRecord(record)) {
+		return false;
+	}
+
+	// Make space for whole record in output buffer.
+	if (!reserveRecord(record.getEscapedSize(JSON_ESCAPE_SIZE,
+		JSON_FIELD_MARKUP_SIZE, JSON_SUBFIELD_MARKUP_SIZE)
+		+ JSON_RECORD_MARKUP_SIZE))
+	{
+		return false;
+	}
+
+	// Discard partially written record in case of error.
+	markOutput();
+
+	// Separate records in JSON array.
+	if (!m_linesMode && m_numRecords > 0 && !appendMarkup(",\n")) {
+		rollbackOutput();
+		return false;
+	}
+
+	if (!appendRecord(record)
+		|| (m_linesMode && !appendMarkup("\n")))
+	{
+		rollbackOutput();
+		return false;
+	}
+	m_numRecords++;
+
+	return true;
+}
+
+/*
+ * Set JSON Lines mode (one record per line).
+ */
+void
+MarcJsonWriter::setLinesMode(bool linesMode)
+{
+	m_linesMode = linesMode;
+}
+
+/*
+ * Write header to output file.
+ */
+bool
+MarcJsonWriter::writeHeader(void)
+{
+	// Records are counted from start of output.
+	m_numRecords = 0;
+
+	// Records in JSON Lines are not enclosed in array.
+	if (m_linesMode) {
+		return true;
+	}
+
+	return appendMarkup("[\n");
+}
+
+/*
+ * Write footer to output file.
+ */
+bool
+MarcJsonWriter::writeFooter(void)
+{
+	if (m_linesMode) {
+		return true;
+	}
+
+	return appendMarkup(m_numRecords > 0 ? "\n]\n" : "]\n");
+}
+
+/*
+ * Append record to output buffer.
+ */
+bool
+MarcJsonWriter::appendRecord(MarcRecord &record)
+{
+	// Append record leader.
+	if (!appendMarkup("{\"leader\":\"")
+		|| !appendJsonData((char *) &record.m_leader,
+			sizeof(MarcRecord::Leader))
+		|| !appendMarkup("\",\"fields\":["))
+	{
+		return false;
+	}
+
+	// Iterate all fields.
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		// Append field tag.
+		if (!appendMarkup(fieldIt == record.m_fieldList.begin()
+			? "{\"" : ",{\"")
+			|| !appendJsonData(fieldIt->m_tag)
+			|| !appendMarkup("\":"))
+		{
+			return false;
+		}
+
+		if (fieldIt->m_tag < "010") {
+			// Append control field.
+			if (!appendMarkup("\"")
+				|| !appendJsonData(fieldIt->m_data)
+				|| !appendMarkup("\"}"))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		// Append indicators of data field.
+		if (!appendMarkup("{\"ind1\":\"")
+			|| !appendJsonData(&fieldIt->m_ind1, 1)
+			|| !appendMarkup("\",\"ind2\":\"")
+			|| !appendJsonData(&fieldIt->m_ind2, 1)
+			|| !appendMarkup("\",\"subfields\":["))
+		{
+			return false;
+		}
+
+		// Iterate all subfields.
+		MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->m_subfieldList.begin();
+		for (; subfieldIt != fieldIt->m_subfieldList.end();
+			subfieldIt++)
+		{
+			// Append subfield.
+			if (!appendMarkup(subfieldIt
+				== fieldIt->m_subfieldList.begin()
+				? "{\"" : ",{\"")
+				|| !appendJsonData(&subfieldIt->m_id, 1)
+				|| !appendMarkup("\":\"")
+				|| !appendJsonData(subfieldIt->m_data)
+				|| !appendMarkup("\"}"))
+			{
+				return false;
+			}
+		}
+
+		if (!appendMarkup("]}}")) {
+			return false;
+		}
+	}
+
+	return appendMarkup("]}");
+}
@@ -241,6 +241,78 @@ MarcRecord::removeField(FieldIt fieldIt)
 	m_fieldList.erase(fieldIt);
 }
 
+/*
+ * Get size of record in ISO 2709 format (exact if data is written
+ * without encoding conversion, raw data of fields isn't decoded).
+ */
+size_t
+MarcRecord::getIsoSize(void)
+{
+	// Leader, directory entries (12 bytes) and separator of directory,
+	// record separator.
+	size_t recordSize = sizeof(Leader) + m_fieldList.size() * 12 + 2;
+
+	// Iterate all fields.
+	for (MarcRecord::FieldIt fieldIt = m_fieldList.begin();
+		fieldIt != m_fieldList.end(); fieldIt++)
+	{
+		if (fieldIt->isRaw()) {
+			// Raw data of field is copied as is.
+			recordSize += fieldIt->m_rawData.size() + 1;
+		} else if (fieldIt->m_tag < "010") {
+			recordSize += fieldIt->m_data.size() + 1;
+		} else {
+			// Indicators, subfields and field separator.
+			recordSize += 3;
+			MarcRecord::SubfieldIt subfieldIt =
+				fieldIt->m_subfieldList.begin();
+			for (; subfieldIt != fieldIt->m_subfieldList.end();
+				subfieldIt++)
+			{
+				recordSize += subfieldIt->m_data.size() + 2;
+			}
+		}
+	}
+
+	return recordSize;
+}
+
+/*
+ * Get upper bound of size of serialized record (characters may be
+ * escaped to escapeSize bytes, markup of each field and subfield is
+ * not longer than fieldSize and subfieldSize). Fields are decoded.
+ */
+size_t
+MarcRecord::getEscapedSize(size_t escapeSize, size_t fieldSize,
+	size_t subfieldSize)
+{
+	size_t dataSize = sizeof(Leader);
+	size_t markupSize = 0;
+
+	// Iterate all fields.
+	for (MarcRecord::FieldIt fieldIt = m_fieldList.begin();
+		fieldIt != m_fieldList.end(); fieldIt++)
+	{
+		fieldIt->decode();
+
+		// Tag, indicators and data of field.
+		markupSize += fieldSize;
+		dataSize += fieldIt->m_tag.size() + 2 + fieldIt->m_data.size();
+
+		// Identifiers and data of subfields.
+		MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->m_subfieldList.begin();
+		for (; subfieldIt != fieldIt->m_subfieldList.end();
+			subfieldIt++)
+		{
+			markupSize += subfieldSize;
+			dataSize += subfieldIt->m_data.size() + 1;
+		}
+	}
+
+	return dataSize * escapeSize + markupSize;
+}
+
 /*
  * Format record to string for printing.
  */
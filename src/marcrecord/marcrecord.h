@@ -35,6 +35,9 @@
 
 namespace marcrecord {
 
+// ISO 2709 reader class.
+class MarcIsoReader;
+
 /*
  * MARC record class.
  */
@@ -108,12 +111,22 @@ public:
 	friend class MarcIsoReader;
 	// ISO 2709 writer class.
 	friend class MarcIsoWriter;
+	// Binary records reader class.
+	friend class MarcBinaryReader;
+	// Binary records writer class.
+	friend class MarcBinaryWriter;
 	// MARCXML reader class.
 	friend class MarcXmlReader;
 	// MARCXML writer class.
 	friend class MarcXmlWriter;
 	// UNIMARCXML writer class.
 	friend class UnimarcXmlWriter;
+	// MARC-in-JSON reader class.
+	friend class MarcJsonReader;
+	// MARC-in-JSON writer class.
+	friend class MarcJsonWriter;
+	// Columnar writer class.
+	friend class MarcColumnWriter;
 
 	// List of fields.
 	typedef std::list<Field> FieldList;
@@ -184,6 +197,15 @@ public:
 	// Remove field from the record.
 	void removeField(FieldIt fieldIt);
 
+	// Get size of record in ISO 2709 format (exact if data is written
+	// without encoding conversion, raw data of fields isn't decoded).
+	size_t getIsoSize(void);
+	// Get upper bound of size of serialized record (characters may be
+	// escaped to escapeSize bytes, markup of each field and subfield is
+	// not longer than fieldSize and subfieldSize).
+	size_t getEscapedSize(size_t escapeSize, size_t fieldSize,
+		size_t subfieldSize);
+
 	// Format record to string for printing.
 	std::string toString(void);
 
@@ -220,6 +242,15 @@ public:
 	// List of regular subfields.
 	SubfieldList m_subfieldList;
 
+	// Raw ISO 2709 data of field (not decoded yet).
+	std::string m_rawData;
+	// Reader which decodes raw data of field (NULL if field is decoded).
+	MarcIsoReader *m_rawReader;
+
+private:
+	// Decode raw ISO 2709 data of field.
+	bool decodeRawData(void);
+
 public:
 	// Constructors.
 	Field(const std::string &tag = "", const std::string &data = "");
@@ -228,6 +259,17 @@ public:
 	// Clear field data.
 	void clear();
 
+	// Return true if field data is not decoded yet.
+	inline bool isRaw(void)
+	{
+		return m_rawReader != NULL;
+	}
+	// Decode field data (if it is not decoded yet).
+	inline bool decode(void)
+	{
+		return m_rawReader == NULL || decodeRawData();
+	}
+
 	// Set type of field to controlfield.
 	void setControlFieldType(void);
 	// Set type of field to datafield.
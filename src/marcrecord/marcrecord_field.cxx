@@ -28,6 +28,7 @@
 
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
+#include "marciso_reader.h"
 
 using namespace marcrecord;
 
@@ -63,6 +64,17 @@ MarcRecord::Field::clear(void)
 	m_ind1 = ' ';
 	m_ind2 = ' ';
 	m_subfieldList.clear();
+	m_rawData.erase();
+	m_rawReader = NULL;
+}
+
+/*
+ * Decode raw ISO 2709 data of field.
+ */
+bool
+MarcRecord::Field::decodeRawData(void)
+{
+	return m_rawReader->decodeField(*this);
 }
 
 /*
@@ -167,6 +179,9 @@ MarcRecord::Field::setInd2(const char ind2)
 std::string &
 MarcRecord::Field::getData(void)
 {
+	// Decode raw data of field.
+	decode();
+
 	return m_data;
 }
 
@@ -176,6 +191,9 @@ MarcRecord::Field::getData(void)
 void
 MarcRecord::Field::setData(const std::string &data)
 {
+	// Decode raw data of field.
+	decode();
+
 	m_data = data;
 }
 
@@ -185,6 +203,9 @@ MarcRecord::Field::setData(const std::string &data)
 std::string
 MarcRecord::Field::toString(void)
 {
+	// Decode raw data of field.
+	decode();
+
 	// Format control field to string.
 	if (m_type == CONTROLFIELD) {
 		return (m_tag + " " + m_data);
@@ -229,6 +250,9 @@ MarcRecord::Field::getSubfields(char subfieldId)
 	SubfieldRefList resultSubfieldList;
 	SubfieldIt subfieldIt;
 
+	// Decode raw data of field.
+	decode();
+
 	// Check subfields in list.
 	subfieldIt = m_subfieldList.begin();
 	for (; subfieldIt != m_subfieldList.end(); subfieldIt++) {
@@ -248,6 +272,9 @@ MarcRecord::Field::getSubfield(char subfieldId)
 {
 	SubfieldIt subfieldIt;
 
+	// Decode raw data of field.
+	decode();
+
 	// Check subfields in list.
 	subfieldIt = m_subfieldList.begin();
 	for (; subfieldIt != m_subfieldList.end(); subfieldIt++) {
@@ -268,6 +295,9 @@ MarcRecord::Field::getEmbeddedFields(const std::string &fieldTag)
 	EmbeddedFieldList resultFieldList;
 	SubfieldRefList embeddedSubfieldList;
 
+	// Decode raw data of field.
+	decode();
+
 	// Check subfields in list.
 	embeddedSubfieldList.clear();
 	for (SubfieldIt subfieldIt = m_subfieldList.begin();
@@ -309,6 +339,9 @@ MarcRecord::Field::getEmbeddedField(const std::string &fieldTag)
 {
 	SubfieldRefList embeddedSubfieldList;
 
+	// Decode raw data of field.
+	decode();
+
 	// Check subfields in list.
 	embeddedSubfieldList.clear();
 	for (SubfieldIt subfieldIt = m_subfieldList.begin();
@@ -340,6 +373,9 @@ MarcRecord::Field::getEmbeddedField(const std::string &fieldTag)
 MarcRecord::SubfieldIt
 MarcRecord::Field::addSubfield(const Subfield &subfield)
 {
+	// Decode raw data of field.
+	decode();
+
 	// Append subfield to the list.
 	SubfieldIt subfieldIt =
 		m_subfieldList.insert(m_subfieldList.end(), subfield);
@@ -350,6 +386,9 @@ MarcRecord::SubfieldIt
 MarcRecord::Field::addSubfield(char subfieldId,
 	const std::string &subfieldData)
 {
+	// Decode raw data of field.
+	decode();
+
 	// Append subfield to the list.
 	SubfieldIt subfieldIt = m_subfieldList.insert(m_subfieldList.end(),
 		Subfield(subfieldId, subfieldData));
@@ -363,6 +402,9 @@ MarcRecord::SubfieldIt
 MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
 	const Subfield &subfield)
 {
+	// Decode raw data of field.
+	decode();
+
 	// Append subfield to the list.
 	SubfieldIt subfieldIt =
 		m_subfieldList.insert(nextSubfieldIt, subfield);
@@ -373,6 +415,9 @@ MarcRecord::SubfieldIt
 MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
 	char subfieldId, const std::string &subfieldData)
 {
+	// Decode raw data of field.
+	decode();
+
 	// Append subfield to the list.
 	SubfieldIt subfieldIt = m_subfieldList.insert(nextSubfieldIt,
 		Subfield(subfieldId, subfieldData));
@@ -385,6 +430,9 @@ MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
 void
 MarcRecord::Field::removeSubfield(SubfieldIt subfieldIt)
 {
+	// Decode raw data of field.
+	decode();
+
 	// Remove subfield from the list.
 	m_subfieldList.erase(subfieldIt);
 }
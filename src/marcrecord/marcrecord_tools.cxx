@@ -30,8 +30,19 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <stdint.h>
 #include "marcrecord_tools.h"
 
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MARCRECORD_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 namespace marcrecord {
 
 /*
@@ -101,17 +112,40 @@ serialize_xml(std::string &s)
 	return dest;
 }
 
+/*
+ * Verify that 8 bytes packed into word are decimal digits in ASCII encoding.
+ * Each byte must be in range 0x30..0x39: its high nibble is 3 and adding 6
+ * doesn't carry into the high nibble (no carries cross byte boundaries).
+ */
+static inline bool
+is_numeric_word(uint64_t word)
+{
+	return (word & 0xF0F0F0F0F0F0F0F0ULL) == 0x3030303030303030ULL
+		&& ((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL)
+		== 0x3030303030303030ULL;
+}
+
 /*
  * Verify that all string characters are decimal digits in ASCII encoding.
  */
 int
 is_numeric(const char *s, size_t n)
 {
-	char *p, *s_end;
+	uint64_t word;
 
-	s_end = (char *) s + n;
-	for (p = (char *) s; p < s_end && *p != '\0'; p++) {
-		if (*p < 0x30 || *p > 0x39) {
+	// Check 8 characters at once.
+	for (; n >= 8; s += 8, n -= 8) {
+		memcpy(&word, s, 8);
+		if (!is_numeric_word(word)) {
+			return 0;
+		}
+	}
+
+	// Check rest of characters (padded with digits).
+	if (n > 0) {
+		word = 0x3030303030303030ULL;
+		memcpy(&word, s, n);
+		if (!is_numeric_word(word)) {
 			return 0;
 		}
 	}
@@ -119,6 +153,292 @@ is_numeric(const char *s, size_t n)
 	return 1;
 }
 
+/*
+ * Parse fixed-width decimal number (up to 9 digits).
+ */
+bool
+parse_decimal(const char *s, size_t n, unsigned int &value)
+{
+	if (n > 9 || !is_numeric(s, n)) {
+		return false;
+	}
+
+	value = 0;
+	for (const char *s_end = s + n; s < s_end; s++) {
+		value = value * 10 + (unsigned int) (*s - '0');
+	}
+
+	return true;
+}
+
+/*
+ * Format fixed-width decimal number with leading zeros.
+ */
+bool
+format_decimal(char *s, size_t n, unsigned int value)
+{
+	for (char *p = s + n; p > s; value /= 10) {
+		*(--p) = (char) ('0' + value % 10);
+	}
+
+	// Check if number fits into specified width.
+	return value == 0;
+}
+
+/*
+ * Store little-endian 32-bit unsigned number.
+ */
+void
+store_uint32(char *s, unsigned int value)
+{
+	for (int i = 0; i < 4; i++, value >>= 8) {
+		s[i] = (char) (value & 0xFF);
+	}
+}
+
+/*
+ * Load little-endian 32-bit unsigned number.
+ */
+unsigned int
+load_uint32(const char *s)
+{
+	unsigned int value = 0;
+	for (int i = 3; i >= 0; i--) {
+		value = (value << 8) | (unsigned char) s[i];
+	}
+
+	return value;
+}
+
+/*
+ * Store little-endian 64-bit unsigned number.
+ */
+void
+store_uint64(char *s, unsigned long long value)
+{
+	store_uint32(s, (unsigned int) (value & 0xFFFFFFFFUL));
+	store_uint32(s + 4, (unsigned int) (value >> 32));
+}
+
+/*
+ * Load little-endian 64-bit unsigned number.
+ */
+unsigned long long
+load_uint64(const char *s)
+{
+	return ((unsigned long long) load_uint32(s + 4) << 32)
+		| load_uint32(s);
+}
+
+/*
+ * Get size of unsigned LEB128 number.
+ */
+size_t
+varint_size(unsigned long long value)
+{
+	size_t n = 1;
+	for (; value >= 0x80; value >>= 7) {
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Encode unsigned LEB128 number (returns number of bytes, up to 10).
+ */
+size_t
+encode_varint(char *s, unsigned long long value)
+{
+	size_t n = 0;
+	for (; value >= 0x80; value >>= 7) {
+		s[n++] = (char) ((value & 0x7F) | 0x80);
+	}
+	s[n++] = (char) value;
+
+	return n;
+}
+
+/*
+ * Decode unsigned LEB128 number (returns number of bytes, 0 if invalid).
+ */
+size_t
+decode_varint(const char *s, size_t n, unsigned long long &value)
+{
+	value = 0;
+	for (size_t i = 0; i < n && i < 10; i++) {
+		unsigned char c = (unsigned char) s[i];
+		value |= (unsigned long long) (c & 0x7F) << (7 * i);
+		if ((c & 0x80) == 0) {
+			return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Get value of hexadecimal digit (-1 if character is not a digit).
+ */
+int
+hex_digit(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+/*
+ * Encode Unicode code point in UTF-8 (returns number of bytes, up to 4).
+ */
+size_t
+encode_utf8(char *s, unsigned int code)
+{
+	if (code < 0x80) {
+		s[0] = (char) code;
+		return 1;
+	} else if (code < 0x800) {
+		s[0] = (char) (0xC0 | (code >> 6));
+		s[1] = (char) (0x80 | (code & 0x3F));
+		return 2;
+	} else if (code < 0x10000) {
+		s[0] = (char) (0xE0 | (code >> 12));
+		s[1] = (char) (0x80 | ((code >> 6) & 0x3F));
+		s[2] = (char) (0x80 | (code & 0x3F));
+		return 3;
+	}
+
+	s[0] = (char) (0xF0 | (code >> 18));
+	s[1] = (char) (0x80 | ((code >> 12) & 0x3F));
+	s[2] = (char) (0x80 | ((code >> 6) & 0x3F));
+	s[3] = (char) (0x80 | (code & 0x3F));
+	return 4;
+}
+
+/*
+ * Lookup tables for CRC-32C calculation (slicing by 8 bytes).
+ */
+struct Crc32cTable {
+	unsigned int t[8][256];
+
+	Crc32cTable()
+	{
+		for (unsigned int i = 0; i < 256; i++) {
+			unsigned int crc = i;
+			for (int j = 0; j < 8; j++) {
+				crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+			}
+			t[0][i] = crc;
+		}
+		for (unsigned int i = 0; i < 256; i++) {
+			for (int k = 1; k < 8; k++) {
+				t[k][i] = (t[k - 1][i] >> 8)
+					^ t[0][t[k - 1][i] & 0xFF];
+			}
+		}
+	}
+};
+
+static const Crc32cTable crc32cTable;
+
+/*
+ * Calculate CRC-32C checksum (crc of previous data is continued).
+ */
+unsigned int
+crc32c(unsigned int crc, const char *s, size_t n)
+{
+	const unsigned int (*t)[256] = crc32cTable.t;
+	const unsigned char *p = (const unsigned char *) s;
+
+	crc = ~crc;
+	for (; n >= 8; p += 8, n -= 8) {
+		unsigned int lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16)
+			| ((unsigned int) p[3] << 24));
+		unsigned int hi = p[4] | (p[5] << 8) | (p[6] << 16)
+			| ((unsigned int) p[7] << 24);
+		crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF]
+			^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+			^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF]
+			^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+	}
+	for (; n > 0; p++, n--) {
+		crc = t[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+#ifdef MARCRECORD_SSE2
+/*
+ * Get position of lowest set bit in non-zero mask.
+ */
+static inline unsigned int
+lowest_bit(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long pos;
+	_BitScanForward(&pos, mask);
+	return (unsigned int) pos;
+#elif defined(__GNUC__)
+	return (unsigned int) __builtin_ctz(mask);
+#else
+	unsigned int pos = 0;
+	for (; (mask & 1) == 0; mask >>= 1) {
+		pos++;
+	}
+	return pos;
+#endif
+}
+#endif
+
+/*
+ * Build index of ISO 2709 delimiters (0x1D, 0x1E, 0x1F) positions.
+ * Positions are relative to the start of string.
+ */
+void
+scan_delimiters(const char *s, size_t begin, size_t end,
+	std::vector<unsigned int> &index)
+{
+	size_t pos = begin;
+
+	index.clear();
+
+#ifdef MARCRECORD_SSE2
+	// Compare 16 characters at once with all delimiters.
+	const __m128i recordSeparator = _mm_set1_epi8(0x1D);
+	const __m128i fieldSeparator = _mm_set1_epi8(0x1E);
+	const __m128i identifierDelimiter = _mm_set1_epi8(0x1F);
+	for (; pos + 16 <= end; pos += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *) (s + pos));
+		__m128i matches = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, recordSeparator),
+				_mm_cmpeq_epi8(chunk, fieldSeparator)),
+			_mm_cmpeq_epi8(chunk, identifierDelimiter));
+		unsigned int mask = (unsigned int) _mm_movemask_epi8(matches);
+
+		// Append positions of matched characters.
+		for (; mask != 0; mask &= mask - 1) {
+			index.push_back(
+				(unsigned int) pos + lowest_bit(mask));
+		}
+	}
+#endif
+
+	// Check rest of characters.
+	for (; pos < end; pos++) {
+		unsigned char c = (unsigned char) s[pos];
+		if (c >= 0x1D && c <= 0x1F) {
+			index.push_back((unsigned int) pos);
+		}
+	}
+}
+
 /*
  * Convert encoding for std::string.
  */
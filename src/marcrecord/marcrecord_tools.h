@@ -31,6 +31,7 @@
 
 #include <iconv.h>
 #include <string>
+#include <vector>
 
 namespace marcrecord {
 
@@ -40,6 +41,33 @@ int snprintf(std::string &s, size_t n, const char *format, ...);
 std::string serialize_xml(std::string &s);
 // Verify that all string characters are decimal digits in ASCII encoding.
 int is_numeric(const char *s, size_t n);
+// Parse fixed-width decimal number (up to 9 digits).
+bool parse_decimal(const char *s, size_t n, unsigned int &value);
+// Format fixed-width decimal number with leading zeros.
+bool format_decimal(char *s, size_t n, unsigned int value);
+// Store little-endian 32-bit unsigned number.
+void store_uint32(char *s, unsigned int value);
+// Load little-endian 32-bit unsigned number.
+unsigned int load_uint32(const char *s);
+// Store little-endian 64-bit unsigned number.
+void store_uint64(char *s, unsigned long long value);
+// Load little-endian 64-bit unsigned number.
+unsigned long long load_uint64(const char *s);
+// Get size of unsigned LEB128 number.
+size_t varint_size(unsigned long long value);
+// Encode unsigned LEB128 number (returns number of bytes, up to 10).
+size_t encode_varint(char *s, unsigned long long value);
+// Decode unsigned LEB128 number (returns number of bytes, 0 if invalid).
+size_t decode_varint(const char *s, size_t n, unsigned long long &value);
+// Get value of hexadecimal digit (-1 if character is not a digit).
+int hex_digit(char c);
+// Encode Unicode code point in UTF-8 (returns number of bytes, up to 4).
+size_t encode_utf8(char *s, unsigned int code);
+// Calculate CRC-32C checksum (crc of previous data is continued).
+unsigned int crc32c(unsigned int crc, const char *s, size_t n);
+// Build index of ISO 2709 delimiters (0x1D, 0x1E, 0x1F) positions.
+void scan_delimiters(const char *s, size_t begin, size_t end,
+	std::vector<unsigned int> &index);
 // Convert encoding for std::string.
 bool iconv(iconv_t iconv_desc, const std::string &src, std::string &dest);
 // Convert encoding for std::string.
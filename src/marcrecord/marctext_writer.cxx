@@ -43,7 +43,6 @@ MarcTextWriter::MarcTextWriter(FILE *outputFile, const char *outputEncoding)
 	: MarcWriter()
 {
 	// Clear member variables.
-	m_iconvDesc = (iconv_t) -1;
 	m_recordHeader = "";
 	m_recordFooter = "";
 
@@ -96,26 +95,17 @@ MarcTextWriter::open(FILE *outputFile, const char *outputEncoding)
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
 	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
 
 	// Initialize encoding conversion.
-	if (outputEncoding == NULL
-		|| strcmp(outputEncoding, "UTF-8") == 0
-		|| strcmp(outputEncoding, "utf-8") == 0)
-	{
-		m_iconvDesc = (iconv_t) -1;
-	} else {
-		// Create iconv descriptor for output encoding conversion.
-		m_iconvDesc = iconv_open(outputEncoding, "UTF-8");
-		if (m_iconvDesc == (iconv_t) -1) {
-			m_errorCode = ERROR_ICONV;
-			if (errno == EINVAL) {
-				m_errorMessage =
-					"encoding conversion is not supported";
-			} else {
-				m_errorMessage = "iconv initialization failed";
-			}
-			return false;
+	if (!m_encoder.open(outputEncoding)) {
+		m_errorCode = ERROR_ICONV;
+		if (errno == EINVAL) {
+			m_errorMessage = "encoding conversion is not supported";
+		} else {
+			m_errorMessage = "iconv initialization failed";
 		}
+		return false;
 	}
 
 	return true;
@@ -127,17 +117,17 @@ MarcTextWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 MarcTextWriter::close(void)
 {
-	// Finalize iconv.
-	if (m_iconvDesc != (iconv_t) -1) {
-		iconv_close(m_iconvDesc);
-	}
+	// Write buffered data to output.
+	closeOutput();
+
+	// Finalize encoder.
+	m_encoder.close();
 
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_outputFile = NULL;
 	m_outputEncoding = "";
-	m_iconvDesc = (iconv_t) -1;
 }
 
 /*
@@ -146,33 +136,20 @@ MarcTextWriter::close(void)
 bool
 MarcTextWriter::write(MarcRecord &record)
 {
+	// Decode raw data of fields.
+	if (!decodeRecord(record)) {
+		return false;
+	}
+
 	std::string recordBuf = m_recordHeader + record.toString()
 		+ m_recordFooter;
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write MARCXML record.
-		if (fwrite(recordBuf.c_str(), recordBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write MARCXML record with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, recordBuf, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
+	// Append MARC text record to output buffer.
+	markOutput();
+	if (!appendEncoded(recordBuf)) {
+		// Discard partially written record.
+		rollbackOutput();
+		return false;
 	}
 
 	return true;
@@ -29,7 +29,6 @@
 #ifndef MARCRECORD_MARCTEXT_WRITER_H
 #define MARCRECORD_MARCTEXT_WRITER_H
 
-#include <iconv.h>
 #include <string>
 #include "marc_writer.h"
 #include "marcrecord.h"
@@ -41,9 +40,6 @@ namespace marcrecord {
  */
 class MarcTextWriter : public MarcWriter {
 protected:
-	// Iconv descriptor for output encoding.
-	iconv_t m_iconvDesc;
-
 	// Record header.
 	std::string m_recordHeader;
 	// Record footer.
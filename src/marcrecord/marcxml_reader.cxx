@@ -26,11 +26,13 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <iconv.h>
 #include <string>
 
+#include "marc_codec_cache.h"
 #include "marcrecord.h"
 #include "marcxml_reader.h"
 
@@ -91,23 +93,10 @@ MarcXmlReader::open(FILE *inputFile, const char *inputEncoding)
 	// Initialize input stream parameters.
 	m_inputFile = inputFile == NULL ? stdin : inputFile;
 	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+	openInput(m_inputFile);
 
 	// Create XML parser.
-	m_xmlParser = XML_ParserCreate(inputEncoding);
-	XML_SetUserData(m_xmlParser, &m_parserState);
-	XML_SetElementHandler(m_xmlParser,
-		marcXmlStartElement, marcXmlEndElement);
-	XML_SetCharacterDataHandler(m_xmlParser, marcXmlCharacterData);
-	XML_SetUnknownEncodingHandler(m_xmlParser,
-		marcXmlUnknownEncoding, NULL);
-
-	// Initialize XML parser state.
-	m_parserState.xmlParser = m_xmlParser;
-	m_parserState.done = false;
-	m_parserState.paused = false;
-	m_parserState.parentTag = "";
-	m_parserState.record = NULL;
-	m_parserState.characterData.erase();
+	createParser();
 
 	return true;
 }
@@ -119,17 +108,15 @@ void
 MarcXmlReader::close(void)
 {
 	// Free XML parser.
-	if (m_xmlParser) {
-		XML_ParserFree(m_xmlParser);
-	}
+	freeParser();
 
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_inputFile = NULL;
+	m_input = NULL;
 	m_inputEncoding = "";
 	m_autoCorrectionMode = false;
-	m_xmlParser = NULL;
 
 	// Clear XML parser state.
 	m_parserState.xmlParser = NULL;
@@ -138,6 +125,10 @@ MarcXmlReader::close(void)
 	m_parserState.parentTag = "";
 	m_parserState.record = NULL;
 	m_parserState.characterData.erase();
+	m_parserState.findRecord = false;
+	m_parserState.recordStartIndex = -1;
+	m_parserState.recordEndIndex = 0;
+	m_inputPosBase = 0;
 }
 
 /*
@@ -164,8 +155,8 @@ MarcXmlReader::next(MarcRecord &record)
 			parserResult = XML_ResumeParser(m_xmlParser);
 		} else {
 			// Read and parse buffer from file.
-			size_t dataLength = (int) fread(m_buffer,
-				1, sizeof(m_buffer), m_inputFile);
+			size_t dataLength = m_input->read(m_buffer,
+				sizeof(m_buffer));
 			m_parserState.done = dataLength < sizeof(m_buffer);
 			parserResult = XML_Parse(m_xmlParser,
 				m_buffer, dataLength, m_parserState.done);
@@ -194,6 +185,166 @@ MarcXmlReader::next(MarcRecord &record)
 	return true;
 }
 
+/*
+ * Get position in input after last read record.
+ */
+unsigned long long
+MarcXmlReader::getInputPos(void)
+{
+	return (unsigned long long) (m_inputPosBase
+		+ m_parserState.recordEndIndex);
+}
+
+/*
+ * Set position in input (at start of record, data before first
+ * record is parsed again).
+ */
+bool
+MarcXmlReader::seekInput(unsigned long long inputPos)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	try {
+		// Find start of first record (parser is stopped there).
+		if (!m_input->seek(0)) {
+			throw std::string("input file is not seekable");
+		}
+		freeParser();
+		createParser();
+		m_parserState.findRecord = true;
+		while (m_parserState.recordStartIndex < 0
+			&& !m_parserState.done)
+		{
+			size_t dataLength = m_input->read(m_buffer,
+				sizeof(m_buffer));
+			m_parserState.done = dataLength < sizeof(m_buffer);
+			if (XML_Parse(m_xmlParser, m_buffer, dataLength,
+				m_parserState.done) == XML_STATUS_ERROR
+				&& m_parserState.recordStartIndex < 0)
+			{
+				throw std::string(XML_ErrorString(
+					XML_GetErrorCode(m_xmlParser)));
+			}
+		}
+		long long headerLength = m_parserState.recordStartIndex;
+
+		// Parse data before first record again.
+		freeParser();
+		createParser();
+		if (!m_input->seek(0)) {
+			throw std::string("input file is not seekable");
+		}
+		if (headerLength < 0) {
+			return true;
+		}
+		for (long long pos = 0; pos < headerLength; ) {
+			size_t dataLength = m_input->read(m_buffer,
+				(size_t) std::min((long long) sizeof(m_buffer),
+				headerLength - pos));
+			if (dataLength == 0) {
+				throw std::string("unexpected end of file");
+			}
+			if (XML_Parse(m_xmlParser, m_buffer, dataLength, 0)
+				== XML_STATUS_ERROR)
+			{
+				throw std::string(XML_ErrorString(
+					XML_GetErrorCode(m_xmlParser)));
+			}
+			pos += dataLength;
+		}
+
+		// Continue parsing from specified position.
+		if ((long long) inputPos > headerLength) {
+			if (!m_input->seek(inputPos)) {
+				throw std::string("input file is not seekable");
+			}
+			m_inputPosBase = (long long) inputPos - headerLength;
+		}
+		m_parserState.recordEndIndex = headerLength;
+	} catch (std::string errorMessage) {
+		m_errorCode = ERROR_XML_PARSER;
+		m_errorMessage = errorMessage;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Reset state of reading to start new input from input source
+ * (XML parser is reused).
+ */
+bool
+MarcXmlReader::reset(void)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	if (m_xmlParser == NULL || !XML_ParserReset(m_xmlParser,
+		m_inputEncoding.empty() ? NULL : m_inputEncoding.c_str()))
+	{
+		freeParser();
+		createParser();
+	} else {
+		initParser();
+	}
+
+	return true;
+}
+
+/*
+ * Create XML parser and initialize parser state.
+ */
+void
+MarcXmlReader::createParser(void)
+{
+	// Create XML parser.
+	m_xmlParser = XML_ParserCreate(m_inputEncoding.empty()
+		? NULL : m_inputEncoding.c_str());
+	initParser();
+}
+
+/*
+ * Set handlers of XML parser and initialize parser state.
+ */
+void
+MarcXmlReader::initParser(void)
+{
+	XML_SetUserData(m_xmlParser, &m_parserState);
+	XML_SetElementHandler(m_xmlParser,
+		marcXmlStartElement, marcXmlEndElement);
+	XML_SetCharacterDataHandler(m_xmlParser, marcXmlCharacterData);
+	XML_SetUnknownEncodingHandler(m_xmlParser,
+		marcXmlUnknownEncoding, NULL);
+
+	// Initialize XML parser state.
+	m_parserState.xmlParser = m_xmlParser;
+	m_parserState.done = false;
+	m_parserState.paused = false;
+	m_parserState.parentTag = "";
+	m_parserState.record = NULL;
+	m_parserState.characterData.erase();
+	m_parserState.findRecord = false;
+	m_parserState.recordStartIndex = -1;
+	m_parserState.recordEndIndex = 0;
+	m_inputPosBase = 0;
+}
+
+/*
+ * Free XML parser.
+ */
+void
+MarcXmlReader::freeParser(void)
+{
+	if (m_xmlParser) {
+		XML_ParserFree(m_xmlParser);
+		m_xmlParser = NULL;
+	}
+}
+
 namespace marcrecord {
 
 /*
@@ -208,6 +359,17 @@ marcXmlStartElement(void *userData, const XML_Char *name,
 
 	// Select MARCXML element.
 	if (strcmp(name, "record") == 0 && parserState->parentTag == "") {
+		// Save position of first record.
+		if (parserState->recordStartIndex < 0) {
+			parserState->recordStartIndex = (long long)
+				XML_GetCurrentByteIndex(parserState->xmlParser);
+		}
+		// Stop parser if start of first record is searched.
+		if (parserState->findRecord) {
+			XML_StopParser(parserState->xmlParser, XML_FALSE);
+			return;
+		}
+
 		// Set parent tag.
 		parserState->parentTag = name;
 	} else if (strcmp(name, "leader") == 0
@@ -295,6 +457,10 @@ marcXmlEndElement(void *userData, const XML_Char *name)
 	if (strcmp(name, "record") == 0) {
 		// Restore parent tag.
 		parserState->parentTag = "";
+		// Save position of end of record.
+		parserState->recordEndIndex = (long long)
+			XML_GetCurrentByteIndex(parserState->xmlParser)
+			+ XML_GetCurrentByteCount(parserState->xmlParser);
 		// Pause parser.
 		parserState->paused = true;
 		XML_StopParser(parserState->xmlParser, XML_TRUE);
@@ -342,8 +508,18 @@ marcXmlUnknownEncoding(void *data, const XML_Char *encoding,
 	iconv_t iconvDesc = (iconv_t) -1;
 	unsigned char iconvBuf[8];
 
+	// Use conversion table generated for previous parser.
+	const MarcByteMap *byteMap = find_byte_map(encoding);
+	if (byteMap != NULL) {
+		std::copy(byteMap->map, byteMap->map + 256, info->map);
+		info->data = NULL;
+		info->convert = NULL;
+		info->release = NULL;
+		return XML_STATUS_OK;
+	}
+
 	// Initialize iconv.
-	iconvDesc = iconv_open("UTF-16BE", encoding);
+	iconvDesc = acquire_iconv("UTF-16BE", encoding);
 	if (iconvDesc == (iconv_t) -1) {
 		return XML_STATUS_ERROR;
 	}
@@ -375,8 +551,11 @@ marcXmlUnknownEncoding(void *data, const XML_Char *encoding,
 		}
 	} while (i++ < 255);
 
-	// Finalize iconv.
-	iconv_close(iconvDesc);
+	// Finalize iconv and add conversion table to cache.
+	release_iconv(iconvDesc, "UTF-16BE", encoding);
+	MarcByteMap newMap;
+	std::copy(info->map, info->map + 256, newMap.map);
+	add_byte_map(encoding, newMap);
 
 	// Initialize rest of encoding information.
 	info->data = NULL;
@@ -52,6 +52,10 @@ public:
 		MarcRecord::FieldIt fieldIt;
 		MarcRecord::SubfieldIt subfieldIt;
 		std::string characterData;
+
+		bool findRecord;
+		long long recordStartIndex;
+		long long recordEndIndex;
 	};
 	typedef struct XmlParserState XmlParserState;
 
@@ -62,6 +66,15 @@ protected:
 	XmlParserState m_parserState;
 	// Record buffer.
 	char m_buffer[4096];
+	// Position in input of data parsed at byte index 0.
+	long long m_inputPosBase;
+
+	// Create XML parser and initialize parser state.
+	void createParser(void);
+	// Set handlers of XML parser and initialize parser state.
+	void initParser(void);
+	// Free XML parser.
+	void freeParser(void);
 
 public:
 	// Constructor.
@@ -76,6 +89,15 @@ public:
 	void close(void);
 	// Read next record from file.
 	bool next(MarcRecord &record);
+
+	// Get position in input after last read record.
+	unsigned long long getInputPos(void);
+	// Set position in input (at start of record, data before first
+	// record is parsed again).
+	bool seekInput(unsigned long long inputPos);
+	// Reset state of reading to start new input from input source
+	// (XML parser is reused).
+	bool reset(void);
 };
 
 } // namespace marcrecord
@@ -33,6 +33,17 @@
 #include "marcrecord_tools.h"
 #include "marcxml_writer.h"
 
+namespace marcrecord {
+
+// Maximal length of escaped character ("&quot;").
+#define XML_ESCAPE_SIZE			6
+// Maximal length of markup of record, field and subfield.
+#define MARCXML_RECORD_MARKUP_SIZE	64
+#define MARCXML_FIELD_MARKUP_SIZE	64
+#define MARCXML_SUBFIELD_MARKUP_SIZE	48
+
+} // namespace marcrecord
+
 using namespace marcrecord;
 
 /*
@@ -42,7 +53,6 @@ MarcXmlWriter::MarcXmlWriter(FILE *outputFile, const char *outputEncoding)
 	: MarcWriter()
 {
 	// Clear member variables.
-	m_iconvDesc = (iconv_t) -1;
 
 	if (outputFile) {
 		// Open output file.
@@ -75,26 +85,17 @@ MarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
 	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
 
 	// Initialize encoding conversion.
-	if (outputEncoding == NULL
-		|| strcmp(outputEncoding, "UTF-8") == 0
-		|| strcmp(outputEncoding, "utf-8") == 0)
-	{
-		m_iconvDesc = (iconv_t) -1;
-	} else {
-		// Create iconv descriptor for output encoding conversion.
-		m_iconvDesc = iconv_open(outputEncoding, "UTF-8");
-		if (m_iconvDesc == (iconv_t) -1) {
-			m_errorCode = ERROR_ICONV;
-			if (errno == EINVAL) {
-				m_errorMessage =
-					"encoding conversion is not supported";
-			} else {
-				m_errorMessage = "iconv initialization failed";
-			}
-			return false;
+	if (!m_encoder.open(outputEncoding)) {
+		m_errorCode = ERROR_ICONV;
+		if (errno == EINVAL) {
+			m_errorMessage = "encoding conversion is not supported";
+		} else {
+			m_errorMessage = "iconv initialization failed";
 		}
+		return false;
 	}
 
 	return true;
@@ -106,17 +107,17 @@ MarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 MarcXmlWriter::close(void)
 {
-	// Finalize iconv.
-	if (m_iconvDesc != (iconv_t) -1) {
-		iconv_close(m_iconvDesc);
-	}
+	// Write buffered data to output.
+	closeOutput();
+
+	// Finalize encoder.
+	m_encoder.close();
 
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_outputFile = NULL;
 	m_outputEncoding = "";
-	m_iconvDesc = (iconv_t) -1;
 }
 
 /*
@@ -125,81 +126,24 @@ MarcXmlWriter::close(void)
 bool
 MarcXmlWriter::write(MarcRecord &record)
 {
-	std::string recordBuf = "";
-
-	// Append tag '<record>'.
-	recordBuf += "  <record>\n";
-
-	// Append record leader.
-	recordBuf += "    <leader>     "
-		+ std::string((char *) &record.m_leader + 5,
-		(size_t) sizeof(MarcRecord::Leader) - 5)
-		+ "</leader>\n";
+	// Decode raw data of fields.
+	if (!decodeRecord(record)) {
+		return false;
+	}
 
-	// Iterate all fields.
-	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
-		fieldIt != record.m_fieldList.end(); fieldIt++)
+	// Make space for whole record in output buffer.
+	if (!reserveRecord(record.getEscapedSize(XML_ESCAPE_SIZE,
+		MARCXML_FIELD_MARKUP_SIZE, MARCXML_SUBFIELD_MARKUP_SIZE)
+		+ MARCXML_RECORD_MARKUP_SIZE))
 	{
-		std::string xmlData;
-
-		if (fieldIt->m_tag < "010") {
-			// Append control field.
-			xmlData = serialize_xml(fieldIt->m_data);
-			recordBuf += "    <controlfield tag=\""
-				+ fieldIt->m_tag + "\">"
-				+ xmlData + "</controlfield>\n";
-		} else {
-			// Append tag '<datafield>'.
-			recordBuf += "    <datafield tag=\"" + fieldIt->m_tag
-				+ "\" ind1=\"" + fieldIt->m_ind1
-				+ "\" ind2=\"" + fieldIt->m_ind2 + "\">\n";
-
-			// Iterate all subfields.
-			MarcRecord::SubfieldIt subfieldIt =
-				fieldIt->m_subfieldList.begin();
-			for (; subfieldIt != fieldIt->m_subfieldList.end();
-				subfieldIt++)
-			{
-				// Append subfield.
-				xmlData = serialize_xml(subfieldIt->m_data);
-				recordBuf = recordBuf
-					+ "      <subfield code=\""
-					+ subfieldIt->m_id + "\">"
-					+ xmlData + "</subfield>\n";
-			}
-
-			// Append tag '</datafield>'.
-			recordBuf += "    </datafield>\n";
-		}
+		return false;
 	}
 
-	// Append tag '<record>'.
-	recordBuf += "  </record>\n";
-
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write MARCXML record.
-		if (fwrite(recordBuf.c_str(), recordBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write MARCXML record with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, recordBuf, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
+	// Discard partially written record in case of error.
+	markOutput();
+	if (!appendRecord(record)) {
+		rollbackOutput();
+		return false;
 	}
 
 	return true;
@@ -223,30 +167,9 @@ MarcXmlWriter::writeHeader(void)
 
 	header += "<collection xmlns=\"http://www.loc.gov/MARC21/slim\">\n";
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write MARCXML header.
-		if (fwrite(header.c_str(), header.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write MARCXML header with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, header, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
+	// Append MARCXML header to output buffer.
+	if (!appendMarkup(header.c_str())) {
+		return false;
 	}
 
 	return true;
@@ -258,33 +181,80 @@ MarcXmlWriter::writeHeader(void)
 bool
 MarcXmlWriter::writeFooter(void)
 {
-	std::string footer = "</collection>\n";
+	// Append MARCXML footer to output buffer.
+	if (!appendMarkup("</collection>\n")) {
+		return false;
+	}
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write MARCXML footer.
-		if (fwrite(footer.c_str(), footer.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write MARCXML footer with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, footer, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
+	return true;
+}
+
+/*
+ * Append record to output buffer.
+ */
+bool
+MarcXmlWriter::appendRecord(MarcRecord &record)
+{
+	// Append tag '<record>' and record leader.
+	if (!appendMarkup("  <record>\n    <leader>     ")
+		|| !appendEncoded((char *) &record.m_leader + 5,
+			sizeof(MarcRecord::Leader) - 5)
+		|| !appendMarkup("</leader>\n"))
+	{
+		return false;
+	}
+
+	// Iterate all fields.
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		if (fieldIt->m_tag < "010") {
+			// Append control field.
+			if (!appendMarkup("    <controlfield tag=\"")
+				|| !appendEncoded(fieldIt->m_tag)
+				|| !appendMarkup("\">")
+				|| !appendXmlData(fieldIt->m_data)
+				|| !appendMarkup("</controlfield>\n"))
+			{
+				return false;
+			}
+		} else {
+			// Append tag '<datafield>'.
+			if (!appendMarkup("    <datafield tag=\"")
+				|| !appendEncoded(fieldIt->m_tag)
+				|| !appendMarkup("\" ind1=\"")
+				|| !appendEncoded(&fieldIt->m_ind1, 1)
+				|| !appendMarkup("\" ind2=\"")
+				|| !appendEncoded(&fieldIt->m_ind2, 1)
+				|| !appendMarkup("\">\n"))
+			{
+				return false;
+			}
+
+			// Iterate all subfields.
+			MarcRecord::SubfieldIt subfieldIt =
+				fieldIt->m_subfieldList.begin();
+			for (; subfieldIt != fieldIt->m_subfieldList.end();
+				subfieldIt++)
+			{
+				// Append subfield.
+				if (!appendMarkup("      <subfield code=\"")
+					|| !appendEncoded(&subfieldIt->m_id, 1)
+					|| !appendMarkup("\">")
+					|| !appendXmlData(subfieldIt->m_data)
+					|| !appendMarkup("</subfield>\n"))
+				{
+					return false;
+				}
+			}
+
+			// Append tag '</datafield>'.
+			if (!appendMarkup("    </datafield>\n")) {
+				return false;
+			}
 		}
 	}
 
-	return true;
+	// Append tag '</record>'.
+	return appendMarkup("  </record>\n");
 }
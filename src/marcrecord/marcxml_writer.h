@@ -29,7 +29,6 @@
 #ifndef MARCRECORD_MARCXML_WRITER_H
 #define MARCRECORD_MARCXML_WRITER_H
 
-#include <iconv.h>
 #include <string>
 #include "marc_writer.h"
 #include "marcrecord.h"
@@ -40,9 +39,9 @@ namespace marcrecord {
  * MARCXML records writer.
  */
 class MarcXmlWriter : public MarcWriter {
-protected:
-	// Iconv descriptor for output encoding.
-	iconv_t m_iconvDesc;
+private:
+	// Append record to output buffer.
+	bool appendRecord(MarcRecord &record);
 
 public:
 	// Constructor.
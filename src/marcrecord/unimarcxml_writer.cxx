@@ -33,6 +33,18 @@
 #include "marcrecord_tools.h"
 #include "unimarcxml_writer.h"
 
+namespace marcrecord {
+
+// Maximal length of escaped character ("&quot;").
+#define XML_ESCAPE_SIZE			6
+// Maximal length of markup of record, field and subfield (embedded fields
+// are written for subfields).
+#define UNIMARCXML_RECORD_MARKUP_SIZE	64
+#define UNIMARCXML_FIELD_MARKUP_SIZE	128
+#define UNIMARCXML_SUBFIELD_MARKUP_SIZE	128
+
+} // namespace marcrecord
+
 using namespace marcrecord;
 
 /*
@@ -43,7 +55,6 @@ UnimarcXmlWriter::UnimarcXmlWriter(FILE *outputFile,
 	: MarcWriter()
 {
 	// Clear member variables.
-	m_iconvDesc = (iconv_t) -1;
 
 	if (outputFile) {
 		// Open output file.
@@ -76,26 +87,17 @@ UnimarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
 	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
+	openOutput(m_outputFile);
 
 	// Initialize encoding conversion.
-	if (outputEncoding == NULL
-		|| strcmp(outputEncoding, "UTF-8") == 0
-		|| strcmp(outputEncoding, "utf-8") == 0)
-	{
-		m_iconvDesc = (iconv_t) -1;
-	} else {
-		// Create iconv descriptor for output encoding conversion.
-		m_iconvDesc = iconv_open(outputEncoding, "UTF-8");
-		if (m_iconvDesc == (iconv_t) -1) {
-			m_errorCode = ERROR_ICONV;
-			if (errno == EINVAL) {
-				m_errorMessage =
-					"encoding conversion is not supported";
-			} else {
-				m_errorMessage = "iconv initialization failed";
-			}
-			return false;
+	if (!m_encoder.open(outputEncoding)) {
+		m_errorCode = ERROR_ICONV;
+		if (errno == EINVAL) {
+			m_errorMessage = "encoding conversion is not supported";
+		} else {
+			m_errorMessage = "iconv initialization failed";
 		}
+		return false;
 	}
 
 	return true;
@@ -107,17 +109,17 @@ UnimarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 UnimarcXmlWriter::close(void)
 {
-	// Finalize iconv.
-	if (m_iconvDesc != (iconv_t) -1) {
-		iconv_close(m_iconvDesc);
-	}
+	// Write buffered data to output.
+	closeOutput();
+
+	// Finalize encoder.
+	m_encoder.close();
 
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_outputFile = NULL;
 	m_outputEncoding = "";
-	m_iconvDesc = (iconv_t) -1;
 }
 
 /*
@@ -126,62 +128,24 @@ UnimarcXmlWriter::close(void)
 bool
 UnimarcXmlWriter::write(MarcRecord &record)
 {
-	std::string recordBuf = "";
-
-	// Append tag '<record>'.
-	recordBuf += "  <record>\n";
-
-	// Append record leader.
-	recordBuf += "    <leader>     "
-		+ std::string((char *) &record.m_leader + 5,
-		(size_t) sizeof(MarcRecord::Leader) - 5)
-		+ "</leader>\n";
+	// Decode raw data of fields.
+	if (!decodeRecord(record)) {
+		return false;
+	}
 
-	// Iterate all fields.
-	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
-		fieldIt != record.m_fieldList.end(); fieldIt++)
+	// Make space for whole record in output buffer.
+	if (!reserveRecord(record.getEscapedSize(XML_ESCAPE_SIZE,
+		UNIMARCXML_FIELD_MARKUP_SIZE, UNIMARCXML_SUBFIELD_MARKUP_SIZE)
+		+ UNIMARCXML_RECORD_MARKUP_SIZE))
 	{
-		std::string xmlData;
-
-		if (fieldIt->m_tag < "010") {
-			// Append control field.
-			xmlData = serialize_xml(fieldIt->m_data);
-			recordBuf += "    <controlfield tag=\""
-				+ fieldIt->m_tag + "\">"
-				+ xmlData + "</controlfield>\n";
-		} else {
-			// Append data field.
-			appendDataField(recordBuf, fieldIt);
-		}
+		return false;
 	}
 
-	// Append tag '<record>'.
-	recordBuf += "  </record>\n";
-
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write UNIMARCXML record.
-		if (fwrite(recordBuf.c_str(), recordBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write UNIMARCXML record with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, recordBuf, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
+	// Discard partially written record in case of error.
+	markOutput();
+	if (!appendRecord(record)) {
+		rollbackOutput();
+		return false;
 	}
 
 	return true;
@@ -206,30 +170,9 @@ UnimarcXmlWriter::writeHeader(void)
 	header += "<collection xmlns="
 		"\"http://www.rusmarc.ru/shema/UNISlim.xsd\">\n";
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write UNIMARCXML header.
-		if (fwrite(header.c_str(), header.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write UNIMARCXML header with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, header, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
+	// Append UNIMARCXML header to output buffer.
+	if (!appendMarkup(header.c_str())) {
+		return false;
 	}
 
 	return true;
@@ -241,48 +184,72 @@ UnimarcXmlWriter::writeHeader(void)
 bool
 UnimarcXmlWriter::writeFooter(void)
 {
-	std::string footer = "</collection>\n";
+	// Append UNIMARCXML footer to output buffer.
+	if (!appendMarkup("</collection>\n")) {
+		return false;
+	}
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Write UNIMARCXML footer.
-		if (fwrite(footer.c_str(), footer.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
-		}
-	} else {
-		// Write UNIMARCXML footer with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, footer, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
-			return false;
-		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
-			return false;
+	return true;
+}
+
+/*
+ * Append record to output buffer.
+ */
+bool
+UnimarcXmlWriter::appendRecord(MarcRecord &record)
+{
+	// Append tag '<record>' and record leader.
+	if (!appendMarkup("  <record>\n    <leader>     ")
+		|| !appendEncoded((char *) &record.m_leader + 5,
+			sizeof(MarcRecord::Leader) - 5)
+		|| !appendMarkup("</leader>\n"))
+	{
+		return false;
+	}
+
+	// Iterate all fields.
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		if (fieldIt->m_tag < "010") {
+			// Append control field.
+			if (!appendMarkup("    <controlfield tag=\"")
+				|| !appendEncoded(fieldIt->m_tag)
+				|| !appendMarkup("\">")
+				|| !appendXmlData(fieldIt->m_data)
+				|| !appendMarkup("</controlfield>\n"))
+			{
+				return false;
+			}
+		} else {
+			// Append data field.
+			if (!appendDataField(fieldIt)) {
+				return false;
+			}
 		}
 	}
 
-	return true;
+	// Append tag '</record>'.
+	return appendMarkup("  </record>\n");
 }
 
 /*
- * Append data field to UNIMARCXML file to record buffer.
+ * Append data field to output buffer.
  */
-void
-UnimarcXmlWriter::appendDataField(std::string &recordBuf,
-	MarcRecord::FieldIt &fieldIt)
+bool
+UnimarcXmlWriter::appendDataField(MarcRecord::FieldIt &fieldIt)
 {
 	// Append tag '<datafield>'.
-	recordBuf += "    <datafield tag=\"" + fieldIt->m_tag
-		+ "\" ind1=\"" + fieldIt->m_ind1
-		+ "\" ind2=\"" + fieldIt->m_ind2 + "\">\n";
+	if (!appendMarkup("    <datafield tag=\"")
+		|| !appendEncoded(fieldIt->m_tag)
+		|| !appendMarkup("\" ind1=\"")
+		|| !appendEncoded(&fieldIt->m_ind1, 1)
+		|| !appendMarkup("\" ind2=\"")
+		|| !appendEncoded(&fieldIt->m_ind2, 1)
+		|| !appendMarkup("\">\n"))
+	{
+		return false;
+	}
 
 	// Iterate all subfields.
 	MarcRecord::SubfieldIt subfieldIt = fieldIt->m_subfieldList.begin();
@@ -290,65 +257,76 @@ UnimarcXmlWriter::appendDataField(std::string &recordBuf,
 	for (; subfieldIt != fieldIt->m_subfieldList.end();
 		subfieldIt++)
 	{
-		std::string xmlData;
-
 		if (subfieldIt->isEmbedded()) {
 			if (isEmbeddedDataField) {
 				// Append embedded data field footer.
-				recordBuf = recordBuf
-					+ "        </datafield>\n"
-					+ "      </s1>\n";
+				if (!appendMarkup("        </datafield>\n"
+					"      </s1>\n"))
+				{
+					return false;
+				}
 			}
 
 			// Append embedded field header.
 			std::string embeddedTag = subfieldIt->getEmbeddedTag();
 			if (embeddedTag < "010") {
 				// Append embedded control field.
-				std::string embeddedData =
-					subfieldIt->getEmbeddedData();
-				xmlData = serialize_xml(embeddedData);
-				recordBuf = recordBuf
-					+ "      <s1>\n"
-					+ "        <controlfield tag=\""
-					+ embeddedTag + "\">"
-					+ xmlData + "</controlfield>\n"
-					+ "      </s1>\n";
+				if (!appendMarkup("      <s1>\n"
+						"        <controlfield tag=\"")
+					|| !appendEncoded(embeddedTag)
+					|| !appendMarkup("\">")
+					|| !appendXmlData(
+						subfieldIt->getEmbeddedData())
+					|| !appendMarkup("</controlfield>\n"
+						"      </s1>\n"))
+				{
+					return false;
+				}
 				isEmbeddedDataField = false;
 			} else {
-				recordBuf = recordBuf
-					+ "      <s1>\n"
-					+ "        <datafield tag=\""
-					+ embeddedTag
-					+ "\" ind1=\""
-					+ subfieldIt->getEmbeddedInd1()
-					+ "\" ind2=\""
-					+ subfieldIt->getEmbeddedInd2()
-					+ "\">\n";
+				char embeddedInd1 = subfieldIt->getEmbeddedInd1();
+				char embeddedInd2 = subfieldIt->getEmbeddedInd2();
+				if (!appendMarkup("      <s1>\n"
+						"        <datafield tag=\"")
+					|| !appendEncoded(embeddedTag)
+					|| !appendMarkup("\" ind1=\"")
+					|| !appendEncoded(&embeddedInd1, 1)
+					|| !appendMarkup("\" ind2=\"")
+					|| !appendEncoded(&embeddedInd2, 1)
+					|| !appendMarkup("\">\n"))
+				{
+					return false;
+				}
 				isEmbeddedDataField = true;
 			}
 			continue;
 		}
 
 		// Append indent for embedded field.
-		if (isEmbeddedDataField) {
-			recordBuf += "    ";
+		if (isEmbeddedDataField && !appendMarkup("    ")) {
+			return false;
 		}
 
 		// Append subfield.
-		xmlData = serialize_xml(subfieldIt->m_data);
-		recordBuf = recordBuf
-			+ "      <subfield code=\""
-			+ subfieldIt->m_id + "\">"
-			+ xmlData + "</subfield>\n";
+		if (!appendMarkup("      <subfield code=\"")
+			|| !appendEncoded(&subfieldIt->m_id, 1)
+			|| !appendMarkup("\">")
+			|| !appendXmlData(subfieldIt->m_data)
+			|| !appendMarkup("</subfield>\n"))
+		{
+			return false;
+		}
 	}
 
 	// Append embedded data field footer.
 	if (isEmbeddedDataField) {
-		recordBuf = recordBuf
-			+ "        </datafield>\n"
-			+ "      </s1>\n";
+		if (!appendMarkup("        </datafield>\n"
+			"      </s1>\n"))
+		{
+			return false;
+		}
 	}
 
 	// Append tag '</datafield>'.
-	recordBuf += "    </datafield>\n";
+	return appendMarkup("    </datafield>\n");
 }
@@ -29,7 +29,6 @@
 #ifndef MARCRECORD_UNIMARCXML_WRITER_H
 #define MARCRECORD_UNIMARCXML_WRITER_H
 
-#include <iconv.h>
 #include <string>
 #include "marc_writer.h"
 #include "marcrecord.h"
@@ -41,13 +40,10 @@ namespace marcrecord {
  */
 class UnimarcXmlWriter : public MarcWriter {
 private:
-	// Append data field to UNIMARCXML file to record buffer.
-	void appendDataField(std::string &recordBuf,
-		MarcRecord::FieldIt &fieldIt);
-
-protected:
-	// Iconv descriptor for output encoding.
-	iconv_t m_iconvDesc;
+	// Append record to output buffer.
+	bool appendRecord(MarcRecord &record);
+	// Append data field to output buffer.
+	bool appendDataField(MarcRecord::FieldIt &fieldIt);
 
 public:
 	// Constructor.